@@ -1,9 +1,13 @@
 from __future__ import annotations
 
 import queue
+import threading
 import tkinter as tk
 from tkinter import ttk, messagebox
-from typing import Callable, Dict
+from typing import Callable, Dict, List, Optional
+
+HISTORY_SPAN_S = 24 * 3600
+HISTORY_REFRESH_MS = 30000
 
 
 class PlantDashboardGui(tk.Tk):
@@ -24,13 +28,15 @@ class PlantDashboardGui(tk.Tk):
         on_set_min: Callable[[int], None],
         on_set_max: Callable[[int], None],
         on_set_name: Callable[[str], None],
+        on_set_group: Callable[[str], None],
         on_close: Callable[[], None],
+        on_query_history: Optional[Callable[[str, int, int], List]] = None,
     ) -> None:
         super().__init__()
 
         self.title("Plant MQTT Dashboard")
-        self.geometry("560x500")
-        self.minsize(520, 460)
+        self.geometry("560x690")
+        self.minsize(520, 600)
 
         self._event_queue = event_queue
         self._on_request_status = on_request_status
@@ -41,13 +47,22 @@ class PlantDashboardGui(tk.Tk):
         self._on_set_min = on_set_min
         self._on_set_max = on_set_max
         self._on_set_name = on_set_name
+        self._on_set_group = on_set_group
         self._on_close = on_close
+        # Runs on a worker thread: (plant, span_s, buckets) -> points with
+        # .ts and .humidity, already downsampled by the store.
+        self._on_query_history = on_query_history
+        self._history_requests: "queue.Queue[str]" = queue.Queue()
+        self._history_results: "queue.Queue[tuple]" = queue.Queue()
+        self._history_plant = ""
 
         self.connection_var = tk.StringVar(value="Disconnected")
         self.humidity_var = tk.StringVar(value="-")
         self.battery_var = tk.StringVar(value="-")
         self.water_ok_var = tk.StringVar(value="-")
+        self.sensor_var = tk.StringVar(value="-")
         self.timestamp_var = tk.StringVar(value="-")
+        self.device_var = tk.StringVar(value="-")
         self.plant_name_var = tk.StringVar(value="-")
         self.min_var = tk.StringVar(value="-")
         self.max_var = tk.StringVar(value="-")
@@ -58,6 +73,9 @@ class PlantDashboardGui(tk.Tk):
         self._build_ui()
         self.protocol("WM_DELETE_WINDOW", self._handle_close)
         self.after(100, self._drain_events)
+        if self._on_query_history is not None:
+            threading.Thread(target=self._history_worker, daemon=True).start()
+            self.after(HISTORY_REFRESH_MS, self._refresh_history)
 
     def _build_ui(self) -> None:
         root = ttk.Frame(self, padding=12)
@@ -69,10 +87,12 @@ class PlantDashboardGui(tk.Tk):
         rows = [
             ("Connection", self.connection_var),
             ("Timestamp", self.timestamp_var),
+            ("Device", self.device_var),
             ("Plant", self.plant_name_var),
             ("Humidity", self.humidity_var),
             ("Battery", self.battery_var),
             ("Water OK", self.water_ok_var),
+            ("Sensor", self.sensor_var),
             ("Min", self.min_var),
             ("Max", self.max_var),
             ("Deep Sleep", self.deep_sleep_var),
@@ -113,8 +133,19 @@ class PlantDashboardGui(tk.Tk):
         self.name_entry.grid(row=2, column=1, sticky=tk.EW, padx=6)
         ttk.Button(set_frame, text="Set Name", command=self._submit_name).grid(row=2, column=2, padx=4)
 
+        ttk.Label(set_frame, text="Group (empty: none)").grid(row=3, column=0, sticky=tk.W, pady=4)
+        self.group_entry = ttk.Entry(set_frame)
+        self.group_entry.grid(row=3, column=1, sticky=tk.EW, padx=6)
+        ttk.Button(set_frame, text="Set Group", command=self._submit_group).grid(row=3, column=2, padx=4)
+
         set_frame.grid_columnconfigure(1, weight=1)
 
+        if self._on_query_history is not None:
+            history_frame = ttk.LabelFrame(root, text="Humidity (last 24 h)", padding=10)
+            history_frame.pack(fill=tk.X, pady=(12, 0))
+            self.history = tk.Canvas(history_frame, height=90, background="white", highlightthickness=0)
+            self.history.pack(fill=tk.X)
+
         log_frame = ttk.LabelFrame(root, text="Event Log", padding=10)
         log_frame.pack(fill=tk.BOTH, expand=True, pady=(12, 0))
 
@@ -150,10 +181,51 @@ class PlantDashboardGui(tk.Tk):
             return
         self._on_set_name(name)
 
+    def _submit_group(self) -> None:
+        self._on_set_group(self.group_entry.get().strip())
+
     def _handle_close(self) -> None:
         self._on_close()
         self.destroy()
 
+    def _history_worker(self) -> None:
+        # Store queries stay off the Tk thread; only the latest request counts.
+        while True:
+            plant = self._history_requests.get()
+            while not self._history_requests.empty():
+                plant = self._history_requests.get_nowait()
+            try:
+                points = self._on_query_history(plant, HISTORY_SPAN_S, 120)
+            except Exception as exc:
+                points = []
+                self._event_queue.put({"type": "status", "payload": f"history query failed: {exc}"})
+            self._history_results.put((plant, points))
+
+    def _refresh_history(self) -> None:
+        if self._history_plant:
+            self._history_requests.put(self._history_plant)
+        self.after(HISTORY_REFRESH_MS, self._refresh_history)
+
+    def _draw_history(self, points: List) -> None:
+        canvas = self.history
+        canvas.delete("all")
+        width = max(canvas.winfo_width(), 2)
+        height = max(canvas.winfo_height(), 2)
+        values = [(p.ts, p.humidity) for p in points if p.humidity is not None]
+        if len(values) < 2:
+            canvas.create_text(width / 2, height / 2, text="no history yet", fill="gray")
+            return
+
+        t0, t1 = values[0][0], values[-1][0]
+        span = max(t1 - t0, 1)
+        coords = []
+        for t, humidity in values:
+            coords.append((t - t0) / span * (width - 4) + 2)
+            coords.append(height - 2 - humidity / 100.0 * (height - 4))
+        canvas.create_line(*coords, fill="#2a7ab0", width=2)
+        canvas.create_text(4, 2, anchor=tk.NW, text="100%", fill="gray")
+        canvas.create_text(4, height - 2, anchor=tk.SW, text="0%", fill="gray")
+
     def _drain_events(self) -> None:
         while True:
             try:
@@ -162,6 +234,14 @@ class PlantDashboardGui(tk.Tk):
                 break
             self._handle_event(event)
 
+        while True:
+            try:
+                plant, points = self._history_results.get_nowait()
+            except queue.Empty:
+                break
+            if plant == self._history_plant:
+                self._draw_history(points)
+
         self.after(100, self._drain_events)
 
     def _handle_event(self, event: Dict) -> None:
@@ -180,14 +260,20 @@ class PlantDashboardGui(tk.Tk):
         if etype == "telemetry":
             data = event.get("data") or {}
             self.timestamp_var.set(str(data.get("ts", "-")))
+            self.device_var.set(str(event.get("device") or "-"))
             self.plant_name_var.set(str(data.get("plant", "-")))
             self.humidity_var.set(str(data.get("humidity", "-")))
             self.battery_var.set(str(data.get("battery", "-")))
             self.water_ok_var.set(str(data.get("water_ok", "-")))
+            self.sensor_var.set(str(data.get("sensor", "-")))
             self.min_var.set(str(data.get("min", "-")))
             self.max_var.set(str(data.get("max", "-")))
             if "deep_sleep" in data:
                 _apply_deep_sleep(data.get("deep_sleep"))
+            plant = str(data.get("plant", ""))
+            if self._on_query_history is not None and plant and plant != self._history_plant:
+                self._history_plant = plant
+                self._history_requests.put(plant)
             self._append_log("telemetry updated")
             return
 
@@ -202,6 +288,13 @@ class PlantDashboardGui(tk.Tk):
             self._append_log("ack: " + ack_line)
             return
 
+        if etype == "broadcast_ack":
+            line = f"{event.get('command', '?')} to {event.get('target', '?')}: {event.get('ok')}/{event.get('acked')} ok"
+            for device, detail in (event.get("failed") or {}).items():
+                line += f", {device} failed ({detail})"
+            self._append_log("broadcast ack: " + line)
+            return
+
         if etype == "status":
             self._append_log("status: " + str(event.get("payload", "")))
             return
@@ -1,14 +1,195 @@
 from __future__ import annotations
 
 import json
+import re
+import struct
 import threading
 import time
 import uuid
 from dataclasses import dataclass
-from typing import Callable, Dict, Optional
+from typing import Callable, Dict, List, Optional, Tuple
 
 import paho.mqtt.client as mqtt
 
+# Sentinel sent after the pending queue is flushed (firmware MQTT_CMD_END_OF_COMMANDS).
+END_OF_COMMANDS = "end"
+
+# Topic namespace (firmware device_topic.h): root/<device id>/<suffix>, plus
+# root/all/<suffix> for broadcasts and root/group/<name>/<suffix> for groups.
+BROADCAST_TARGET = "all"
+GROUP_LEVEL = "group"
+GROUP_NAME_PATTERN = re.compile(r"[A-Za-z0-9_-]{0,16}")
+# Broadcasts whose acks are still being counted.
+MAX_TRACKED_BROADCASTS = 32
+# Entries per command batch (firmware MQTT_BATCH_MAX_COMMANDS).
+MAX_BATCH_COMMANDS = 8
+# Largest evapotranspiration the firmware accepts (FORECAST_ET_MAX_X10, 0.1 mm/day).
+FORECAST_ET_MAX_MM = 15.0
+
+# Field order of one record in a telemetry batch ("r" array, firmware telemetry_log.h).
+BATCH_RECORD_FIELDS = ("seq", "ts", "raw", "humidity", "battery_mv", "flags", "result")
+BATCH_FLAG_WATER_OK = 0x01
+BATCH_FLAG_FAULT_SHIFT = 1  # bits 1-2: sensor fault class
+BATCH_FLAG_CHANNEL_SHIFT = 5  # bits 5-7: plant channel
+BATCH_RESULT_NONE = 0xFF
+WATERING_RESULTS = (
+    "ok", "partial", "not_needed", "battery_low", "reservoir_low", "too_soon", "sensor_error", "pump_failed",
+)
+# Firmware SensorFault, reported as "sensor" in telemetry.
+SENSOR_FAULTS = ("ok", "disconnected", "noisy", "stuck")
+
+# Binary wire format (firmware wire_format.h). Little-endian, 2 byte header
+# [version, type]; strings are u8 length + UTF-8 bytes.
+WIRE_VERSION = 1
+WIRE_MSG_TELEMETRY = 0x01
+WIRE_MSG_ACK = 0x02
+WIRE_MSG_TELEMETRY_BATCH = 0x03
+WIRE_MSG_COMMAND = 0x10
+WIRE_FLAG_WATER_OK = 0x01
+WIRE_FLAG_DEEP_SLEEP = 0x02
+WIRE_FLAG_FAULT_SHIFT = 2  # bits 2-3: sensor fault class
+_WIRE_TELEMETRY = struct.Struct("<IBBBBB")
+_WIRE_ACK = struct.Struct("<IB")
+_WIRE_BATCH_RECORD = struct.Struct("<IIHHBBB")  # same order as BATCH_RECORD_FIELDS
+
+
+class WireFormatError(ValueError):
+    pass
+
+
+def _wire_read_str(data: bytes, pos: int) -> Tuple[str, int]:
+    if pos >= len(data):
+        raise WireFormatError("truncated string length")
+    end = pos + 1 + data[pos]
+    if end > len(data):
+        raise WireFormatError("truncated string")
+    return data[pos + 1:end].decode("utf-8", errors="replace"), end
+
+
+def _wire_str(text: str) -> bytes:
+    raw = text.encode("utf-8")[:255]
+    return bytes((len(raw),)) + raw
+
+
+def decode_wire_frame(data: bytes) -> Tuple[int, Dict]:
+    """Decode a firmware binary frame into (type, dict shaped like the JSON payload)."""
+    if len(data) < 2:
+        raise WireFormatError("short frame")
+    if data[0] != WIRE_VERSION:
+        raise WireFormatError(f"unsupported wire version {data[0]}")
+    msg_type = data[1]
+    pos = 2
+
+    if msg_type == WIRE_MSG_TELEMETRY:
+        if len(data) < pos + _WIRE_TELEMETRY.size:
+            raise WireFormatError("truncated telemetry")
+        ts, humidity, battery, min_h, max_h, flags = _WIRE_TELEMETRY.unpack_from(data, pos)
+        plant, pos = _wire_read_str(data, pos + _WIRE_TELEMETRY.size)
+        channel = data[pos] if pos < len(data) else 0  # absent before multi-plant firmware
+        return msg_type, {
+            "plant": plant,
+            "ch": channel,
+            "ts": ts,
+            "humidity": humidity,
+            "battery": battery,
+            "water_ok": bool(flags & WIRE_FLAG_WATER_OK),
+            "min": min_h,
+            "max": max_h,
+            "deep_sleep": bool(flags & WIRE_FLAG_DEEP_SLEEP),
+            "sensor": SENSOR_FAULTS[(flags >> WIRE_FLAG_FAULT_SHIFT) & 0x03],
+        }
+
+    if msg_type == WIRE_MSG_ACK:
+        if len(data) < pos + _WIRE_ACK.size:
+            raise WireFormatError("truncated ack")
+        ts, ok = _WIRE_ACK.unpack_from(data, pos)
+        pos += _WIRE_ACK.size
+        plant, pos = _wire_read_str(data, pos)
+        cmd_id, pos = _wire_read_str(data, pos)
+        cmd, pos = _wire_read_str(data, pos)
+        detail, pos = _wire_read_str(data, pos)
+        return msg_type, {"plant": plant, "ts": ts, "id": cmd_id, "cmd": cmd, "ok": bool(ok), "detail": detail}
+
+    if msg_type == WIRE_MSG_TELEMETRY_BATCH:
+        plant, pos = _wire_read_str(data, pos)
+        if pos >= len(data):
+            raise WireFormatError("truncated batch count")
+        count = data[pos]
+        pos += 1
+        if len(data) < pos + count * _WIRE_BATCH_RECORD.size:
+            raise WireFormatError("truncated batch")
+        rows = [list(row) for row in _WIRE_BATCH_RECORD.iter_unpack(data[pos:pos + count * _WIRE_BATCH_RECORD.size])]
+        return msg_type, {"plant": plant, "r": rows}
+
+    raise WireFormatError(f"unknown wire message type 0x{msg_type:02x}")
+
+
+def expand_telemetry_batch(parsed: Optional[Dict]) -> Optional[List[Dict]]:
+    """Turn a telemetry batch (JSON or decoded binary) into telemetry dicts, None if malformed."""
+    if not isinstance(parsed, dict) or not isinstance(parsed.get("r"), list):
+        return None
+
+    plant = parsed.get("plant", "")
+    records = []
+    for row in parsed["r"]:
+        if not isinstance(row, list) or len(row) != len(BATCH_RECORD_FIELDS):
+            continue
+        record = dict(zip(BATCH_RECORD_FIELDS, row))
+        record["seq"] = int(record["seq"])
+        flags = int(record.pop("flags"))
+        result = int(record.pop("result"))
+        data = {
+            "plant": plant,
+            "ch": (flags >> BATCH_FLAG_CHANNEL_SHIFT) & 0x07,
+            "logged": True,
+            **record,
+            "water_ok": bool(flags & BATCH_FLAG_WATER_OK),
+            "sensor": SENSOR_FAULTS[(flags >> BATCH_FLAG_FAULT_SHIFT) & 0x03],
+        }
+        if result != BATCH_RESULT_NONE:
+            data["result"] = WATERING_RESULTS[result] if result < len(WATERING_RESULTS) else result
+        records.append(data)
+    return records
+
+
+def device_topic(topic: str, device: str) -> str:
+    """Insert the device level into a configured topic: plant/cmd -> plant/<device>/cmd."""
+    root, _, suffix = topic.partition("/")
+    return f"{root}/{device}/{suffix}"
+
+
+def group_topic(topic: str, group: str) -> str:
+    root, _, suffix = topic.partition("/")
+    return f"{root}/{GROUP_LEVEL}/{group}/{suffix}"
+
+
+def split_device_topic(topic: str) -> Tuple[str, str]:
+    """(device, suffix) of root/<device>/<suffix>; device is "" for other layouts."""
+    levels = topic.split("/")
+    if len(levels) < 3:
+        return "", "/".join(levels[1:])
+    return levels[1], "/".join(levels[2:])
+
+
+def _topic_suffix(topic: str) -> str:
+    return topic.partition("/")[2]
+
+
+def forecast_command(et_mm: float, rain_pct: int) -> Optional[str]:
+    """ "forecast:<ET in 0.1 mm/day> <rain %>", or None if a value is out of range."""
+    try:
+        et_x10 = round(float(et_mm) * 10)
+        rain = int(rain_pct)
+    except (TypeError, ValueError):
+        return None
+    if not 0 <= et_x10 <= round(FORECAST_ET_MAX_MM * 10) or not 0 <= rain <= 100:
+        return None
+    return f"forecast:{et_x10} {rain}"
+
+
+def encode_wire_command(cmd_id: str, command: str) -> bytes:
+    return bytes((WIRE_VERSION, WIRE_MSG_COMMAND)) + _wire_str(cmd_id) + _wire_str(command)
+
 
 @dataclass
 class MqttConfig:
@@ -21,6 +202,27 @@ class MqttConfig:
     topic_status: str = "plant/status"
     topic_telemetry: str = "plant/telemetry"
     topic_ack: str = "plant/ack"
+    topic_awake: str = "plant/awake"
+    topic_telemetry_batch: str = "plant/telemetry/batch"
+    topic_command_bin: str = "plant/cmd/bin"
+    topic_telemetry_bin: str = "plant/telemetry/bin"
+    topic_ack_bin: str = "plant/ack/bin"
+    topic_telemetry_batch_bin: str = "plant/telemetry/batch/bin"
+    topic_profile: str = "plant/profile"
+    # The topic_* values name root and suffix; devices use root/<device id>/suffix.
+    # Device commands go to device_id (12 hex digits of its MAC). Empty: the
+    # first device heard from, which suits single-device setups.
+    device_id: str = ""
+    # Subscription of the receiver's ingestion client (logic/telemetry_ingest.py);
+    # data topics are recognised by their suffix below it.
+    topic_ingest: str = "plant/#"
+    # "json" or "binary": encoding for outgoing commands. Binary needs firmware
+    # built with MQTT_WIRE_FORMAT other than MQTT_WIRE_JSON.
+    command_wire: str = "json"
+    # Firmware built with MQTT_PERSISTENT_SESSION: the broker queues QoS1
+    # commands while the device sleeps, so each command is published once.
+    # Set False for clean-session firmware to re-send until acked.
+    persistent_session: bool = True
 
 
 class PlantMqttLogic:
@@ -33,14 +235,38 @@ class PlantMqttLogic:
         self,
         config: MqttConfig,
         on_event: Callable[[Dict], None],
+        subscribe_data: bool = True,
     ) -> None:
         self._config = config
         self._on_event = on_event
+        # False when a TelemetryIngest takes the telemetry, batch and profile
+        # topics: this client then only handles commands, acks and status.
+        self._subscribe_data = subscribe_data
         self._stop_event = threading.Event()
         self._connected = False
         self._pending_lock = threading.Lock()
         self._pending_commands: Dict[str, Dict] = {}
+        self._target = config.device_id.strip().lower()
+        # Broadcast / group commands by id: acks per device, summarised once
+        # per retry tick instead of one event per device.
+        self._broadcasts: Dict[str, Dict] = {}
+        self._kinds = {
+            _topic_suffix(topic): kind
+            for topic, kind in (
+                (config.topic_status, "status"),
+                (config.topic_telemetry, "telemetry"),
+                (config.topic_ack, "ack"),
+                (config.topic_awake, "awake"),
+                (config.topic_telemetry_batch, "batch"),
+                (config.topic_telemetry_bin, "wire"),
+                (config.topic_ack_bin, "wire"),
+                (config.topic_telemetry_batch_bin, "wire"),
+                (config.topic_profile, "profile"),
+            )
+        }
         self._retry_thread: Optional[threading.Thread] = None
+        # Highest telemetry log seq seen per plant (batches may be re-sent).
+        self._last_batch_seq: Dict[Tuple[str, str], int] = {}  # (device id, plant)
 
         self._client = mqtt.Client(client_id=self._config.client_id, protocol=mqtt.MQTTv311)
         if self._config.username:
@@ -78,13 +304,39 @@ class PlantMqttLogic:
     def _emit(self, event: Dict) -> None:
         self._on_event(event)
 
+    @property
+    def target(self) -> str:
+        return self._target
+
+    def set_target(self, device: str) -> None:
+        """Send device commands (and commands still pending) to this device id."""
+        self._target = (device or "").strip().lower()
+        self._emit({"type": "status", "payload": f"commands go to device {self._target or '(first heard)'}"})
+
+    def _adopt_device(self, device: str) -> None:
+        if not self._target and device and device != BROADCAST_TARGET:
+            self.set_target(device)
+
     def _on_connect(self, client: mqtt.Client, userdata, flags, rc: int) -> None:
         self._connected = rc == 0
         self._emit({"type": "connection", "connected": self._connected, "rc": rc})
         if self._connected:
-            client.subscribe(self._config.topic_status)
-            client.subscribe(self._config.topic_telemetry)
-            client.subscribe(self._config.topic_ack)
+            topics = [
+                self._config.topic_status,
+                self._config.topic_ack,
+                self._config.topic_awake,
+                self._config.topic_ack_bin,
+            ]
+            if self._subscribe_data:
+                topics += [
+                    self._config.topic_telemetry,
+                    self._config.topic_telemetry_batch,
+                    self._config.topic_telemetry_bin,
+                    self._config.topic_telemetry_batch_bin,
+                    self._config.topic_profile,
+                ]
+            for topic in topics:
+                client.subscribe(device_topic(topic, "+"))
             self._flush_pending(force=True)
 
     def _on_disconnect(self, client: mqtt.Client, userdata, rc: int) -> None:
@@ -92,6 +344,17 @@ class PlantMqttLogic:
         self._emit({"type": "connection", "connected": False, "rc": rc})
 
     def _on_message(self, client: mqtt.Client, userdata, msg: mqtt.MQTTMessage) -> None:
+        topic = msg.topic
+        device, suffix = split_device_topic(topic)
+        kind = self._kinds.get(suffix)
+        if kind is None:
+            return
+        self._adopt_device(device)
+
+        if kind == "wire":
+            self._handle_wire_frame(topic, device, msg.payload)
+            return
+
         payload = msg.payload.decode("utf-8", errors="replace")
         parsed: Optional[Dict] = None
         try:
@@ -99,28 +362,83 @@ class PlantMqttLogic:
         except json.JSONDecodeError:
             parsed = None
 
-        topic = msg.topic
-        if topic == self._config.topic_telemetry:
-            self._emit({"type": "telemetry", "topic": topic, "payload": payload, "data": parsed})
+        if kind == "telemetry":
+            self._emit({"type": "telemetry", "topic": topic, "device": device, "payload": payload, "data": parsed})
+            return
+
+        if kind == "batch":
+            self._handle_telemetry_batch(topic, device, parsed)
+            return
+
+        if kind == "profile":
+            # Wake-cycle profile: span durations and estimated charge
+            self._emit({"type": "profile", "topic": topic, "device": device, "payload": payload, "data": parsed})
             return
 
-        if topic == self._config.topic_ack:
-            self._handle_ack(parsed)
-            self._emit({"type": "ack", "topic": topic, "payload": payload, "data": parsed})
+        if kind == "ack":
+            if not self._handle_ack(device, parsed):
+                self._emit({"type": "ack", "topic": topic, "device": device, "payload": payload, "data": parsed})
             return
 
-        self._emit({"type": "status", "topic": topic, "payload": payload, "data": parsed})
+        if kind == "awake":
+            # Device opened its command window: push everything pending,
+            # then tell it there is nothing more so it can sleep right away.
+            self._flush_pending(force=True)
+            wake = parsed.get("wake", "") if isinstance(parsed, dict) else ""
+            self._publish_end_of_commands(device, str(wake))
+
+        self._emit({"type": "status", "topic": topic, "device": device, "payload": payload, "data": parsed})
+
+    def _handle_wire_frame(self, topic: str, device: str, data: bytes) -> None:
+        """Decode a binary frame and route it like its JSON counterpart."""
+        try:
+            msg_type, parsed = decode_wire_frame(data)
+        except WireFormatError as exc:
+            self._emit({"type": "error", "message": f"Malformed binary frame on {topic}: {exc}"})
+            return
 
-    def _publish_packet(self, payload: str) -> bool:
-        result = self._client.publish(self._config.topic_command, payload, qos=1, retain=False)
+        payload = json.dumps(parsed)
+        if msg_type == WIRE_MSG_TELEMETRY:
+            self._emit({"type": "telemetry", "topic": topic, "device": device, "payload": payload, "data": parsed})
+        elif msg_type == WIRE_MSG_TELEMETRY_BATCH:
+            self._handle_telemetry_batch(topic, device, parsed)
+        elif msg_type == WIRE_MSG_ACK:
+            if not self._handle_ack(device, parsed):
+                self._emit({"type": "ack", "topic": topic, "device": device, "payload": payload, "data": parsed})
+
+    def _binary_commands(self) -> bool:
+        return self._config.command_wire == "binary"
+
+    def _encode_command(self, cmd_id: str, command: str):
+        if self._binary_commands():
+            return encode_wire_command(cmd_id, command)
+        packet = {"id": cmd_id, "cmd": command} if cmd_id else {"cmd": command}
+        return json.dumps(packet, separators=(",", ":"))
+
+    def _command_topic(self) -> str:
+        return self._config.topic_command_bin if self._binary_commands() else self._config.topic_command
+
+    def _publish_packet(self, payload, topic: str) -> bool:
+        result = self._client.publish(topic, payload, qos=1, retain=False)
         if result.rc != mqtt.MQTT_ERR_SUCCESS:
             self._emit({"type": "error", "message": f"Publish failed: rc={result.rc}"})
             return False
         return True
 
+    def _publish_end_of_commands(self, device: str, wake: str) -> None:
+        # Same topic and QoS as commands, so the broker keeps it behind them.
+        # The wake token from the awake marker lets the device ignore a
+        # sentinel the broker queued for an earlier wake.
+        if device:
+            self._publish_packet(self._encode_command(wake, END_OF_COMMANDS), device_topic(self._command_topic(), device))
+
+    @staticmethod
+    def _new_command_id() -> str:
+        return f"{int(time.time() * 1000)}-{uuid.uuid4().hex[:8]}"
+
     def _publish_command(self, command: str, ack_cmd: str) -> None:
-        cmd_id = f"{int(time.time() * 1000)}-{uuid.uuid4().hex[:8]}"
-        packet = json.dumps({"id": cmd_id, "cmd": command}, separators=(",", ":"))
+        cmd_id = self._new_command_id()
+        packet = self._encode_command(cmd_id, command)
 
         with self._pending_lock:
             self._pending_commands[cmd_id] = {
@@ -128,6 +446,7 @@ class PlantMqttLogic:
                 "command": command,
                 "ack_cmd": ack_cmd,
                 "packet": packet,
+                "device": self._target,  # "" = whichever device is heard first
                 "last_sent": 0.0,
                 "retries": 0,
             }
@@ -135,9 +454,72 @@ class PlantMqttLogic:
         self._emit({"type": "status", "payload": f"queued command {command} ({cmd_id})"})
         self._flush_pending(force=True)
 
+    def _publish_batch(self, commands: List[str]) -> None:
+        # Batches are JSON only (binary frames carry one command), so they
+        # use the JSON command topic whatever command_wire says.
+        cmd_id = self._new_command_id()
+        packet = json.dumps({"id": cmd_id, "cmds": commands}, separators=(",", ":"))
+
+        with self._pending_lock:
+            self._pending_commands[cmd_id] = {
+                "id": cmd_id,
+                "command": "; ".join(commands),
+                "commands": list(commands),
+                "ack_cmd": "batch",
+                "packet": packet,
+                "topic": self._config.topic_command,
+                "device": self._target,
+                "last_sent": 0.0,
+                "retries": 0,
+            }
+
+        self._emit({"type": "status", "payload": f"queued batch of {len(commands)} commands ({cmd_id})"})
+        self._flush_pending(force=True)
+
+    def _publish_broadcast(self, command: str, group: str = "") -> None:
+        # Published once: every device's persistent session queues its copy.
+        cmd_id = self._new_command_id()
+        base = self._command_topic()
+        topic = group_topic(base, group) if group else device_topic(base, BROADCAST_TARGET)
+        if not self._publish_packet(self._encode_command(cmd_id, command), topic):
+            return
+
+        with self._pending_lock:
+            self._broadcasts[cmd_id] = {
+                "id": cmd_id,
+                "command": command,
+                "target": f"{GROUP_LEVEL}/{group}" if group else BROADCAST_TARGET,
+                "acks": {},
+                "dirty": False,
+            }
+            while len(self._broadcasts) > MAX_TRACKED_BROADCASTS:
+                self._broadcasts.pop(next(iter(self._broadcasts)))
+        self._emit({"type": "status", "payload": f"sent {command} to {topic} ({cmd_id})"})
+
+    def _emit_broadcast_summaries(self) -> None:
+        summaries = []
+        with self._pending_lock:
+            for item in self._broadcasts.values():
+                if not item["dirty"]:
+                    continue
+                item["dirty"] = False
+                acks = item["acks"]
+                summaries.append({
+                    "type": "broadcast_ack",
+                    "id": item["id"],
+                    "command": item["command"],
+                    "target": item["target"],
+                    "acked": len(acks),
+                    "ok": sum(1 for ack in acks.values() if ack["ok"]),
+                    "failed": {device: ack["detail"] for device, ack in acks.items() if not ack["ok"]},
+                })
+        for summary in summaries:
+            self._emit(summary)
+
     def _retry_pending_loop(self) -> None:
         while not self._stop_event.is_set():
             self._flush_pending(force=False)
+            self._emit_broadcast_summaries()
             time.sleep(1.0)
 
     def _flush_pending(self, force: bool) -> None:
@@ -148,11 +530,17 @@ class PlantMqttLogic:
         to_send = []
         with self._pending_lock:
             for cmd_id, item in self._pending_commands.items():
+                if self._config.persistent_session and int(item.get("retries", 0)) > 0:
+                    continue  # accepted by the broker, delivered on the next wake
                 if force or (now - float(item.get("last_sent", 0.0)) >= 2.0):
                     to_send.append((cmd_id, item.copy()))
 
         for cmd_id, item in to_send:
-            sent = self._publish_packet(str(item.get("packet", "")))
+            device = item.get("device") or self._target
+            if not device:
+                continue  # no device heard from yet
+            topic = item.get("topic") or self._command_topic()
+            sent = self._publish_packet(item.get("packet", ""), device_topic(topic, device))
             if not sent:
                 continue
             with self._pending_lock:
@@ -162,21 +550,48 @@ class PlantMqttLogic:
                 current["last_sent"] = now
                 current["retries"] = int(current.get("retries", 0)) + 1
 
-    def _handle_ack(self, parsed: Optional[Dict]) -> None:
-        if not isinstance(parsed, dict):
+    def _handle_telemetry_batch(self, topic: str, device: str, parsed: Optional[Dict]) -> None:
+        """Expand a logged telemetry batch into one telemetry event per record."""
+        records = expand_telemetry_batch(parsed)
+        if records is None:
+            self._emit({"type": "error", "message": f"Malformed telemetry batch on {topic}"})
             return
 
+        # seq counts per device; devices can share a (default) plant name
+        key = (device, parsed.get("plant", ""))
+        last_seq = self._last_batch_seq.get(key, -1)
+        for data in records:
+            if data["seq"] <= last_seq:
+                continue  # duplicate from a re-sent batch
+            last_seq = data["seq"]
+            self._emit({"type": "telemetry", "topic": topic, "device": device, "payload": json.dumps(data), "data": data})
+
+        self._last_batch_seq[key] = last_seq
+
+    def _handle_ack(self, device: str, parsed: Optional[Dict]) -> bool:
+        """Settle the acked command; True if it belonged to a broadcast (counted, not emitted)."""
+        if not isinstance(parsed, dict):
+            return False
+
         ack_id = parsed.get("id")
         ack_cmd = parsed.get("cmd")
 
         if isinstance(ack_id, str) and ack_id:
             with self._pending_lock:
+                broadcast = self._broadcasts.get(ack_id)
+                if broadcast is not None:
+                    broadcast["acks"][device] = {"ok": bool(parsed.get("ok")), "detail": parsed.get("detail", "")}
+                    broadcast["dirty"] = True
+                    return True
                 removed = self._pending_commands.pop(ack_id, None)
             if removed is not None:
-                return
+                if "commands" in removed:
+                    # A batch ack only carries the entry details; name them.
+                    parsed["cmds"] = removed["commands"]
+                return False
 
         if not isinstance(ack_cmd, str) or not ack_cmd:
-            return
+            return False
 
         # Fallback for older firmware ACK payloads without command id.
         with self._pending_lock:
@@ -187,18 +602,27 @@ class PlantMqttLogic:
                     break
             if pending_id:
                 self._pending_commands.pop(pending_id, None)
+        return False
+
+    @staticmethod
+    def _channel_prefix(channel: int) -> str:
+        # Firmware reads an optional "<digit>/" prefix; no prefix means channel 0.
+        channel = int(channel)
+        if not 0 <= channel <= 9:
+            raise ValueError(f"plant channel out of range: {channel}")
+        return f"{channel}/" if channel else ""
 
     def request_status(self) -> None:
         self._publish_command("status", ack_cmd="status")
 
-    def command_water(self) -> None:
-        self._publish_command("water", ack_cmd="water")
+    def command_water(self, channel: int = 0) -> None:
+        self._publish_command(f"{self._channel_prefix(channel)}water", ack_cmd="water")
 
-    def command_calibrate_wet(self) -> None:
-        self._publish_command("calibrate_wet", ack_cmd="calibrate_wet")
+    def command_calibrate_wet(self, channel: int = 0) -> None:
+        self._publish_command(f"{self._channel_prefix(channel)}calibrate_wet", ack_cmd="calibrate_wet")
 
-    def command_calibrate_dry(self) -> None:
-        self._publish_command("calibrate_dry", ack_cmd="calibrate_dry")
+    def command_calibrate_dry(self, channel: int = 0) -> None:
+        self._publish_command(f"{self._channel_prefix(channel)}calibrate_dry", ack_cmd="calibrate_dry")
 
     def command_toggle_deep_sleep(self) -> None:
         self._publish_command("toggle_sleep", ack_cmd="set_sleep")
@@ -210,13 +634,97 @@ class PlantMqttLogic:
     def request_deep_sleep_status(self) -> None:
         self._publish_command("sleep_status", ack_cmd="set_sleep")
 
-    def set_min_humidity(self, value: int) -> None:
+    def set_min_humidity(self, value: int, channel: int = 0) -> None:
         value = max(0, min(100, int(value)))
-        self._publish_command(f"set_min:{value}", ack_cmd="set_min")
+        self._publish_command(f"{self._channel_prefix(channel)}set_min:{value}", ack_cmd="set_min")
 
-    def set_max_humidity(self, value: int) -> None:
+    def set_max_humidity(self, value: int, channel: int = 0) -> None:
         value = max(0, min(100, int(value)))
-        self._publish_command(f"set_max:{value}", ack_cmd="set_max")
+        self._publish_command(f"{self._channel_prefix(channel)}set_max:{value}", ack_cmd="set_max")
+
+    def command_ota(self, url: str, sha256: str) -> None:
+        """Queue a firmware update; the device downloads it over the next wake(s)."""
+        url = (url or "").strip()
+        sha256 = (sha256 or "").strip().lower()
+        if not url.startswith(("http://", "https://")) or len(sha256) != 64:
+            self._emit({"type": "error", "message": "OTA needs an http(s) URL and a 64 digit SHA-256"})
+            return
+        self._publish_command(f"ota:{url} {sha256}", ack_cmd="ota")
+
+    def set_group(self, group: str) -> None:
+        """Make the target device join a command group ("" leaves it)."""
+        group = (group or "").strip()
+        if not GROUP_NAME_PATTERN.fullmatch(group):
+            self._emit({"type": "error", "message": "Group names are up to 16 letters, digits, '_' or '-'"})
+            return
+        self._publish_command(f"set_group:{group}", ack_cmd="set_group")
+
+    def send_forecast(self, et_mm: float, rain_pct: int, group: Optional[str] = None, broadcast: bool = False) -> None:
+        """
+        Push today's evapotranspiration (mm/day) and rain probability (%) to
+        the target device, a group, or every device (broadcast=True).
+        """
+        command = forecast_command(et_mm, rain_pct)
+        if command is None:
+            self._emit({"type": "error", "message": f"Forecast needs ET 0-{FORECAST_ET_MAX_MM:g} mm/day and rain 0-100 %"})
+            return
+        if broadcast:
+            self._publish_broadcast(command)
+        elif group:
+            self.group_command(group, command)
+        else:
+            self._publish_command(command, ack_cmd="forecast")
+
+    def broadcast_command(self, command: str) -> None:
+        """Send a raw command (e.g. "set_max:70") to every device; acks arrive as broadcast_ack events."""
+        self._publish_broadcast(command)
+
+    def group_command(self, group: str, command: str) -> None:
+        """Send a raw command to the devices that joined group."""
+        group = (group or "").strip()
+        if not group or not GROUP_NAME_PATTERN.fullmatch(group):
+            self._emit({"type": "error", "message": f"Invalid group name: {group!r}"})
+            return
+        self._publish_broadcast(command, group)
+
+    def command_batch(self, commands: List[str]) -> None:
+        """
+        Send several commands in one message, e.g. ["set_min:40", "set_max:70"].
+        The device applies them in order and answers with a single "batch" ack
+        whose detail lists each entry's detail, comma separated.
+        """
+        commands = [str(command).strip() for command in commands if str(command).strip()]
+        if not 0 < len(commands) <= MAX_BATCH_COMMANDS:
+            self._emit({"type": "error", "message": f"A batch takes 1 to {MAX_BATCH_COMMANDS} commands"})
+            return
+        self._publish_batch(commands)
+
+    def apply_settings(
+        self,
+        min_humidity: Optional[int] = None,
+        max_humidity: Optional[int] = None,
+        name: Optional[str] = None,
+        deep_sleep: Optional[bool] = None,
+        group: Optional[str] = None,
+        channel: int = 0,
+    ) -> None:
+        """Provision a device in one round trip; settings left as None are not sent."""
+        prefix = self._channel_prefix(channel)
+        commands = []
+        if min_humidity is not None:
+            commands.append(f"{prefix}set_min:{max(0, min(100, int(min_humidity)))}")
+        if max_humidity is not None:
+            commands.append(f"{prefix}set_max:{max(0, min(100, int(max_humidity)))}")
+        if name is not None and name.strip():
+            commands.append(f"set_name:{name.strip()}")
+        if deep_sleep is not None:
+            commands.append(f"set_sleep:{'on' if deep_sleep else 'off'}")
+        if group is not None:
+            if not GROUP_NAME_PATTERN.fullmatch(group.strip()):
+                self._emit({"type": "error", "message": "Group names are up to 16 letters, digits, '_' or '-'"})
+                return
+            commands.append(f"set_group:{group.strip()}")
+        self.command_batch(commands)
 
     def set_plant_name(self, name: str) -> None:
         cleaned = (name or "").strip()
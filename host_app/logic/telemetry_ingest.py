@@ -0,0 +1,183 @@
+from __future__ import annotations
+
+import asyncio
+import json
+import time
+from concurrent.futures import ThreadPoolExecutor
+from typing import Callable, Dict, List, Optional, Tuple
+
+import paho.mqtt.client as mqtt
+
+from logic.plant_mqtt_logic import (
+    WIRE_MSG_TELEMETRY,
+    WIRE_MSG_TELEMETRY_BATCH,
+    MqttConfig,
+    WireFormatError,
+    decode_wire_frame,
+    expand_telemetry_batch,
+)
+from logic.telemetry_store import PlantTelemetryStore
+
+
+class TelemetryIngest:
+    """Asynchronous telemetry ingestion for the headless receiver.
+
+    The paho network thread only hands (topic, payload) over to the asyncio
+    loop. A consumer task decodes JSON and binary frames (including logged
+    batches), collects the samples and appends them to the store in batches
+    on a single writer thread, so disk writes never stall the MQTT client.
+
+    One wildcard subscription (MqttConfig.topic_ingest) covers every device;
+    a message is routed by the trailing segments of its topic, and the level
+    in front of them (plant/<device id>/telemetry) is stored as device_id.
+    """
+
+    def __init__(
+        self,
+        config: MqttConfig,
+        store: PlantTelemetryStore,
+        on_event: Callable[[Dict], None],
+        batch_size: int = 500,
+        flush_interval_s: float = 1.0,
+    ) -> None:
+        self._config = config
+        self._store = store  # only touched on the writer thread
+        self._on_event = on_event
+        self._batch_size = batch_size
+        self._flush_interval_s = flush_interval_s
+        self._writer = ThreadPoolExecutor(max_workers=1, thread_name_prefix="telemetry-writer")
+        self._routes = self._build_routes()
+
+        self._client = mqtt.Client(client_id=f"{self._config.client_id}-ingest", protocol=mqtt.MQTTv311)
+        if self._config.username:
+            self._client.username_pw_set(self._config.username, self._config.password)
+        self._client.on_connect = self._on_connect
+
+    def _build_routes(self) -> List[Tuple[List[str], str]]:
+        prefix = self._config.topic_ingest.rstrip("#")
+        routes = []
+        for topic, kind in (
+            (self._config.topic_telemetry, "telemetry"),
+            (self._config.topic_telemetry_bin, "wire"),
+            (self._config.topic_telemetry_batch, "batch"),
+            (self._config.topic_telemetry_batch_bin, "wire"),
+            (self._config.topic_profile, "profile"),
+        ):
+            suffix = topic[len(prefix):] if prefix and topic.startswith(prefix) else topic
+            routes.append((suffix.split("/"), kind))
+        # Longest suffix first: telemetry/batch/bin before telemetry/bin
+        routes.sort(key=lambda route: len(route[0]), reverse=True)
+        return routes
+
+    def _route(self, topic: str) -> Tuple[Optional[str], str]:
+        """(kind, device id) of a topic; the id is "" for topics without a device level."""
+        levels = topic.split("/")
+        for suffix, kind in self._routes:
+            if levels[-len(suffix):] == suffix:
+                device = levels[-len(suffix) - 1] if len(levels) > len(suffix) + 1 else ""
+                return kind, device
+        return None, ""
+
+    def _on_connect(self, client: mqtt.Client, userdata, flags, rc: int) -> None:
+        self._on_event({"type": "connection", "connected": rc == 0, "rc": rc, "client": "ingest"})
+        if rc == 0:
+            client.subscribe(self._config.topic_ingest)
+
+    def _decode(self, topic: str, payload: bytes, received_at: float) -> List[Dict]:
+        """Samples carried by one message; profiles and errors become events."""
+        kind, device = self._route(topic)
+        if kind is None:
+            return []
+
+        if kind == "wire":
+            try:
+                msg_type, parsed = decode_wire_frame(payload)
+            except WireFormatError as exc:
+                self._on_event({"type": "error", "message": f"Malformed binary frame on {topic}: {exc}"})
+                return []
+            if msg_type == WIRE_MSG_TELEMETRY:
+                kind = "telemetry"
+            elif msg_type == WIRE_MSG_TELEMETRY_BATCH:
+                kind = "batch"
+            else:
+                return []
+        else:
+            text = payload.decode("utf-8", errors="replace")
+            try:
+                parsed = json.loads(text)
+            except json.JSONDecodeError:
+                parsed = None
+            if kind == "profile":
+                self._on_event({"type": "profile", "topic": topic, "device": device, "payload": text, "data": parsed})
+                return []
+
+        if kind == "batch":
+            samples = expand_telemetry_batch(parsed)
+            if samples is None:
+                self._on_event({"type": "error", "message": f"Malformed telemetry batch on {topic}"})
+                return []
+        elif isinstance(parsed, dict) and parsed.get("plant"):
+            samples = [parsed]
+        else:
+            self._on_event({"type": "error", "message": f"Malformed telemetry on {topic}"})
+            return []
+
+        for sample in samples:
+            sample["received_at"] = received_at
+            if device:
+                sample["device_id"] = device
+        return samples
+
+    async def run_store(self, fn: Callable, *args):
+        """Run fn(store, *args) on the writer thread, after pending appends."""
+        loop = asyncio.get_running_loop()
+        return await loop.run_in_executor(self._writer, fn, self._store, *args)
+
+    async def _flush(self, samples: List[Dict]) -> None:
+        added = await self.run_store(PlantTelemetryStore.append, samples)
+        plants = {(s.get("plant"), s.get("ch", 0)) for s in samples}
+        self._on_event(
+            {"type": "stored", "samples": len(samples), "added": added, "plants": len(plants), "latest": samples[-1]}
+        )
+
+    async def run(self, stop: asyncio.Event) -> None:
+        """Ingest until stop is set, then write what was received and disconnect."""
+        loop = asyncio.get_running_loop()
+        inbox: "asyncio.Queue[Tuple[str, bytes, float]]" = asyncio.Queue()
+
+        def _on_message(client: mqtt.Client, userdata, msg: mqtt.MQTTMessage) -> None:
+            loop.call_soon_threadsafe(inbox.put_nowait, (msg.topic, msg.payload, time.time()))
+
+        self._client.on_message = _on_message
+        try:
+            # Non-blocking connect: paho keeps retrying while the broker is down.
+            self._client.connect_async(self._config.broker_host, self._config.broker_port, keepalive=30)
+            self._client.loop_start()
+        except Exception as exc:
+            self._on_event({"type": "error", "message": f"MQTT ingest start failed: {exc}"})
+            return
+
+        pending: List[Dict] = []
+        deadline = 0.0
+        try:
+            while not stop.is_set() or not inbox.empty():
+                timeout = max(0.0, deadline - loop.time()) if pending else self._flush_interval_s
+                try:
+                    topic, payload, received_at = await asyncio.wait_for(inbox.get(), timeout)
+                except asyncio.TimeoutError:
+                    pass
+                else:
+                    if not pending:
+                        deadline = loop.time() + self._flush_interval_s
+                    pending.extend(self._decode(topic, payload, received_at))
+
+                if pending and (len(pending) >= self._batch_size or loop.time() >= deadline):
+                    await self._flush(pending)
+                    pending = []
+        finally:
+            self._client.loop_stop()
+            self._client.disconnect()
+            if pending:
+                await self._flush(pending)
+            await self.run_store(PlantTelemetryStore.close)
+            self._writer.shutdown(wait=True)
@@ -0,0 +1,229 @@
+from __future__ import annotations
+
+import re
+import sqlite3
+import time
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Dict, Iterable, List, Optional
+
+# Columns of one sample, in insert order. Live telemetry fills battery/min/max,
+# logged batch records fill seq/raw/battery_mv/result; the rest stays NULL.
+SAMPLE_COLUMNS = (
+    "received_at", "ts", "seq", "logged", "humidity", "battery", "battery_mv",
+    "raw", "water_ok", "sensor", "result", "min", "max", "device_id",
+)
+
+_SCHEMA = """
+CREATE TABLE IF NOT EXISTS meta (key TEXT PRIMARY KEY, value TEXT NOT NULL);
+CREATE TABLE IF NOT EXISTS samples (
+    received_at REAL NOT NULL,
+    ts          INTEGER,
+    seq         INTEGER,
+    logged      INTEGER NOT NULL DEFAULT 0,
+    humidity    INTEGER,
+    battery     INTEGER,
+    battery_mv  INTEGER,
+    raw         INTEGER,
+    water_ok    INTEGER,
+    sensor      TEXT,
+    result      TEXT,
+    min         INTEGER,
+    max         INTEGER,
+    -- seq counts per device: unnamed devices share a plant name (and store)
+    device_id   TEXT NOT NULL DEFAULT '',
+    UNIQUE (device_id, seq)
+);
+CREATE INDEX IF NOT EXISTS samples_ts ON samples (ts);
+"""
+
+# Stores created before device_id had seq UNIQUE on its own: rebuild the
+# table, crediting the old rows to the device id in meta.
+_MIGRATE_DEVICE_ID = """
+ALTER TABLE samples RENAME TO samples_old;
+DROP INDEX IF EXISTS samples_ts;
+{schema}
+INSERT OR IGNORE INTO samples ({columns}, device_id)
+    SELECT {columns}, COALESCE((SELECT value FROM meta WHERE key = 'device_id'), '') FROM samples_old;
+DROP TABLE samples_old;
+"""
+
+_INSERT = (
+    f"INSERT OR IGNORE INTO samples ({', '.join(SAMPLE_COLUMNS)}) "
+    f"VALUES ({', '.join('?' for _ in SAMPLE_COLUMNS)})"
+)
+
+
+def slugify_plant_name(name: str) -> str:
+    slug = re.sub(r"[^A-Za-z0-9._-]+", "_", name.strip())
+    slug = slug.strip("._-")
+    return slug or "unknown_plant"
+
+
+def plant_store_name(plant: str, channel: int = 0) -> str:
+    # Channel 0 keeps the device name; further pots of a multi-plant
+    # controller get their own store.
+    channel = channel if isinstance(channel, int) else 0
+    return f"{plant}-{channel}" if channel > 0 else plant
+
+
+@dataclass
+class HistoryPoint:
+    """One downsampled bucket of a plant's history."""
+
+    ts: int  # device persistent time (s) of the first sample in the bucket
+    humidity: Optional[float]
+    humidity_min: Optional[int]
+    humidity_max: Optional[int]
+    battery_mv: Optional[float]
+    samples: int
+
+
+class PlantTelemetryStore:
+    """Append-only telemetry history, one SQLite database per plant.
+
+    Databases run in WAL mode, so the receiver keeps appending while the
+    dashboard reads. Re-sent telemetry log records are dropped by their
+    device id and seq.
+    Connections are cached per instance: use one instance per thread.
+    """
+
+    def __init__(self, base_dir: Path) -> None:
+        self._dir = Path(base_dir) / "plants"
+        self._connections: Dict[str, sqlite3.Connection] = {}
+
+    def _path(self, plant: str) -> Path:
+        return self._dir / f"{slugify_plant_name(plant)}.db"
+
+    def _connect(self, plant: str, create: bool) -> Optional[sqlite3.Connection]:
+        path = self._path(plant)
+        conn = self._connections.get(path.name)
+        if conn is not None:
+            return conn
+        if not create and not path.exists():
+            return None
+
+        self._dir.mkdir(parents=True, exist_ok=True)
+        conn = sqlite3.connect(str(path))
+        conn.execute("PRAGMA journal_mode=WAL")
+        conn.execute("PRAGMA synchronous=NORMAL")  # WAL keeps this crash-safe
+        conn.executescript(_SCHEMA)
+        columns = [row[1] for row in conn.execute("PRAGMA table_info(samples)")]
+        if "device_id" not in columns:
+            conn.executescript(
+                _MIGRATE_DEVICE_ID.format(schema=_SCHEMA, columns=", ".join(SAMPLE_COLUMNS[:-1]))
+            )
+        self._connections[path.name] = conn
+        return conn
+
+    def close(self) -> None:
+        for conn in self._connections.values():
+            conn.close()
+        self._connections.clear()
+
+    def append(self, samples: Iterable[Dict]) -> int:
+        """Insert telemetry dicts (event "data"), one transaction per plant. Returns rows added."""
+        by_plant: Dict[str, List[tuple]] = {}
+        device: Dict[str, tuple] = {}
+        device_ids: Dict[str, str] = {}
+        now = time.time()
+        for data in samples:
+            plant = str(data.get("plant", "")).strip()
+            if not plant:
+                continue
+            channel = data.get("ch", 0)
+            name = plant_store_name(plant, channel)
+            device[name] = (plant, channel)
+            if data.get("device_id"):
+                device_ids[name] = str(data["device_id"])
+            row = dict(data)
+            row.setdefault("received_at", now)
+            row["logged"] = bool(row.get("logged"))
+            row["device_id"] = str(row.get("device_id") or "")
+            by_plant.setdefault(name, []).append(tuple(row.get(col) for col in SAMPLE_COLUMNS))
+
+        added = 0
+        for name, rows in by_plant.items():
+            conn = self._connect(name, create=True)
+            plant, channel = device[name]
+            with conn:
+                before = conn.total_changes
+                conn.executemany(_INSERT, rows)
+                added += conn.total_changes - before
+                conn.executemany(
+                    "INSERT OR REPLACE INTO meta (key, value) VALUES (?, ?)",
+                    (("plant", name), ("device", plant), ("channel", str(channel))),
+                )
+                if name in device_ids:
+                    conn.execute(
+                        "INSERT OR REPLACE INTO meta (key, value) VALUES ('device_id', ?)", (device_ids[name],)
+                    )
+        return added
+
+    def plants(self) -> List[str]:
+        """Names of all plants with a store."""
+        names = []
+        for path in sorted(self._dir.glob("*.db")):
+            meta = self._meta(path.stem)
+            names.append(meta.get("plant", path.stem))
+        return names
+
+    def _meta(self, plant: str) -> Dict[str, str]:
+        conn = self._connect(plant, create=False)
+        if conn is None:
+            return {}
+        return dict(conn.execute("SELECT key, value FROM meta").fetchall())
+
+    def devices(self) -> List[str]:
+        """Distinct device names (a multi-plant controller owns several stores)."""
+        return sorted({self._meta(name).get("device", name) for name in self.plants()})
+
+    def device_name_for_id(self, device_id: str) -> Optional[str]:
+        """Device name last stored for a device id (MAC), None if never seen."""
+        for name in self.plants():
+            meta = self._meta(name)
+            if meta.get("device_id") == device_id:
+                return meta.get("device", name)
+        return None
+
+    def rename_device(self, old: str, new: str) -> None:
+        """Move the history of every store of device old to device new."""
+        for name in self.plants():
+            meta = self._meta(name)
+            if meta.get("device") != old:
+                continue
+            channel = int(meta.get("channel", "0"))
+            source = self._connect(name, create=False)
+            rows = source.execute(f"SELECT {', '.join(SAMPLE_COLUMNS)} FROM samples").fetchall()
+            columns = SAMPLE_COLUMNS[1:]  # received_at stays as is
+            self.append(
+                {"plant": new, "ch": channel, "received_at": row[0], **dict(zip(columns, row[1:]))}
+                for row in rows
+            )
+            source.close()
+            del self._connections[self._path(name).name]
+            for suffix in ("", "-wal", "-shm"):
+                try:
+                    Path(str(self._path(name)) + suffix).unlink(missing_ok=True)
+                except OSError:
+                    pass  # still open elsewhere (e.g. a dashboard on Windows)
+
+    def query_downsampled(self, plant: str, span_s: int, buckets: int) -> List[HistoryPoint]:
+        """
+        The last span_s seconds of a plant's history (relative to its newest
+        sample, on the device clock) averaged into at most buckets points.
+        """
+        conn = self._connect(plant, create=False)
+        if conn is None:
+            return []
+        newest = conn.execute("SELECT MAX(ts) FROM samples").fetchone()[0]
+        if newest is None:
+            return []
+        start = int(newest) - int(span_s)
+        width = max(1, int(span_s) // max(1, int(buckets)))
+        rows = conn.execute(
+            "SELECT MIN(ts), AVG(humidity), MIN(humidity), MAX(humidity), AVG(battery_mv), COUNT(*) "
+            "FROM samples WHERE ts >= ? GROUP BY (ts - ?) / ? ORDER BY 1",
+            (start, start, width),
+        ).fetchall()
+        return [HistoryPoint(*row) for row in rows]
@@ -7,6 +7,7 @@ from pathlib import Path
 
 from gui.plant_dashboard_gui import PlantDashboardGui
 from logic.plant_mqtt_logic import MqttConfig, PlantMqttLogic
+from logic.telemetry_store import PlantTelemetryStore
 
 
 def _read_env_or_raw(raw: dict, env_name: str, raw_key: str, default: str) -> str:
@@ -23,6 +24,13 @@ def _read_env_int_or_raw(raw: dict, env_name: str, raw_key: str, default: int) -
     return int(raw.get(raw_key, default))
 
 
+def _read_env_bool_or_raw(raw: dict, env_name: str, raw_key: str, default: bool) -> bool:
+    value = os.getenv(env_name)
+    if value is not None and value.strip() != "":
+        return value.strip().lower() in ("1", "true", "yes", "on")
+    return bool(raw.get(raw_key, default))
+
+
 def load_config() -> MqttConfig:
     config_path = Path(__file__).with_name("host_config.json")
     raw = {}
@@ -43,6 +51,22 @@ def load_config() -> MqttConfig:
         topic_status=_read_env_or_raw(raw, "PLANT_MQTT_TOPIC_STATUS", "topic_status", "plant/status"),
         topic_telemetry=_read_env_or_raw(raw, "PLANT_MQTT_TOPIC_TELEMETRY", "topic_telemetry", "plant/telemetry"),
         topic_ack=_read_env_or_raw(raw, "PLANT_MQTT_TOPIC_ACK", "topic_ack", "plant/ack"),
+        topic_awake=_read_env_or_raw(raw, "PLANT_MQTT_TOPIC_AWAKE", "topic_awake", "plant/awake"),
+        topic_telemetry_batch=_read_env_or_raw(
+            raw, "PLANT_MQTT_TOPIC_TELEMETRY_BATCH", "topic_telemetry_batch", "plant/telemetry/batch"
+        ),
+        topic_command_bin=_read_env_or_raw(raw, "PLANT_MQTT_TOPIC_COMMAND_BIN", "topic_command_bin", "plant/cmd/bin"),
+        topic_telemetry_bin=_read_env_or_raw(
+            raw, "PLANT_MQTT_TOPIC_TELEMETRY_BIN", "topic_telemetry_bin", "plant/telemetry/bin"
+        ),
+        topic_ack_bin=_read_env_or_raw(raw, "PLANT_MQTT_TOPIC_ACK_BIN", "topic_ack_bin", "plant/ack/bin"),
+        topic_telemetry_batch_bin=_read_env_or_raw(
+            raw, "PLANT_MQTT_TOPIC_TELEMETRY_BATCH_BIN", "topic_telemetry_batch_bin", "plant/telemetry/batch/bin"
+        ),
+        topic_profile=_read_env_or_raw(raw, "PLANT_MQTT_TOPIC_PROFILE", "topic_profile", "plant/profile"),
+        device_id=_read_env_or_raw(raw, "PLANT_MQTT_DEVICE_ID", "device_id", ""),
+        command_wire=_read_env_or_raw(raw, "PLANT_MQTT_COMMAND_WIRE", "command_wire", "json"),
+        persistent_session=_read_env_bool_or_raw(raw, "PLANT_MQTT_PERSISTENT_SESSION", "persistent_session", True),
     )
 
 
@@ -52,6 +76,8 @@ def main() -> None:
     logic = PlantMqttLogic(cfg, on_event=events.put)
     logic.start()
     logic.request_deep_sleep_status()
+    # History written by run_receiver.py; the GUI queries it from its worker thread.
+    store = PlantTelemetryStore(Path(__file__).with_name("data"))
 
     app = PlantDashboardGui(
         event_queue=events,
@@ -63,7 +89,9 @@ def main() -> None:
         on_set_min=logic.set_min_humidity,
         on_set_max=logic.set_max_humidity,
         on_set_name=logic.set_plant_name,
+        on_set_group=logic.set_group,
         on_close=logic.stop,
+        on_query_history=store.query_downsampled,
     )
     app.mainloop()
 
@@ -1,15 +1,22 @@
 from __future__ import annotations
 
+import asyncio
 import json
 import os
-import queue
-import re
 import signal
 import time
 from pathlib import Path
 from typing import Any, Dict
 
 from logic.plant_mqtt_logic import MqttConfig, PlantMqttLogic
+from logic.telemetry_ingest import TelemetryIngest
+from logic.telemetry_store import PlantTelemetryStore
+
+STATUS_REQUEST_INTERVAL_S = 60
+# data/forecast.json ({"et_mm": 4.2, "rain_pct": 20}), written by any weather fetcher,
+# is broadcast to all devices at startup and whenever it changes.
+FORECAST_FILE = "forecast.json"
+FORECAST_POLL_INTERVAL_S = 10
 
 
 def _read_env_or_raw(raw: dict, env_name: str, raw_key: str, default: str) -> str:
@@ -26,6 +33,13 @@ def _read_env_int_or_raw(raw: dict, env_name: str, raw_key: str, default: int) -
     return int(raw.get(raw_key, default))
 
 
+def _read_env_bool_or_raw(raw: dict, env_name: str, raw_key: str, default: bool) -> bool:
+    value = os.getenv(env_name)
+    if value is not None and value.strip() != "":
+        return value.strip().lower() in ("1", "true", "yes", "on")
+    return bool(raw.get(raw_key, default))
+
+
 def load_config() -> MqttConfig:
     config_path = Path(__file__).with_name("host_config.json")
     raw = {}
@@ -46,6 +60,23 @@ def load_config() -> MqttConfig:
         topic_status=_read_env_or_raw(raw, "PLANT_MQTT_TOPIC_STATUS", "topic_status", "plant/status"),
         topic_telemetry=_read_env_or_raw(raw, "PLANT_MQTT_TOPIC_TELEMETRY", "topic_telemetry", "plant/telemetry"),
         topic_ack=_read_env_or_raw(raw, "PLANT_MQTT_TOPIC_ACK", "topic_ack", "plant/ack"),
+        topic_awake=_read_env_or_raw(raw, "PLANT_MQTT_TOPIC_AWAKE", "topic_awake", "plant/awake"),
+        topic_telemetry_batch=_read_env_or_raw(
+            raw, "PLANT_MQTT_TOPIC_TELEMETRY_BATCH", "topic_telemetry_batch", "plant/telemetry/batch"
+        ),
+        topic_command_bin=_read_env_or_raw(raw, "PLANT_MQTT_TOPIC_COMMAND_BIN", "topic_command_bin", "plant/cmd/bin"),
+        topic_telemetry_bin=_read_env_or_raw(
+            raw, "PLANT_MQTT_TOPIC_TELEMETRY_BIN", "topic_telemetry_bin", "plant/telemetry/bin"
+        ),
+        topic_ack_bin=_read_env_or_raw(raw, "PLANT_MQTT_TOPIC_ACK_BIN", "topic_ack_bin", "plant/ack/bin"),
+        topic_telemetry_batch_bin=_read_env_or_raw(
+            raw, "PLANT_MQTT_TOPIC_TELEMETRY_BATCH_BIN", "topic_telemetry_batch_bin", "plant/telemetry/batch/bin"
+        ),
+        topic_profile=_read_env_or_raw(raw, "PLANT_MQTT_TOPIC_PROFILE", "topic_profile", "plant/profile"),
+        topic_ingest=_read_env_or_raw(raw, "PLANT_MQTT_TOPIC_INGEST", "topic_ingest", "plant/#"),
+        device_id=_read_env_or_raw(raw, "PLANT_MQTT_DEVICE_ID", "device_id", ""),
+        command_wire=_read_env_or_raw(raw, "PLANT_MQTT_COMMAND_WIRE", "command_wire", "json"),
+        persistent_session=_read_env_bool_or_raw(raw, "PLANT_MQTT_PERSISTENT_SESSION", "persistent_session", True),
     )
 
 
@@ -58,10 +89,26 @@ def print_event(event: Dict[str, Any]) -> None:
 
     if etype == "connection":
         state = "connected" if event.get("connected") else "disconnected"
-        print(f"[{ts()}] connection {state} rc={event.get('rc')}")
+        client = event.get("client", "control")
+        print(f"[{ts()}] connection {client} {state} rc={event.get('rc')}")
         return
 
-    if etype in ("telemetry", "ack", "status"):
+    if etype == "stored":
+        print(
+            f"[{ts()}] stored {event.get('added')}/{event.get('samples')} samples "
+            f"for {event.get('plants')} plant(s)"
+        )
+        return
+
+    if etype == "broadcast_ack":
+        failed = event.get("failed") or {}
+        line = f"[{ts()}] broadcast_ack {event.get('command')} to {event.get('target')}: {event.get('ok')}/{event.get('acked')} ok"
+        if failed:
+            line += " failed " + ", ".join(f"{device}={detail}" for device, detail in failed.items())
+        print(line)
+        return
+
+    if etype in ("telemetry", "ack", "status", "profile"):
         data = event.get("data")
         if isinstance(data, dict):
             print(f"[{ts()}] {etype} {json.dumps(data, separators=(',', ':'))}")
@@ -76,118 +123,71 @@ def print_event(event: Dict[str, Any]) -> None:
     print(f"[{ts()}] event {event}")
 
 
-def _slugify_plant_name(name: str) -> str:
-    slug = re.sub(r"[^A-Za-z0-9._-]+", "_", name.strip())
-    slug = slug.strip("._-")
-    return slug or "unknown_plant"
-
-
-def _extract_plant_name(event: Dict[str, Any]) -> str:
-    data = event.get("data")
-    if isinstance(data, dict):
-        plant = data.get("plant")
-        if isinstance(plant, str) and plant.strip():
-            return plant.strip()
-
-    payload = event.get("payload")
-    if isinstance(payload, str) and payload.strip().startswith("{"):
-        try:
-            payload_data = json.loads(payload)
-        except json.JSONDecodeError:
-            return ""
-        if isinstance(payload_data, dict):
-            plant = payload_data.get("plant")
-            if isinstance(plant, str) and plant.strip():
-                return plant.strip()
-
-    return ""
-
-
-def _is_plant_data_event(event: Dict[str, Any]) -> bool:
-    if event.get("type") != "telemetry":
-        return False
-
-    data = event.get("data")
-    if not isinstance(data, dict):
-        return False
-
-    plant = data.get("plant")
-    if not isinstance(plant, str) or not plant.strip():
-        return False
-
-    # Telemetry measurements should include at least one value besides plant name.
-    measurement_keys = ("humidity", "ts", "battery", "water_ok", "min", "max")
-    return any(key in data for key in measurement_keys)
-
-
 def _append_jsonl(path: Path, item: Dict[str, Any]) -> None:
     with path.open("a", encoding="utf-8") as f:
         f.write(json.dumps(item, separators=(",", ":"), ensure_ascii=False) + "\n")
 
 
-def _persist_plant_data(base_dir: Path, plant_name: str, envelope: Dict[str, Any]) -> None:
-    plants_dir = base_dir / "plants"
-    plants_dir.mkdir(parents=True, exist_ok=True)
-
-    slug = _slugify_plant_name(plant_name)
-    plant_file = plants_dir / f"{slug}.json"
-
-    if plant_file.exists():
-        try:
-            with plant_file.open("r", encoding="utf-8") as f:
-                plant_payload = json.load(f)
-        except json.JSONDecodeError:
-            plant_payload = {"plant": plant_name, "events": []}
-    else:
-        plant_payload = {"plant": plant_name, "events": []}
-
-    if not isinstance(plant_payload, dict):
-        plant_payload = {"plant": plant_name, "events": []}
-
-    events = plant_payload.get("events")
-    if not isinstance(events, list):
-        events = []
+def _write_latest(base_dir: Path, etype: str, envelope: Dict[str, Any]) -> None:
+    latest_path = base_dir / f"latest_{etype}.json"
+    with latest_path.open("w", encoding="utf-8") as f:
+        json.dump(envelope, f, separators=(",", ":"), ensure_ascii=False)
 
-    plant_payload["plant"] = plant_name
-    plant_payload["updated_at"] = envelope.get("received_at", time.time())
-    events.append(envelope)
-    plant_payload["events"] = events
 
-    with plant_file.open("w", encoding="utf-8") as f:
-        json.dump(plant_payload, f, separators=(",", ":"), ensure_ascii=False)
-
-
-def persist_event(event: Dict[str, Any]) -> None:
-    base_dir = Path(__file__).with_name("data")
+def persist_event(base_dir: Path, event: Dict[str, Any]) -> None:
+    """Store a non-telemetry event; telemetry goes to the per-plant store."""
     base_dir.mkdir(parents=True, exist_ok=True)
 
+    etype = event.get("type")
+    if etype == "stored":
+        # Once per ingest batch instead of once per sample
+        latest = {"type": "telemetry", "data": event.get("latest")}
+        _write_latest(base_dir, "telemetry", {"received_at": time.time(), "event": latest})
+        return
+
     envelope = {
         "received_at": time.time(),
         "event": event,
     }
+    _append_jsonl(base_dir / "events.jsonl", envelope)
 
-    events_path = base_dir / "events.jsonl"
-    if _is_plant_data_event(event):
-        plant_name = _extract_plant_name(event)
-        if plant_name:
-            _persist_plant_data(base_dir, plant_name, envelope)
-        else:
-            _append_jsonl(events_path, envelope)
-    else:
-        _append_jsonl(events_path, envelope)
+    if etype in ("ack", "status", "profile"):
+        _write_latest(base_dir, etype, envelope)
 
-    etype = event.get("type")
-    if etype in ("telemetry", "ack", "status"):
-        latest_path = base_dir / f"latest_{etype}.json"
-        with latest_path.open("w", encoding="utf-8") as f:
-            json.dump(envelope, f, separators=(",", ":"), ensure_ascii=False)
 
-    if etype == "ack":
-        data = event.get("data")
-        if isinstance(data, dict) and data.get("cmd") == "set_name" and bool(data.get("ok")):
-            new_name = data.get("plant")
-            if isinstance(new_name, str) and new_name:
-                migrate_stored_plant_name(base_dir, new_name)
+def renamed_plant(event: Dict[str, Any]) -> str:
+    """New device name from a successful set_name ACK (single or in a batch), empty otherwise."""
+    if event.get("type") != "ack":
+        return ""
+    data = event.get("data")
+    if not isinstance(data, dict):
+        return ""
+    renamed = data.get("cmd") == "set_name" and bool(data.get("ok"))
+    if data.get("cmd") == "batch":
+        # Entry details are listed in order; the host added the commands.
+        details = str(data.get("detail", "")).split(",")
+        for i, command in enumerate(data.get("cmds") or []):
+            if str(command).startswith("set_name:") and i < len(details) and details[i] == "ok":
+                renamed = True
+    new_name = data.get("plant")
+    if renamed and isinstance(new_name, str) and new_name:
+        return new_name
+    return ""
+
+
+def migrate_store_device(store: PlantTelemetryStore, new_name: str, device_id: str = "") -> None:
+    # The ACK topic names the device; its stores carry the id from telemetry.
+    old_name = store.device_name_for_id(device_id) if device_id else None
+    if old_name is not None:
+        if old_name != new_name:
+            store.rename_device(old_name, new_name)
+        return
+    # History recorded before device ids: only a store holding a single
+    # other device can be attributed; with several, history stays under the
+    # names it was recorded with.
+    others = [device for device in store.devices() if device != new_name]
+    if len(others) == 1:
+        store.rename_device(others[0], new_name)
 
 
 def _replace_plant_name_in_obj(obj: Any, new_name: str) -> Any:
@@ -263,96 +263,80 @@ def migrate_stored_plant_name(base_dir: Path, new_name: str) -> None:
         with latest_path.open("w", encoding="utf-8") as f:
             json.dump(item, f, separators=(",", ":"), ensure_ascii=False)
 
-    plants_dir = base_dir / "plants"
-    if not plants_dir.exists():
-        return
 
-    target_path = plants_dir / f"{_slugify_plant_name(new_name)}.json"
-    target_payload: Dict[str, Any] = {"plant": new_name, "events": []}
+async def run(cfg: MqttConfig, base_dir: Path) -> None:
+    loop = asyncio.get_running_loop()
+    stop = asyncio.Event()
+    events: "asyncio.Queue[Dict[str, Any]]" = asyncio.Queue()
 
-    if target_path.exists():
-        try:
-            with target_path.open("r", encoding="utf-8") as f:
-                loaded_target = json.load(f)
-            if isinstance(loaded_target, dict):
-                target_payload = loaded_target
-        except json.JSONDecodeError:
-            pass
+    def _post(event: Dict[str, Any]) -> None:
+        # Called from paho threads and the ingest task alike
+        loop.call_soon_threadsafe(events.put_nowait, event)
 
-    target_events = target_payload.get("events")
-    if not isinstance(target_events, list):
-        target_events = []
+    def _stop_handler(signum, frame) -> None:
+        loop.call_soon_threadsafe(stop.set)
 
-    changed = False
-    for plant_file in plants_dir.glob("*.json"):
-        if plant_file == target_path:
-            continue
+    signal.signal(signal.SIGINT, _stop_handler)
+    signal.signal(signal.SIGTERM, _stop_handler)
 
-        try:
-            with plant_file.open("r", encoding="utf-8") as f:
-                content = json.load(f)
-        except json.JSONDecodeError:
-            continue
+    # Telemetry arrives on the ingest client; this one only runs the command side.
+    logic = PlantMqttLogic(cfg, on_event=_post, subscribe_data=False)
+    ingest = TelemetryIngest(cfg, PlantTelemetryStore(base_dir), on_event=_post)
 
-        if not isinstance(content, dict):
-            continue
+    async def _handle_events() -> None:
+        while not stop.is_set() or not events.empty():
+            try:
+                event = await asyncio.wait_for(events.get(), 0.5)
+            except asyncio.TimeoutError:
+                continue
+            print_event(event)
+            persist_event(base_dir, event)
+            new_name = renamed_plant(event)
+            if new_name:
+                migrate_stored_plant_name(base_dir, new_name)
+                await ingest.run_store(migrate_store_device, new_name, event.get("device", ""))
 
-        content = _replace_plant_name_in_obj(content, new_name)
-        source_events = content.get("events")
-        if isinstance(source_events, list):
-            target_events.extend(source_events)
-            changed = True
+    async def _request_status() -> None:
+        while not stop.is_set():
+            logic.request_status()
+            try:
+                await asyncio.wait_for(stop.wait(), STATUS_REQUEST_INTERVAL_S)
+            except asyncio.TimeoutError:
+                pass
 
-        if plant_file != target_path:
+    async def _push_forecast() -> None:
+        path = base_dir / FORECAST_FILE
+        sent_mtime = None
+        while not stop.is_set():
             try:
-                plant_file.unlink()
+                mtime = path.stat().st_mtime
             except OSError:
+                mtime = None
+            if mtime is not None and mtime != sent_mtime and logic.connected:
+                sent_mtime = mtime
+                try:
+                    with path.open("r", encoding="utf-8") as f:
+                        forecast = json.load(f)
+                    logic.send_forecast(forecast["et_mm"], forecast["rain_pct"], broadcast=True)
+                except (OSError, ValueError, KeyError, TypeError) as exc:
+                    _post({"type": "error", "message": f"Ignoring {FORECAST_FILE}: {exc}"})
+            try:
+                await asyncio.wait_for(stop.wait(), FORECAST_POLL_INTERVAL_S)
+            except asyncio.TimeoutError:
                 pass
 
-    if changed:
-        target_payload["plant"] = new_name
-        target_payload["updated_at"] = time.time()
-        target_payload["events"] = target_events
-        with target_path.open("w", encoding="utf-8") as f:
-            json.dump(target_payload, f, separators=(",", ":"), ensure_ascii=False)
-
-
-def main() -> None:
-    events: "queue.Queue[Dict[str, Any]]" = queue.Queue()
-    cfg = load_config()
-    logic = PlantMqttLogic(cfg, on_event=events.put)
-
-    running = True
-
-    def _stop_handler(signum, frame) -> None:
-        nonlocal running
-        running = False
-
-    signal.signal(signal.SIGINT, _stop_handler)
-    signal.signal(signal.SIGTERM, _stop_handler)
-
     logic.start()
     print(f"[{ts()}] receiver started")
-
-    last_status_request = 0.0
-
     try:
-        while running:
-            now = time.time()
-            if now - last_status_request > 60:
-                logic.request_status()
-                last_status_request = now
-
-            try:
-                event = events.get(timeout=0.5)
-                print_event(event)
-                persist_event(event)
-            except queue.Empty:
-                pass
+        await asyncio.gather(ingest.run(stop), _handle_events(), _request_status(), _push_forecast())
     finally:
         logic.stop()
         print(f"[{ts()}] receiver stopped")
 
 
+def main() -> None:
+    asyncio.run(run(load_config(), Path(__file__).with_name("data")))
+
+
 if __name__ == "__main__":
     main()
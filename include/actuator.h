@@ -0,0 +1,132 @@
+/**
+ * actuator.h - Compile-time watering actuator selection
+ *
+ * Actuator<Backend> is a static policy wrapper: every call resolves at
+ * compile time to the selected backend (pump or stepper), so the hot path
+ * is fully inlined and the unused backend is never referenced.
+ *
+ * The stepper driver (A4988 / DRV8825 / DRV8833) is itself a policy
+ * selected inside motor.cpp from STEPPER_DRIVER_TYPE.
+ *
+ * Volume dosing: the pump converts uL to pump time from its flow
+ * calibration and the present battery voltage; the stepper runs an exact
+ * step count (STEPPER_UL_PER_STEP), independent of voltage and timing.
+ */
+
+#ifndef ACTUATOR_H
+#define ACTUATOR_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "pump.h"
+#include "motor.h"
+#include "battery.h"
+#include "hw_init.h"
+
+// =============================================================================
+// BACKENDS
+// =============================================================================
+
+struct PumpBackend {
+    static constexpr const char *name = "pump";
+    static constexpr uint32_t nominal_ul_per_s = PUMP_FLOW_UL_PER_S;
+    static inline void init()                 { pump_init(); }
+    static inline bool run_timed(uint8_t ch, uint32_t ms) { return pump_run_timed(ch, ms); }
+    static inline bool start(uint8_t ch, uint32_t)        { pump_on(ch); return true; }
+    static inline void stop(uint8_t ch)                   { pump_off(ch); }
+    static inline uint32_t volume_ms(uint32_t ul)         { return pump_volume_ms(ul, battery_read_voltage_mv()); }
+    static inline bool start_ul(uint8_t ch, uint32_t ul, uint32_t *on_ms) { *on_ms = volume_ms(ul); pump_on(ch); return true; }
+    static inline bool dispense_ul(uint8_t ch, uint32_t ul) { return pump_run_timed(ch, volume_ms(ul)); }
+    static inline void emergency_stop()       { pump_emergency_stop(); }
+    static inline bool is_running()           { return pump_is_running(); }
+};
+
+struct StepperBackend {
+    static constexpr const char *name = "stepper";
+    static constexpr uint32_t nominal_ul_per_s = STEPPER_UL_PER_STEP * STEPPER_STEP_HZ;
+    static inline void init()                 { motor_init(); }
+    static inline bool run_timed(uint8_t, uint32_t ms)    { return motor_run_timed(ms); }  // single channel
+    // Step generation blocks, so start() runs the whole pulse and stop() has nothing left to do.
+    static inline bool start(uint8_t, uint32_t ms)        { return motor_run_timed(ms); }
+    static inline void stop(uint8_t)                      {}
+    static inline uint32_t steps_for(uint32_t ul)         { return (ul + STEPPER_UL_PER_STEP / 2U) / STEPPER_UL_PER_STEP; }
+    static inline bool start_ul(uint8_t, uint32_t ul, uint32_t *on_ms) { *on_ms = 0; return dispense_ul(0, ul); }
+    static inline bool dispense_ul(uint8_t, uint32_t ul)  { return motor_run_steps(steps_for(ul), PUMP_MAX_DURATION_MS); }
+    static inline void emergency_stop()       { motor_emergency_stop(); }
+    static inline bool is_running()           { return motor_is_running(); }
+};
+
+// =============================================================================
+// POLICY
+// =============================================================================
+
+template <typename Backend>
+struct Actuator {
+    static constexpr const char *name = Backend::name;
+
+    /** Configure the actuator outputs (off). */
+    static inline void init() { Backend::init(); }
+
+    /** Run channel ch for duration_ms (backend enforces its own safety limit). */
+    static inline bool run_timed(uint8_t ch, uint32_t duration_ms) { return Backend::run_timed(ch, duration_ms); }
+
+    /**
+     * Start a pulse of duration_ms without waiting for it; the caller
+     * calls stop() once the duration has elapsed (and must clamp it to
+     * the safety limit). Blocking backends finish the pulse here.
+     */
+    static inline bool start(uint8_t ch, uint32_t duration_ms) { return Backend::start(ch, duration_ms); }
+    static inline void stop(uint8_t ch) { Backend::stop(ch); }
+
+    /**
+     * Volume delivered by duration_ms at the backend's nominal flow
+     * (calibration voltage / STEPPER_STEP_HZ). The soil model sizes
+     * pulses in these units.
+     */
+    static inline uint32_t ul_for_ms(uint32_t duration_ms) {
+        return (uint32_t)(((uint64_t)Backend::nominal_ul_per_s * duration_ms) / 1000U);
+    }
+
+    /**
+     * Start delivering volume_ul without waiting for it. *on_ms is how
+     * long the caller waits before stop(): pump time at the present
+     * battery voltage, or 0 when the backend blocks until delivered.
+     */
+    static inline bool start_ul(uint8_t ch, uint32_t volume_ul, uint32_t *on_ms) {
+        return Backend::start_ul(ch, volume_ul, on_ms);
+    }
+
+    /** Deliver volume_ml and return when done. */
+    static inline bool dispense_ml(uint8_t ch, uint32_t volume_ml) {
+        return Backend::dispense_ul(ch, volume_ml * 1000U);
+    }
+
+    /** Immediately stop and de-energize. */
+    static inline void emergency_stop() { Backend::emergency_stop(); }
+
+    static inline bool is_running() { return Backend::is_running(); }
+};
+
+#if (ACTUATOR_TYPE == ACTUATOR_TYPE_STEPPER)
+using ActiveActuator = Actuator<StepperBackend>;
+#else
+using ActiveActuator = Actuator<PumpBackend>;
+#endif
+
+// =============================================================================
+// CALL SITES
+// =============================================================================
+
+// The actuator is initialized on first use (hw_init.h); stopping one that
+// was never configured this wake is a no-op.
+static inline void actuator_init()                      { hw_require(HW_ACTUATOR); }
+static inline bool actuator_run_timed(uint8_t ch, uint32_t ms) { hw_require(HW_ACTUATOR); return ActiveActuator::run_timed(ch, ms); }
+static inline bool actuator_start(uint8_t ch, uint32_t ms)     { hw_require(HW_ACTUATOR); return ActiveActuator::start(ch, ms); }
+static inline bool actuator_start_ul(uint8_t ch, uint32_t ul, uint32_t *on_ms) { hw_require(HW_ACTUATOR); return ActiveActuator::start_ul(ch, ul, on_ms); }
+static inline bool actuator_dispense_ml(uint8_t ch, uint32_t ml) { hw_require(HW_ACTUATOR); return ActiveActuator::dispense_ml(ch, ml); }
+static inline uint32_t actuator_ul_for_ms(uint32_t ms)         { return ActiveActuator::ul_for_ms(ms); }
+static inline void actuator_stop(uint8_t ch)                   { if (hw_ready(HW_ACTUATOR)) ActiveActuator::stop(ch); }
+static inline void actuator_emergency_stop()            { if (hw_ready(HW_ACTUATOR)) ActiveActuator::emergency_stop(); }
+static inline bool actuator_is_running()                { return hw_ready(HW_ACTUATOR) && ActiveActuator::is_running(); }
+
+#endif // ACTUATOR_H
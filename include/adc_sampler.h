@@ -0,0 +1,128 @@
+/**
+ * adc_sampler.h - Shared ADC sampling engine interface
+ *
+ * Samples the battery and every plant channel's soil sensor together
+ * through the ESP32 continuous-mode (DMA) ADC driver (adc_continuous on
+ * ESP-IDF 5, adc_digi_* on ESP-IDF 4.4) and reduces each burst to a single
+ * raw value per channel. Falls back to analogRead() bursts when the driver
+ * cannot be set up.
+ *
+ * The driver can also stream every conversion to a sink from a
+ * background task (power_log.h); bursts requested meanwhile are served
+ * from the running stream.
+ */
+
+#ifndef ADC_SAMPLER_H
+#define ADC_SAMPLER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// =============================================================================
+// TYPES
+// =============================================================================
+
+/** ADC inputs handled by the sampler (all are in the same scan pattern). */
+typedef enum {
+    ADC_CH_BATTERY,
+    ADC_CH_SOIL,                                    // soil sensor of plant channel 0
+    ADC_CH_POWER_SENSE = ADC_CH_SOIL + PLANT_CHANNEL_COUNT,  // POWER_LOG_SENSE_PIN, if configured
+    ADC_CH_COUNT = ADC_CH_POWER_SENSE + POWER_LOG_HAS_SENSE
+} AdcChannel;
+
+/** Soil input of plant channel ch (0..PLANT_CHANNEL_COUNT-1). */
+static inline AdcChannel adc_soil_channel(uint8_t ch) {
+    return (AdcChannel)(ADC_CH_SOIL + ch);
+}
+
+/** How a burst of samples is reduced to one value. */
+typedef enum {
+    ADC_REDUCE_MEAN,            // plain average
+    ADC_REDUCE_MEDIAN,          // middle value, rejects single spikes
+    ADC_REDUCE_TRIMMED_MEAN     // average after dropping ADC_SAMPLER_TRIM_PERCENT at each end
+} AdcReduce;
+
+// =============================================================================
+// INITIALIZATION
+// =============================================================================
+
+/**
+ * Configure the ADC for battery + soil sampling.
+ * Call once per wake before any reading.
+ */
+void adc_sampler_init();
+
+/**
+ * ADC1 channel number of a GPIO, as the driver and the SAR registers
+ * number it (the sleep monitor's wake stub reads the registers directly).
+ *
+ * @return false if pin is no ADC1 input or the framework has no ADC driver
+ */
+bool adc_sampler_adc1_channel(gpio_num_t pin, uint8_t *channel);
+
+// =============================================================================
+// READING
+// =============================================================================
+
+/**
+ * Collect a burst for one channel and reduce it.
+ *
+ * @param ch     Channel to read
+ * @param count  Samples to collect (clamped to ADC_SAMPLER_MAX_SAMPLES,
+ *               and to ADC_SAMPLES on the analogRead() fallback)
+ * @param mode   Reduction applied to the burst
+ * @return Reduced raw ADC value (0-4095), 0 if no sample was collected
+ */
+uint16_t adc_sampler_read(AdcChannel ch, uint16_t count, AdcReduce mode);
+
+/**
+ * Collect one burst covering n consecutive channels and reduce each.
+ * With the DMA driver this is a single scan; all channels are sampled
+ * interleaved instead of one burst per channel.
+ *
+ * @param first  First channel of the group
+ * @param n      Number of channels (first + n <= ADC_CH_COUNT)
+ * @param count  Samples per channel (clamped to ADC_SAMPLER_MAX_SAMPLES / n)
+ * @param mode   Reduction applied to each channel
+ * @param out    n reduced values
+ * @param spread Optional: n burst standard deviations (raw counts), a
+ *               noise estimate per channel
+ */
+void adc_sampler_read_group(AdcChannel first, uint8_t n, uint16_t count, AdcReduce mode,
+                            uint16_t *out, uint16_t *spread = nullptr);
+
+/**
+ * Reduce a sample buffer to one value.
+ * MEDIAN / TRIMMED_MEAN sort the buffer in place.
+ *
+ * @return Reduced value, 0 if n == 0
+ */
+uint16_t adc_reduce(uint16_t *samples, uint16_t n, AdcReduce mode);
+
+/**
+ * Sample standard deviation of a burst (raw counts, rounded down).
+ *
+ * @return 0 if n < 2
+ */
+uint16_t adc_spread(const uint16_t *samples, uint16_t n);
+
+// =============================================================================
+// STREAMING
+// =============================================================================
+
+/** Receives every conversion while streaming (stream task context). */
+typedef void (*AdcStreamSink)(AdcChannel ch, uint16_t raw);
+
+/**
+ * Run the DMA driver continuously and hand each conversion of every
+ * channel to sink, ADC_SAMPLER_RATE_HZ in total. Needs the continuous
+ * driver.
+ *
+ * @return false on the analogRead() fallback or if already streaming
+ */
+bool adc_sampler_stream_start(AdcStreamSink sink);
+
+/** Stop streaming; returns once the stream task has finished. */
+void adc_sampler_stream_stop();
+
+#endif // ADC_SAMPLER_H
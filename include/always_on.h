@@ -0,0 +1,32 @@
+/**
+ * always_on.h - Low-power idle for always-on mode
+ *
+ * With deep sleep disabled at runtime the main loop never leaves the app.
+ * Instead of spinning it blocks in always_on_idle() until a button edge,
+ * the next MQTT poll or the next scheduled measurement. Meanwhile:
+ *   - the CPU clock scales between ALWAYS_ON_CPU_MIN/MAX_MHZ
+ *   - FreeRTOS tickless idle enters automatic light sleep
+ *     (ALWAYS_ON_LIGHT_SLEEP); button level triggers wake it
+ *   - WiFi uses modem sleep and only wakes for DTIM beacons, so the MQTT
+ *     link stays up and incoming data is picked up on the next poll
+ */
+
+#ifndef ALWAYS_ON_H
+#define ALWAYS_ON_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * Switch to the always-on power configuration. Idempotent; call from
+ * loop() once deep sleep is known to be disabled.
+ */
+void always_on_enter();
+
+/**
+ * Block until a button edge arrives or max_ms pass. The chip light-sleeps
+ * in between when always_on_enter() could enable it.
+ */
+void always_on_idle(uint32_t max_ms);
+
+#endif // ALWAYS_ON_H
@@ -3,6 +3,12 @@
  * 
  * Reads battery voltage via ADC through voltage divider.
  * Provides threshold checking for warning and critical states.
+ *
+ * Load model (BATTERY_LOAD_AWARE): the resting reading says little about
+ * how far the pack sags once pumps start. The watering scheduler samples
+ * the pack early in every pulse; the drop per running pump is kept as a
+ * per-pack estimate (internal resistance × pump current) and predicts the
+ * loaded voltage of the next pulse before it starts.
  */
 
 #ifndef BATTERY_H
@@ -42,6 +48,43 @@ void battery_init();
  */
 uint16_t battery_read_voltage_mv();
 
+/**
+ * Drop the cached reading so the next call samples the ADC again.
+ * Deep sleep wakes read once per wake; always-on mode calls this (via
+ * measurement_new_cycle()) before each scheduled measurement.
+ */
+void battery_refresh();
+
+/**
+ * Take a fresh resting reading (no pump running) and make it the cached
+ * voltage, so percent and state follow the pack after watering.
+ *
+ * @return Battery voltage in mV
+ */
+uint16_t battery_sample_rest_mv();
+
+// =============================================================================
+// LOAD MODEL
+// =============================================================================
+
+/**
+ * Sample the pack under load and update the drop-per-pump estimate
+ * against the cached resting voltage.
+ *
+ * @param pumps  Pumps running during the sample (0 does nothing)
+ * @return Loaded voltage in mV, 0 if nothing was sampled
+ */
+uint16_t battery_sample_load_mv(uint8_t pumps);
+
+/**
+ * Predicted pack voltage with this many pumps running, from the cached
+ * resting voltage and the drop-per-pump estimate.
+ */
+uint16_t battery_predict_load_mv(uint8_t pumps);
+
+/** Present drop-per-pump estimate in mV (BATTERY_SAG_DEFAULT_MV until measured). */
+uint16_t battery_sag_per_pump_mv();
+
 /**
  * Get current battery state based on voltage thresholds.
  * 
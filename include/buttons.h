@@ -2,7 +2,8 @@
  * buttons.h - Button handling interface
  *
  * Three-layer design:
- *   1. Debounce + raw read
+ *   1. Edge capture (GPIO interrupts, timestamped into a lock-free queue)
+ *      + debounce from the timestamps
  *   2. Press detection (short / long / none per button)
  *   3. Mode-based action dispatch
  */
@@ -59,9 +60,9 @@ void buttons_init(void);
 
 /**
  * Handle button interaction after wake.
- * Runs a polling loop that detects presses, resolves mode,
- * and dispatches actions. Returns when an action fires or
- * the mode timeout is reached.
+ * Runs a loop that blocks on button edges, detects presses,
+ * resolves mode, and dispatches actions. Returns when an action
+ * fires or the mode timeout is reached.
  *
  * @param from_button_wake  true when called right after a
  *        deep-sleep GPIO wake so that a very fast tap that
@@ -69,4 +70,13 @@ void buttons_init(void);
  */
 void buttons_handle_interaction(bool from_button_wake = false);
 
+/** true if button edges are queued (a press started since the last interaction). */
+bool buttons_pending(void);
+
+/**
+ * Block the calling task until a button edge arrives or max_ms pass.
+ * The CPU idles meanwhile; returns at once if edges are queued.
+ */
+void buttons_wait_event(uint32_t max_ms);
+
 #endif // BUTTONS_H
@@ -30,8 +30,33 @@
 #define ACTUATOR_TYPE_PUMP       0
 #define ACTUATOR_TYPE_STEPPER    1
 
-// Select active actuator here.
+// Select active actuator here (or per PlatformIO env via -D ACTUATOR_TYPE=...).
+#ifndef ACTUATOR_TYPE
 #define ACTUATOR_TYPE            ACTUATOR_TYPE_PUMP
+#endif
+
+#if (ACTUATOR_TYPE != ACTUATOR_TYPE_PUMP) && (ACTUATOR_TYPE != ACTUATOR_TYPE_STEPPER)
+#error "Invalid ACTUATOR_TYPE. Use ACTUATOR_TYPE_PUMP or ACTUATOR_TYPE_STEPPER."
+#endif
+
+// =============================================================================
+// PLANT CHANNELS
+// =============================================================================
+// One soil sensor + one pump output per pot, all served from the same wake:
+// sensors are read in one ADC pass and pulses are interleaved so one pot
+// pumps while the others soak. Pins come from PLANT_CHANNELS (wiring.h).
+// Buttons and LEDs always operate on channel 0.
+#ifndef PLANT_CHANNEL_COUNT
+#define PLANT_CHANNEL_COUNT      1
+#endif
+#define PLANT_CHANNEL_MAX        4      // ADC1 inputs left on the ESP32-C3
+
+#if (PLANT_CHANNEL_COUNT < 1) || (PLANT_CHANNEL_COUNT > PLANT_CHANNEL_MAX)
+#error "PLANT_CHANNEL_COUNT must be 1..PLANT_CHANNEL_MAX"
+#endif
+#if (PLANT_CHANNEL_COUNT > 1) && (ACTUATOR_TYPE != ACTUATOR_TYPE_PUMP)
+#error "Multiple plant channels need one pump output per channel (ACTUATOR_TYPE_PUMP)"
+#endif
 
 // =============================================================================
 // CONTROL SOURCE SELECTION
@@ -43,8 +68,26 @@
 #define CONTROL_MODE_MQTT         1
 #define CONTROL_MODE_BOTH         2
 
-// Select control source here.
+// Select control source here (or per PlatformIO env via -D CONTROL_MODE=...).
+#ifndef CONTROL_MODE
 #define CONTROL_MODE              CONTROL_MODE_BUTTONS
+#endif
+
+#if (PLANT_CHANNEL_COUNT > 1) && (CONTROL_MODE != CONTROL_MODE_MQTT)
+#error "Plant channels 1..3 use the button pins, multi-channel builds need CONTROL_MODE_MQTT"
+#endif
+
+#if (CONTROL_MODE == CONTROL_MODE_BUTTONS || CONTROL_MODE == CONTROL_MODE_BOTH)
+#define CONTROL_HAS_BUTTONS 1
+#else
+#define CONTROL_HAS_BUTTONS 0
+#endif
+
+#if (CONTROL_MODE == CONTROL_MODE_MQTT || CONTROL_MODE == CONTROL_MODE_BOTH)
+#define CONTROL_HAS_MQTT 1
+#else
+#define CONTROL_HAS_MQTT 0
+#endif
 
 // =============================================================================
 // MQTT SETTINGS (used when CONTROL_MODE includes MQTT)
@@ -57,17 +100,135 @@
 #define MQTT_BROKER_USER          SECRET_MQTT_BROKER_USER
 #define MQTT_BROKER_PASSWORD      SECRET_MQTT_BROKER_PASSWORD
 
-#define MQTT_CLIENT_ID            "plant-esp32c3"
-#define MQTT_TOPIC_COMMAND        "plant/cmd"
-#define MQTT_TOPIC_STATUS         "plant/status"
-#define MQTT_TOPIC_TELEMETRY      "plant/telemetry"
-#define MQTT_TOPIC_ACK            "plant/ack"
+// Topic namespace (device_topic.h). Every device publishes and listens
+// below MQTT_TOPIC_ROOT/<device id>/, the id being the 12 hex digits of its
+// factory (eFuse) MAC, and also takes commands from:
+//   plant/all/cmd            every device
+//   plant/group/<name>/cmd   devices that joined <name> with set_group
+// The MQTT_TOPIC_* names below are the suffixes after the device level.
+#define MQTT_TOPIC_ROOT           "plant"
+#define MQTT_TOPIC_BROADCAST      "all"
+#define MQTT_TOPIC_GROUP          "group"
+#define MQTT_GROUP_MAX_LEN        16
+#define MQTT_TOPIC_MAX_LEN        64
+#define MQTT_CLIENT_ID_PREFIX     "plant-"   // client id = prefix + device id
+
+#define MQTT_TOPIC_COMMAND        "cmd"
+#define MQTT_TOPIC_STATUS         "status"
+#define MQTT_TOPIC_TELEMETRY      "telemetry"
+#define MQTT_TOPIC_ACK            "ack"
+#define MQTT_TOPIC_AWAKE          "awake"
+#define MQTT_TOPIC_TELEMETRY_BATCH "telemetry/batch"
+#define MQTT_TOPIC_PROFILE        "profile"
+
+// Payload encoding for telemetry / ack / batch publishes (see wire_format.h).
+// MQTT_WIRE_JSON: JSON topics only
+// MQTT_WIRE_BINARY: packed binary frames on the .../bin topics only
+// MQTT_WIRE_BOTH: publish both (host migration)
+// Commands are accepted on both command topics whenever binary is enabled.
+#define MQTT_WIRE_JSON            0
+#define MQTT_WIRE_BINARY          1
+#define MQTT_WIRE_BOTH            2
+#ifndef MQTT_WIRE_FORMAT
+#define MQTT_WIRE_FORMAT          MQTT_WIRE_JSON
+#endif
+
+#if (MQTT_WIRE_FORMAT != MQTT_WIRE_JSON) && (MQTT_WIRE_FORMAT != MQTT_WIRE_BINARY) && \
+    (MQTT_WIRE_FORMAT != MQTT_WIRE_BOTH)
+#error "Invalid MQTT_WIRE_FORMAT. Use MQTT_WIRE_JSON, MQTT_WIRE_BINARY or MQTT_WIRE_BOTH."
+#endif
+
+#define MQTT_TOPIC_COMMAND_BIN         "cmd/bin"
+#define MQTT_TOPIC_TELEMETRY_BIN       "telemetry/bin"
+#define MQTT_TOPIC_ACK_BIN             "ack/bin"
+#define MQTT_TOPIC_TELEMETRY_BATCH_BIN "telemetry/batch/bin"
+
+// Sentinel command the host sends after flushing its queue.
+#define MQTT_CMD_END_OF_COMMANDS  "end"
 
 #define MQTT_PLANT_NAME           "Stirps"
 #define MQTT_PLANT_NAME_MAX_LEN   32
 
+// Persistent session: connect with clean-session off and subscribe to the
+// command topics with MQTT_COMMAND_QOS, so the broker queues commands while
+// the device sleeps and delivers them right after CONNACK. The client id
+// carries the device id, so every device keeps its own session.
+#define MQTT_PERSISTENT_SESSION   1
+#define MQTT_COMMAND_QOS          1
+
 #define MQTT_RECONNECT_MS         5000
-#define MQTT_COMMAND_WINDOW_MS    3000
+#define MQTT_BUFFER_SIZE          1024   // PubSubClient packet buffer (batched telemetry)
+#define MQTT_COMMAND_WINDOW_MS    3000   // Hard upper limit for the command window
+#define MQTT_COMMAND_IDLE_MS      800    // Close window this long after the last message
+
+// Command batches {"id":"..","cmds":["set_min:45","set_name:Fern",...]}:
+// entries run under one id with one combined ack and one telemetry publish.
+#define MQTT_BATCH_MAX_COMMANDS   8
+#define MQTT_BATCH_DETAIL_LEN     96     // combined ack detail, entry details joined by ','
+
+// Fast WiFi reconnect: the last good BSSID/channel is kept in RTC memory
+// across deep sleep and used to join directly on the next wake. A full
+// scan only runs after the fast join failed.
+#define MQTT_WIFI_FAST_JOIN             1
+#define MQTT_WIFI_FAST_JOIN_TIMEOUT_MS  4000
+
+// 1 = also reuse the cached DHCP lease (IP/gateway/DNS) as static config,
+// skipping DHCP on fast join. Only enable with a DHCP reservation on the router.
+#define MQTT_WIFI_REUSE_IP_LEASE        0
+
+// Stack for the background WiFi/MQTT bring-up task (bytes).
+#define MQTT_BRINGUP_TASK_STACK         6144
+
+// =============================================================================
+// CONTROL TRANSPORT (control_link.h)
+// =============================================================================
+// CONTROL_TRANSPORT_WIFI:   join WiFi and talk to the broker directly
+// CONTROL_TRANSPORT_ESPNOW: exchange the same topics as ESP-NOW frames with a
+//                           gateway board (no association, DHCP or TCP per
+//                           wake); telemetry and acks reach the broker through it
+#define CONTROL_TRANSPORT_WIFI    0
+#define CONTROL_TRANSPORT_ESPNOW  1
+#ifndef CONTROL_TRANSPORT
+#define CONTROL_TRANSPORT         CONTROL_TRANSPORT_WIFI
+#endif
+
+// Gateway role (espnow_gateway.h): mains-powered board that stays connected
+// to the broker and bridges ESP-NOW nodes. Runs no plant duties.
+#ifndef GATEWAY_ROLE
+#define GATEWAY_ROLE              0
+#endif
+
+#if (CONTROL_TRANSPORT != CONTROL_TRANSPORT_WIFI) && (CONTROL_TRANSPORT != CONTROL_TRANSPORT_ESPNOW)
+#error "Invalid CONTROL_TRANSPORT. Use CONTROL_TRANSPORT_WIFI or CONTROL_TRANSPORT_ESPNOW."
+#endif
+#if (CONTROL_TRANSPORT == CONTROL_TRANSPORT_ESPNOW) && !CONTROL_HAS_MQTT
+#error "CONTROL_TRANSPORT_ESPNOW carries the MQTT control channel, it needs CONTROL_MODE_MQTT or CONTROL_MODE_BOTH"
+#endif
+#if GATEWAY_ROLE && (!CONTROL_HAS_MQTT || CONTROL_TRANSPORT != CONTROL_TRANSPORT_WIFI)
+#error "GATEWAY_ROLE needs MQTT over CONTROL_TRANSPORT_WIFI"
+#endif
+
+// Optional 16-byte key: unicast frames are then encrypted (ESP-NOW CCMP).
+// Define SECRET_ESPNOW_KEY in secrets.h, identical on nodes and gateway.
+#ifdef SECRET_ESPNOW_KEY
+#define ESPNOW_KEY                SECRET_ESPNOW_KEY
+#endif
+
+#define ESPNOW_MAX_CHANNEL        13
+#define ESPNOW_SCAN_DWELL_MS      30     // Wait for the gateway's hello reply per channel
+#define ESPNOW_SEND_TIMEOUT_MS    50     // Wait for the MAC-layer ack per frame
+#define ESPNOW_SEND_RETRIES       3
+#define ESPNOW_MAX_SEND_FAILS     2      // Lost messages before the node rescans
+#define ESPNOW_KEEPALIVE_MS       MQTT_RECONNECT_MS   // Always-on nodes poll the gateway this often
+#define ESPNOW_RX_QUEUE_LEN       8
+#define ESPNOW_MESSAGE_MAX        MQTT_BUFFER_SIZE    // Largest reassembled message
+
+// Gateway: nodes it tracks (encrypted builds are limited by the radio's
+// encrypted peer table) and commands it holds while the nodes sleep.
+#define ESPNOW_GATEWAY_MAX_NODES  6
+#define ESPNOW_GATEWAY_WINDOW_MS  MQTT_COMMAND_WINDOW_MS  // Forward live commands this long after a node frame
+#define ESPNOW_GATEWAY_QUEUE_LEN  8
+#define ESPNOW_GATEWAY_CMD_MAX    256
 
 // =============================================================================
 // STEPPER DRIVER CONFIG (used only when ACTUATOR_TYPE == ACTUATOR_TYPE_STEPPER)
@@ -99,6 +260,29 @@
 #define STEPPER_STEP_HZ          400    // steps per second while running timed mode
 #endif
 #define STEPPER_DISABLE_WHEN_IDLE 1     // 1=disable driver on motor_off, 0=keep enabled
+#ifndef STEPPER_UL_PER_STEP
+#define STEPPER_UL_PER_STEP      50     // Water per (half) step of the dosing head (uL)
+#endif
+
+// Hardware-timed step generation (0 = legacy busy-wait loop).
+// STEP/DIR drivers: LEDC square wave on PIN_STEPPER_STEP.
+// DRV8833: half-step phases advanced from a self re-arming one-shot esp_timer.
+#ifndef STEPPER_HW_PULSES
+#define STEPPER_HW_PULSES        1
+#endif
+#if (STEPPER_DRIVER_TYPE == STEPPER_DRIVER_DRV8833)
+#define STEPPER_START_HZ         60     // rate at start/end of each run
+#else
+#define STEPPER_START_HZ         100    // rate at start/end of each run (LEDC min ~80 Hz)
+#endif
+#define STEPPER_RAMP_MS          250    // accel / decel time (shortened for short runs)
+#define STEPPER_RAMP_SLICE_MS    10     // step-rate update period during ramps
+#define STEPPER_LEDC_TIMER       LEDC_TIMER_1
+#define STEPPER_LEDC_CHANNEL     LEDC_CHANNEL_2
+
+#if STEPPER_HW_PULSES && (STEPPER_STEP_HZ == 0)
+#error "STEPPER_HW_PULSES requires STEPPER_STEP_HZ > 0"
+#endif
 
 // =============================================================================
 // ADC CONFIGURATION
@@ -107,7 +291,40 @@
 #define ADC_RESOLUTION          12                  // 12-bit (0-4095)
 #define ADC_MAX_VALUE           4095
 #define ADC_ATTENUATION         ADC_11db            // Full 0-3.3V range
-#define ADC_SAMPLES             16                  // Samples to average
+#define ADC_SAMPLES             16                  // Samples per reading (analogRead fallback)
+
+// Continuous (DMA) sampling engine, see adc_sampler.h
+#define ADC_SAMPLER_RATE_HZ      80000   // Conversions/s, shared by soil + battery
+#define ADC_SAMPLER_SAMPLES      64      // Samples per channel per reading
+#define ADC_SAMPLER_MAX_SAMPLES  512     // Burst buffer capacity
+#define ADC_SAMPLER_TRIM_PERCENT 25      // Trimmed mean drops this % at each end
+#define ADC_SAMPLER_TIMEOUT_MS   50      // Give up on a burst after this long
+
+// Reduction per input (ADC_REDUCE_MEAN / _MEDIAN / _TRIMMED_MEAN)
+#define SENSOR_ADC_REDUCE        ADC_REDUCE_TRIMMED_MEAN
+#define BATTERY_ADC_REDUCE       ADC_REDUCE_MEDIAN
+
+// Soil reading robustness (sensor_measure_all): fault classes from the
+// burst noise estimate and wake-to-wake history, then an exponential
+// moving average across wakes (RTC memory)
+#define SENSOR_RAW_MIN             100                     // below: disconnected / shorted
+#define SENSOR_RAW_MAX             (ADC_MAX_VALUE - 100)   // above: disconnected (floating)
+#define SENSOR_NOISE_MAX           60      // Burst std deviation (raw) above which a read is noisy
+#define SENSOR_NOISE_RETRY_SAMPLES ADC_SAMPLER_MAX_SAMPLES   // One longer median burst when noisy
+#define SENSOR_STUCK_DELTA         1       // Raw change per wake at or below this counts as unchanged
+#define SENSOR_STUCK_WAKES         6       // Unchanged, noise-free wakes before the sensor is stuck
+#ifndef SENSOR_EMA_ENABLED
+#define SENSOR_EMA_ENABLED         1
+#endif
+#define SENSOR_EMA_WEIGHT_PCT      50      // Weight of the new reading (1-100)
+#define SENSOR_EMA_RESET_DELTA     90      // Larger jumps (watering) restart the average
+
+// Shared measurement snapshot (measurement.h): older snapshots are retaken
+#define MEASUREMENT_MAX_AGE_MS     60000
+
+#if SENSOR_EMA_ENABLED && (SENSOR_EMA_WEIGHT_PCT < 1 || SENSOR_EMA_WEIGHT_PCT > 100)
+#error "SENSOR_EMA_WEIGHT_PCT must be 1..100"
+#endif
 
 // =============================================================================
 // BATTERY THRESHOLDS (in millivolts)
@@ -123,6 +340,37 @@
 #define BATTERY_CRITICAL_MV     4400    // Disable watering (4 × 1.0V)
 #define BATTERY_EMPTY_MV        4000    // Dead (4 × 1.0V)
 
+// Load-aware pump budget (battery.h). The pack is sampled again
+// BATTERY_LOAD_SAMPLE_MS into every pump pulse, while the motor still
+// draws its spin-up current; the drop against the resting voltage, per
+// running pump, is learned per pack (RTC memory, a power-on starts over).
+// A pulse only starts if the predicted loaded voltage stays
+// BATTERY_LOAD_MARGIN_MV above BATTERY_BROWNOUT_MV; less than
+// BATTERY_LOAD_SHORTEN_MV of headroom halves the pulse. The stepper
+// blocks for its whole move and is not sampled.
+#ifndef BATTERY_LOAD_AWARE
+#define BATTERY_LOAD_AWARE      (ACTUATOR_TYPE == ACTUATOR_TYPE_PUMP)
+#endif
+#define BATTERY_BROWNOUT_MV     3500    // Pack voltage where the 3.3 V rail drops out
+#define BATTERY_LOAD_MARGIN_MV  150     // Kept between predicted dip and brown-out
+#define BATTERY_LOAD_SHORTEN_MV 300     // Less headroom than this halves the pulse
+#define BATTERY_LOAD_SAMPLE_MS  60      // Sample point in the pulse (within the first 200 ms)
+#define BATTERY_LOAD_SAMPLES    16      // Short burst, the sample must stay inside the surge
+#define BATTERY_SAG_DEFAULT_MV  400     // Drop per pump until a pulse was measured
+#define BATTERY_SAG_MAX_MV      2000    // Larger drops are discarded as bad readings
+#define BATTERY_SAG_WEIGHT_PCT  25      // EMA weight of a new measurement
+#define PUMP_LOAD_CURRENT_MA    500     // Pump spin-up current, only to log the pack resistance
+
+#if BATTERY_LOAD_AWARE && (ACTUATOR_TYPE != ACTUATOR_TYPE_PUMP)
+#error "BATTERY_LOAD_AWARE needs ACTUATOR_TYPE_PUMP (the stepper blocks during its move)"
+#endif
+#if BATTERY_LOAD_AWARE && (BATTERY_LOAD_SAMPLE_MS >= 200)
+#error "BATTERY_LOAD_SAMPLE_MS must fall inside the first 200 ms of a pulse"
+#endif
+#if (BATTERY_SAG_WEIGHT_PCT < 1) || (BATTERY_SAG_WEIGHT_PCT > 100)
+#error "BATTERY_SAG_WEIGHT_PCT must be 1..100"
+#endif
+
 // =============================================================================
 // SOIL SENSOR DEFAULTS (raw ADC values, will be overwritten by calibration)
 // =============================================================================
@@ -131,17 +379,76 @@
 #define DEFAULT_SENSOR_DRY      3200    // Raw ADC when sensor is in dry earth
 #define DEFAULT_SENSOR_WET      1400    // Raw ADC when sensor is in water
 
+// Optional non-linear soil curve, applied after the linear dry/wet mapping.
+// Each point maps linear % → reported %; x must start at 0, end at 100 and
+// increase strictly. Expanded once into a 101-entry table at calibration load.
+#define SENSOR_CURVE_ENABLED    0
+
+typedef struct { uint8_t linear; uint8_t percent; } SensorCurvePoint;
+
+static const SensorCurvePoint SENSOR_CURVE[] = {
+	{0,   0},
+	{30,  15},
+	{60,  50},
+	{100, 100},
+};
+
 // =============================================================================
 // WATERING PARAMETERS
 // =============================================================================
 
+#ifndef DEFAULT_MINIMAL_HUMIDITY
 #define DEFAULT_MINIMAL_HUMIDITY    30      // Start watering below this % (0-100)
+#endif
+#ifndef DEFAULT_MAX_HUMIDITY
 #define DEFAULT_MAX_HUMIDITY        80      // Stop watering at this % (0-100)
+#endif
 
+#ifndef PUMP_RUN_DURATION_MS
 #define PUMP_RUN_DURATION_MS        3000    // Pump on time per pulse (3 sec)
+#endif
 #define PUMP_MAX_DURATION_MS        10000   // Absolute safety limit per pulse (10 sec)
+#ifndef SOAK_WAIT_TIME_MS
 #define SOAK_WAIT_TIME_MS           1* 60 *1000   // Wait after each pump pulse for water to soak (1 min)
+#endif
+#ifndef MAX_PUMP_PULSES
 #define MAX_PUMP_PULSES             8       // Max pump pulses per watering cycle
+#endif
+#define PUMP_MAX_CONCURRENT         2       // Pumps allowed on at once (battery OK; 1 at warning)
+#define SOAK_LIGHT_SLEEP            1       // 1=light-sleep during soak waits (radio off only)
+#define SOAK_LIGHT_SLEEP_MIN_MS     50      // Remaining soak below this is a plain delay()
+#define SOAK_POLL_MS                100     // delay() slice while light sleep is not possible
+
+#if (PUMP_MAX_CONCURRENT < 1)
+#error "PUMP_MAX_CONCURRENT must be at least 1"
+#endif
+
+// Volume dosing (actuator_dispense_ml). Calibrate each pump once: run it
+// for 10 s at a known battery voltage and weigh the water. Flow is scaled
+// linearly with the battery voltage; the stepper meters by step count.
+#ifndef PUMP_FLOW_UL_PER_S
+#define PUMP_FLOW_UL_PER_S          15000   // Pump flow at PUMP_FLOW_REF_MV (uL/s)
+#endif
+#ifndef PUMP_FLOW_REF_MV
+#define PUMP_FLOW_REF_MV            3700    // Battery voltage of the flow calibration
+#endif
+#define MANUAL_WATER_ML             45      // Manual / button dose (3 s at calibration flow)
+
+#if (PUMP_FLOW_UL_PER_S < 1) || (PUMP_FLOW_REF_MV < 1) || (STEPPER_UL_PER_STEP < 1)
+#error "PUMP_FLOW_UL_PER_S, PUMP_FLOW_REF_MV and STEPPER_UL_PER_STEP must be positive"
+#endif
+
+// Adaptive pulse sizing / soak (soil_model.h). The model learns gain per
+// pump second and settle time from the readings of each pulse.
+#ifndef SOIL_MODEL_ENABLED
+#define SOIL_MODEL_ENABLED          1
+#endif
+#define SOIL_MODEL_TARGET_PCT       80      // Size a pulse for this % of the remaining gap
+#define SOIL_MODEL_EMA_SHIFT        2       // New observation weight = 1 / (1 << shift)
+#define PUMP_MIN_PULSE_MS           1000    // Shortest model-sized pulse
+#define SOAK_MIN_MS                 10000   // Never soak shorter than this
+#define SOAK_SAMPLE_MS              5000    // Sensor sample period while soaking
+#define SOAK_SETTLE_DELTA           1       // Change (%) between samples counted as settled
 
 // Minimum time between watering cycles (in seconds)
 #define MIN_WATERING_INTERVAL_SEC   (3 * 60 * 60)   // 3 hours
@@ -156,18 +463,162 @@
 ///////////////////////////////////////////////////////////////////////////////////////////
 //CHANGE THISSSSSSSSSSSSSSSSSSS to 0 !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 //!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+#ifndef DEBUG_NO_SLEEP
 #define DEBUG_NO_SLEEP           1
+#endif
 
 // Enable serial debugging output (115200 baud)
-// Set to 1 to enable serial debug messages, 0 for production (saves power)
+// Set to 1 to enable serial debug messages, 0 for production (saves power).
+// Checked with #if: the build profiles in platformio.ini pass 0 or 1.
+#ifndef DEBUG_SERIAL
 #define DEBUG_SERIAL             1
+#endif
+
+#if (DEBUG_SERIAL != 0) && (DEBUG_SERIAL != 1)
+#error "DEBUG_SERIAL must be 0 or 1"
+#endif
 
 // How often to wake and check soil moisture (in seconds)
+#ifndef MEASUREMENT_INTERVAL_SEC
 #define MEASUREMENT_INTERVAL_SEC    (1 * 60 * 60)   // 1 hour
+#endif
 
 // How often to wake and flash LEDs when water or battery is low (in seconds)
 #define ALERT_INTERVAL_SEC          (15 * 60)        // 15 minutes
 
+// Always-on mode (deep sleep disabled at runtime, always_on.h): the loop
+// blocks until a button edge, the next MQTT poll or the next scheduled
+// measurement, with frequency scaling, automatic light sleep and WiFi
+// modem sleep (radio wakes for DTIM beacons) in between.
+#define ALWAYS_ON_POLL_MS           250     // MQTT poll period (command latency bound)
+#define ALWAYS_ON_CPU_MAX_MHZ       160
+#define ALWAYS_ON_CPU_MIN_MHZ       40      // XTAL; lowest the radio allows
+#ifndef ALWAYS_ON_LIGHT_SLEEP
+#if DEBUG_SERIAL
+#define ALWAYS_ON_LIGHT_SLEEP       0       // USB serial drops while the chip sleeps
+#else
+#define ALWAYS_ON_LIGHT_SLEEP       1
+#endif
+#endif
+#define ALWAYS_ON_WIFI_MODEM_SLEEP  1       // 1 = WiFi power save while always on
+
+// Adaptive wake interval (wake_scheduler.h). MEASUREMENT_INTERVAL_SEC is the
+// fallback while there is no usable humidity trend.
+#ifndef WAKE_ADAPTIVE_ENABLED
+#define WAKE_ADAPTIVE_ENABLED       1
+#endif
+#define WAKE_MIN_INTERVAL_SEC       (15 * 60)        // Never wake sooner
+#define WAKE_MAX_INTERVAL_SEC       (8 * 60 * 60)    // Never sleep longer
+#define WAKE_CONFIRM_INTERVAL_SEC   (20 * 60)        // First wake after watering
+#define WAKE_TREND_SAMPLES          6                // Logged readings in the trend fit
+#define WAKE_PREDICT_MARGIN_PCT     25               // Wake this much before the predicted crossing
+#define WAKE_BATTERY_STRETCH_PCT    30               // Below this battery % ...
+#define WAKE_BATTERY_STRETCH_FACTOR 2                // ... multiply the interval by this
+
+#if (WAKE_MIN_INTERVAL_SEC > WAKE_MAX_INTERVAL_SEC)
+#error "WAKE_MIN_INTERVAL_SEC must not exceed WAKE_MAX_INTERVAL_SEC"
+#endif
+
+// Forecast planner (forecast.h). The host pushes "forecast:<ET> <rain %>"
+// once a day (ET = evapotranspiration in 0.1 mm/day). While it is valid,
+// dry soil is left alone if rain is likely (as long as it stays within
+// FORECAST_RAIN_MARGIN_PCT of the minimal humidity), soil predicted to
+// cross the minimal within FORECAST_EARLY_WINDOW_SEC is watered now instead
+// of on an extra wake, and the next wake follows the predicted crossing.
+// Drying per mm ET is learned per channel from readings between waterings.
+#define FORECAST_ENABLED            1
+#define FORECAST_VALID_SEC          (30 * 60 * 60)   // A daily push, plus slack
+#define FORECAST_ET_MAX_X10         150              // Reject ET above 15 mm/day
+#define FORECAST_RAIN_SKIP_PCT      60               // Rain this likely holds watering
+#define FORECAST_RAIN_MARGIN_PCT    10               // ... while this close to the minimal
+#define FORECAST_RAIN_RECHECK_SEC   (3 * 60 * 60)    // Wake interval while holding for rain
+#define FORECAST_EARLY_WINDOW_SEC   (2 * 60 * 60)    // Water now if crossing sooner than this
+#define FORECAST_PCT_PER_MM_X10     30               // Drying until learned: 3.0 % per mm ET
+#define FORECAST_PCT_PER_MM_MAX_X10 300              // Larger samples are discarded
+#define FORECAST_LEARN_MIN_SEC      (2 * 60 * 60)    // Shortest reading interval learned from
+#define FORECAST_LEARN_WEIGHT_PCT   25               // EMA weight of a new sample
+
+#if FORECAST_ENABLED && (FORECAST_LEARN_WEIGHT_PCT < 1 || FORECAST_LEARN_WEIGHT_PCT > 100)
+#error "FORECAST_LEARN_WEIGHT_PCT must be 1..100"
+#endif
+
+// Wake stub monitor (sleep_monitor.h): checks soil and reservoir every
+// slice from the deep sleep wake stub and only boots the app when needed.
+// The stub reads the ADC without calibration; verify the logged wake raw
+// values against sensor readings before relying on it.
+#ifndef SLEEP_MONITOR_ENABLED
+#define SLEEP_MONITOR_ENABLED       0
+#endif
+#define SLEEP_MONITOR_SLICE_SEC     (15 * 60)        // Stub check interval
+#define SLEEP_MONITOR_MARGIN_PCT    3                // Wake this far above minimal humidity
+#define SLEEP_MONITOR_RAW_SLACK     200              // Plausible range beyond calibration
+
+#if SLEEP_MONITOR_ENABLED && (SLEEP_MONITOR_SLICE_SEC < 60)
+#error "SLEEP_MONITOR_SLICE_SEC below 1 minute costs more than full wakes save"
+#endif
+
+// Persistent clock (rtc_clock.h): RTC timer, disciplined by NTP whenever
+// WiFi is already up for MQTT. The drift estimate needs syncs at least
+// CLOCK_DRIFT_MIN_SPAN_SEC apart; NTP is not requested more often than
+// CLOCK_NTP_MIN_INTERVAL_SEC.
+#ifndef CLOCK_NTP_ENABLED
+#define CLOCK_NTP_ENABLED           1
+#endif
+#define CLOCK_NTP_SERVER            "pool.ntp.org"
+#define CLOCK_NTP_MIN_INTERVAL_SEC  (6 * 60 * 60)
+#define CLOCK_DRIFT_MIN_SPAN_SEC    (6 * 60 * 60)
+#define CLOCK_DRIFT_MAX_PPM         100000           // Reject estimates beyond 10 %
+#define CLOCK_DRIFT_EMA_SHIFT       2                // New estimate weight 1/4
+
+#if (CLOCK_DRIFT_MIN_SPAN_SEC < 60 * 60)
+#error "CLOCK_DRIFT_MIN_SPAN_SEC below 1 hour gives a noisy drift estimate"
+#endif
+
+// Wake-cycle profiler (profiler.h): span times per wake, kept for the
+// last PROFILE_HISTORY wakes in RTC memory and published on
+// MQTT_TOPIC_PROFILE. The charge estimate uses these typical supply
+// currents in uA; spans add their current on top of PROFILE_UA_AWAKE,
+// except soak (light sleep), which replaces it.
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED            1
+#endif
+#define PROFILE_HISTORY             8
+#define PROFILE_UA_AWAKE            25000   // CPU at 160 MHz, radio off
+#define PROFILE_UA_SENSOR           2000    // Soil sensor + ADC
+#define PROFILE_UA_BATTERY          500     // Divider + ADC
+#define PROFILE_UA_WIFI_JOIN        80000   // Scan / association
+#define PROFILE_UA_MQTT_CONNECT     60000   // TCP + MQTT handshake
+#define PROFILE_UA_CMD_WINDOW       50000   // Radio listening
+#define PROFILE_UA_PUMP             300000  // One pump running
+#define PROFILE_UA_SOAK_SLEEP       800     // Light sleep, replaces awake current
+
+// Streaming power logger (power_log.h): continuous ADC samples of the
+// battery rail (and an optional current sense input) streamed as packed
+// binary frames over USB CDC for test/power_log/capture_power_log.py.
+// Takes over the serial port; build it into a test environment only.
+#ifndef POWER_LOG_ENABLED
+#define POWER_LOG_ENABLED           0
+#endif
+#ifndef POWER_LOG_RATE_HZ
+#define POWER_LOG_RATE_HZ           2000    // Logged sets per second (decimated)
+#endif
+#define POWER_LOG_FRAME_SETS        32      // Sample sets per frame
+#ifndef POWER_LOG_WHOLE_WAKE
+#define POWER_LOG_WHOLE_WAKE        1       // 1 = log from boot to deep sleep
+#endif
+// Optional current sense amplifier / shunt output on a free ADC1 pin,
+// e.g. -D POWER_LOG_SENSE_PIN=GPIO_NUM_2 (logged in mV at the pin)
+#ifdef POWER_LOG_SENSE_PIN
+#define POWER_LOG_HAS_SENSE         1
+#else
+#define POWER_LOG_HAS_SENSE         0
+#endif
+
+#if POWER_LOG_ENABLED && \
+    (POWER_LOG_RATE_HZ * (PLANT_CHANNEL_COUNT + 1 + POWER_LOG_HAS_SENSE) > ADC_SAMPLER_RATE_HZ)
+#error "POWER_LOG_RATE_HZ exceeds the per-channel ADC_SAMPLER_RATE_HZ"
+#endif
+
 // Conversion factor for deep sleep (microseconds)
 #define SEC_TO_US                   1000000ULL
 
@@ -177,6 +628,7 @@
 // =============================================================================
 
 #define SENSOR_CALIBRATION_TIME_MS  15000   // Default: 15 seconds
+#define SENSOR_CALIBRATION_SAMPLES  ADC_SAMPLER_MAX_SAMPLES   // Samples per calibration burst
 
 // =============================================================================
 // BUTTON TIMING (in milliseconds)
@@ -185,6 +637,7 @@
 #define BTN_DEBOUNCE_MS             50      // Debounce time
 #define BTN_LONG_PRESS_MS           2000    // Long press threshold
 #define MODE_TIMEOUT_MS             8000    // Mode timeout before returning to general
+#define BTN_EDGE_QUEUE_LEN          32      // Buffered button edges (ISR → interaction loop)
 #define HUMIDITY_STEP               5       // Minimal humidity adjustment step (%)
 
 // =============================================================================
@@ -201,6 +654,11 @@
 // --- Number display (humidity / battery percentage) ---
 #define LED_NUMBER_START_MS         100     // Start indicator (both LEDs on)
 
+// --- Asynchronous player (leds.h) ---
+#define LED_QUEUE_LEN               96      // Queued on/off segments
+#define LED_QUEUE_POLL_MS           10      // Wait slice while the queue is full / draining
+#define LED_SLEEP_WAIT_MAX_MS       30000   // Longest wait for lit output before deep sleep
+
 // =============================================================================
 // LED PATTERN SYSTEM
 // =============================================================================
@@ -332,6 +790,68 @@ static const LedStep PAT_NUM_END[] = {
 #define PAT_NUM_END_PAUSE_MS     LED_RAPID
 #define PAT_NUM_END_GAP_MS       PAT_GAP_NONE
 
+// =============================================================================
+// TELEMETRY LOG (see telemetry_log.h)
+// =============================================================================
+
+// Every timer wake appends a 16-byte record to an RTC ring, which is
+// spilled to a raw flash partition when full. WiFi comes up on timer
+// wakes only every TELEMETRY_UPLOAD_EVERY_WAKES to upload the backlog.
+#define TELEMETRY_LOG_ENABLED        1
+#define TELEMETRY_RTC_RECORDS        32        // RTC ring capacity (512 B)
+#define TELEMETRY_FLASH_PARTITION    "spiffs"  // Unused data partition in default.csv
+#define TELEMETRY_FLASH_SECTORS      16        // 16 x 4 KB = 4096 records (~170 days hourly)
+#define TELEMETRY_UPLOAD_EVERY_WAKES 12        // Timer wakes per WiFi upload (1 = every wake)
+#define TELEMETRY_BATCH_RECORDS      24        // Records per MQTT batch message
+
+// =============================================================================
+// COUNTER LOG (see counter_log.h)
+// =============================================================================
+// Boot count, persistent time, watering timestamps, the last command id and
+// the telemetry upload cursor are appended as 128-byte records to a ring of
+// raw flash sectors instead of rewriting NVS. The ring sits in the same
+// unused data partition, right behind the telemetry log's sectors; without
+// room there the values stay in NVS. 4 sectors = 128 appends per erase lap.
+#define COUNTER_LOG_ENABLED          1
+#define COUNTER_LOG_PARTITION        TELEMETRY_FLASH_PARTITION
+#define COUNTER_LOG_FIRST_SECTOR     TELEMETRY_FLASH_SECTORS
+#define COUNTER_LOG_SECTORS          4
+#define COUNTER_LOG_COMMIT_WAKES     1         // Replaces STORAGE_COUNTER_COMMIT_WAKES while the log works
+
+#if COUNTER_LOG_ENABLED && (COUNTER_LOG_SECTORS < 2)
+#error "COUNTER_LOG_SECTORS must be at least 2 (a sector is erased while the other holds the newest record)"
+#endif
+
+// =============================================================================
+// OTA FIRMWARE UPDATES (ota_update.h)
+// =============================================================================
+// The MQTT command "ota:<url> <sha256>" queues an update. The image is
+// streamed over HTTP(S) into the inactive app slot of default.csv one
+// flash sector at a time, resumed with a Range request on later wakes,
+// SHA-256 checked against the command and booted. The new image must reach
+// the broker within OTA_CONFIRM_ATTEMPTS wakes, otherwise it is rolled back.
+#ifndef OTA_ENABLED
+#define OTA_ENABLED                  (CONTROL_HAS_MQTT && CONTROL_TRANSPORT == CONTROL_TRANSPORT_WIFI && !GATEWAY_ROLE)
+#endif
+#define OTA_URL_MAX_LEN              160
+#define OTA_CHUNK_SIZE               4096      // One flash sector per write
+#define OTA_WAKE_BUDGET_MS           30000     // Download time per wake, the rest resumes next wake
+#define OTA_HTTP_TIMEOUT_MS          5000
+#define OTA_MIN_BATTERY_MV           BATTERY_WARNING_MV   // No download below this
+#ifndef OTA_CONFIRM_ATTEMPTS
+#define OTA_CONFIRM_ATTEMPTS         3         // Offline wakes before a new image is rolled back
+#endif
+// PEM root certificate for https:// URLs; nullptr skips the server check
+// (the image itself is pinned by the SHA-256 in the command)
+#define OTA_CA_CERT                  nullptr
+
+#if OTA_ENABLED && !CONTROL_HAS_MQTT
+#error "OTA_ENABLED needs MQTT (CONTROL_MODE_MQTT or CONTROL_MODE_BOTH)"
+#endif
+#if OTA_ENABLED && (CONTROL_TRANSPORT != CONTROL_TRANSPORT_WIFI)
+#error "OTA_ENABLED downloads over WiFi, it needs CONTROL_TRANSPORT_WIFI"
+#endif
+
 // =============================================================================
 // NVS STORAGE KEYS
 // =============================================================================
@@ -347,5 +867,19 @@ static const LedStep PAT_NUM_END[] = {
 #define NVS_KEY_PLANT_NAME          "plant_name"
 #define NVS_KEY_DEEP_SLEEP_ENABLED  "deep_sleep"
 #define NVS_KEY_LAST_CMD_ID         "last_cmd_id"
+#define NVS_KEY_SOIL_GAIN           "soil_gain"
+#define NVS_KEY_SOIL_SETTLE         "soil_settle"
+#define NVS_KEY_TLM_UPLOAD_SEQ      "tlm_up_seq"
+#define NVS_KEY_OTA_URL             "ota_url"
+#define NVS_KEY_OTA_SHA256          "ota_sha"
+#define NVS_KEY_OTA_SIZE            "ota_size"
+#define NVS_KEY_OTA_OFFSET          "ota_offset"
+#define NVS_KEY_GROUP               "group"
+
+// Boot count / total time are kept in RTC memory and written to NVS only
+// every N wakes (plus power-on and brown-out) to reduce flash wear. The
+// stored total time only seeds the clock after a power loss.
+#define STORAGE_COUNTER_COMMIT_WAKES 12
+#define STORAGE_CMD_ID_MAX_LEN       47      // Cached MQTT command id length
 
 #endif // CONFIG_H
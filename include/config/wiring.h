@@ -16,6 +16,24 @@
 // Pump control (N-MOSFET gate)
 #define PIN_PUMP                GPIO_NUM_5    // Digital output to MOSFET
 
+// Plant channels {soil sensor (ADC1), pump MOSFET gate}. Channel 0 is the
+// single-plant wiring above; only the first PLANT_CHANNEL_COUNT are used.
+// Extra sensors need the remaining ADC1 pins, which are the button pins:
+// build multi-channel boards with CONTROL_MODE_MQTT.
+// WARNING: GPIO 9 is a strapping pin (BOOT). Its MOSFET gate must not pull
+// it low during reset. GPIO 20/21 are UART0: keep Serial on USB CDC.
+typedef struct {
+    gpio_num_t soil_pin;
+    gpio_num_t pump_pin;
+} PlantChannelPins;
+
+static const PlantChannelPins PLANT_CHANNELS[PLANT_CHANNEL_MAX] = {
+    { PIN_SOIL_SENSOR, PIN_PUMP    },
+    { GPIO_NUM_0,      GPIO_NUM_20 },
+    { GPIO_NUM_1,      GPIO_NUM_21 },
+    { GPIO_NUM_2,      GPIO_NUM_9  },
+};
+
 // LEDs
 #define PIN_LED_GREEN           GPIO_NUM_6    // Status / humidity display
 #define PIN_LED_RED             GPIO_NUM_7    // Low battery / error
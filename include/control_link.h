@@ -0,0 +1,43 @@
+/**
+ * control_link.h - Transport below the MQTT control channel
+ *
+ * mqtt_control.cpp builds every topic and payload (telemetry, acks,
+ * status, awake marker) and parses every command the same way whatever
+ * carries them; a ControlLink only moves (topic, payload) pairs:
+ *   - control_link_mqtt():   WiFi join plus PubSubClient to the broker
+ *   - control_link_espnow(): ESP-NOW frames to a gateway board that
+ *                            publishes them on the same topics
+ *                            (espnow_link.h, espnow_gateway.h)
+ * CONTROL_TRANSPORT selects the node's link at build time.
+ */
+
+#ifndef CONTROL_LINK_H
+#define CONTROL_LINK_H
+
+#include <Arduino.h>
+
+/** Incoming message on one of the command topics. */
+typedef void (*ControlLinkRxFn)(const char *topic, const uint8_t *payload, size_t len);
+
+typedef struct {
+    const char *name;
+
+    /** Bring the link up (blocking) and subscribe to the command topics. */
+    bool (*connect)(ControlLinkRxFn on_rx);
+
+    bool (*connected)(void);
+
+    /** Publish one message; false if it was not handed to the transport. */
+    bool (*publish)(const char *topic, const uint8_t *payload, size_t len, bool retained);
+
+    /** Keep the link alive and deliver received commands to on_rx. */
+    void (*poll)(void);
+} ControlLink;
+
+/** WiFi + broker link (mqtt_control.cpp); also used by the gateway. */
+const ControlLink *control_link_mqtt(void);
+
+/** ESP-NOW link to the gateway (espnow_link.cpp). */
+const ControlLink *control_link_espnow(void);
+
+#endif // CONTROL_LINK_H
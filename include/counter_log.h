@@ -0,0 +1,49 @@
+/**
+ * counter_log.h - Append-only flash log for frequently changing counters
+ *
+ * Boot count, persistent time, watering timestamps, the last command id
+ * and the telemetry upload cursor change on most wakes. Instead of
+ * rewriting their NVS entries, storage appends the whole set as one
+ * fixed-size record (sequence number + CRC) to a small ring of raw flash
+ * sectors (COUNTER_LOG_PARTITION). The newest valid record is the
+ * current value; a record torn by a brown-out fails its CRC and the one
+ * before it is used instead. A sector is erased only when the log moves
+ * into it, so the previous sector still holds the newest record.
+ *
+ * Only storage.cpp uses this module.
+ */
+
+#ifndef COUNTER_LOG_H
+#define COUNTER_LOG_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/** The values kept in the log (one complete set per record). */
+typedef struct {
+    uint32_t boot_count;
+    uint32_t total_time;                        // persistent time (s)
+    uint32_t tlm_upload_seq;                    // telemetry upload cursor
+    uint32_t last_watering[PLANT_CHANNEL_MAX];  // per channel, unused channels 0
+    char     last_cmd_id[STORAGE_CMD_ID_MAX_LEN + 1];
+} CounterSnapshot;
+
+/**
+ * Locate the log and, after power loss, find its head in flash.
+ * @return true if the log is usable (partition present and large enough)
+ */
+bool counter_log_init();
+
+/**
+ * Newest valid record.
+ * @return false if the log is unusable or still empty
+ */
+bool counter_log_latest(CounterSnapshot *out);
+
+/**
+ * Append one record.
+ * @return false if the log is unusable or the flash write failed
+ */
+bool counter_log_append(const CounterSnapshot *snap);
+
+#endif // COUNTER_LOG_H
@@ -0,0 +1,55 @@
+/**
+ * device_topic.h - Per-device MQTT topic namespace
+ *
+ * Topics are MQTT_TOPIC_ROOT/<level>/<suffix>, the suffix being one of
+ * the MQTT_TOPIC_* names in config.h ("telemetry", "cmd/bin", ...):
+ *
+ *   plant/<device id>/<suffix>       one device (publishes and commands)
+ *   plant/all/<suffix>               broadcast commands
+ *   plant/group/<group>/<suffix>     group commands
+ *
+ * The device id is the factory (eFuse) MAC as 12 lowercase hex digits,
+ * i.e. the station MAC a gateway sees as the ESP-NOW source address.
+ */
+
+#ifndef DEVICE_TOPIC_H
+#define DEVICE_TOPIC_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#define DEVICE_ID_LEN  12
+
+typedef enum {
+    TOPIC_SCOPE_DEVICE,      // plant/<id>/...
+    TOPIC_SCOPE_BROADCAST,   // plant/all/...
+    TOPIC_SCOPE_GROUP        // plant/group/<group>/...
+} TopicScope;
+
+/** A parsed topic; target points into the topic string (not terminated). */
+typedef struct {
+    TopicScope  scope;
+    const char *target;      // device id or group name, nullptr for broadcast
+    size_t      target_len;
+    const char *suffix;
+} TopicParts;
+
+/** This board's device id (read from eFuse once). */
+const char *device_id();
+
+/** Device id of the board with this station MAC. */
+void device_id_from_mac(const uint8_t mac[6], char out[DEVICE_ID_LEN + 1]);
+
+/** plant/<device>/<suffix>; returns false if it does not fit. */
+bool device_topic(char *out, size_t size, const char *device, const char *suffix);
+
+/** plant/group/<group>/<suffix>; returns false if it does not fit. */
+bool group_topic(char *out, size_t size, const char *group, const char *suffix);
+
+/** Split a topic below MQTT_TOPIC_ROOT; false for anything else. */
+bool device_topic_parse(const char *topic, TopicParts *out);
+
+/** True if parts.target equals text. */
+bool device_topic_target_is(const TopicParts *parts, const char *text);
+
+#endif // DEVICE_TOPIC_H
@@ -0,0 +1,35 @@
+/**
+ * espnow_gateway.h - ESP-NOW to MQTT bridge (GATEWAY_ROLE builds)
+ *
+ * A mains-powered board stays joined to WiFi and the broker over
+ * control_link_mqtt() and listens for ESP-NOW frames on its access
+ * point's channel (espnow_link.h):
+ *   - HELLO from a node is answered with the channel while the broker
+ *     link is up; a node that hears nothing keeps its data for later.
+ *   - PUBLISH messages are republished on the node's own plant/<id>/
+ *     topics (id from its MAC, device_topic.h), so the host app cannot
+ *     tell a bridged node from a directly connected one.
+ *   - Commands on plant/<id>/cmd of a known node, and broadcasts on
+ *     plant/all/cmd for every known node, go out right away if the node
+ *     was heard from within ESPNOW_GATEWAY_WINDOW_MS. Otherwise they are
+ *     held (up to ESPNOW_GATEWAY_QUEUE_LEN for all nodes) and sent with
+ *     that node's next PUBLISH or POLL.
+ *   - Group commands on plant/group/<name>/cmd go to every known node
+ *     with ESPNOW_FLAG_GROUP and the name in front of the payload; the
+ *     gateway does not know memberships, each node keeps only its own.
+ *   - A broadcast or group command only reaches nodes heard since the
+ *     gateway booted.
+ */
+
+#ifndef ESPNOW_GATEWAY_H
+#define ESPNOW_GATEWAY_H
+
+#include <Arduino.h>
+
+/** Join WiFi and the broker (blocking), then start listening for nodes. */
+void espnow_gateway_init();
+
+/** One bridge iteration: keep the broker link up, handle node frames. */
+void espnow_gateway_process();
+
+#endif // ESPNOW_GATEWAY_H
@@ -0,0 +1,125 @@
+/**
+ * espnow_link.h - ESP-NOW framing shared by battery nodes and the gateway
+ *
+ * Every control channel message travels as one or more frames (ESP-NOW
+ * carries at most 250 bytes): a 7-byte header with the topic as an index
+ * into a fixed table, then a slice of the payload. Unicast frames are
+ * acked by the MAC layer; espnow_send() waits for that ack per frame and
+ * retries, so a true return means the peer's radio took every part.
+ *
+ * Discovery: a node broadcasts HELLO on its cached channel (RTC memory),
+ * then on every channel, until the gateway answers with its channel. The
+ * gateway stays on its access point's channel, so a normal wake costs one
+ * hello round trip instead of association, DHCP, TCP and MQTT CONNECT.
+ *
+ * control_link_espnow() (control_link.h) is the node side built on this.
+ */
+
+#ifndef ESPNOW_LINK_H
+#define ESPNOW_LINK_H
+
+#include <Arduino.h>
+#include <esp_now.h>
+#include "config.h"
+
+// =============================================================================
+// FRAMES
+// =============================================================================
+
+#define ESPNOW_FRAME_VERSION   1
+#define ESPNOW_FLAG_RETAIN     0x01
+#define ESPNOW_FLAG_GROUP      0x02     // command payload is "<group>\0<payload>"
+#define ESPNOW_TOPIC_NONE      0xFF
+
+typedef enum {
+    ESPNOW_FRAME_HELLO   = 1,   // node: looking for a gateway; gateway: reply (both broadcast)
+    ESPNOW_FRAME_PUBLISH = 2,   // node -> gateway: message for the broker
+    ESPNOW_FRAME_COMMAND = 3,   // gateway -> node: message from a command topic
+    ESPNOW_FRAME_POLL    = 4    // node -> gateway: still listening, send queued commands
+} EspNowFrameType;
+
+typedef struct __attribute__((packed)) {
+    uint8_t version;
+    uint8_t type;       // EspNowFrameType
+    uint8_t topic;      // espnow_topic_id()
+    uint8_t flags;      // ESPNOW_FLAG_*
+    uint8_t msg_seq;    // same for every part of one message
+    uint8_t part;       // 0 .. parts-1
+    uint8_t parts;
+} EspNowHeader;
+
+#define ESPNOW_PART_MAX   (ESP_NOW_MAX_DATA_LEN - sizeof(EspNowHeader))
+
+// Gateway hello reply payload: node MAC it answers, gateway channel
+#define ESPNOW_HELLO_REPLY_LEN  7
+
+/** One received frame, copied out of the WiFi task. */
+typedef struct {
+    uint8_t mac[6];
+    uint8_t len;
+    uint8_t data[ESP_NOW_MAX_DATA_LEN];
+} EspNowRxFrame;
+
+/** Reassembly buffer for one sender. */
+typedef struct {
+    uint8_t  type;
+    uint8_t  topic;
+    uint8_t  flags;
+    uint8_t  msg_seq;
+    uint8_t  next_part;
+    uint8_t  parts;
+    uint16_t len;
+    uint8_t  data[ESPNOW_MESSAGE_MAX];
+} EspNowMessage;
+
+// =============================================================================
+// API
+// =============================================================================
+
+/**
+ * Start WiFi in station mode (not associated) and ESP-NOW with the
+ * broadcast peer. Idempotent.
+ */
+bool espnow_start();
+
+/** Add a unicast peer on the current channel, encrypted if ESPNOW_KEY is set. */
+bool espnow_add_peer(const uint8_t mac[6]);
+
+/** Forget a unicast peer. */
+void espnow_remove_peer(const uint8_t mac[6]);
+
+/**
+ * Send one message, split into as many frames as needed.
+ *
+ * @param mac     Peer address, nullptr to broadcast (no MAC ack)
+ * @param payload May be nullptr when len is 0
+ * @return true if every frame was acked
+ */
+bool espnow_send(const uint8_t *mac, EspNowFrameType type, uint8_t topic, uint8_t flags,
+                 const uint8_t *payload, size_t len);
+
+/** Next received frame, waiting at most wait_ms. */
+bool espnow_receive(EspNowRxFrame *out, uint32_t wait_ms);
+
+/** Drop frames received so far. */
+void espnow_flush_rx();
+
+/**
+ * Add one frame to msg. Returns true once it completed a message; a part
+ * out of order or from another message restarts the buffer.
+ */
+bool espnow_assemble(EspNowMessage *msg, const EspNowRxFrame *frame);
+
+/** Header of a received frame, nullptr if it is too short or another version. */
+const EspNowHeader *espnow_header(const EspNowRxFrame *frame);
+
+/**
+ * Index of a bridged topic (plant/<level>/<suffix>, only the suffix
+ * counts), ESPNOW_TOPIC_NONE if it is not bridged.
+ */
+uint8_t espnow_topic_id(const char *topic);
+
+/** Topic suffix for an index, nullptr if unknown. */
+const char *espnow_topic_name(uint8_t id);
+
+#endif // ESPNOW_LINK_H
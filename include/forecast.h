@@ -0,0 +1,68 @@
+/**
+ * forecast.h - Forecast-driven watering planner
+ *
+ * The host pushes a compact daily forecast over MQTT: evapotranspiration
+ * (ET, 0.1 mm/day) and rain probability. While it is valid the planner
+ * turns the reactive "water below minimal" decision into a plan:
+ *   - rain likely: dry soil close to its minimal is left for the rain
+ *   - soil about to cross its minimal: water now, once, up to the maximal
+ *     humidity, instead of on a separate wake shortly after
+ *   - next wake: the predicted crossing, from ET times the learned drying
+ *     per mm ET of the channel
+ *
+ * The forecast and the learned drying live in RTC memory (a power-on
+ * starts without them until the host pushes the next forecast).
+ */
+
+#ifndef FORECAST_H
+#define FORECAST_H
+
+#include <Arduino.h>
+#include "config.h"
+
+typedef enum {
+    FORECAST_PLAN_NONE,          // no forecast, or the reactive decision stands
+    FORECAST_PLAN_HOLD_RAIN,     // below minimal, but rain is likely: do not water
+    FORECAST_PLAN_WATER_EARLY    // above minimal, but crossing it soon: water now
+} ForecastPlan;
+
+/**
+ * Store a forecast received from the host.
+ *
+ * @param et_x10    Evapotranspiration in 0.1 mm/day (<= FORECAST_ET_MAX_X10)
+ * @param rain_pct  Rain probability (0-100)
+ * @return false if a value is out of range (nothing stored)
+ */
+bool forecast_set(uint32_t et_x10, uint32_t rain_pct);
+
+/** True while the last forecast is younger than FORECAST_VALID_SEC. */
+bool forecast_active();
+
+/** Active and rain probability at least FORECAST_RAIN_SKIP_PCT. */
+bool forecast_rain_likely();
+
+/**
+ * Feed this wake's humidity of a channel; learns the drying per mm ET
+ * from the drop since the previous reading (skipped across waterings).
+ */
+void forecast_observe(uint8_t ch, uint8_t humidity);
+
+/**
+ * Plan for a channel at this wake.
+ *
+ * @param humidity  Current humidity (%)
+ * @param minimal   Minimal humidity of the channel (%)
+ */
+ForecastPlan forecast_plan(uint8_t ch, uint8_t humidity, uint8_t minimal);
+
+/**
+ * Seconds until the next wake should look at the channel, from the last
+ * observed humidity: the predicted crossing of its minimal, or
+ * FORECAST_RAIN_RECHECK_SEC while watering is held for rain.
+ *
+ * @param rain_hold  Set true when the value is a rain recheck
+ * @return UINT32_MAX without an active forecast or observation
+ */
+uint32_t forecast_next_check_sec(uint8_t ch, bool *rain_hold);
+
+#endif // FORECAST_H
@@ -0,0 +1,51 @@
+/**
+ * hw_init.h - Lazy, on-demand hardware module initialization
+ *
+ * Each peripheral module is initialized the first time something uses
+ * it instead of unconditionally at boot: modules call hw_require() at
+ * their entry points and an init-state bitmask makes repeated calls a
+ * single AND. A timer wake that finds the soil moist therefore never
+ * configures the actuator, a button wake never sets up the telemetry
+ * log, and so on. Dependencies (e.g. sensor reads need the ADC) are
+ * resolved by the registry.
+ *
+ * Every init is timed; hw_report_boot_times() prints the breakdown for
+ * the current wake.
+ */
+
+#ifndef HW_INIT_H
+#define HW_INIT_H
+
+#include <Arduino.h>
+
+typedef enum {
+    HW_STORAGE       = 1u << 0,
+    HW_ADC           = 1u << 1,
+    HW_SENSOR        = 1u << 2,   // calibration tables
+    HW_BATTERY       = 1u << 3,
+    HW_ACTUATOR      = 1u << 4,
+    HW_WATERING      = 1u << 5,
+    HW_WATER_LEVEL   = 1u << 6,
+    HW_LEDS          = 1u << 7,
+    HW_BUTTONS       = 1u << 8,
+    HW_TELEMETRY_LOG = 1u << 9
+} HwModule;
+
+/**
+ * Initialize every module in the mask (plus dependencies) that is not
+ * initialized yet. Cheap once everything is up.
+ */
+void hw_require(uint16_t modules);
+
+/**
+ * @return true if all modules in the mask are initialized
+ */
+bool hw_ready(uint16_t modules);
+
+/**
+ * Print the modules initialized this wake and their init times
+ * (DEBUG_SERIAL only).
+ */
+void hw_report_boot_times();
+
+#endif // HW_INIT_H
@@ -3,6 +3,11 @@
  * 
  * Controls status LEDs for user feedback.
  * Provides shared value/status display patterns.
+ *
+ * Blinks, patterns and value displays are queued as on/off segments and
+ * played by a one-shot esp_timer, so they return immediately and run
+ * alongside sensor reads and the WiFi join. The direct on/off calls wait
+ * for queued output first, so mixed sequences keep their order.
  */
 
 #ifndef LEDS_H
@@ -41,12 +46,31 @@ void led_red_off();
  */
 void leds_all_off();
 
+// =============================================================================
+// PLAYER
+// =============================================================================
+
+/** true while queued output is still playing. */
+bool leds_busy();
+
+/** Block until all queued output has played. */
+void leds_wait_idle();
+
+/**
+ * Before sleep: wait (at most max_ms) until no lit segment is left,
+ * then drop the remaining pauses and switch both LEDs off.
+ */
+void leds_finish(uint32_t max_ms);
+
+/** Queue a pause (both LEDs off) of ms after the output queued so far. */
+void leds_pause(uint16_t ms);
+
 // =============================================================================
 // FLASH PATTERNS
 // =============================================================================
 
 /**
- * Blink green LED a specified number of times.
+ * Blink green LED a specified number of times (queued).
  * 
  * @param count Number of blinks
  * @param duration_ms Duration of each blink
@@ -54,7 +78,7 @@ void leds_all_off();
 void led_green_blink(uint8_t count, uint16_t duration_ms);
 
 /**
- * Blink red LED a specified number of times.
+ * Blink red LED a specified number of times (queued).
  * 
  * @param count Number of blinks
  * @param duration_ms Duration of each blink
@@ -62,7 +86,7 @@ void led_green_blink(uint8_t count, uint16_t duration_ms);
 void led_red_blink(uint8_t count, uint16_t duration_ms);
 
 /**
- * Play a pattern defined as an array of {green_ms, red_ms} steps.
+ * Queue a pattern defined as an array of {green_ms, red_ms} steps.
  *
  * @param steps     Array of LedStep definitions
  * @param length    Number of steps in the array
@@ -82,7 +106,7 @@ void leds_play_pattern(const LedStep steps[], uint8_t length,
 // =============================================================================
 
 /**
- * Display a percentage value (0-100) using LED flashes.
+ * Display a percentage value (0-100) using LED flashes (queued).
  * Tens digit: long flashes, ones digit: short flashes.
  * Green LED for humidity, red LED for battery.
  *
@@ -0,0 +1,50 @@
+/**
+ * measurement.h - Per-wake measurement snapshot
+ *
+ * One snapshot of every soil channel, the battery, the reservoir and the
+ * time, shared by the watering decision, alerts, telemetry and the
+ * telemetry log instead of each taking its own ADC bursts. Telemetry
+ * therefore reports the values the decision was made on.
+ *
+ * The first snapshot of a wake (or always-on cycle) is the filtered
+ * decision reading (sensor_measure_all). It is retaken only when a
+ * consumer invalidates it (pump pulse, calibration) or asks for data
+ * younger than the snapshot's age; retakes read the soil unfiltered.
+ */
+
+#ifndef MEASUREMENT_H
+#define MEASUREMENT_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "sensor.h"
+
+typedef struct {
+    uint16_t    raw[PLANT_CHANNEL_COUNT];        // soil raw ADC
+    uint8_t     humidity[PLANT_CHANNEL_COUNT];   // %
+    SensorFault fault[PLANT_CHANNEL_COUNT];      // from the cycle's decision reading
+    uint16_t    battery_mv;
+    bool        water_ok;                        // reservoir level OK
+    uint32_t    ts;                              // persistent time (s) at capture
+    uint32_t    taken_ms;                        // millis() at capture
+} Measurement;
+
+/**
+ * Current snapshot; taken first if there is none yet, it was invalidated
+ * or it is older than max_age_ms.
+ */
+const Measurement *measurement_get(uint32_t max_age_ms = MEASUREMENT_MAX_AGE_MS);
+
+/** Milliseconds since the snapshot was taken, UINT32_MAX if there is none. */
+uint32_t measurement_age_ms();
+
+/** Mark the snapshot stale (soil or supply changed); the next get retakes it. */
+void measurement_invalidate();
+
+/**
+ * Start a new measurement cycle (always-on mode): the next get takes a
+ * fresh filtered decision reading and a new battery sample.
+ */
+void measurement_new_cycle();
+
+#endif // MEASUREMENT_H
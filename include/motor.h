@@ -19,8 +19,14 @@ void motor_on();
 void motor_off();
 
 // Run stepper for a fixed duration (ms) by generating step pulses.
+// With STEPPER_HW_PULSES the pulses come from LEDC (STEP/DIR drivers) or a
+// one-shot esp_timer re-armed per step (DRV8833), ramped STEPPER_START_HZ -> STEPPER_STEP_HZ.
 bool motor_run_timed(uint32_t duration_ms);
 
+// Run exactly `steps` steps on the same (step-indexed) ramp, for volume
+// dosing. Gives up after timeout_ms and returns false in that case.
+bool motor_run_steps(uint32_t steps, uint32_t timeout_ms);
+
 // Emergency stop: immediate output disable/off.
 void motor_emergency_stop();
 
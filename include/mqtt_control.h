@@ -3,16 +3,55 @@
 
 #include <Arduino.h>
 
-// Initialize WiFi and MQTT command channel.
+// The control channel runs over the link CONTROL_TRANSPORT selects
+// (control_link.h): WiFi + broker, or ESP-NOW through a gateway board.
+// Topics and payloads are the same either way.
+
+// Initialize WiFi and MQTT command channel (blocking).
 void mqtt_control_init();
 
+// Start WiFi/MQTT bring-up in a background task and return immediately.
+// The task never reads sensors or the measurement; it publishes the
+// telemetry snapshot handed over by mqtt_control_publish_telemetry() as
+// soon as the link is up.
+void mqtt_control_begin_async();
+
+// Block until the async bring-up has finished (bounded by the WiFi retry
+// policy). Publishes the wake's first telemetry if the task did not.
+// Returns true if the broker link is up.
+bool mqtt_control_wait_connected();
+
+// True while the link is up or being brought up this wake. Light sleep
+// would drop it, so callers must not light-sleep while this is set. A
+// failed bring-up switches WiFi off, so offline wakes may light-sleep.
+bool mqtt_control_radio_active();
+
+// WiFi modem sleep (always-on mode). Applied now if connected and on every
+// later bring-up; off by default so timer wakes join and answer fastest.
+void mqtt_control_set_power_save(bool on);
+
 // Keep MQTT connection alive and process incoming commands.
 void mqtt_control_process();
 
-// Process MQTT for a bounded time window (ms), then return.
+// Process MQTT for at most duration_ms. Returns early when the host sends
+// the end-of-commands sentinel or after MQTT_COMMAND_IDLE_MS without traffic.
 void mqtt_control_process_for(uint32_t duration_ms);
 
-// Publish current telemetry snapshot.
+// Publish current telemetry snapshot. During the async bring-up the
+// snapshot is taken here and published by the bring-up task.
 void mqtt_control_publish_telemetry();
 
+// Upload the pending telemetry log (telemetry_log.h) as batched messages
+// on MQTT_TOPIC_TELEMETRY_BATCH. No-op while offline.
+void mqtt_control_upload_telemetry_log();
+
+// Confirm a freshly updated image and continue a pending OTA download
+// for up to OTA_WAKE_BUDGET_MS (ota_update.h), acking progress on
+// MQTT_TOPIC_ACK. Restarts into the new image once it is verified.
+void mqtt_control_service_ota();
+
+// Publish the finished wake profiles (profiler.h) on MQTT_TOPIC_PROFILE,
+// one message per wake. No-op while offline.
+void mqtt_control_publish_profile();
+
 #endif // MQTT_CONTROL_H
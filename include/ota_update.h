@@ -0,0 +1,80 @@
+/**
+ * ota_update.h - Resumable OTA firmware updates
+ *
+ * An update is queued by the MQTT "ota" command with the image URL and
+ * its SHA-256. On connected wakes ota_update_service() streams the image
+ * over HTTP(S) straight into the inactive app slot, one flash sector at
+ * a time (no image buffer), for at most a time budget per wake; progress
+ * lives in NVS (storage.h) and the next wake continues with a Range
+ * request, so no byte is downloaded twice except a partial last sector.
+ *
+ * A complete image is hashed back from flash, checked against the queued
+ * SHA-256 and validated by esp_ota_set_boot_partition() before it boots.
+ * With bootloader rollback enabled the new image starts pending; it has
+ * to reach the broker within OTA_CONFIRM_ATTEMPTS wakes (ota_update_confirm)
+ * or it is marked invalid and the previous image boots again. Those wakes
+ * are light sleeps: any reset of a pending image boots the previous one.
+ */
+
+#ifndef OTA_UPDATE_H
+#define OTA_UPDATE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+typedef enum {
+    OTA_IDLE,          // no job queued
+    OTA_IN_PROGRESS,   // budget used up or transient error: resumes next wake
+    OTA_READY,         // verified and selected for boot: restart to run it
+    OTA_FAILED         // job dropped (see detail)
+} OtaStatus;
+
+/** Called after every flash sector written (keep the MQTT link alive). */
+typedef void (*OtaProgressFn)(uint32_t done, uint32_t total);
+
+/**
+ * Queue a new download, replacing any pending job and its progress.
+ *
+ * @param url     http:// or https:// image URL (not NUL-terminated)
+ * @param url_len Length of url, at most OTA_URL_MAX_LEN
+ * @param sha256  Expected SHA-256 of the whole image
+ * @return false if the URL does not fit or OTA is disabled
+ */
+bool ota_update_queue(const char *url, size_t url_len, const uint8_t sha256[32]);
+
+/** true while a download is queued. */
+bool ota_update_pending();
+
+/**
+ * true if a download is queued and not pausing after a transient error
+ * (OTA_RETRY_MS within one boot; every deep sleep wake retries).
+ */
+bool ota_update_due();
+
+/**
+ * Continue the pending download for at most budget_ms. Needs WiFi.
+ *
+ * @param budget_ms   Download time for this call
+ * @param on_progress Optional progress callback
+ * @param detail      Receives a short reason ("downloading", "hash_mismatch", ...)
+ */
+OtaStatus ota_update_service(uint32_t budget_ms, OtaProgressFn on_progress, const char **detail);
+
+/**
+ * true while a new image is not confirmed yet. It must not deep-sleep:
+ * the bootloader rolls a pending image back on the next reset.
+ */
+bool ota_update_verify_pending();
+
+/**
+ * Health check result of a pending image: keep it, or count a failed
+ * (offline) wake and, after OTA_CONFIRM_ATTEMPTS of them, mark it invalid
+ * and reboot into the previous one. The image is only marked valid on
+ * success; until then it stays pending. No-op unless
+ * ota_update_verify_pending().
+ *
+ * @return true if a pending image was confirmed by this call
+ */
+bool ota_update_confirm(bool healthy);
+
+#endif // OTA_UPDATE_H
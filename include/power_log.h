@@ -0,0 +1,71 @@
+/**
+ * power_log.h - Streaming power logger over USB CDC
+ *
+ * Streams the battery rail (and the optional POWER_LOG_SENSE_PIN current
+ * sense input) from the continuous ADC, averaged down to
+ * POWER_LOG_RATE_HZ sets per second, as packed binary frames on Serial.
+ * Each frame carries a sequence number, the timestamp of its first set
+ * and the active phase flags, so the host sees drops and can line the
+ * trace up with pump pulses, WiFi joins and MQTT traffic. Frames the
+ * USB buffer cannot take are dropped (sequence gap), never blocked on.
+ *
+ * Frame (little-endian):
+ *   A5 5A | version u8 | type u8 | seq u16 | len u16 | payload | crc16 u16
+ *   DATA payload: t_us u32, phases u8, channels u8, sets u8, 0 u8,
+ *                 mV u16 [sets][channels]
+ *   INFO payload: rate_hz u32, channels u8, kind u8 [channels]
+ * crc16 is CRC-16/CCITT-FALSE over version .. end of payload. An INFO
+ * frame goes out on start and every POWER_LOG_INFO_EVERY frames.
+ *
+ * Everything compiles to no-ops unless POWER_LOG_ENABLED; the decoder is
+ * test/power_log/capture_power_log.py.
+ */
+
+#ifndef POWER_LOG_H
+#define POWER_LOG_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#define POWER_LOG_SYNC0         0xA5
+#define POWER_LOG_SYNC1         0x5A
+#define POWER_LOG_VERSION       1
+
+typedef enum {
+    POWER_FRAME_DATA = 1,
+    POWER_FRAME_INFO = 2
+} PowerFrameType;
+
+/** Channel kinds listed in the INFO frame. */
+typedef enum {
+    POWER_KIND_BATTERY_MV = 0,   // battery rail, divider removed
+    POWER_KIND_SENSE_MV   = 1    // current sense output at the ADC pin
+} PowerChannelKind;
+
+/** Phase flags, several can be active at once. */
+typedef enum {
+    POWER_PHASE_PUMP  = 1u << 0,   // actuator pulse running
+    POWER_PHASE_WIFI  = 1u << 1,   // WiFi scan / join
+    POWER_PHASE_MQTT  = 1u << 2,   // broker connect
+    POWER_PHASE_USER  = 1u << 7    // free for ad-hoc captures
+} PowerPhase;
+
+/**
+ * Start streaming (idempotent). Safe to call from any phase that should
+ * be captured; with POWER_LOG_WHOLE_WAKE the firmware starts it at boot.
+ *
+ * @return false if disabled or the ADC cannot stream
+ */
+bool power_log_start();
+
+/** Flush the frame in progress and stop streaming. */
+void power_log_stop();
+
+/**
+ * Enter or leave a phase. Nested and concurrent calls are counted, so
+ * two overlapping pump pulses keep POWER_PHASE_PUMP set until both end.
+ * Cheap when the logger is off.
+ */
+void power_log_phase(PowerPhase phase, bool active);
+
+#endif // POWER_LOG_H
@@ -0,0 +1,91 @@
+/**
+ * profiler.h - Wake-cycle span profiler and charge estimate
+ *
+ * Named spans are timed with esp_timer_get_time() and summed per wake
+ * (total time and count). At the end of a wake the totals become one
+ * ProfileRecord in a small RTC ring, so wakes without radio are reported
+ * on the next MQTT wake. The charge estimate weights each span with the
+ * PROFILE_UA_* supply currents from config.h.
+ *
+ * Spans can overlap (the MQTT bring-up task runs beside the sensor read)
+ * and may be recorded from any task.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+typedef enum {
+    PROF_INIT = 0,      // hardware module init (hw_init.h)
+    PROF_SENSOR,        // soil sensor burst
+    PROF_BATTERY,       // battery voltage burst
+    PROF_WIFI_JOIN,     // fast join / scan join
+    PROF_MQTT_CONNECT,  // broker connect + subscribe
+    PROF_CMD_WINDOW,    // MQTT command window
+    PROF_PUMP,          // pump (or stepper) on time, summed over channels
+    PROF_SOAK,          // light sleep while soaking
+    PROF_SPAN_COUNT
+} ProfileSpan;
+
+typedef struct {
+    uint32_t boot;                         // storage boot count of the wake
+    uint32_t awake_us;                     // app start to end of the wake
+    uint32_t setup_us;                     // app start to setup() (image load, runtime init)
+    uint32_t span_us[PROF_SPAN_COUNT];
+    uint16_t span_n[PROF_SPAN_COUNT];
+} ProfileRecord;
+
+/** Return false to stop; the record stays queued. */
+typedef bool (*ProfileSink)(const ProfileRecord *record);
+
+/**
+ * Record the time from app start to setup(); call first thing in setup().
+ */
+void profiler_mark_setup();
+
+/**
+ * Start timestamp for a span (esp_timer time in us).
+ */
+int64_t profiler_start();
+
+/**
+ * Add the time since start_us to a span.
+ */
+void profiler_stop(ProfileSpan span, int64_t start_us);
+
+/**
+ * Add a measured duration to a span.
+ */
+void profiler_add(ProfileSpan span, uint32_t duration_us);
+
+/**
+ * Close this wake's totals into the RTC history (and print them with
+ * DEBUG_SERIAL). Later spans go to the next wake. Call once per wake.
+ */
+void profiler_finish_wake();
+
+/**
+ * Hand queued records to sink, oldest first; delivered ones are dropped.
+ * @return Number of records delivered
+ */
+uint16_t profiler_drain(ProfileSink sink);
+
+/**
+ * Estimated charge of a wake in uAh.
+ */
+uint32_t profiler_charge_uah(const ProfileRecord *record);
+
+/**
+ * The same estimate in uA*us, without rounding a short wake down to a few
+ * uAh; for sums over many wakes.
+ */
+uint64_t profiler_charge_ua_us(const ProfileRecord *record);
+
+/**
+ * Short span name for reports ("sensor", "wifi", ...).
+ */
+const char *profiler_span_name(ProfileSpan span);
+
+#endif // PROFILER_H
@@ -1,7 +1,8 @@
 /**
  * pump.h - Water pump control interface
  * 
- * Controls pump via N-MOSFET with safety timeout.
+ * Controls pump via N-MOSFET with safety timeout. One pump per plant
+ * channel (PLANT_CHANNELS in wiring.h); `ch` selects it.
  * Battery and policy checks are handled by higher-level watering logic.
  */
 
@@ -15,8 +16,8 @@
 // =============================================================================
 
 /**
- * Initialize pump control GPIO.
- * Sets pin as output and ensures pump is OFF.
+ * Initialize pump control GPIOs.
+ * Sets every channel's pin as output and ensures all pumps are OFF.
  */
 void pump_init();
 
@@ -29,33 +30,45 @@ void pump_init();
  * Direct control - caller must handle timing.
  * WARNING: Always call pump_off() after use!
  */
-void pump_on();
+void pump_on(uint8_t ch);
 
 /**
  * Turn pump OFF.
  * Safe to call multiple times.
  */
-void pump_off();
+void pump_off(uint8_t ch);
 
 /**
  * Run pump for specified duration with safety timeout.
  * Blocks until pump cycle complete.
  * 
+ * @param ch          Plant channel whose pump to run
  * @param duration_ms How long to run pump (clamped to MAX)
  * @return true if pump ran successfully
  */
-bool pump_run_timed(uint32_t duration_ms);
+bool pump_run_timed(uint8_t ch, uint32_t duration_ms);
 
 /**
- * Emergency stop - immediately turn off pump.
+ * Pump time that delivers a volume at the given supply voltage.
+ * Flow is PUMP_FLOW_UL_PER_S at PUMP_FLOW_REF_MV, scaled linearly with
+ * the voltage; 0 mV (no reading) uses the calibration voltage.
+ *
+ * @param volume_ul  Volume to deliver (uL)
+ * @param supply_mv  Battery voltage during the pulse
+ * @return Duration in ms, clamped to PUMP_MAX_DURATION_MS
+ */
+uint32_t pump_volume_ms(uint32_t volume_ul, uint16_t supply_mv);
+
+/**
+ * Emergency stop - immediately turn off all pumps.
  * Use in error conditions or battery critical situations.
  */
 void pump_emergency_stop();
 
 /**
- * Check if pump is currently running.
+ * Check if any pump is currently running.
  * 
- * @return true if pump is ON
+ * @return true if a pump is ON
  */
 bool pump_is_running();
 
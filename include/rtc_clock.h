@@ -0,0 +1,65 @@
+/**
+ * rtc_clock.h - Persistent clock on the RTC timer
+ *
+ * The RTC timer keeps counting through deep sleep, so persistent time is
+ * "time at the last anchor + RTC time elapsed since", not a sum of
+ * programmed sleep intervals. The slow clock behind it is the internal
+ * RC oscillator and can be off by several percent; whenever WiFi is
+ * already up for MQTT the clock asks NTP for the time and derives a drift
+ * estimate from two syncs, which then corrects every later reading.
+ *
+ * All state lives in RTC memory. NVS only holds the total time that seeds
+ * the clock after a power loss (see storage.h).
+ */
+
+#ifndef RTC_CLOCK_H
+#define RTC_CLOCK_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * Restore the clock after a wake or reset.
+ * Keeps running from RTC memory when possible; otherwise (power loss,
+ * RTC timer reset) restarts at restored_sec.
+ *
+ * @param restored_sec  Last persistent time written to NVS
+ */
+void rtc_clock_init(uint32_t restored_sec);
+
+/**
+ * Persistent time in seconds, drift corrected.
+ * Monotonic, continues across deep sleep and is seeded from NVS after
+ * a power loss.
+ */
+uint32_t rtc_clock_now_sec();
+
+/**
+ * Restart persistent time at sec (keeps the drift estimate).
+ */
+void rtc_clock_reset(uint32_t sec);
+
+/**
+ * Request an NTP sync. Call once WiFi is connected; does nothing if the
+ * last sync is younger than CLOCK_NTP_MIN_INTERVAL_SEC or NTP is disabled.
+ */
+void rtc_clock_ntp_start();
+
+/**
+ * Apply a completed NTP sync (drift estimate, epoch offset).
+ * Call from the main task while WiFi is up; cheap when nothing arrived.
+ */
+void rtc_clock_ntp_poll();
+
+/**
+ * Current Unix time in seconds, or 0 if the clock was never synced since
+ * the last power loss.
+ */
+uint32_t rtc_clock_epoch_now();
+
+/**
+ * Current drift estimate in ppm (positive: RTC runs fast), 0 if unknown.
+ */
+int32_t rtc_clock_drift_ppm();
+
+#endif // RTC_CLOCK_H
@@ -15,4 +15,8 @@
 #define SECRET_MQTT_BROKER_USER     ""
 #define SECRET_MQTT_BROKER_PASSWORD ""
 
+// Optional, 16 characters: encrypts ESP-NOW traffic between nodes and the
+// gateway (CONTROL_TRANSPORT_ESPNOW / GATEWAY_ROLE builds).
+// #define SECRET_ESPNOW_KEY        "0123456789abcdef"
+
 #endif
@@ -3,12 +3,33 @@
  * 
  * Handles ADC reading from capacitive soil moisture sensor
  * and conversion to humidity percentage using calibration values.
+ *
+ * The once-per-wake decision reading (sensor_measure_all) also classifies
+ * sensor faults from the burst noise estimate and the wake-to-wake
+ * history, and smooths valid readings with a moving average kept in RTC
+ * memory across deep sleep.
  */
 
 #ifndef SENSOR_H
 #define SENSOR_H
 
 #include <Arduino.h>
+#include "config.h"
+
+// Every function taking `ch` addresses one plant channel
+// (0..PLANT_CHANNEL_COUNT-1); out-of-range channels fall back to 0.
+
+// =============================================================================
+// TYPES
+// =============================================================================
+
+/** Fault class of a channel, from its last sensor_measure_all() reading. */
+typedef enum {
+    SENSOR_OK = 0,
+    SENSOR_FAULT_DISCONNECTED,   // reading at a rail (open or shorted input)
+    SENSOR_FAULT_NOISY,          // burst spread above SENSOR_NOISE_MAX, even after a retry
+    SENSOR_FAULT_STUCK           // unchanged noise-free readings for SENSOR_STUCK_WAKES wakes
+} SensorFault;
 
 // =============================================================================
 // INITIALIZATION
@@ -28,20 +49,51 @@ void sensor_init();
  * Read raw ADC value from soil sensor.
  * Takes multiple samples and averages for noise reduction.
  * 
+ * @param ch Plant channel
  * @return Raw ADC value (0-4095 for 12-bit)
  */
-uint16_t sensor_read_raw();
+uint16_t sensor_read_raw(uint8_t ch);
+
+/**
+ * Read every soil channel in one ADC pass (one scan pattern, one
+ * start/stop), so N plants cost about the same wake time as one.
+ *
+ * @param raw Receives one raw value per channel
+ */
+void sensor_read_raw_all(uint16_t raw[PLANT_CHANNEL_COUNT]);
+
+/**
+ * Decision reading of every channel, once per wake: one burst with a noise
+ * estimate (noisy channels get one longer median burst), fault
+ * classification, then the moving average across wakes. Faulted channels
+ * report their raw value and leave the average untouched.
+ *
+ * Soak re-reads while watering use sensor_read_raw_all() instead, so the
+ * pulse response is not delayed by the average.
+ *
+ * @param filtered Receives the filtered raw value per channel
+ */
+void sensor_measure_all(uint16_t filtered[PLANT_CHANNEL_COUNT]);
+
+/**
+ * Fault class from the last sensor_measure_all(); kept across deep sleep.
+ */
+SensorFault sensor_get_fault(uint8_t ch);
+
+/** Short lowercase name of a fault class ("ok", "noisy", ...). */
+const char *sensor_fault_name(SensorFault fault);
 
 /**
  * Convert a raw ADC value to humidity percentage (0-100%).
- * Uses stored wet/dry calibration values for conversion.
+ * Uses the precomputed calibration context (no NVS access).
  * Use this when you already have a raw reading to avoid a
  * second ADC read.
  *
+ * @param ch  Plant channel whose calibration applies
  * @param raw Raw ADC value to convert
  * @return Humidity percentage (0-100), clamped to valid range
  */
-uint8_t sensor_raw_to_humidity_percent(uint16_t raw);
+uint8_t sensor_raw_to_humidity_percent(uint8_t ch, uint16_t raw);
 
 /**
  * Read soil humidity as percentage (0-100%).
@@ -49,7 +101,7 @@ uint8_t sensor_raw_to_humidity_percent(uint16_t raw);
  * 
  * @return Humidity percentage (0-100), clamped to valid range
  */
-uint8_t sensor_read_humidity_percent();
+uint8_t sensor_read_humidity_percent(uint8_t ch);
 
 // =============================================================================
 // CALIBRATION
@@ -62,7 +114,7 @@ uint8_t sensor_read_humidity_percent();
  * 
  * @return The raw value that was stored
  */
-uint16_t sensor_calibrate_dry();
+uint16_t sensor_calibrate_dry(uint8_t ch);
 
 /**
  * Perform wet calibration.
@@ -71,7 +123,14 @@ uint16_t sensor_calibrate_dry();
  * 
  * @return The raw value that was stored
  */
-uint16_t sensor_calibrate_wet();
+uint16_t sensor_calibrate_wet(uint8_t ch);
+
+/**
+ * Rebuild the precomputed calibration context of every channel from storage.
+ * Called by sensor_init() and the calibrate functions; call it after
+ * changing the dry/wet values through storage directly.
+ */
+void sensor_calibration_reload();
 
 /**
  * Check if sensor reading is within valid/expected range.
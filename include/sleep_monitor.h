@@ -0,0 +1,54 @@
+/**
+ * sleep_monitor.h - Deep sleep wake stub soil / reservoir monitor
+ *
+ * The C3 has no ULP or LP core, so monitoring runs in the deep sleep wake
+ * stub (RTC fast memory, runs before the bootloader loads the app). The
+ * planned sleep is cut into SLEEP_MONITOR_SLICE_SEC slices; on each slice
+ * the stub samples the soil ADC of every channel and the float switch and
+ * compares them with limits cached in RTC memory:
+ *   - soil drier than minimal humidity + SLEEP_MONITOR_MARGIN_PCT
+ *   - reservoir state different from the one at sleep entry
+ *   - soil reading outside the calibrated range (sensor fault)
+ *   - planned sleep over
+ * Any of these boots the app normally; otherwise the stub goes straight
+ * back to sleep after a few hundred microseconds.
+ *
+ * The stub uses a raw one-shot ADC conversion without the app's
+ * calibration, so the thresholds carry a margin and doubtful readings
+ * always fall through to a full wake.
+ */
+
+#ifndef SLEEP_MONITOR_H
+#define SLEEP_MONITOR_H
+
+#include <Arduino.h>
+#include "config.h"
+
+typedef enum {
+    MONITOR_TRIGGER_NONE = 0,   // not armed, or not a timer wake
+    MONITOR_TRIGGER_SCHEDULED,  // planned sleep over
+    MONITOR_TRIGGER_SOIL,       // a channel crossed its wake threshold
+    MONITOR_TRIGGER_RESERVOIR,  // float switch changed
+    MONITOR_TRIGGER_SENSOR      // implausible soil reading
+} MonitorTrigger;
+
+/**
+ * Arm the monitor for the coming deep sleep.
+ * Needs storage and sensor calibration; call before storage_close().
+ *
+ * @param sleep_sec  Planned sleep until the next full wake
+ * @return Seconds to program for the first slice (sleep_sec if the
+ *         monitor is disabled or not armed)
+ */
+uint32_t sleep_monitor_arm(uint32_t sleep_sec);
+
+/**
+ * Fetch why the stub let this wake through and disarm the monitor.
+ * Call early on every boot, before water_level_init() (releases the
+ * float switch pin hold).
+ *
+ * @param stub_wakes  Optional: slices the stub handled on its own
+ */
+MonitorTrigger sleep_monitor_boot(uint16_t *stub_wakes);
+
+#endif // SLEEP_MONITOR_H
@@ -0,0 +1,50 @@
+/**
+ * soil_model.h - Learned soil response for adaptive watering pulses
+ *
+ * Two numbers per plant channel, learned from the before/after readings of the
+ * pulse loop and persisted through storage:
+ *   gain    humidity increase per second of pump time at nominal flow
+ *           (0.001 %/s); pulses are dosed by volume, so it does not
+ *           drift with battery voltage
+ *   settle  time after a pulse until readings stop changing (ms)
+ *
+ * Until a value is learned the fixed PUMP_RUN_DURATION_MS /
+ * SOAK_WAIT_TIME_MS defaults are used.
+ */
+
+#ifndef SOIL_MODEL_H
+#define SOIL_MODEL_H
+
+#include <Arduino.h>
+
+/**
+ * Pump duration for the next pulse.
+ * Aims at SOIL_MODEL_TARGET_PCT of the gap to the target so the pulse
+ * lands just below it, clamped to [PUMP_MIN_PULSE_MS, PUMP_MAX_DURATION_MS].
+ *
+ * @param ch        Plant channel
+ * @param humidity  Current humidity (%)
+ * @param target    Target humidity (%)
+ */
+uint32_t soil_model_pulse_ms(uint8_t ch, uint8_t humidity, uint8_t target);
+
+/**
+ * Upper bound for the next soak wait (learned settle time + 25%,
+ * clamped to [SOAK_MIN_MS, SOAK_WAIT_TIME_MS]).
+ */
+uint32_t soil_model_soak_ms(uint8_t ch);
+
+/**
+ * Update the model from one pulse.
+ *
+ * @param ch         Plant channel
+ * @param pulse_ms   Pump time of the pulse
+ * @param before     Humidity before the pulse (%)
+ * @param after      Humidity after the soak (%)
+ * @param soaked_ms  How long the soak lasted
+ * @param settled    true if readings settled before the soak limit
+ */
+void soil_model_learn(uint8_t ch, uint32_t pulse_ms, uint8_t before, uint8_t after,
+                      uint32_t soaked_ms, bool settled);
+
+#endif // SOIL_MODEL_H
@@ -3,12 +3,16 @@
  * 
  * Wraps ESP32 Preferences library for storing calibration values,
  * settings, and timestamps that survive deep sleep and power cycles.
+ * Reads are served from an RTC-memory cache; writes are deferred until
+ * storage_commit() / storage_close(). Counters and timestamps that change
+ * on most wakes are appended to the counter log (counter_log.h) instead.
  */
 
 #ifndef STORAGE_H
 #define STORAGE_H
 
 #include <Arduino.h>
+#include "config.h"
 
 // =============================================================================
 // STORAGE INITIALIZATION
@@ -23,10 +27,20 @@
 bool storage_init();
 
 /**
- * Close NVS storage (call before deep sleep if needed).
+ * Write all dirty cached values to NVS in one pass.
+ * Cheap no-op when nothing changed.
+ */
+void storage_commit();
+
+/**
+ * Commit dirty values and close NVS storage (call before deep sleep).
  */
 void storage_close();
 
+// Calibration, thresholds, watering time and soil model are kept per
+// plant channel (ch = 0..PLANT_CHANNEL_COUNT-1, see config.h). Channel 0
+// uses the NVS keys of the single-plant firmware.
+
 // =============================================================================
 // CALIBRATION VALUES
 // =============================================================================
@@ -35,27 +49,29 @@ void storage_close();
  * Get dry calibration value (raw ADC reading for 0% humidity).
  * Returns stored value or DEFAULT_SENSOR_DRY if not set.
  */
-uint16_t storage_get_sensor_dry();
+uint16_t storage_get_sensor_dry(uint8_t ch);
 
 /**
  * Get wet calibration value (raw ADC reading for 100% humidity).
  * Returns stored value or DEFAULT_SENSOR_WET if not set.
  */
-uint16_t storage_get_sensor_wet();
+uint16_t storage_get_sensor_wet(uint8_t ch);
 
 /**
  * Store dry calibration value to NVS.
  * 
+ * @param ch    Plant channel
  * @param value Raw ADC reading when sensor is dry
  */
-void storage_set_sensor_dry(uint16_t value);
+void storage_set_sensor_dry(uint8_t ch, uint16_t value);
 
 /**
  * Store wet calibration value to NVS.
  * 
+ * @param ch    Plant channel
  * @param value Raw ADC reading when sensor is wet
  */
-void storage_set_sensor_wet(uint16_t value);
+void storage_set_sensor_wet(uint8_t ch, uint16_t value);
 
 // =============================================================================
 // HUMIDITY SETPOINT
@@ -65,27 +81,27 @@ void storage_set_sensor_wet(uint16_t value);
  * Get minimal humidity threshold percentage.
  * Returns stored value or DEFAULT_MINIMAL_HUMIDITY if not set.
  */
-uint8_t storage_get_minimal_humidity();
+uint8_t storage_get_minimal_humidity(uint8_t ch);
 
 /**
  * Store minimal humidity threshold percentage.
  * 
  * @param percent Humidity percentage (0-100)
  */
-void storage_set_minimal_humidity(uint8_t percent);
+void storage_set_minimal_humidity(uint8_t ch, uint8_t percent);
 
 /**
  * Get max humidity target percentage.
  * Returns stored value or DEFAULT_MAX_HUMIDITY if not set.
  */
-uint8_t storage_get_max_humidity();
+uint8_t storage_get_max_humidity(uint8_t ch);
 
 /**
  * Store max humidity target percentage.
  * 
  * @param percent Humidity percentage (0-100)
  */
-void storage_set_max_humidity(uint8_t percent);
+void storage_set_max_humidity(uint8_t ch, uint8_t percent);
 
 // =============================================================================
 // PLANT NAME
@@ -93,14 +109,30 @@ void storage_set_max_humidity(uint8_t percent);
 
 /**
  * Get persisted plant name used in MQTT payloads.
- * Returns MQTT_PLANT_NAME if not set.
+ * Returns MQTT_PLANT_NAME if not set. Points into the storage cache,
+ * valid until the next storage_set_plant_name().
+ */
+const char *storage_get_plant_name();
+
+/**
+ * Store plant name for MQTT payloads (truncated to MQTT_PLANT_NAME_MAX_LEN).
+ */
+void storage_set_plant_name(const char *name);
+
+// =============================================================================
+// MQTT GROUP
+// =============================================================================
+
+/**
+ * Get the command group this device joined (plant/group/<name>/cmd).
+ * Returns an empty string if it joined none.
  */
-String storage_get_plant_name();
+const char *storage_get_group();
 
 /**
- * Store plant name for MQTT payloads.
+ * Persist the command group (truncated to MQTT_GROUP_MAX_LEN, empty = none).
  */
-void storage_set_plant_name(const String &name);
+void storage_set_group(const char *group);
 
 // =============================================================================
 // RUNTIME POWER MODE
@@ -125,12 +157,12 @@ void storage_set_deep_sleep_enabled(bool enabled);
  * Get last processed MQTT command id.
  * Returns empty string if none has been processed yet.
  */
-String storage_get_last_command_id();
+const char *storage_get_last_command_id();
 
 /**
- * Persist last processed MQTT command id.
+ * Persist last processed MQTT command id (truncated to STORAGE_CMD_ID_MAX_LEN).
  */
-void storage_set_last_command_id(const String &cmd_id);
+void storage_set_last_command_id(const char *cmd_id);
 
 // =============================================================================
 // WATERING TIMESTAMP
@@ -141,14 +173,82 @@ void storage_set_last_command_id(const String &cmd_id);
  * Returns persistent time in seconds (accumulated across boots).
  * Returns 0 if never watered.
  */
-uint32_t storage_get_last_watering_time();
+uint32_t storage_get_last_watering_time(uint8_t ch);
 
 /**
  * Store timestamp of last watering event.
  * 
  * @param timestamp Persistent time in seconds
  */
-void storage_set_last_watering_time(uint32_t timestamp);
+void storage_set_last_watering_time(uint8_t ch, uint32_t timestamp);
+
+// =============================================================================
+// SOIL RESPONSE MODEL
+// =============================================================================
+
+/**
+ * Get the learned humidity gain per second of pump time.
+ *
+ * @return Gain in 0.001 %/s, 0 if not learned yet
+ */
+uint16_t storage_get_soil_gain(uint8_t ch);
+
+/**
+ * Get the learned time for a reading to settle after a pulse.
+ *
+ * @return Settle time in ms, 0 if not learned yet
+ */
+uint32_t storage_get_soil_settle_ms(uint8_t ch);
+
+/**
+ * Store the soil response model (see soil_model.h).
+ */
+void storage_set_soil_model(uint8_t ch, uint16_t gain, uint32_t settle_ms);
+
+// =============================================================================
+// TELEMETRY LOG CURSOR
+// =============================================================================
+
+/**
+ * Get the first telemetry record sequence number not yet uploaded.
+ * Survives power loss so the flash log upload resumes where it stopped.
+ *
+ * @return Sequence number, 0 if never uploaded
+ */
+uint32_t storage_get_telemetry_upload_seq();
+
+/**
+ * Store the telemetry upload cursor.
+ */
+void storage_set_telemetry_upload_seq(uint32_t seq);
+
+// =============================================================================
+// OTA UPDATE JOB
+// =============================================================================
+
+/** Pending firmware download (ota_update.h); url[0] == '\0' means none. */
+typedef struct {
+    char     url[OTA_URL_MAX_LEN + 1];
+    uint8_t  sha256[32];
+    uint32_t size;       // image size, 0 until the server reported it
+    uint32_t offset;     // bytes already written to the update slot
+} StorageOtaJob;
+
+/**
+ * Get the pending OTA job. Survives power loss so a download resumes
+ * where it stopped.
+ */
+const StorageOtaJob *storage_get_ota_job();
+
+/**
+ * Replace the OTA job (progress included), or clear it with nullptr.
+ */
+void storage_set_ota_job(const StorageOtaJob *job);
+
+/**
+ * Store the download progress of the current job.
+ */
+void storage_set_ota_progress(uint32_t offset, uint32_t size);
 
 // =============================================================================
 // PERSISTENT TIME TRACKING
@@ -156,22 +256,20 @@ void storage_set_last_watering_time(uint32_t timestamp);
 
 /**
  * Get current persistent time in seconds.
- * Accumulates time across deep sleep cycles and reboots.
- * Uses boot count and measurement interval to track total elapsed time.
+ * Read from the RTC timer clock (rtc_clock.h), so it keeps running
+ * through deep sleep and while awake; restored from NVS after power loss.
  * 
  * @return Total elapsed seconds since first boot
  */
 uint32_t storage_get_persistent_time();
 
 /**
- * Increment boot counter and update persistent time.
+ * Increment boot counter.
  * Call this once per wake from deep sleep.
  *
- * @param sleep_duration_sec  How long the ESP was asleep (e.g. MEASUREMENT_INTERVAL_SEC on timer wake, 0 on power-on)
- * @param awake_duration_sec  How long the ESP was awake this cycle
+ * @param power_on  true on power-on (counters are written to NVS at once)
  */
-void storage_increment_boot_count(uint32_t sleep_duration_sec,
-                                  uint32_t awake_duration_sec);
+void storage_increment_boot_count(bool power_on);
 
 /**
  * Get total boot count.
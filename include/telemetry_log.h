@@ -0,0 +1,104 @@
+/**
+ * telemetry_log.h - On-device telemetry history interface
+ *
+ * One fixed-size record per plant channel and timer wake, kept in an RTC-memory ring and
+ * spilled to a raw flash partition (TELEMETRY_FLASH_PARTITION) when the
+ * ring fills. The MQTT path uploads the backlog in batches every
+ * TELEMETRY_UPLOAD_EVERY_WAKES wakes, so the radio does not have to come
+ * up on every wake to keep a full-resolution history.
+ *
+ * Records carry a monotonically increasing sequence number; the upload
+ * cursor is persisted in NVS so an interrupted upload resumes.
+ */
+
+#ifndef TELEMETRY_LOG_H
+#define TELEMETRY_LOG_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// =============================================================================
+// RECORD FORMAT
+// =============================================================================
+
+#define TELEMETRY_FLAG_WATER_OK   (1u << 0)   // reservoir level OK
+#define TELEMETRY_FLAG_FAULT_SHIFT   1        // bits 1-2: SensorFault
+#define TELEMETRY_FLAG_FAULT_MASK    (0x3u << TELEMETRY_FLAG_FAULT_SHIFT)
+#define TELEMETRY_FLAG_CHANNEL_SHIFT 5        // bits 5-7: plant channel
+#define TELEMETRY_FLAG_CHANNEL_MASK  (0x7u << TELEMETRY_FLAG_CHANNEL_SHIFT)
+#define TELEMETRY_RESULT_NONE     0xFF        // no watering check this wake
+
+typedef struct __attribute__((packed)) {
+    uint32_t seq;          // sequence number (0xFFFFFFFF = erased flash)
+    uint32_t ts;           // persistent time (s)
+    uint16_t raw_soil;     // raw ADC
+    uint16_t battery_mv;
+    uint8_t  humidity;     // %
+    uint8_t  flags;        // TELEMETRY_FLAG_*
+    uint8_t  result;       // WateringResult or TELEMETRY_RESULT_NONE
+    uint8_t  crc;          // CRC-8 over the preceding bytes
+} TelemetryRecord;
+
+/**
+ * Upload sink: publish the first records of the batch that fit into one
+ * message and return how many, 0 to stop the upload (records stay
+ * pending).
+ */
+typedef uint16_t (*TelemetryBatchSink)(const TelemetryRecord *records, uint16_t count);
+
+// =============================================================================
+// API
+// =============================================================================
+
+/**
+ * Restore the log after a wake. Rebuilds the write position from flash
+ * after power loss. Call after storage_init().
+ */
+void telemetry_log_init();
+
+/**
+ * Append one record per plant channel for this wake from live sensor /
+ * battery / reservoir readings (all soil channels in one ADC pass).
+ *
+ * @param results  WateringResult of each channel, or TELEMETRY_RESULT_NONE
+ */
+void telemetry_log_record_wake(const uint8_t results[PLANT_CHANNEL_COUNT]);
+
+/**
+ * True if this timer wake should bring the radio up to upload
+ * (the wake completes a TELEMETRY_UPLOAD_EVERY_WAKES batch).
+ */
+bool telemetry_log_upload_due();
+
+/**
+ * Restart the TELEMETRY_UPLOAD_EVERY_WAKES count: call on every wake that
+ * brought the radio up, whether or not the upload could run.
+ */
+void telemetry_log_upload_attempted();
+
+/**
+ * Number of records not yet uploaded.
+ */
+uint32_t telemetry_log_pending();
+
+/**
+ * Most recent records of one plant channel, newest first. Only looks at
+ * the last TELEMETRY_RTC_RECORDS records still held in RTC memory (no
+ * flash access), so it is cheap enough to call on every wake.
+ *
+ * @param ch   Plant channel
+ * @param out  Receives up to max records
+ * @return Records written to out
+ */
+uint16_t telemetry_log_recent(uint8_t ch, TelemetryRecord *out, uint16_t max);
+
+/**
+ * Upload pending records oldest-first in batches of up to
+ * TELEMETRY_BATCH_RECORDS and advance the cursor past every record the
+ * sink accepted; the next batch starts at the first one it left.
+ *
+ * @return Records uploaded
+ */
+uint32_t telemetry_log_upload(TelemetryBatchSink sink);
+
+#endif // TELEMETRY_LOG_H
@@ -0,0 +1,31 @@
+/**
+ * wake_scheduler.h - Adaptive deep sleep interval
+ *
+ * Picks the timer wake interval instead of a fixed MEASUREMENT_INTERVAL_SEC:
+ *   - right after watering: WAKE_CONFIRM_INTERVAL_SEC to check the result
+ *   - otherwise: fit the humidity trend of each channel from the telemetry
+ *     log and sleep until shortly before the first channel is predicted to
+ *     cross its minimal humidity (and is allowed to be watered)
+ *   - with a forecast (forecast.h): the predicted crossing from the
+ *     forecast ET when it is earlier, or a rain recheck while watering
+ *     is held for rain
+ *   - a low battery stretches the interval
+ */
+
+#ifndef WAKE_SCHEDULER_H
+#define WAKE_SCHEDULER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "watering.h"
+
+/**
+ * Interval for the next deep sleep.
+ *
+ * @param results  This wake's watering result per channel, or nullptr
+ *                 if no watering check ran
+ * @return Seconds, clamped to [WAKE_MIN_INTERVAL_SEC, WAKE_MAX_INTERVAL_SEC]
+ */
+uint32_t wake_scheduler_next_interval(const WateringResult *results);
+
+#endif // WAKE_SCHEDULER_H
@@ -3,12 +3,15 @@
  * 
  * Central decision engine that determines when to water.
  * Checks humidity, water reservoir level, battery, and timing constraints.
+ * Thresholds, calibration and the watering interval are per plant channel;
+ * reservoir and battery are shared.
  */
 
 #ifndef WATERING_H
 #define WATERING_H
 
 #include <Arduino.h>
+#include "config.h"
 
 // =============================================================================
 // WATERING RESULT CODES
@@ -40,31 +43,36 @@ void watering_init();
 // =============================================================================
 
 /**
- * Check all conditions and perform automatic watering if needed.
- * This is the main function called during timer wake.
+ * Check all conditions and perform automatic watering if needed, for
+ * every plant channel. This is the main function called during timer wake.
  * 
- * Decision logic:
- * 1. Read sensor → calculate humidity %
+ * Decision logic (per channel):
+ * 1. Read sensors (one ADC pass) → calculate humidity %
  * 2. Compare humidity to minimal threshold
  * 3. Check water reservoir level
  * 4. Check battery level
  * 5. Check time since last watering
  * 6. If all conditions met → pulse-pump loop:
- *    pump → wait soak → re-read → repeat until >= max humidity or safety limit
+ *    pump → wait soak → re-read → repeat until >= max humidity or safety limit;
+ *    one channel pumps while the others soak
  * 7. Update last watering timestamp
  * 
- * @return Result code indicating what happened
+ * @param results Receives the result of each channel
+ * @return Most significant result over all channels
+ *         (PUMP_FAILED > SENSOR_ERROR > RESERVOIR_LOW > BATTERY_LOW >
+ *          PARTIAL > OK > TOO_SOON > NOT_NEEDED)
  */
-WateringResult watering_check_and_execute();
+WateringResult watering_check_and_execute(WateringResult results[PLANT_CHANNEL_COUNT]);
 
 /**
  * Perform manual watering (triggered by user button).
  * Still enforces battery and timing constraints for safety.
  * 
+ * @param ch             Plant channel to water
  * @param force_override If true, skip interval check (use with caution)
  * @return Result code indicating what happened
  */
-WateringResult watering_manual(bool force_override);
+WateringResult watering_manual(uint8_t ch, bool force_override);
 
 // =============================================================================
 // STATUS QUERIES
@@ -76,7 +84,7 @@ WateringResult watering_manual(bool force_override);
  * 
  * @return true if watering would be permitted
  */
-bool watering_is_allowed();
+bool watering_is_allowed(uint8_t ch);
 
 /**
  * Get seconds until next watering is allowed.
@@ -84,20 +92,20 @@ bool watering_is_allowed();
  * 
  * @return Seconds remaining, or 0 if allowed now
  */
-uint32_t watering_get_seconds_until_allowed();
+uint32_t watering_get_seconds_until_allowed(uint8_t ch);
 
 /**
  * Get current soil humidity reading.
  * 
  * @return Humidity percentage (0-100)
  */
-uint8_t watering_get_current_humidity();
+uint8_t watering_get_current_humidity(uint8_t ch);
 
 /**
  * Check if soil needs water based on humidity threshold.
  * 
  * @return true if humidity < minimal threshold
  */
-bool watering_soil_needs_water();
+bool watering_soil_needs_water(uint8_t ch);
 
 #endif // WATERING_H
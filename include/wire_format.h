@@ -0,0 +1,82 @@
+/**
+ * wire_format.h - Compact binary MQTT payloads
+ *
+ * Versioned little-endian frames published on the ".../bin" topics next to
+ * the JSON ones (MQTT_WIRE_FORMAT selects which are sent). Every frame
+ * starts with a two byte header:
+ *
+ *   [0] WIRE_VERSION   bumped on any incompatible layout change
+ *   [1] WireMsgType
+ *
+ * Strings are length-prefixed (u8 length, no terminator). Encoders and
+ * the command decoder work on caller-provided fixed buffers; nothing is
+ * allocated. The host decoder lives in host_app/logic/plant_mqtt_logic.py
+ * and must be kept in step with the layouts below.
+ */
+
+#ifndef WIRE_FORMAT_H
+#define WIRE_FORMAT_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "telemetry_log.h"
+
+#define WIRE_VERSION          1
+#define WIRE_CMD_MAX_LEN      63     // longest accepted command text
+
+typedef enum {
+    WIRE_MSG_TELEMETRY       = 0x01,  // u32 ts, u8 humidity, u8 battery, u8 min, u8 max, u8 flags, str plant, u8 channel
+    WIRE_MSG_ACK             = 0x02,  // u32 ts, u8 ok, str plant, str id, str cmd, str detail
+    WIRE_MSG_TELEMETRY_BATCH = 0x03,  // str plant, u8 count, count x record (see wire_encode_telemetry_batch)
+    WIRE_MSG_COMMAND         = 0x10   // str id, str cmd
+} WireMsgType;
+
+// WIRE_MSG_TELEMETRY flags
+#define WIRE_FLAG_WATER_OK    (1u << 0)
+#define WIRE_FLAG_DEEP_SLEEP  (1u << 1)
+#define WIRE_FLAG_FAULT_SHIFT 2                          // bits 2-3: SensorFault
+#define WIRE_FLAG_FAULT_MASK  (0x3u << WIRE_FLAG_FAULT_SHIFT)
+
+typedef struct {
+    uint32_t ts;
+    uint8_t  humidity;
+    uint8_t  battery;
+    uint8_t  min_h;
+    uint8_t  max_h;
+    uint8_t  flags;       // WIRE_FLAG_*
+    uint8_t  channel;     // plant channel
+} WireTelemetry;
+
+typedef struct {
+    char id[STORAGE_CMD_ID_MAX_LEN + 1];
+    char cmd[WIRE_CMD_MAX_LEN + 1];
+} WireCommand;
+
+// =============================================================================
+// ENCODE (return frame length, 0 if it does not fit into cap)
+// =============================================================================
+
+size_t wire_encode_telemetry(uint8_t *out, size_t cap, const char *plant, const WireTelemetry *t);
+
+size_t wire_encode_ack(uint8_t *out, size_t cap, const char *plant, uint32_t ts,
+                       const char *cmd_id, const char *cmd, bool ok, const char *detail);
+
+/**
+ * Logged telemetry records, 15 bytes each:
+ *   u32 seq, u32 ts, u16 raw_soil, u16 battery_mv, u8 humidity, u8 flags, u8 result
+ * (TelemetryRecord without its flash CRC; flags carry the plant channel).
+ */
+size_t wire_encode_telemetry_batch(uint8_t *out, size_t cap, const char *plant,
+                                   const TelemetryRecord *records, uint16_t count);
+
+// =============================================================================
+// DECODE
+// =============================================================================
+
+/**
+ * Decode a WIRE_MSG_COMMAND frame into out (NUL-terminated strings).
+ * @return false on wrong version/type, truncation or over-long fields
+ */
+bool wire_decode_command(const uint8_t *in, size_t len, WireCommand *out);
+
+#endif // WIRE_FORMAT_H
@@ -0,0 +1,64 @@
+"""
+PlatformIO extra script for the build profiles in platformio.ini.
+
+- LTO: a profile that compiles with -flto also needs it (and its
+  optimization level) on the link line, where the code is generated.
+- Size report: after each build the image size of the environment is
+  printed and appended to <build_dir>/profile_sizes.csv, so profiles can
+  be compared side by side:
+
+      pio run -e production_mqtt -e production_buttons -e debug
+
+Boot-to-setup() time is measured on the board: every wake profile carries
+it as "setup_us" (profile topic, or the [PROF] debug line).
+"""
+
+import csv
+import os
+import subprocess
+import time
+
+Import("env")  # noqa: F821 (provided by PlatformIO)
+
+ccflags = env.Flatten(env.get("CCFLAGS", []))  # noqa: F821
+if "-flto" in ccflags:
+    link = ["-flto"] + [f for f in ccflags if f.startswith("-O")][-1:]
+    env.Append(LINKFLAGS=[f for f in link if f not in env.get("LINKFLAGS", [])])  # noqa: F821
+
+
+def _elf_sections(elf_path, size_tool):
+    """text/data/bss of the ELF from the toolchain's size (Berkeley format)."""
+    try:
+        out = subprocess.run([size_tool, "-B", elf_path], capture_output=True, text=True, check=True).stdout
+    except (OSError, subprocess.CalledProcessError):
+        return None
+    lines = out.strip().splitlines()
+    if len(lines) < 2:
+        return None
+    text, data, bss = (int(v) for v in lines[1].split()[:3])
+    return text, data, bss
+
+
+def report_size(source, target, env):
+    build_dir = env.subst("$BUILD_DIR")
+    bin_path = str(target[0])
+    elf_path = os.path.join(build_dir, env.subst("${PROGNAME}.elf"))
+    image = os.path.getsize(bin_path)
+    sections = _elf_sections(elf_path, env.subst("$SIZETOOL"))
+    name = env.subst("$PIOENV")
+
+    line = f"[profile] {name}: image {image} bytes"
+    if sections is not None:
+        line += " (text {} / data {} / bss {})".format(*sections)
+    print(line)
+
+    log_path = os.path.join(os.path.dirname(build_dir), "profile_sizes.csv")
+    new_file = not os.path.exists(log_path)
+    with open(log_path, "a", newline="") as f:
+        writer = csv.writer(f)
+        if new_file:
+            writer.writerow(["time", "env", "image", "text", "data", "bss"])
+        writer.writerow([time.strftime("%Y-%m-%d %H:%M:%S"), name, image, *(sections or ("", "", ""))])
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.bin", report_size)  # noqa: F821
@@ -0,0 +1,513 @@
+/**
+ * adc_sampler.cpp - Shared ADC sampling engine implementation
+ *
+ * Battery and soil channels are converted back-to-back by the ADC's DMA
+ * controller at ADC_SAMPLER_RATE_HZ: through the adc_continuous driver on
+ * ESP-IDF 5, or the adc_digi_* API of driver/adc.h on ESP-IDF 4.4 (Arduino
+ * core 2.0.x). The driver only runs while a burst is collected, and the CPU
+ * is free to run other tasks while it waits for DMA frames.
+ *
+ * While a stream runs (adc_sampler_stream_start()) the driver stays
+ * started and a task owns the DMA pool: it feeds the stream sink and the
+ * burst in progress, if any, from the same frames.
+ *
+ * If neither API is available, or the driver cannot be set up, readings
+ * use the previous analogRead() loop.
+ */
+
+#include "adc_sampler.h"
+#include "config.h"
+#include "hw_init.h"
+#include <math.h>
+#include <string.h>
+
+#if __has_include("esp_adc/adc_continuous.h")
+#include "esp_adc/adc_continuous.h"
+#define ADC_SAMPLER_HAS_CONTINUOUS 1
+#define ADC_SAMPLER_LEGACY_DIGI    0
+#elif __has_include("driver/adc.h")
+#include "driver/adc.h"
+#define ADC_SAMPLER_HAS_CONTINUOUS 1
+#define ADC_SAMPLER_LEGACY_DIGI    1
+#else
+#define ADC_SAMPLER_HAS_CONTINUOUS 0
+#define ADC_SAMPLER_LEGACY_DIGI    0
+#endif
+
+#if ADC_SAMPLER_HAS_CONTINUOUS
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+#if POWER_LOG_ENABLED && !ADC_SAMPLER_HAS_CONTINUOUS
+#error "POWER_LOG_ENABLED needs the ADC DMA driver (esp_adc/adc_continuous.h or driver/adc.h)"
+#endif
+
+static gpio_num_t adc_pin(uint8_t ch) {
+#if POWER_LOG_HAS_SENSE
+    if (ch == ADC_CH_POWER_SENSE) {
+        return POWER_LOG_SENSE_PIN;
+    }
+#endif
+    return (ch == ADC_CH_BATTERY) ? PIN_BATTERY_ADC
+                                  : PLANT_CHANNELS[ch - ADC_CH_SOIL].soil_pin;
+}
+
+bool adc_sampler_adc1_channel(gpio_num_t pin, uint8_t *channel) {
+#if ADC_SAMPLER_LEGACY_DIGI
+    // The 4.4 driver only maps channel -> GPIO
+    for (int c = 0; c < ADC1_CHANNEL_MAX; ++c) {
+        gpio_num_t io;
+        if (adc1_pad_get_io_num((adc1_channel_t)c, &io) == ESP_OK && io == pin) {
+            *channel = (uint8_t)c;
+            return true;
+        }
+    }
+    return false;
+#elif ADC_SAMPLER_HAS_CONTINUOUS
+    adc_unit_t unit;
+    adc_channel_t ch;
+    if (adc_continuous_io_to_channel(pin, &unit, &ch) != ESP_OK || unit != ADC_UNIT_1) {
+        return false;
+    }
+    *channel = (uint8_t)ch;
+    return true;
+#else
+    (void)pin;
+    (void)channel;
+    return false;
+#endif
+}
+
+// Burst buffer, shared by all channels (one burst at a time). A group
+// burst splits it into n slices of `per` samples.
+static uint16_t s_samples[ADC_SAMPLER_MAX_SAMPLES];
+
+// =============================================================================
+// CONTINUOUS (DMA) BACKEND
+// =============================================================================
+
+#if ADC_SAMPLER_HAS_CONTINUOUS
+
+#define ADC_RESULT_BYTES         sizeof(adc_digi_output_data_t)
+#define ADC_SAMPLER_FRAME_BYTES  (64 * ADC_RESULT_BYTES)
+#define ADC_STREAM_TASK_STACK    3072
+#define ADC_STREAM_TASK_PRIORITY 5
+#define ADC_STREAM_READ_MS       20
+#define ADC_NO_CHANNEL           0xFF
+
+static uint8_t s_channel_id[ADC_CH_COUNT];
+static uint8_t s_channel_of[16];             // ADC1 channel id -> AdcChannel
+static uint8_t s_frame[ADC_SAMPLER_FRAME_BYTES];
+
+// Burst being collected: got_n[i] samples of channel first + i go to
+// s_samples[i * per ...].
+typedef struct {
+    uint8_t  first;
+    uint8_t  n;
+    uint16_t per;
+    uint16_t *got_n;
+    uint8_t  complete;
+} Capture;
+
+// Stream state. The capture handed to the stream task is guarded by
+// s_cap_mux; the task clears s_stream_cap once it is complete.
+static volatile bool s_streaming = false;
+static volatile bool s_stream_task_running = false;
+static AdcStreamSink s_stream_sink = nullptr;
+static Capture *volatile s_stream_cap = nullptr;
+static portMUX_TYPE s_cap_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Fills a DMA pattern entry for one ADC1 channel.
+static void pattern_entry(adc_digi_pattern_config_t *p, uint8_t channel) {
+    p->atten     = ADC_ATTEN_DB_11;
+    p->channel   = channel;
+    p->unit      = ADC_UNIT_1;
+    p->bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+}
+
+#if ADC_SAMPLER_LEGACY_DIGI
+
+// ESP-IDF 4.4: the digital controller is a single global instance.
+static bool s_dma_ready = false;
+
+static bool continuous_init() {
+    if (s_dma_ready) {
+        return true;
+    }
+
+    adc_digi_pattern_config_t pattern[ADC_CH_COUNT] = {};
+    uint32_t chan_mask = 0;
+    memset(s_channel_of, ADC_NO_CHANNEL, sizeof(s_channel_of));
+    for (uint8_t i = 0; i < ADC_CH_COUNT; ++i) {
+        uint8_t channel;
+        if (!adc_sampler_adc1_channel(adc_pin(i), &channel)) {
+            return false;
+        }
+        s_channel_id[i]      = channel;
+        s_channel_of[channel & 0x0F] = i;
+        chan_mask |= 1UL << channel;
+        pattern_entry(&pattern[i], channel);
+    }
+
+    adc_digi_init_config_t init_cfg = {};
+    init_cfg.max_store_buf_size = ADC_SAMPLER_FRAME_BYTES * 4;
+    init_cfg.conv_num_each_intr = ADC_SAMPLER_FRAME_BYTES;
+    init_cfg.adc1_chan_mask     = chan_mask;
+    if (adc_digi_initialize(&init_cfg) != ESP_OK) {
+        return false;
+    }
+
+    adc_digi_configuration_t dig_cfg = {};
+    dig_cfg.conv_limit_en  = false;
+    dig_cfg.pattern_num    = ADC_CH_COUNT;
+    dig_cfg.adc_pattern    = pattern;
+    dig_cfg.sample_freq_hz = ADC_SAMPLER_RATE_HZ;
+    dig_cfg.conv_mode      = ADC_CONV_SINGLE_UNIT_1;
+    dig_cfg.format         = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+    if (adc_digi_controller_configure(&dig_cfg) != ESP_OK) {
+        adc_digi_deinitialize();
+        return false;
+    }
+    s_dma_ready = true;
+    return true;
+}
+
+static void dma_start() { adc_digi_start(); }
+static void dma_stop()  { adc_digi_stop(); }
+
+// Reads one frame into s_frame. ESP_ERR_INVALID_STATE means the pool
+// overflowed; the bytes it returns are still valid conversions.
+static bool dma_read(uint32_t *got, uint32_t timeout_ms) {
+    const esp_err_t err = adc_digi_read_bytes(s_frame, sizeof(s_frame), got, timeout_ms);
+    return err == ESP_OK || (err == ESP_ERR_INVALID_STATE && *got > 0);
+}
+
+#else // ESP-IDF 5 adc_continuous
+
+static adc_continuous_handle_t s_handle = nullptr;
+
+static bool continuous_init() {
+    if (s_handle != nullptr) {
+        return true;
+    }
+
+    adc_continuous_handle_cfg_t handle_cfg = {};
+    handle_cfg.max_store_buf_size = ADC_SAMPLER_FRAME_BYTES * 4;
+    handle_cfg.conv_frame_size    = ADC_SAMPLER_FRAME_BYTES;
+    if (adc_continuous_new_handle(&handle_cfg, &s_handle) != ESP_OK) {
+        s_handle = nullptr;
+        return false;
+    }
+
+    adc_digi_pattern_config_t pattern[ADC_CH_COUNT] = {};
+    memset(s_channel_of, ADC_NO_CHANNEL, sizeof(s_channel_of));
+    for (uint8_t i = 0; i < ADC_CH_COUNT; ++i) {
+        uint8_t channel;
+        if (!adc_sampler_adc1_channel(adc_pin(i), &channel)) {
+            adc_continuous_deinit(s_handle);
+            s_handle = nullptr;
+            return false;
+        }
+        s_channel_id[i]      = channel;
+        s_channel_of[channel & 0x0F] = i;
+        pattern_entry(&pattern[i], channel);
+    }
+
+    adc_continuous_config_t dig_cfg = {};
+    dig_cfg.pattern_num    = ADC_CH_COUNT;
+    dig_cfg.adc_pattern    = pattern;
+    dig_cfg.sample_freq_hz = ADC_SAMPLER_RATE_HZ;
+    dig_cfg.conv_mode      = ADC_CONV_SINGLE_UNIT_1;
+    dig_cfg.format         = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+    if (adc_continuous_config(s_handle, &dig_cfg) != ESP_OK) {
+        adc_continuous_deinit(s_handle);
+        s_handle = nullptr;
+        return false;
+    }
+    return true;
+}
+
+static void dma_start() { adc_continuous_start(s_handle); }
+static void dma_stop()  { adc_continuous_stop(s_handle); }
+
+static bool dma_read(uint32_t *got, uint32_t timeout_ms) {
+    return adc_continuous_read(s_handle, s_frame, sizeof(s_frame), got, timeout_ms) == ESP_OK;
+}
+
+#endif // ADC_SAMPLER_LEGACY_DIGI
+
+// Sorts the conversions of the first got bytes of s_frame into cap.
+// Returns true once every channel of the capture is complete.
+static bool capture_frame(Capture *cap, uint32_t got) {
+    for (uint32_t off = 0; off + ADC_RESULT_BYTES <= got;
+         off += ADC_RESULT_BYTES) {
+        const adc_digi_output_data_t *p = (const adc_digi_output_data_t *)&s_frame[off];
+        for (uint8_t i = 0; i < cap->n; ++i) {
+            if (p->type2.channel != s_channel_id[cap->first + i] || cap->got_n[i] >= cap->per) {
+                continue;
+            }
+            s_samples[i * cap->per + cap->got_n[i]++] = (uint16_t)p->type2.data;
+            if (cap->got_n[i] == cap->per) cap->complete++;
+            break;
+        }
+    }
+    return cap->complete >= cap->n;
+}
+
+static void stream_frame(uint32_t got) {
+    for (uint32_t off = 0; off + ADC_RESULT_BYTES <= got;
+         off += ADC_RESULT_BYTES) {
+        const adc_digi_output_data_t *p = (const adc_digi_output_data_t *)&s_frame[off];
+        const uint8_t ch = s_channel_of[p->type2.channel & 0x0F];
+        if (ch != ADC_NO_CHANNEL) {
+            s_stream_sink((AdcChannel)ch, (uint16_t)p->type2.data);
+        }
+    }
+}
+
+// Drop conversions left in the pool so the next burst starts fresh.
+static void continuous_drain() {
+    uint32_t got = 0;
+    while (dma_read(&got, 0)) {
+    }
+}
+
+static void continuous_capture(Capture *cap) {
+    dma_start();
+    const uint32_t start_ms = millis();
+    while (cap->complete < cap->n && (millis() - start_ms) < ADC_SAMPLER_TIMEOUT_MS) {
+        uint32_t got = 0;
+        if (!dma_read(&got, ADC_SAMPLER_TIMEOUT_MS)) {
+            continue;
+        }
+        capture_frame(cap, got);
+    }
+    dma_stop();
+    continuous_drain();
+}
+
+// Hand the capture to the stream task and wait for it. On timeout the
+// capture is withdrawn, keeping whatever was collected.
+static void stream_capture(Capture *cap) {
+    portENTER_CRITICAL(&s_cap_mux);
+    s_stream_cap = cap;
+    portEXIT_CRITICAL(&s_cap_mux);
+
+    const uint32_t start_ms = millis();
+    while (s_stream_cap == cap && (millis() - start_ms) < ADC_SAMPLER_TIMEOUT_MS) {
+        delay(1);
+    }
+    portENTER_CRITICAL(&s_cap_mux);
+    s_stream_cap = nullptr;
+    portEXIT_CRITICAL(&s_cap_mux);
+}
+
+static void stream_task(void *arg) {
+    (void)arg;
+    while (s_streaming) {
+        uint32_t got = 0;
+        if (!dma_read(&got, ADC_STREAM_READ_MS)) {
+            continue;
+        }
+        stream_frame(got);
+
+        portENTER_CRITICAL(&s_cap_mux);
+        Capture *cap = s_stream_cap;
+        if (cap != nullptr && capture_frame(cap, got)) {
+            s_stream_cap = nullptr;
+        }
+        portEXIT_CRITICAL(&s_cap_mux);
+    }
+    s_stream_task_running = false;
+    vTaskDelete(nullptr);
+}
+
+#endif // ADC_SAMPLER_HAS_CONTINUOUS
+
+// =============================================================================
+// analogRead() FALLBACK
+// =============================================================================
+
+static void oneshot_capture(uint8_t first, uint8_t n, uint16_t per, uint16_t *got_n) {
+    const uint16_t count = (per > ADC_SAMPLES) ? ADC_SAMPLES : per;
+    for (uint16_t k = 0; k < count; ++k) {
+        for (uint8_t i = 0; i < n; ++i) {
+            s_samples[i * per + k] = analogRead(adc_pin(first + i));
+        }
+        delayMicroseconds(100);  // Small delay between samples
+    }
+    for (uint8_t i = 0; i < n; ++i) got_n[i] = count;
+}
+
+// =============================================================================
+// INITIALIZATION
+// =============================================================================
+
+static bool s_use_continuous = false;
+
+void adc_sampler_init() {
+#if ADC_SAMPLER_HAS_CONTINUOUS
+    s_use_continuous = continuous_init();
+#endif
+    if (!s_use_continuous) {
+        analogReadResolution(ADC_RESOLUTION);
+        analogSetAttenuation(ADC_ATTENUATION);
+    }
+
+    #if DEBUG_SERIAL
+    Serial.println(s_use_continuous ? "[ADC] Continuous DMA sampling"
+                                    : "[ADC] analogRead sampling");
+    #endif
+}
+
+// =============================================================================
+// READING
+// =============================================================================
+
+void adc_sampler_read_group(AdcChannel first, uint8_t n, uint16_t count, AdcReduce mode,
+                            uint16_t *out, uint16_t *spread) {
+    hw_require(HW_ADC);
+    if (n == 0) {
+        return;
+    }
+    if (count > ADC_SAMPLER_MAX_SAMPLES / n) {
+        count = ADC_SAMPLER_MAX_SAMPLES / n;
+    }
+
+    uint16_t got[ADC_CH_COUNT] = {};
+#if ADC_SAMPLER_HAS_CONTINUOUS
+    if (s_use_continuous) {
+        Capture cap = {(uint8_t)first, n, count, got, 0};
+        if (s_streaming) {
+            stream_capture(&cap);
+        } else {
+            continuous_capture(&cap);
+        }
+    } else
+#endif
+    {
+        oneshot_capture((uint8_t)first, n, count, got);
+    }
+
+    for (uint8_t i = 0; i < n; ++i) {
+        if (spread != nullptr) {
+            spread[i] = adc_spread(&s_samples[i * count], got[i]);
+        }
+        out[i] = adc_reduce(&s_samples[i * count], got[i], mode);
+    }
+}
+
+uint16_t adc_sampler_read(AdcChannel ch, uint16_t count, AdcReduce mode) {
+    uint16_t value = 0;
+    adc_sampler_read_group(ch, 1, count, mode, &value);
+    return value;
+}
+
+// =============================================================================
+// STREAMING
+// =============================================================================
+
+bool adc_sampler_stream_start(AdcStreamSink sink) {
+    hw_require(HW_ADC);
+#if ADC_SAMPLER_HAS_CONTINUOUS
+    if (!s_use_continuous || s_streaming || sink == nullptr) {
+        return false;
+    }
+    s_stream_sink = sink;
+    s_streaming = true;
+    s_stream_task_running = true;
+    dma_start();
+    if (xTaskCreate(stream_task, "adc_stream", ADC_STREAM_TASK_STACK, nullptr,
+                    ADC_STREAM_TASK_PRIORITY, nullptr) != pdPASS) {
+        s_streaming = false;
+        s_stream_task_running = false;
+        dma_stop();
+        continuous_drain();
+        return false;
+    }
+
+    #if DEBUG_SERIAL
+    Serial.println("[ADC] Streaming started");
+    #endif
+    return true;
+#else
+    (void)sink;
+    return false;
+#endif
+}
+
+void adc_sampler_stream_stop() {
+#if ADC_SAMPLER_HAS_CONTINUOUS
+    if (!s_streaming) {
+        return;
+    }
+    s_streaming = false;
+    while (s_stream_task_running) {
+        delay(1);
+    }
+    dma_stop();
+    continuous_drain();
+    s_stream_sink = nullptr;
+#endif
+}
+
+// =============================================================================
+// REDUCTION
+// =============================================================================
+
+static void sort_u16(uint16_t *v, uint16_t n) {
+    // Insertion sort: bursts are small and often nearly sorted.
+    for (uint16_t i = 1; i < n; ++i) {
+        const uint16_t x = v[i];
+        uint16_t j = i;
+        while (j > 0 && v[j - 1] > x) {
+            v[j] = v[j - 1];
+            --j;
+        }
+        v[j] = x;
+    }
+}
+
+uint16_t adc_reduce(uint16_t *samples, uint16_t n, AdcReduce mode) {
+    if (n == 0) {
+        return 0;
+    }
+
+    if (mode == ADC_REDUCE_MEAN) {
+        uint32_t sum = 0;
+        for (uint16_t i = 0; i < n; ++i) sum += samples[i];
+        return (uint16_t)(sum / n);
+    }
+
+    sort_u16(samples, n);
+
+    if (mode == ADC_REDUCE_MEDIAN) {
+        return (n & 1) ? samples[n / 2]
+                       : (uint16_t)((samples[n / 2 - 1] + samples[n / 2]) / 2);
+    }
+
+    uint16_t drop = (uint16_t)((uint32_t)n * ADC_SAMPLER_TRIM_PERCENT / 100);
+    if (2 * drop >= n) {
+        drop = (n - 1) / 2;
+    }
+    uint32_t sum = 0;
+    for (uint16_t i = drop; i < n - drop; ++i) sum += samples[i];
+    return (uint16_t)(sum / (n - 2 * drop));
+}
+
+uint16_t adc_spread(const uint16_t *samples, uint16_t n) {
+    if (n < 2) {
+        return 0;
+    }
+    uint32_t sum = 0;
+    for (uint16_t i = 0; i < n; ++i) sum += samples[i];
+    const int32_t mean = (int32_t)(sum / n);
+
+    uint64_t sq = 0;
+    for (uint16_t i = 0; i < n; ++i) {
+        const int32_t d = (int32_t)samples[i] - mean;
+        sq += (uint64_t)(d * d);
+    }
+    return (uint16_t)sqrtf((float)(sq / (n - 1)));
+}
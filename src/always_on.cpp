@@ -0,0 +1,71 @@
+/**
+ * always_on.cpp - Always-on power configuration implementation
+ *
+ * Automatic light sleep needs CONFIG_PM_ENABLE and tickless idle in the
+ * framework build; without them esp_pm_configure() rejects light sleep
+ * and only frequency scaling is applied.
+ */
+
+#include "always_on.h"
+#include "buttons.h"
+#include "hw_init.h"
+#include "mqtt_control.h"
+#include "esp_idf_version.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+
+// IDF 5 has a common esp_pm_config_t; IDF 4.4 (Arduino 2.0.x) only the
+// per-chip struct with the same fields.
+#if ESP_IDF_VERSION_MAJOR >= 5
+typedef esp_pm_config_t always_on_pm_config_t;
+#else
+#include "esp32c3/pm.h"
+typedef esp_pm_config_esp32c3_t always_on_pm_config_t;
+#endif
+
+static bool s_entered = false;
+
+void always_on_enter() {
+    if (s_entered) {
+        return;
+    }
+    s_entered = true;
+
+#if CONTROL_HAS_MQTT && ALWAYS_ON_WIFI_MODEM_SLEEP
+    // Light sleep with WiFi requires modem sleep; enable it first
+    mqtt_control_set_power_save(true);
+#endif
+
+    always_on_pm_config_t pm = {};
+    pm.max_freq_mhz = ALWAYS_ON_CPU_MAX_MHZ;
+    pm.min_freq_mhz = ALWAYS_ON_CPU_MIN_MHZ;
+    pm.light_sleep_enable = ALWAYS_ON_LIGHT_SLEEP && ALWAYS_ON_WIFI_MODEM_SLEEP;
+    esp_err_t err = esp_pm_configure(&pm);
+    if (err != ESP_OK && pm.light_sleep_enable) {
+        pm.light_sleep_enable = false;
+        err = esp_pm_configure(&pm);
+    }
+
+#if CONTROL_HAS_BUTTONS
+    // Buttons arm level triggers (buttons.cpp); let them end light sleep
+    if (pm.light_sleep_enable && err == ESP_OK) {
+        hw_require(HW_BUTTONS);
+        esp_sleep_enable_gpio_wakeup();
+    }
+#endif
+
+    #if DEBUG_SERIAL
+    Serial.print("[ALWAYS_ON] PM ");
+    Serial.print(err == ESP_OK ? "on" : "unavailable");
+    Serial.print(", light sleep ");
+    Serial.println(pm.light_sleep_enable && err == ESP_OK ? "on" : "off");
+    #endif
+}
+
+void always_on_idle(uint32_t max_ms) {
+#if CONTROL_HAS_BUTTONS
+    buttons_wait_event(max_ms);
+#else
+    delay(max_ms);
+#endif
+}
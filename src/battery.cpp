@@ -5,33 +5,86 @@
  * on an ADC pin.  The result is cached so that repeated calls to
  * battery_get_state() / battery_watering_allowed() / battery_get_percent()
  * do not trigger additional ADC reads.
+ *
+ * The drop-per-pump estimate lives in RTC memory so it keeps learning
+ * across deep sleep; a power-on usually means a fresh pack and resets it.
+ * A brown-out reset means the estimate was too optimistic and raises it.
  */
 
 #include "battery.h"
 #include "config.h"
+#include "adc_sampler.h"
+#include "hw_init.h"
+#include "profiler.h"
+#include "esp_attr.h"
+#include "esp_system.h"
 
 // ADC reference voltage in millivolts (ESP32 with 11dB attenuation)
 #define ADC_REF_VOLTAGE_MV  3300
 
+#define LOAD_MODEL_MAGIC    0x424C4D31UL   // "BLM1"
+
 // Cached voltage (0 = not yet read this wake cycle)
 static uint16_t cached_voltage_mv = 0;
 
+typedef struct {
+    uint32_t magic;
+    uint16_t sag_mv;            // pack drop per running pump (EMA)
+    uint16_t samples;           // pulses measured since the reset
+} BatteryLoadModel;
+
+static RTC_DATA_ATTR BatteryLoadModel s_load;
+
 // =============================================================================
 // INITIALIZATION
 // =============================================================================
 
 void battery_init() {
-    pinMode(PIN_BATTERY_ADC, INPUT);
+    // Pin and ADC are configured by adc_sampler_init()
     cached_voltage_mv = 0;
+
+    const esp_reset_reason_t reason = esp_reset_reason();
+    if (s_load.magic != LOAD_MODEL_MAGIC || reason == ESP_RST_POWERON) {
+        s_load.magic   = LOAD_MODEL_MAGIC;
+        s_load.sag_mv  = BATTERY_SAG_DEFAULT_MV;
+        s_load.samples = 0;
+    } else if (reason == ESP_RST_BROWNOUT) {
+        const uint32_t raised = (uint32_t)s_load.sag_mv * 3U / 2U;
+        s_load.sag_mv = (uint16_t)((raised > BATTERY_SAG_MAX_MV) ? BATTERY_SAG_MAX_MV : raised);
+    }
 }
 
 // =============================================================================
 // VOLTAGE READING (cached)
 // =============================================================================
 
+// One uncached burst of count samples, converted to pack voltage.
+static uint16_t sample_mv(uint16_t count) {
+    const int64_t span = profiler_start();
+    uint16_t raw = adc_sampler_read(ADC_CH_BATTERY, count, BATTERY_ADC_REDUCE);
+    profiler_stop(PROF_BATTERY, span);
+    uint32_t voltage_at_adc = ((uint32_t)raw * ADC_REF_VOLTAGE_MV) / ADC_MAX_VALUE;
+    const uint16_t mv = (uint16_t)(voltage_at_adc * BATTERY_DIVIDER_RATIO);
+
+    #if DEBUG_SERIAL
+    Serial.print("[BATTERY] Raw ADC: ");
+    Serial.print(raw);
+    Serial.print(", Voltage: ");
+    Serial.print(mv);
+    Serial.println(" mV");
+    #endif
+
+    return mv;
+}
+
+void battery_refresh() {
+    cached_voltage_mv = 0;
+}
+
 uint16_t battery_read_voltage_mv() {
+    hw_require(HW_BATTERY);
     if (cached_voltage_mv != 0) {
-        #ifdef DEBUG_SERIAL
+        #if DEBUG_SERIAL
         Serial.print("[BATTERY] Cached voltage: ");
         Serial.print(cached_voltage_mv);
         Serial.println(" mV");
@@ -39,25 +92,65 @@ uint16_t battery_read_voltage_mv() {
         return cached_voltage_mv;
     }
 
-    uint32_t sum = 0;
-    for (int i = 0; i < ADC_SAMPLES; i++) {
-        sum += analogRead(PIN_BATTERY_ADC);
-        delayMicroseconds(100);
+    cached_voltage_mv = sample_mv(ADC_SAMPLER_SAMPLES);
+    return cached_voltage_mv;
+}
+
+uint16_t battery_sample_rest_mv() {
+    battery_refresh();
+    return battery_read_voltage_mv();
+}
+
+// =============================================================================
+// LOAD MODEL
+// =============================================================================
+
+uint16_t battery_sample_load_mv(uint8_t pumps) {
+    if (pumps == 0) {
+        return 0;
+    }
+    hw_require(HW_BATTERY);
+    const uint16_t rest = cached_voltage_mv;
+    const uint16_t loaded = sample_mv(BATTERY_LOAD_SAMPLES);
+    const uint32_t sag = (loaded < rest) ? (uint32_t)(rest - loaded) / pumps : 0;
+    if (rest == 0 || sag > BATTERY_SAG_MAX_MV) {
+        return loaded;   // no resting reference, or too far off to learn from
     }
 
-    uint16_t raw = sum / ADC_SAMPLES;
-    uint32_t voltage_at_adc = ((uint32_t)raw * ADC_REF_VOLTAGE_MV) / ADC_MAX_VALUE;
-    cached_voltage_mv = (uint16_t)(voltage_at_adc * BATTERY_DIVIDER_RATIO);
+    // The first measurement replaces the default outright
+    if (s_load.samples == 0) {
+        s_load.sag_mv = (uint16_t)sag;
+    } else {
+        s_load.sag_mv = (uint16_t)(((uint32_t)s_load.sag_mv * (100U - BATTERY_SAG_WEIGHT_PCT) +
+                                    sag * BATTERY_SAG_WEIGHT_PCT + 50U) / 100U);
+    }
+    if (s_load.samples < UINT16_MAX) {
+        s_load.samples++;
+    }
 
-    #ifdef DEBUG_SERIAL
-    Serial.print("[BATTERY] Raw ADC: ");
-    Serial.print(raw);
-    Serial.print(", Voltage: ");
-    Serial.print(cached_voltage_mv);
-    Serial.println(" mV");
+    #if DEBUG_SERIAL
+    Serial.print("[BATTERY] Under load (");
+    Serial.print(pumps);
+    Serial.print(" pumps): ");
+    Serial.print(loaded);
+    Serial.print(" mV, drop per pump ");
+    Serial.print(s_load.sag_mv);
+    Serial.print(" mV (~");
+    Serial.print((uint32_t)s_load.sag_mv * 1000U / PUMP_LOAD_CURRENT_MA);
+    Serial.println(" mOhm)");
     #endif
 
-    return cached_voltage_mv;
+    return loaded;
+}
+
+uint16_t battery_predict_load_mv(uint8_t pumps) {
+    const uint16_t rest = battery_read_voltage_mv();
+    const uint32_t drop = (uint32_t)battery_sag_per_pump_mv() * pumps;
+    return (drop >= rest) ? 0 : (uint16_t)(rest - drop);
+}
+
+uint16_t battery_sag_per_pump_mv() {
+    return (s_load.magic == LOAD_MODEL_MAGIC) ? s_load.sag_mv : BATTERY_SAG_DEFAULT_MV;
 }
 
 // =============================================================================
@@ -72,7 +165,7 @@ BatteryState battery_get_state() {
     else if (voltage < BATTERY_WARNING_MV) state = BATTERY_WARNING;
     else state = BATTERY_OK;
 
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.print("[BATTERY] State: ");
     switch(state) {
         case BATTERY_OK:       Serial.print("OK"); break;
@@ -104,7 +197,7 @@ uint8_t battery_get_percent() {
     else percent = (uint8_t)(((uint32_t)(voltage - BATTERY_EMPTY_MV) * 100)
                      / (BATTERY_FULL_MV - BATTERY_EMPTY_MV));
 
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.print("[BATTERY] Percentage: ");
     Serial.print(percent);
     Serial.println("%");
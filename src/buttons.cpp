@@ -2,18 +2,26 @@
  * buttons.cpp - Button handling implementation
  *
  * Separated into three layers:
- *   1. Hardware read + debounce  (read_button_raw)
+ *   1. Edge capture + debounce   (GPIO ISR → edge queue, drain_edges)
  *   2. Press detection           (buttons_poll → ButtonPress[BTN_COUNT])
  *   3. Mode / action dispatch    (resolve_mode, buttons_handle_interaction)
  */
 
 #include "buttons.h"
 #include "config.h"
+
+// MQTT-only builds have no buttons; every caller is behind CONTROL_HAS_BUTTONS.
+#if CONTROL_HAS_BUTTONS
 #include "leds.h"
 #include "sensor.h"
+#include "measurement.h"
 #include "battery.h"
 #include "watering.h"
 #include "storage.h"
+#include "hw_init.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
 
 // =============================================================================
 // CONSTANTS
@@ -25,7 +33,11 @@ static const uint8_t BTN_PINS[BTN_COUNT] = {
     PIN_BTN_CAL_DRY
 };
 
-#ifdef DEBUG_SERIAL
+// Buttons only exist on single-plant builds (config.h), so every action
+// applies to channel 0.
+#define BUTTON_CHANNEL  0
+
+#if DEBUG_SERIAL
 static void btn_log(const __FlashStringHelper *msg) {
     Serial.print(F("[BTN] "));
     Serial.println(msg);
@@ -73,15 +85,73 @@ static void btn_log_water_result(WateringResult result) {
 }
 #endif
 
+// =============================================================================
+// EDGE QUEUE (GPIO interrupt → interaction loop)
+// =============================================================================
+
+// Single-producer / single-consumer ring: the GPIO ISRs (one interrupt,
+// handlers never nest) write at s_edge_head, the interaction loop reads
+// at s_edge_tail. Each index is only written by its side, so no lock.
+//
+// Edges are caught with level interrupts that flip to the opposite level
+// on every hit: unlike edge triggers, a level trigger can also wake the
+// chip from light sleep (always-on mode), and it fires once per edge.
+typedef struct {
+    uint32_t t_ms;     // edge time
+    uint8_t  index;    // button
+    bool     down;     // level after the edge (pressed)
+} ButtonEdge;
+
+static ButtonEdge s_edges[BTN_EDGE_QUEUE_LEN];
+static volatile uint8_t s_edge_head = 0;
+static volatile uint8_t s_edge_tail = 0;
+static volatile bool s_edge_overflow = false;
+static volatile TaskHandle_t s_waiter = nullptr;   // task blocked in buttons_wait_event()
+
+static volatile bool s_isr_down[BTN_COUNT];   // level each trigger waits to leave
+
+static void arm_level_trigger(uint8_t index, bool down) {
+    gpio_wakeup_enable((gpio_num_t)BTN_PINS[index],
+                       down ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL);
+}
+
+static void IRAM_ATTR button_edge_isr(void *arg) {
+    const uint8_t index = (uint8_t)(uintptr_t)arg;
+    const bool down = (digitalRead(BTN_PINS[index]) == LOW);
+    if (down == s_isr_down[index]) {
+        return;   // bounced back before we got here
+    }
+    s_isr_down[index] = down;
+    arm_level_trigger(index, down);
+
+    const uint8_t head = s_edge_head;
+    const uint8_t next = (uint8_t)((head + 1U) % BTN_EDGE_QUEUE_LEN);
+    if (next == s_edge_tail) {
+        s_edge_overflow = true;   // consumer resyncs from the pins
+    } else {
+        s_edges[head].t_ms  = millis();
+        s_edges[head].index = index;
+        s_edges[head].down  = down;
+        s_edge_head = next;
+    }
+
+    const TaskHandle_t waiter = s_waiter;
+    if (waiter != nullptr) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(waiter, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
 // =============================================================================
 // PER-BUTTON STATE (single struct, one debounce layer)
 // =============================================================================
 
 typedef struct {
-    bool     is_down;          // currently held
-    bool     long_reported;    // long-press already latched
+    bool     is_down;          // debounced state
+    bool     raw_down;         // level of the latest edge
+    uint32_t raw_since_ms;     // time of the latest edge
     uint32_t press_start_ms;   // when the current press began
-    uint32_t last_change_ms;   // last edge for debounce
     ButtonPress result;        // accumulated press type
 } ButtonTracker;
 
@@ -90,9 +160,9 @@ static ButtonTracker s_btn[BTN_COUNT];
 static void buttons_reset_all(void) {
     for (uint8_t i = 0; i < BTN_COUNT; ++i) {
         s_btn[i].is_down        = false;
-        s_btn[i].long_reported  = false;
+        s_btn[i].raw_down       = false;
+        s_btn[i].raw_since_ms   = 0;
         s_btn[i].press_start_ms = 0;
-        s_btn[i].last_change_ms = 0;
         s_btn[i].result         = PRESS_NONE;
     }
 }
@@ -113,47 +183,66 @@ static bool read_button_raw(uint8_t index) {
 
 // =============================================================================
 // PRESS DETECTION
-// Call in a loop; returns true once ALL buttons are released.
-// Results are accumulated in s_btn[].result between calls.
+// Call whenever an edge may have arrived; returns true once ALL buttons
+// are released. Results are accumulated in s_btn[].result between calls.
 // =============================================================================
 
+// Move queued edges into the trackers' raw state.
+static void drain_edges(void) {
+    if (s_edge_overflow) {
+        // Edges were lost: take the pins as they are now.
+        s_edge_overflow = false;
+        s_edge_tail = s_edge_head;
+        const uint32_t now = millis();
+        for (uint8_t i = 0; i < BTN_COUNT; ++i) {
+            const bool down = read_button_raw(i);
+            if (down != s_btn[i].raw_down) {
+                s_btn[i].raw_down     = down;
+                s_btn[i].raw_since_ms = now;
+            }
+        }
+        return;
+    }
+
+    uint8_t tail = s_edge_tail;
+    while (tail != s_edge_head) {
+        const ButtonEdge e = s_edges[tail];
+        if (e.index < BTN_COUNT && e.down != s_btn[e.index].raw_down) {
+            s_btn[e.index].raw_down     = e.down;
+            s_btn[e.index].raw_since_ms = e.t_ms;
+        }
+        tail = (uint8_t)((tail + 1U) % BTN_EDGE_QUEUE_LEN);
+    }
+    s_edge_tail = tail;
+}
+
+// A level counts once it has been stable for BTN_DEBOUNCE_MS; the press
+// and release times are the edge timestamps, so short/long follows the
+// real hold time rather than when the loop got to look.
 static bool buttons_poll(ButtonPress out[BTN_COUNT]) {
+    drain_edges();
+
     const uint32_t now = millis();
     bool any_pressed = false;
 
     for (uint8_t i = 0; i < BTN_COUNT; ++i) {
-        const bool pressed = read_button_raw(i);
-
-        // debounce gate
-        if ((now - s_btn[i].last_change_ms) < BTN_DEBOUNCE_MS) {
-            if (s_btn[i].is_down) any_pressed = true;
-            continue;
-        }
-
-        if (pressed) {
-            any_pressed = true;
-
-            if (!s_btn[i].is_down) {                         // new press
-                s_btn[i].is_down        = true;
-                s_btn[i].press_start_ms = now;
-                s_btn[i].long_reported  = false;
-                s_btn[i].last_change_ms = now;
-            } else if (!s_btn[i].long_reported &&
-                       (now - s_btn[i].press_start_ms) >= BTN_LONG_PRESS_MS) {
-                // mark that we've passed the long-press threshold; do not
-                // set the final result yet — wait for release so visual
-                // feedback only happens after the interaction completes.
-                s_btn[i].long_reported = true;
-            }
-        } else if (s_btn[i].is_down) {                       // just released
-            // On release decide whether it was a short or long press.
-            if (s_btn[i].long_reported) {
-                s_btn[i].result = PRESS_LONG;
-            } else {
-                s_btn[i].result = PRESS_SHORT;
+        ButtonTracker &b = s_btn[i];
+        const bool settled = (now - b.raw_since_ms) >= BTN_DEBOUNCE_MS;
+
+        if (settled && b.raw_down != b.is_down) {
+            if (b.raw_down) {                                // new press
+                b.is_down        = true;
+                b.press_start_ms = b.raw_since_ms;
+            } else {                                         // released
+                // Decide on release so visual feedback only happens after
+                // the interaction completes.
+                const uint32_t held_ms = b.raw_since_ms - b.press_start_ms;
+                b.result  = (held_ms >= BTN_LONG_PRESS_MS) ? PRESS_LONG : PRESS_SHORT;
+                b.is_down = false;
             }
-            s_btn[i].is_down        = false;
-            s_btn[i].last_change_ms = now;
+        }
+        if (b.is_down || b.raw_down != b.is_down) {
+            any_pressed = true;   // held, or an edge still settling
         }
     }
 
@@ -165,6 +254,33 @@ static bool buttons_poll(ButtonPress out[BTN_COUNT]) {
     return true;
 }
 
+// true while an edge has not settled yet (the loop must look again soon).
+static bool buttons_settling(void) {
+    for (uint8_t i = 0; i < BTN_COUNT; ++i) {
+        if (s_btn[i].raw_down != s_btn[i].is_down) return true;
+    }
+    return false;
+}
+
+bool buttons_pending(void) {
+    if (!hw_ready(HW_BUTTONS)) {
+        return false;
+    }
+    return s_edge_head != s_edge_tail || s_edge_overflow;
+}
+
+void buttons_wait_event(uint32_t max_ms) {
+    if (!hw_ready(HW_BUTTONS)) {
+        delay(max_ms);
+        return;
+    }
+    s_waiter = xTaskGetCurrentTaskHandle();
+    if (s_edge_head == s_edge_tail && !s_edge_overflow) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(max_ms));
+    }
+    s_waiter = nullptr;
+}
+
 // =============================================================================
 // PRESS-LIST HELPER
 // =============================================================================
@@ -239,8 +355,14 @@ void buttons_init(void) {
         pinMode(BTN_PINS[i], INPUT_PULLUP);
     }
     buttons_reset_all();
+    for (uint8_t i = 0; i < BTN_COUNT; ++i) {
+        s_isr_down[i] = read_button_raw(i);
+        attachInterruptArg(digitalPinToInterrupt(BTN_PINS[i]), button_edge_isr,
+                           (void *)(uintptr_t)i, CHANGE);
+        arm_level_trigger(i, s_isr_down[i]);   // replaces the CHANGE trigger
+    }
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     btn_log(F("init"));
     #endif
 }
@@ -250,16 +372,16 @@ void buttons_init(void) {
 // =============================================================================
 
 static void perform_manual_watering(void) {
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     btn_log(F("mw"));
     #endif
     
     PLAY_PATTERN(BTN_ACK);
     // force_override = true: the user explicitly chose to water, so skip
     // the minimum-interval check.  Battery safety is still enforced.
-    WateringResult result = watering_manual(true);
+    WateringResult result = watering_manual(BUTTON_CHANNEL, true);
 
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     btn_log_water_result(result);
     #endif
 
@@ -272,8 +394,8 @@ static void perform_manual_watering(void) {
 }
 
 static void perform_display_humidity(void) {
-    uint8_t humidity = sensor_read_humidity_percent();
-    #ifdef DEBUG_SERIAL
+    uint8_t humidity = measurement_get()->humidity[BUTTON_CHANNEL];
+    #if DEBUG_SERIAL
     btn_log_u8(F("hum="), humidity);
     #endif
     led_display_humidity(humidity);
@@ -281,47 +403,47 @@ static void perform_display_humidity(void) {
 
 static void perform_display_humidity_range(void) {
     // Show min humidity in green flashes, then max humidity in red flashes
-    led_display_value(storage_get_minimal_humidity(), false);  // green
-    delay(LED_DIGIT_PAUSE_MS);                                // pause between the two
-    led_display_value(storage_get_max_humidity(), true);       // red
+    led_display_value(storage_get_minimal_humidity(BUTTON_CHANNEL), false);  // green
+    leds_pause(LED_DIGIT_PAUSE_MS);                           // pause between the two
+    led_display_value(storage_get_max_humidity(BUTTON_CHANNEL), true);       // red
 }
 
 static void perform_display_battery(void) {
     uint8_t percent = battery_get_percent();
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     btn_log_u8(F("bat="), percent);
     #endif
     led_display_battery_percent(percent);
 }
 
 static void perform_calibrate_wet(void) {
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     btn_log(F("cal wet"));
     #endif
     led_red_on();                       // Red LED on during wet calibration
-    (void)sensor_calibrate_wet();
+    (void)sensor_calibrate_wet(BUTTON_CHANNEL);
     led_red_off();
     led_show_success();
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     btn_log(F("cal wet ok"));
     #endif
 }
 
 static void perform_calibrate_dry(void) {
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     btn_log(F("cal dry"));
     #endif
     led_green_on();                     // Green LED on during dry calibration
-    (void)sensor_calibrate_dry();
+    (void)sensor_calibrate_dry(BUTTON_CHANNEL);
     led_green_off();
     led_show_success();
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     btn_log(F("cal dry ok"));
     #endif
 }
 
 static void adjust_minimal_humidity(int8_t direction) {
-    uint8_t val = storage_get_minimal_humidity();
+    uint8_t val = storage_get_minimal_humidity(BUTTON_CHANNEL);
 
     if (direction > 0 && val <= (uint8_t)(100 - HUMIDITY_STEP)) {
         val += HUMIDITY_STEP;
@@ -329,9 +451,9 @@ static void adjust_minimal_humidity(int8_t direction) {
         val -= HUMIDITY_STEP;
     }
 
-    storage_set_minimal_humidity(val);
+    storage_set_minimal_humidity(BUTTON_CHANNEL, val);
 
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     btn_log_u8(F("min="), val);
     #endif
 
@@ -350,7 +472,7 @@ static void adjust_minimal_humidity(int8_t direction) {
 }
 
 static void adjust_max_humidity(int8_t direction) {
-    uint8_t val = storage_get_max_humidity();
+    uint8_t val = storage_get_max_humidity(BUTTON_CHANNEL);
 
     if (direction > 0 && val <= (uint8_t)(100 - HUMIDITY_STEP)) {
         val += HUMIDITY_STEP;
@@ -358,9 +480,9 @@ static void adjust_max_humidity(int8_t direction) {
         val -= HUMIDITY_STEP;
     }
 
-    storage_set_max_humidity(val);
+    storage_set_max_humidity(BUTTON_CHANNEL, val);
 
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     btn_log_u8(F("max="), val);
     #endif
 
@@ -421,7 +543,18 @@ static void calibration_heartbeat_tick() {
 // MAIN INTERACTION LOOP
 // =============================================================================
 
+// How long the loop may block until the next edge: short while an edge is
+// settling or the calibration heartbeat runs, else up to the mode timeout.
+static uint32_t interaction_wait_ms(ButtonMode mode, uint32_t deadline_ms) {
+    if (buttons_settling() || mode == MODE_CALIBRATION) {
+        return BTN_DEBOUNCE_MS;
+    }
+    const uint32_t elapsed_ms = millis() - deadline_ms;
+    return (elapsed_ms < MODE_TIMEOUT_MS) ? (MODE_TIMEOUT_MS - elapsed_ms) : 0;
+}
+
 void buttons_handle_interaction(bool from_button_wake) {
+    hw_require(HW_BUTTONS);
     buttons_reset_all();
 
     // ── Seed buttons immediately ────────────────────────────────────
@@ -434,17 +567,16 @@ void buttons_handle_interaction(bool from_button_wake) {
     for (uint8_t i = 0; i < BTN_COUNT; ++i) {
         if (read_button_raw(i)) {
             s_btn[i].is_down        = true;
+            s_btn[i].raw_down       = true;
+            s_btn[i].raw_since_ms   = 0;
             s_btn[i].press_start_ms = 0;
-            s_btn[i].long_reported  = false;
-            s_btn[i].last_change_ms = 0;
             any_held = true;
         }
     }
 
-    // Wake acknowledgment (green pulse).
-    led_green_on();
-    delay(LED_SHORT);
-    led_green_off();
+    // Wake acknowledgment (green pulse), played while buttons are polled.
+    static const LedStep wake_ack[] = { LED_G(LED_SHORT) };
+    leds_play_pattern(wake_ack, ARRAY_LEN(wake_ack), 0, 0);
 
     // If no button is currently held the press was released during
     // boot.  ESP32-C3 GPIO wake cannot identify which pin triggered.
@@ -456,7 +588,7 @@ void buttons_handle_interaction(bool from_button_wake) {
         bool cal_likely = (digitalRead(PIN_BTN_CAL_WET) == LOW) ||
                           (digitalRead(PIN_BTN_CAL_DRY) == LOW);
         if (!cal_likely) {
-            #ifdef DEBUG_SERIAL
+            #if DEBUG_SERIAL
             btn_log(F("wake hum"));
             #endif
             perform_display_humidity();
@@ -478,7 +610,7 @@ void buttons_handle_interaction(bool from_button_wake) {
             if (mode == MODE_CALIBRATION) {
                 calibration_heartbeat_tick();
             }
-            yield();
+            buttons_wait_event(interaction_wait_ms(mode, deadline_ms));
             continue;
         }
 
@@ -493,7 +625,7 @@ void buttons_handle_interaction(bool from_button_wake) {
 
         // Unrecognized button combination → brief red flash as feedback
         if (any_press && new_mode == mode) {
-            #ifdef DEBUG_SERIAL
+            #if DEBUG_SERIAL
             btn_log(F("bad combo"));
             #endif
             PLAY_PATTERN(BTN_BAD);
@@ -526,7 +658,7 @@ void buttons_handle_interaction(bool from_button_wake) {
             last_mode_change_ms  = millis();
             deadline_ms          = millis();   // extend deadline on mode change
             humidity_prompted     = false;
-            #ifdef DEBUG_SERIAL
+            #if DEBUG_SERIAL
             btn_log_mode(mode);
             #endif
         }
@@ -548,7 +680,7 @@ void buttons_handle_interaction(bool from_button_wake) {
                 return;
 
             case MODE_DISPLAY_HUMIDITY_RANGE:
-                #ifdef DEBUG_SERIAL
+                #if DEBUG_SERIAL
                 btn_log(F("range"));
                 #endif
                 perform_display_humidity_range();
@@ -628,9 +760,11 @@ void buttons_handle_interaction(bool from_button_wake) {
                 break;
         }
 
-        yield();
+        buttons_wait_event(interaction_wait_ms(mode, deadline_ms));
     }
 
     // Mode timed out — clean up LEDs
     calibration_heartbeat_reset();
 }
+
+#endif // CONTROL_HAS_BUTTONS
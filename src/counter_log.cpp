@@ -0,0 +1,220 @@
+/**
+ * counter_log.cpp - Append-only counter log implementation
+ *
+ * The log owns COUNTER_LOG_SECTORS sectors of COUNTER_LOG_PARTITION,
+ * starting at COUNTER_LOG_FIRST_SECTOR, split into 128-byte slots. Slots
+ * are programmed strictly in order and only after their sector was
+ * erased, so within the head sector the programmed slots form a prefix:
+ * after power loss a binary search finds its end, and the newest record
+ * is the last one in that prefix with a valid CRC.
+ */
+
+#include "counter_log.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_partition.h"
+#include <string.h>
+
+#define CLOG_MAGIC             0x434C4731UL   // "CLG1"
+#define CLOG_SECTOR_SIZE       4096U
+#define CLOG_RECORD_SIZE       128U
+#define CLOG_SLOTS_PER_SECTOR  (CLOG_SECTOR_SIZE / CLOG_RECORD_SIZE)
+#define CLOG_SEQ_ERASED        0xFFFFFFFFUL
+
+typedef struct __attribute__((packed)) {
+    uint32_t seq;                // 0xFFFFFFFF = erased flash
+    CounterSnapshot values;
+    uint8_t  reserved[CLOG_RECORD_SIZE - sizeof(uint32_t) - sizeof(CounterSnapshot) - sizeof(uint16_t)];
+    uint16_t crc;                // CRC-16/CCITT over the preceding bytes
+} CounterRecord;
+
+static_assert(sizeof(CounterRecord) == CLOG_RECORD_SIZE, "CounterRecord must stay 128 bytes");
+
+// =============================================================================
+// STATE
+// =============================================================================
+
+typedef struct {
+    uint32_t magic;
+    uint32_t next_slot;          // ring slot the next append programs
+    uint32_t next_seq;
+    uint32_t latest_slot;        // slot of the newest valid record
+    bool     has_latest;
+} CounterLogState;
+
+static RTC_DATA_ATTR CounterLogState s_state;
+
+// Looked up each wake (0 slots = log unusable)
+static const esp_partition_t *s_part = nullptr;
+static uint32_t s_slots = 0;
+
+// =============================================================================
+// RECORD HELPERS
+// =============================================================================
+
+static uint16_t crc16(const uint8_t *data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    while (len--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (uint8_t i = 0; i < 8; ++i) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static bool record_valid(const CounterRecord &rec) {
+    return rec.seq != CLOG_SEQ_ERASED &&
+           rec.crc == crc16((const uint8_t *)&rec, sizeof(rec) - sizeof(rec.crc));
+}
+
+static bool record_erased(const CounterRecord &rec) {
+    const uint8_t *p = (const uint8_t *)&rec;
+    for (size_t i = 0; i < sizeof(rec); ++i) {
+        if (p[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static size_t slot_offset(uint32_t slot) {
+    return (size_t)COUNTER_LOG_FIRST_SECTOR * CLOG_SECTOR_SIZE + (size_t)slot * CLOG_RECORD_SIZE;
+}
+
+static bool slot_read(uint32_t slot, CounterRecord *out) {
+    return esp_partition_read(s_part, slot_offset(slot), out, sizeof(*out)) == ESP_OK;
+}
+
+// =============================================================================
+// RECOVERY
+// =============================================================================
+
+/**
+ * Rebuild the RTC state from flash: the sector whose first record has the
+ * highest seq is the head; a binary search over its slots finds the first
+ * erased one (the next append), and the newest valid record is searched
+ * backwards from there, skipping a slot torn by a brown-out.
+ */
+static void recover() {
+    memset(&s_state, 0, sizeof(s_state));
+    s_state.magic = CLOG_MAGIC;
+
+    const uint32_t sectors = s_slots / CLOG_SLOTS_PER_SECTOR;
+    int32_t head = -1;
+    uint32_t head_seq = 0;
+    CounterRecord rec;
+    for (uint32_t s = 0; s < sectors; ++s) {
+        if (!slot_read(s * CLOG_SLOTS_PER_SECTOR, &rec) || !record_valid(rec)) {
+            continue;
+        }
+        if (head < 0 || rec.seq > head_seq) {
+            head = (int32_t)s;
+            head_seq = rec.seq;
+        }
+    }
+    if (head < 0) {
+        return;   // empty log: start at slot 0
+    }
+
+    const uint32_t first = (uint32_t)head * CLOG_SLOTS_PER_SECTOR;
+    uint32_t lo = 1;
+    uint32_t hi = CLOG_SLOTS_PER_SECTOR;
+    while (lo < hi) {
+        const uint32_t mid = (lo + hi) / 2;
+        if (slot_read(first + mid, &rec) && record_erased(rec)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    s_state.next_slot = (first + lo) % s_slots;   // a full sector continues in the next one
+    for (uint32_t i = lo; i > 0; --i) {
+        if (slot_read(first + i - 1, &rec) && record_valid(rec)) {
+            s_state.latest_slot = first + i - 1;
+            s_state.next_seq = rec.seq + 1;
+            s_state.has_latest = true;
+            break;
+        }
+    }
+}
+
+// =============================================================================
+// API
+// =============================================================================
+
+bool counter_log_init() {
+#if COUNTER_LOG_ENABLED
+    s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                      COUNTER_LOG_PARTITION);
+    s_slots = 0;
+    if (s_part != nullptr &&
+        s_part->size >= (size_t)(COUNTER_LOG_FIRST_SECTOR + COUNTER_LOG_SECTORS) * CLOG_SECTOR_SIZE) {
+        s_slots = COUNTER_LOG_SECTORS * CLOG_SLOTS_PER_SECTOR;
+    }
+    if (s_slots == 0) {
+        #if DEBUG_SERIAL
+        Serial.println("[CLOG] No room in partition, counters stay in NVS");
+        #endif
+        return false;
+    }
+
+    if (s_state.magic != CLOG_MAGIC || esp_reset_reason() == ESP_RST_POWERON) {
+        recover();
+        #if DEBUG_SERIAL
+        Serial.print("[CLOG] Recovered, next seq ");
+        Serial.print(s_state.next_seq);
+        Serial.print(" at slot ");
+        Serial.println(s_state.next_slot);
+        #endif
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool counter_log_latest(CounterSnapshot *out) {
+    CounterRecord rec;
+    if (s_slots == 0 || !s_state.has_latest ||
+        !slot_read(s_state.latest_slot, &rec) || !record_valid(rec)) {
+        return false;
+    }
+    *out = rec.values;
+    return true;
+}
+
+bool counter_log_append(const CounterSnapshot *snap) {
+    if (s_slots == 0) {
+        return false;
+    }
+
+    CounterRecord rec;
+    memset(&rec, 0xFF, sizeof(rec));
+    rec.seq = s_state.next_seq;
+    rec.values = *snap;
+    rec.crc = crc16((const uint8_t *)&rec, sizeof(rec) - sizeof(rec.crc));
+
+    const uint32_t slot = s_state.next_slot;
+    if ((slot % CLOG_SLOTS_PER_SECTOR) == 0 &&
+        esp_partition_erase_range(s_part, slot_offset(slot), CLOG_SECTOR_SIZE) != ESP_OK) {
+        #if DEBUG_SERIAL
+        Serial.println("[CLOG] Sector erase failed");
+        #endif
+        return false;   // retried by the next append
+    }
+
+    // The slot is used up even if the write fails half way
+    s_state.next_slot = (slot + 1) % s_slots;
+    s_state.next_seq++;
+    if (esp_partition_write(s_part, slot_offset(slot), &rec, sizeof(rec)) != ESP_OK) {
+        #if DEBUG_SERIAL
+        Serial.println("[CLOG] Write failed");
+        #endif
+        return false;
+    }
+    s_state.latest_slot = slot;
+    s_state.has_latest = true;
+    return true;
+}
@@ -0,0 +1,85 @@
+/**
+ * device_topic.cpp - Per-device MQTT topic namespace implementation
+ */
+
+#include "device_topic.h"
+#include "esp_mac.h"
+#include <string.h>
+
+#define ROOT_LEN  (sizeof(MQTT_TOPIC_ROOT) - 1)
+
+static char s_device_id[DEVICE_ID_LEN + 1];
+
+void device_id_from_mac(const uint8_t mac[6], char out[DEVICE_ID_LEN + 1]) {
+    static const char k_hex[] = "0123456789abcdef";
+    for (uint8_t i = 0; i < 6; ++i) {
+        out[2 * i]     = k_hex[mac[i] >> 4];
+        out[2 * i + 1] = k_hex[mac[i] & 0x0F];
+    }
+    out[DEVICE_ID_LEN] = '\0';
+}
+
+const char *device_id() {
+    if (s_device_id[0] == '\0') {
+        uint8_t mac[6];
+        esp_efuse_mac_get_default(mac);
+        device_id_from_mac(mac, s_device_id);
+    }
+    return s_device_id;
+}
+
+bool device_topic(char *out, size_t size, const char *device, const char *suffix) {
+    const int len = snprintf(out, size, MQTT_TOPIC_ROOT "/%s/%s", device, suffix);
+    return len > 0 && (size_t)len < size;
+}
+
+bool group_topic(char *out, size_t size, const char *group, const char *suffix) {
+    const int len = snprintf(out, size, MQTT_TOPIC_ROOT "/" MQTT_TOPIC_GROUP "/%s/%s", group, suffix);
+    return len > 0 && (size_t)len < size;
+}
+
+// Next level of topic starting at p: its length, 0 if there is no '/' after it.
+static size_t level_len(const char *p) {
+    const char *slash = strchr(p, '/');
+    return (slash != nullptr) ? (size_t)(slash - p) : 0;
+}
+
+static bool level_is(const char *p, size_t len, const char *text) {
+    return len == strlen(text) && memcmp(p, text, len) == 0;
+}
+
+bool device_topic_parse(const char *topic, TopicParts *out) {
+    if (strncmp(topic, MQTT_TOPIC_ROOT "/", ROOT_LEN + 1) != 0) {
+        return false;
+    }
+    const char *level = topic + ROOT_LEN + 1;
+    size_t len = level_len(level);
+    if (len == 0) {
+        return false;
+    }
+
+    if (level_is(level, len, MQTT_TOPIC_BROADCAST)) {
+        out->scope = TOPIC_SCOPE_BROADCAST;
+        out->target = nullptr;
+        out->target_len = 0;
+    } else if (level_is(level, len, MQTT_TOPIC_GROUP)) {
+        level += len + 1;
+        len = level_len(level);
+        if (len == 0) {
+            return false;
+        }
+        out->scope = TOPIC_SCOPE_GROUP;
+        out->target = level;
+        out->target_len = len;
+    } else {
+        out->scope = TOPIC_SCOPE_DEVICE;
+        out->target = level;
+        out->target_len = len;
+    }
+    out->suffix = level + len + 1;
+    return out->suffix[0] != '\0';
+}
+
+bool device_topic_target_is(const TopicParts *parts, const char *text) {
+    return parts->target != nullptr && level_is(parts->target, parts->target_len, text);
+}
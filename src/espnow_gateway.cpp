@@ -0,0 +1,309 @@
+/**
+ * espnow_gateway.cpp - ESP-NOW to MQTT bridge implementation
+ *
+ * Everything runs in the loop task: the MQTT callback (inside the link's
+ * poll) and the frame handler both send ESP-NOW from here, never from
+ * the WiFi task.
+ */
+
+#include "espnow_gateway.h"
+#include "config.h"
+
+#if GATEWAY_ROLE
+#include <WiFi.h>
+#include "control_link.h"
+#include "device_topic.h"
+#include "espnow_link.h"
+#include <string.h>
+
+#define GATEWAY_RX_WAIT_MS  10   // Frame wait per iteration, paces the loop
+
+typedef struct {
+    bool          used;
+    uint8_t       mac[6];
+    char          id[DEVICE_ID_LEN + 1];   // device level of the node's topics
+    uint32_t      last_rx_ms;
+    EspNowMessage rx;
+} GatewayNode;
+
+typedef struct {
+    uint8_t  mac[6];    // node it is held for
+    uint8_t  topic;
+    uint8_t  flags;     // ESPNOW_FLAG_GROUP
+    uint16_t len;
+    uint8_t  data[ESPNOW_GATEWAY_CMD_MAX];
+} GatewayCommand;
+
+static const ControlLink *s_link = nullptr;
+static uint32_t s_last_connect_ms = 0;
+static GatewayNode s_nodes[ESPNOW_GATEWAY_MAX_NODES];
+
+// Commands held while their node is not listening, oldest first (the
+// oldest is dropped when full). Shared by all nodes, kept in arrival order.
+static GatewayCommand s_queue[ESPNOW_GATEWAY_QUEUE_LEN];
+static uint8_t s_queue_count = 0;
+
+static void queue_forget(const uint8_t mac[6]);
+
+// =============================================================================
+// NODES
+// =============================================================================
+
+static GatewayNode *find_node(const uint8_t mac[6]) {
+    for (uint8_t i = 0; i < ESPNOW_GATEWAY_MAX_NODES; ++i) {
+        if (s_nodes[i].used && memcmp(s_nodes[i].mac, mac, 6) == 0) {
+            return &s_nodes[i];
+        }
+    }
+    return nullptr;
+}
+
+// Known node, or a new entry (peer added) replacing the longest silent one.
+static GatewayNode *track_node(const uint8_t mac[6]) {
+    GatewayNode *node = find_node(mac);
+    if (node != nullptr) {
+        return node;
+    }
+    node = &s_nodes[0];
+    for (uint8_t i = 0; i < ESPNOW_GATEWAY_MAX_NODES; ++i) {
+        if (!s_nodes[i].used) {
+            node = &s_nodes[i];
+            break;
+        }
+        if ((millis() - s_nodes[i].last_rx_ms) > (millis() - node->last_rx_ms)) {
+            node = &s_nodes[i];
+        }
+    }
+    if (node->used) {
+        espnow_remove_peer(node->mac);
+        queue_forget(node->mac);
+    }
+    memset(node, 0, sizeof(*node));
+    memcpy(node->mac, mac, sizeof(node->mac));
+    device_id_from_mac(mac, node->id);
+    node->used = espnow_add_peer(mac);
+    node->last_rx_ms = millis();
+    return node->used ? node : nullptr;
+}
+
+static GatewayNode *find_node_by_id(const TopicParts &parts) {
+    for (uint8_t i = 0; i < ESPNOW_GATEWAY_MAX_NODES; ++i) {
+        if (s_nodes[i].used && device_topic_target_is(&parts, s_nodes[i].id)) {
+            return &s_nodes[i];
+        }
+    }
+    return nullptr;
+}
+
+// Still inside the command window that follows its last frame.
+static bool node_listening(const GatewayNode *node) {
+    return (millis() - node->last_rx_ms) <= ESPNOW_GATEWAY_WINDOW_MS;
+}
+
+// =============================================================================
+// COMMANDS (broker -> node)
+// =============================================================================
+
+static void queue_drop(uint8_t index) {
+    memmove(&s_queue[index], &s_queue[index + 1], (s_queue_count - index - 1) * sizeof(s_queue[0]));
+    --s_queue_count;
+}
+
+static void queue_forget(const uint8_t mac[6]) {
+    uint8_t i = 0;
+    while (i < s_queue_count) {
+        if (memcmp(s_queue[i].mac, mac, 6) == 0) {
+            queue_drop(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+static void queue_push(const GatewayNode *node, uint8_t topic, uint8_t flags,
+                       const uint8_t *payload, size_t len) {
+    if (s_queue_count == ESPNOW_GATEWAY_QUEUE_LEN) {
+#if DEBUG_SERIAL
+        Serial.println("[GW] Command queue full, dropping the oldest");
+#endif
+        queue_drop(0);
+    }
+    GatewayCommand *cmd = &s_queue[s_queue_count];
+    memcpy(cmd->mac, node->mac, sizeof(cmd->mac));
+    cmd->topic = topic;
+    cmd->flags = flags;
+    cmd->len = (uint16_t)len;
+    memcpy(cmd->data, payload, len);
+    ++s_queue_count;
+}
+
+static bool send_command(const GatewayNode *node, uint8_t topic, uint8_t flags,
+                         const uint8_t *payload, size_t len) {
+    return espnow_send(node->mac, ESPNOW_FRAME_COMMAND, topic, flags, payload, len);
+}
+
+// Deliver the node's held commands in order; stop at the first it misses.
+// Returns true if none are left for it.
+static bool flush_queue(const GatewayNode *node) {
+    uint8_t i = 0;
+    while (i < s_queue_count) {
+        const GatewayCommand *cmd = &s_queue[i];
+        if (memcmp(cmd->mac, node->mac, sizeof(cmd->mac)) != 0) {
+            ++i;
+            continue;
+        }
+        if (!send_command(node, cmd->topic, cmd->flags, cmd->data, cmd->len)) {
+            return false;
+        }
+        queue_drop(i);
+    }
+    return true;
+}
+
+static void deliver(const GatewayNode *node, uint8_t topic, uint8_t flags,
+                    const uint8_t *payload, size_t len) {
+    // Keep the order: a live command never overtakes held ones.
+    if (node_listening(node) && flush_queue(node) && send_command(node, topic, flags, payload, len)) {
+        return;
+    }
+    queue_push(node, topic, flags, payload, len);
+}
+
+// Fan out to every node heard since boot
+static void deliver_all(uint8_t topic, uint8_t flags, const uint8_t *payload, size_t len) {
+    for (uint8_t i = 0; i < ESPNOW_GATEWAY_MAX_NODES; ++i) {
+        if (s_nodes[i].used) {
+            deliver(&s_nodes[i], topic, flags, payload, len);
+        }
+    }
+}
+
+static void on_broker_command(const char *topic, const uint8_t *payload, size_t len) {
+    TopicParts parts;
+    const uint8_t id = espnow_topic_id(topic);
+    if (id == ESPNOW_TOPIC_NONE || len > ESPNOW_GATEWAY_CMD_MAX || !device_topic_parse(topic, &parts)) {
+#if DEBUG_SERIAL
+        Serial.print("[GW] Dropped command on ");
+        Serial.println(topic);
+#endif
+        return;
+    }
+
+    if (parts.scope == TOPIC_SCOPE_BROADCAST) {
+        deliver_all(id, 0, payload, len);
+        return;
+    }
+    if (parts.scope == TOPIC_SCOPE_GROUP) {
+        // The gateway does not track memberships: every node gets it with
+        // the group name in front and keeps it only if it joined the group.
+        uint8_t framed[ESPNOW_GATEWAY_CMD_MAX];
+        const size_t name_len = parts.target_len;
+        if (name_len + 1 + len > sizeof(framed)) {
+#if DEBUG_SERIAL
+            Serial.print("[GW] Dropped command on ");
+            Serial.println(topic);
+#endif
+            return;
+        }
+        memcpy(framed, parts.target, name_len);
+        framed[name_len] = '\0';
+        memcpy(&framed[name_len + 1], payload, len);
+        deliver_all(id, ESPNOW_FLAG_GROUP, framed, name_len + 1 + len);
+        return;
+    }
+    // Other devices' topics match the wildcard too: only nodes we serve.
+    const GatewayNode *node = find_node_by_id(parts);
+    if (node != nullptr) {
+        deliver(node, id, 0, payload, len);
+    }
+}
+
+// =============================================================================
+// NODE FRAMES (node -> broker)
+// =============================================================================
+
+static void reply_hello(const uint8_t mac[6]) {
+    uint8_t reply[ESPNOW_HELLO_REPLY_LEN];
+    memcpy(reply, mac, 6);
+    reply[6] = (uint8_t)WiFi.channel();
+    espnow_send(nullptr, ESPNOW_FRAME_HELLO, ESPNOW_TOPIC_NONE, 0, reply, sizeof(reply));
+}
+
+static void handle_frame(const EspNowRxFrame *frame) {
+    const EspNowHeader *h = espnow_header(frame);
+    if (h == nullptr) {
+        return;
+    }
+
+    if (h->type == ESPNOW_FRAME_HELLO) {
+        // Only claim to be a gateway while the broker can take the data
+        if (s_link->connected() && track_node(frame->mac) != nullptr) {
+            reply_hello(frame->mac);
+        }
+        return;
+    }
+    if (h->type != ESPNOW_FRAME_PUBLISH && h->type != ESPNOW_FRAME_POLL) {
+        return;
+    }
+
+    GatewayNode *node = track_node(frame->mac);
+    if (node == nullptr) {
+        return;
+    }
+    node->last_rx_ms = millis();
+
+    if (h->type == ESPNOW_FRAME_PUBLISH && espnow_assemble(&node->rx, frame)) {
+        const char *suffix = espnow_topic_name(node->rx.topic);
+        char topic[MQTT_TOPIC_MAX_LEN];
+        if (suffix != nullptr && device_topic(topic, sizeof(topic), node->id, suffix)) {
+            s_link->publish(topic, node->rx.data, node->rx.len,
+                            (node->rx.flags & ESPNOW_FLAG_RETAIN) != 0);
+        }
+    }
+    // The node's peer entry exists by now: held commands can follow
+    flush_queue(node);
+}
+
+// =============================================================================
+// API
+// =============================================================================
+
+void espnow_gateway_init() {
+    s_link = control_link_mqtt();
+    // The WiFi join fixes the channel nodes will find the gateway on
+    s_link->connect(on_broker_command);
+    s_last_connect_ms = millis();
+    WiFi.setSleep(WIFI_PS_NONE);   // modem sleep would miss node frames
+    const bool started = espnow_start();
+
+#if DEBUG_SERIAL
+    Serial.print("[GW] ESP-NOW gateway ");
+    Serial.print(started ? "listening on ch=" : "FAILED to start, ch=");
+    Serial.print(WiFi.channel());
+    Serial.println(s_link->connected() ? " (broker up)" : " (broker down)");
+#else
+    (void)started;
+#endif
+}
+
+void espnow_gateway_process() {
+    if (!s_link->connected() && (millis() - s_last_connect_ms) >= MQTT_RECONNECT_MS) {
+        s_link->connect(on_broker_command);
+        s_last_connect_ms = millis();
+    }
+    s_link->poll();
+
+    EspNowRxFrame frame;
+    if (espnow_receive(&frame, GATEWAY_RX_WAIT_MS)) {
+        do {
+            handle_frame(&frame);
+        } while (espnow_receive(&frame, 0));
+    }
+}
+
+#else
+
+void espnow_gateway_init() {}
+void espnow_gateway_process() {}
+
+#endif // GATEWAY_ROLE
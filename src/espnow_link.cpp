@@ -0,0 +1,454 @@
+/**
+ * espnow_link.cpp - ESP-NOW framing and the node side control link
+ *
+ * Receive and send callbacks run in the WiFi task: received frames are
+ * copied into a queue and handled by whoever polls (mqtt_control on a
+ * node, espnow_gateway on the gateway); the send callback only releases
+ * the sender waiting for the MAC ack.
+ */
+
+#include "espnow_link.h"
+
+#if (CONTROL_TRANSPORT == CONTROL_TRANSPORT_ESPNOW) || GATEWAY_ROLE
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include "control_link.h"
+#include "device_topic.h"
+#include "profiler.h"
+#include "power_log.h"
+#include "esp_attr.h"
+#include "esp_idf_version.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const uint8_t k_broadcast_mac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+#ifdef ESPNOW_KEY
+#define ESPNOW_ENCRYPTED  1
+static_assert(sizeof(ESPNOW_KEY) == ESP_NOW_KEY_LEN + 1, "SECRET_ESPNOW_KEY must be 16 characters");
+#else
+#define ESPNOW_ENCRYPTED  0
+#endif
+
+static bool s_started = false;
+static QueueHandle_t s_rx_queue = nullptr;
+static SemaphoreHandle_t s_sent = nullptr;
+static volatile esp_now_send_status_t s_send_status = ESP_NOW_SEND_FAIL;
+// Continues across deep sleep so a receiver never takes a new message for
+// the retry of the last one.
+static RTC_DATA_ATTR uint8_t s_msg_seq = 0;
+
+// Topic suffixes (device_topic.h); the device level is implied by the
+// sender. Indices are part of the frame format: append only.
+static const char *const k_topics[] = {
+    MQTT_TOPIC_COMMAND,
+    MQTT_TOPIC_STATUS,
+    MQTT_TOPIC_TELEMETRY,
+    MQTT_TOPIC_ACK,
+    MQTT_TOPIC_AWAKE,
+    MQTT_TOPIC_TELEMETRY_BATCH,
+    MQTT_TOPIC_PROFILE,
+    MQTT_TOPIC_COMMAND_BIN,
+    MQTT_TOPIC_TELEMETRY_BIN,
+    MQTT_TOPIC_ACK_BIN,
+    MQTT_TOPIC_TELEMETRY_BATCH_BIN,
+};
+
+#define TOPIC_COUNT  (sizeof(k_topics) / sizeof(k_topics[0]))
+
+// =============================================================================
+// RADIO
+// =============================================================================
+
+// IDF 5 passes the sender in esp_now_recv_info_t, IDF 4.4 (Arduino 2.0.x)
+// only its MAC.
+#if ESP_IDF_VERSION_MAJOR >= 5
+static void on_recv(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    const uint8_t *mac = info->src_addr;
+#else
+static void on_recv(const uint8_t *mac, const uint8_t *data, int len) {
+#endif
+    if (len < (int)sizeof(EspNowHeader) || len > ESP_NOW_MAX_DATA_LEN) {
+        return;
+    }
+    EspNowRxFrame frame;
+    memcpy(frame.mac, mac, sizeof(frame.mac));
+    frame.len = (uint8_t)len;
+    memcpy(frame.data, data, (size_t)len);
+    xQueueSend(s_rx_queue, &frame, 0);   // full: drop, the sender retries on its next wake
+}
+
+static void on_sent(const uint8_t *mac, esp_now_send_status_t status) {
+    (void)mac;
+    s_send_status = status;
+    xSemaphoreGive(s_sent);
+}
+
+static bool add_peer(const uint8_t *mac, bool encrypt) {
+    if (esp_now_is_peer_exist(mac)) {
+        return true;
+    }
+    esp_now_peer_info_t peer;
+    memset(&peer, 0, sizeof(peer));
+    memcpy(peer.peer_addr, mac, sizeof(peer.peer_addr));
+    peer.channel = 0;   // whatever channel the radio is on
+    peer.ifidx = WIFI_IF_STA;
+    peer.encrypt = encrypt;
+#if ESPNOW_ENCRYPTED
+    memcpy(peer.lmk, ESPNOW_KEY, ESP_NOW_KEY_LEN);
+#endif
+    return esp_now_add_peer(&peer) == ESP_OK;
+}
+
+bool espnow_start() {
+    if (s_started) {
+        return true;
+    }
+    if (s_rx_queue == nullptr) {
+        s_rx_queue = xQueueCreate(ESPNOW_RX_QUEUE_LEN, sizeof(EspNowRxFrame));
+        s_sent = xSemaphoreCreateBinary();
+        if (s_rx_queue == nullptr || s_sent == nullptr) {
+            return false;
+        }
+    }
+
+    if (WiFi.getMode() == WIFI_OFF) {
+        WiFi.mode(WIFI_STA);
+    }
+    if (esp_now_init() != ESP_OK) {
+#if DEBUG_SERIAL
+        Serial.println("[ESPNOW] esp_now_init failed");
+#endif
+        return false;
+    }
+#if ESPNOW_ENCRYPTED
+    esp_now_set_pmk((const uint8_t *)ESPNOW_KEY);
+#endif
+    esp_now_register_recv_cb(on_recv);
+    esp_now_register_send_cb(on_sent);
+    s_started = add_peer(k_broadcast_mac, false);
+    return s_started;
+}
+
+bool espnow_add_peer(const uint8_t mac[6]) {
+    return add_peer(mac, ESPNOW_ENCRYPTED);
+}
+
+void espnow_remove_peer(const uint8_t mac[6]) {
+    esp_now_del_peer(mac);
+}
+
+static bool send_frame(const uint8_t *mac, const uint8_t *frame, size_t len) {
+    for (uint8_t attempt = 0; attempt < ESPNOW_SEND_RETRIES; ++attempt) {
+        xSemaphoreTake(s_sent, 0);   // drop a late callback of an earlier frame
+        if (esp_now_send(mac, frame, len) != ESP_OK) {
+            delay(2);
+            continue;
+        }
+        if (xSemaphoreTake(s_sent, pdMS_TO_TICKS(ESPNOW_SEND_TIMEOUT_MS)) == pdTRUE &&
+            s_send_status == ESP_NOW_SEND_SUCCESS) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool espnow_send(const uint8_t *mac, EspNowFrameType type, uint8_t topic, uint8_t flags,
+                 const uint8_t *payload, size_t len) {
+    const size_t parts = (len == 0) ? 1 : (len + ESPNOW_PART_MAX - 1) / ESPNOW_PART_MAX;
+    if (!s_started || len > ESPNOW_MESSAGE_MAX || parts > 255) {
+        return false;
+    }
+    const uint8_t *dest = (mac != nullptr) ? mac : k_broadcast_mac;
+
+    uint8_t frame[ESP_NOW_MAX_DATA_LEN];
+    EspNowHeader *h = (EspNowHeader *)frame;
+    h->version = ESPNOW_FRAME_VERSION;
+    h->type    = (uint8_t)type;
+    h->topic   = topic;
+    h->flags   = flags;
+    h->msg_seq = s_msg_seq++;
+    h->parts   = (uint8_t)parts;
+
+    for (size_t part = 0; part < parts; ++part) {
+        const size_t offset = part * ESPNOW_PART_MAX;
+        const size_t chunk = (len - offset < ESPNOW_PART_MAX) ? len - offset : ESPNOW_PART_MAX;
+        h->part = (uint8_t)part;
+        if (chunk > 0) {
+            memcpy(frame + sizeof(EspNowHeader), payload + offset, chunk);
+        }
+        if (!send_frame(dest, frame, sizeof(EspNowHeader) + chunk)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool espnow_receive(EspNowRxFrame *out, uint32_t wait_ms) {
+    if (s_rx_queue == nullptr) {
+        return false;
+    }
+    return xQueueReceive(s_rx_queue, out, pdMS_TO_TICKS(wait_ms)) == pdTRUE;
+}
+
+void espnow_flush_rx() {
+    if (s_rx_queue != nullptr) {
+        xQueueReset(s_rx_queue);
+    }
+}
+
+// =============================================================================
+// FRAMING
+// =============================================================================
+
+const EspNowHeader *espnow_header(const EspNowRxFrame *frame) {
+    if (frame->len < sizeof(EspNowHeader)) {
+        return nullptr;
+    }
+    const EspNowHeader *h = (const EspNowHeader *)frame->data;
+    return (h->version == ESPNOW_FRAME_VERSION && h->parts > 0 && h->part < h->parts) ? h : nullptr;
+}
+
+bool espnow_assemble(EspNowMessage *msg, const EspNowRxFrame *frame) {
+    const EspNowHeader *h = espnow_header(frame);
+    if (h == nullptr) {
+        return false;
+    }
+    if (h->msg_seq == msg->msg_seq && msg->next_part != 0xFF && h->part < msg->next_part) {
+        return false;   // resent because its MAC ack was lost
+    }
+    if (h->part == 0) {
+        msg->type      = h->type;
+        msg->topic     = h->topic;
+        msg->flags     = h->flags;
+        msg->msg_seq   = h->msg_seq;
+        msg->parts     = h->parts;
+        msg->next_part = 0;
+        msg->len       = 0;
+    } else if (h->msg_seq != msg->msg_seq || h->part != msg->next_part || h->parts != msg->parts) {
+        msg->next_part = 0xFF;   // lost a part: wait for the next message
+        return false;
+    }
+
+    const size_t chunk = frame->len - sizeof(EspNowHeader);
+    if (msg->len + chunk > sizeof(msg->data)) {
+        msg->next_part = 0xFF;
+        return false;
+    }
+    memcpy(msg->data + msg->len, frame->data + sizeof(EspNowHeader), chunk);
+    msg->len += (uint16_t)chunk;
+    ++msg->next_part;
+    return msg->next_part == msg->parts;
+}
+
+uint8_t espnow_topic_id(const char *topic) {
+    TopicParts parts;
+    if (!device_topic_parse(topic, &parts)) {
+        return ESPNOW_TOPIC_NONE;
+    }
+    for (uint8_t i = 0; i < TOPIC_COUNT; ++i) {
+        if (strcmp(parts.suffix, k_topics[i]) == 0) {
+            return i;
+        }
+    }
+    return ESPNOW_TOPIC_NONE;
+}
+
+const char *espnow_topic_name(uint8_t id) {
+    return (id < TOPIC_COUNT) ? k_topics[id] : nullptr;
+}
+
+// =============================================================================
+// NODE LINK (control_link.h)
+// =============================================================================
+
+#if CONTROL_TRANSPORT == CONTROL_TRANSPORT_ESPNOW
+
+#define ESPNOW_GATEWAY_CACHE_MAGIC  0x454E4731UL   // "ENG1"
+
+typedef struct {
+    uint32_t magic;
+    uint8_t  mac[6];
+    uint8_t  channel;
+} EspNowGatewayCache;
+
+// Survives deep sleep: the next wake says hello on this channel first.
+static RTC_DATA_ATTR EspNowGatewayCache s_gateway;
+
+static ControlLinkRxFn s_on_rx = nullptr;
+static bool s_link_up = false;
+static uint8_t s_send_fails = 0;
+static uint32_t s_last_tx_ms = 0;
+static EspNowMessage s_rx_msg;
+
+static bool gateway_cached() {
+    return s_gateway.magic == ESPNOW_GATEWAY_CACHE_MAGIC && s_gateway.channel > 0;
+}
+
+// Broadcast a hello on one channel and wait for the gateway's reply to us.
+static bool hello_on_channel(uint8_t channel, const uint8_t own_mac[6]) {
+    if (esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE) != ESP_OK) {
+        return false;
+    }
+    espnow_flush_rx();
+    if (!espnow_send(nullptr, ESPNOW_FRAME_HELLO, ESPNOW_TOPIC_NONE, 0, nullptr, 0)) {
+        return false;
+    }
+
+    const uint32_t start_ms = millis();
+    EspNowRxFrame frame;
+    for (uint32_t waited = 0; waited < ESPNOW_SCAN_DWELL_MS; waited = millis() - start_ms) {
+        if (!espnow_receive(&frame, ESPNOW_SCAN_DWELL_MS - waited)) {
+            break;
+        }
+        const EspNowHeader *h = espnow_header(&frame);
+        const uint8_t *reply = frame.data + sizeof(EspNowHeader);
+        if (h == nullptr || h->type != ESPNOW_FRAME_HELLO ||
+            frame.len < sizeof(EspNowHeader) + ESPNOW_HELLO_REPLY_LEN ||
+            memcmp(reply, own_mac, 6) != 0) {
+            continue;   // another node's hello, or a reply to it
+        }
+        memcpy(s_gateway.mac, frame.mac, sizeof(s_gateway.mac));
+        s_gateway.channel = reply[6];
+        s_gateway.magic = ESPNOW_GATEWAY_CACHE_MAGIC;
+        if (reply[6] != channel) {
+            // Heard through an adjacent channel: move to the gateway's
+            esp_wifi_set_channel(reply[6], WIFI_SECOND_CHAN_NONE);
+        }
+        return true;
+    }
+    return false;
+}
+
+static bool find_gateway() {
+    uint8_t own_mac[6];
+    WiFi.macAddress(own_mac);
+
+    if (gateway_cached()) {
+#if DEBUG_SERIAL
+        const uint32_t start_ms = millis();
+#endif
+        const bool ok = hello_on_channel(s_gateway.channel, own_mac);
+#if DEBUG_SERIAL
+        Serial.print("[ESPNOW] Gateway hello ch=");
+        Serial.print(s_gateway.channel);
+        Serial.print(ok ? " ok in " : " FAILED after ");
+        Serial.print(millis() - start_ms);
+        Serial.println(" ms");
+#endif
+        if (ok) {
+            return true;
+        }
+    }
+
+    // Gateway moved with its access point (or first wake): try every channel.
+    // The cache is kept on failure, the gateway is most likely just offline.
+    const uint8_t skip = gateway_cached() ? s_gateway.channel : 0;
+    for (uint8_t ch = 1; ch <= ESPNOW_MAX_CHANNEL; ++ch) {
+        if (ch != skip && hello_on_channel(ch, own_mac)) {
+#if DEBUG_SERIAL
+            Serial.print("[ESPNOW] Gateway found on ch=");
+            Serial.println(s_gateway.channel);
+#endif
+            return true;
+        }
+    }
+#if DEBUG_SERIAL
+    Serial.println("[ESPNOW] No gateway answered");
+#endif
+    return false;
+}
+
+static void note_send(bool ok) {
+    s_last_tx_ms = millis();
+    if (ok) {
+        s_send_fails = 0;
+    } else if (++s_send_fails >= ESPNOW_MAX_SEND_FAILS) {
+        s_link_up = false;   // next reconnect says hello again
+    }
+}
+
+static bool espnow_link_connect(ControlLinkRxFn on_rx) {
+    s_on_rx = on_rx;
+    const int64_t span = profiler_start();
+    power_log_phase(POWER_PHASE_WIFI, true);
+    s_link_up = espnow_start() && find_gateway() && espnow_add_peer(s_gateway.mac);
+    power_log_phase(POWER_PHASE_WIFI, false);
+    profiler_stop(PROF_WIFI_JOIN, span);
+    s_send_fails = 0;
+    s_last_tx_ms = millis();
+    return s_link_up;
+}
+
+static bool espnow_link_connected() {
+    return s_link_up;
+}
+
+static bool espnow_link_publish(const char *topic, const uint8_t *payload, size_t len, bool retained) {
+    const uint8_t id = espnow_topic_id(topic);
+    if (!s_link_up || id == ESPNOW_TOPIC_NONE) {
+        return false;
+    }
+    const bool ok = espnow_send(s_gateway.mac, ESPNOW_FRAME_PUBLISH, id,
+                                retained ? ESPNOW_FLAG_RETAIN : 0, payload, len);
+    note_send(ok);
+    return ok;
+}
+
+static void espnow_link_poll() {
+    if (!s_link_up) {
+        return;
+    }
+    EspNowRxFrame frame;
+    while (espnow_receive(&frame, 0)) {
+        if (memcmp(frame.mac, s_gateway.mac, sizeof(frame.mac)) != 0 ||
+            !espnow_assemble(&s_rx_msg, &frame) || s_rx_msg.type != ESPNOW_FRAME_COMMAND) {
+            continue;
+        }
+        const char *suffix = espnow_topic_name(s_rx_msg.topic);
+        if (suffix == nullptr || s_on_rx == nullptr) {
+            continue;
+        }
+        char topic[MQTT_TOPIC_MAX_LEN];
+        if ((s_rx_msg.flags & ESPNOW_FLAG_GROUP) != 0) {
+            // "<group>\0<payload>": rebuilt as the group topic, so the
+            // command handler drops groups we have not joined.
+            const uint8_t *end = (const uint8_t *)memchr(s_rx_msg.data, '\0', s_rx_msg.len);
+            if (end == nullptr ||
+                !group_topic(topic, sizeof(topic), (const char *)s_rx_msg.data, suffix)) {
+                continue;
+            }
+            const size_t skip = (size_t)(end - s_rx_msg.data) + 1;
+            s_on_rx(topic, end + 1, s_rx_msg.len - skip);
+            continue;
+        }
+        // Anything else the gateway forwards is meant for us (own or
+        // broadcast topic), so it arrives as a command on our own topic.
+        if (device_topic(topic, sizeof(topic), device_id(), suffix)) {
+            s_on_rx(topic, s_rx_msg.data, s_rx_msg.len);
+        }
+    }
+
+    // Always-on nodes: the gateway forwards commands only for a while
+    // after hearing from us.
+    if ((millis() - s_last_tx_ms) >= ESPNOW_KEEPALIVE_MS) {
+        note_send(espnow_send(s_gateway.mac, ESPNOW_FRAME_POLL, ESPNOW_TOPIC_NONE, 0, nullptr, 0));
+    }
+}
+
+static const ControlLink k_espnow_link = {
+    "espnow",
+    espnow_link_connect,
+    espnow_link_connected,
+    espnow_link_publish,
+    espnow_link_poll,
+};
+
+const ControlLink *control_link_espnow() {
+    return &k_espnow_link;
+}
+
+#endif // CONTROL_TRANSPORT == CONTROL_TRANSPORT_ESPNOW
+
+#endif // CONTROL_TRANSPORT == CONTROL_TRANSPORT_ESPNOW || GATEWAY_ROLE
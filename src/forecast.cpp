@@ -0,0 +1,193 @@
+/**
+ * forecast.cpp - Forecast-driven watering planner implementation
+ *
+ * Drying rate of a channel: pct_per_mm (0.1 % humidity per mm ET) times
+ * the forecast ET gives the expected humidity drop per day. Each sample is
+ * the drop between two readings at least FORECAST_LEARN_MIN_SEC apart,
+ * divided by the forecast ET; intervals with a watering, rising readings
+ * or likely rain only move the baseline.
+ */
+
+#include "forecast.h"
+#include "storage.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include <string.h>
+
+#define FORECAST_MAGIC  0x46435331UL   // "FCS1"
+#define SEC_PER_DAY     86400UL
+
+typedef struct {
+    uint32_t base_ts;            // learning baseline (persistent time), 0 = none
+    uint32_t now_ts;             // last observation, 0 = none
+    uint16_t pct_per_mm_x10;     // learned drying
+    uint8_t  base_h;
+    uint8_t  now_h;
+} ForecastChannel;
+
+typedef struct {
+    uint32_t magic;
+    bool     has_forecast;
+    uint32_t received_at;        // persistent time of the last forecast
+    uint16_t et_x10;
+    uint8_t  rain_pct;
+    ForecastChannel ch[PLANT_CHANNEL_COUNT];
+} ForecastState;
+
+static RTC_DATA_ATTR ForecastState s_fc;
+static bool s_checked = false;
+
+// RTC memory holds garbage after a power-on; start clean then.
+static ForecastState &state() {
+    if (!s_checked) {
+        s_checked = true;
+        if (s_fc.magic != FORECAST_MAGIC || esp_reset_reason() == ESP_RST_POWERON) {
+            memset(&s_fc, 0, sizeof(s_fc));
+            s_fc.magic = FORECAST_MAGIC;
+            for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+                s_fc.ch[ch].pct_per_mm_x10 = FORECAST_PCT_PER_MM_X10;
+            }
+        }
+    }
+    return s_fc;
+}
+
+static uint8_t clamp_channel(uint8_t ch) {
+    return (ch < PLANT_CHANNEL_COUNT) ? ch : 0;
+}
+
+// Expected humidity drop in 0.1 %/day at the forecast ET.
+static uint32_t drop_x10_per_day(const ForecastChannel &c) {
+    return ((uint32_t)c.pct_per_mm_x10 * state().et_x10) / 10U;
+}
+
+// Seconds until humidity drops below minimal at the forecast ET.
+static uint32_t crossing_sec(const ForecastChannel &c, uint8_t humidity, uint8_t minimal) {
+    if (humidity < minimal) {
+        return 0;
+    }
+    const uint32_t rate = drop_x10_per_day(c);
+    if (rate == 0) {
+        return UINT32_MAX;
+    }
+    const uint64_t sec = ((uint64_t)(humidity - minimal) * 10U * SEC_PER_DAY) / rate;
+    return (sec > UINT32_MAX) ? UINT32_MAX : (uint32_t)sec;
+}
+
+// =============================================================================
+// FORECAST
+// =============================================================================
+
+bool forecast_set(uint32_t et_x10, uint32_t rain_pct) {
+    if (et_x10 > FORECAST_ET_MAX_X10 || rain_pct > 100) {
+        return false;
+    }
+    ForecastState &fc = state();
+    fc.has_forecast = true;
+    fc.received_at  = storage_get_persistent_time();
+    fc.et_x10       = (uint16_t)et_x10;
+    fc.rain_pct     = (uint8_t)rain_pct;
+
+    #if DEBUG_SERIAL
+    Serial.print("[FCST] ET ");
+    Serial.print(et_x10 / 10);
+    Serial.print('.');
+    Serial.print(et_x10 % 10);
+    Serial.print(" mm/day, rain ");
+    Serial.print(rain_pct);
+    Serial.println("%");
+    #endif
+    return true;
+}
+
+bool forecast_active() {
+#if FORECAST_ENABLED
+    const ForecastState &fc = state();
+    return fc.has_forecast &&
+           storage_get_persistent_time() - fc.received_at < FORECAST_VALID_SEC;
+#else
+    return false;
+#endif
+}
+
+bool forecast_rain_likely() {
+    return forecast_active() && state().rain_pct >= FORECAST_RAIN_SKIP_PCT;
+}
+
+// =============================================================================
+// LEARNING
+// =============================================================================
+
+void forecast_observe(uint8_t ch, uint8_t humidity) {
+    ch = clamp_channel(ch);
+    ForecastChannel &c = state().ch[ch];
+    const uint32_t now = storage_get_persistent_time();
+    c.now_h  = humidity;
+    c.now_ts = now;
+
+    const bool baseline = c.base_ts != 0 && now > c.base_ts &&
+                          storage_get_last_watering_time(ch) < c.base_ts &&
+                          humidity <= c.base_h;
+    if (!baseline) {
+        c.base_h  = humidity;
+        c.base_ts = now;
+        return;
+    }
+    const uint32_t dt = now - c.base_ts;
+    if (dt < FORECAST_LEARN_MIN_SEC) {
+        return;   // keep the older baseline, the drop is still too small to learn from
+    }
+
+    if (forecast_active() && !forecast_rain_likely() && state().et_x10 > 0) {
+        // (drop per day) / (ET in mm), in 0.1 % per mm
+        const uint64_t sample = ((uint64_t)(c.base_h - humidity) * SEC_PER_DAY * 100U) /
+                                ((uint64_t)dt * state().et_x10);
+        if (sample <= FORECAST_PCT_PER_MM_MAX_X10) {
+            c.pct_per_mm_x10 = (uint16_t)(((uint32_t)c.pct_per_mm_x10 * (100U - FORECAST_LEARN_WEIGHT_PCT) +
+                                           (uint32_t)sample * FORECAST_LEARN_WEIGHT_PCT + 50U) / 100U);
+            #if DEBUG_SERIAL
+            Serial.print("[FCST] ch");
+            Serial.print(ch);
+            Serial.print(" drying ");
+            Serial.print(c.pct_per_mm_x10);
+            Serial.println(" x0.1 %/mm ET");
+            #endif
+        }
+    }
+    c.base_h  = humidity;
+    c.base_ts = now;
+}
+
+// =============================================================================
+// PLANNING
+// =============================================================================
+
+ForecastPlan forecast_plan(uint8_t ch, uint8_t humidity, uint8_t minimal) {
+    if (!forecast_active()) {
+        return FORECAST_PLAN_NONE;
+    }
+    const bool rain = forecast_rain_likely();
+    if (humidity < minimal) {
+        return (rain && humidity + FORECAST_RAIN_MARGIN_PCT >= minimal) ? FORECAST_PLAN_HOLD_RAIN
+                                                                        : FORECAST_PLAN_NONE;
+    }
+    if (!rain && crossing_sec(state().ch[clamp_channel(ch)], humidity, minimal) <= FORECAST_EARLY_WINDOW_SEC) {
+        return FORECAST_PLAN_WATER_EARLY;
+    }
+    return FORECAST_PLAN_NONE;
+}
+
+uint32_t forecast_next_check_sec(uint8_t ch, bool *rain_hold) {
+    *rain_hold = false;
+    ch = clamp_channel(ch);
+    const ForecastChannel &c = state().ch[ch];
+    if (!forecast_active() || c.now_ts == 0) {
+        return UINT32_MAX;
+    }
+    const uint8_t minimal = storage_get_minimal_humidity(ch);
+    if (forecast_plan(ch, c.now_h, minimal) == FORECAST_PLAN_HOLD_RAIN) {
+        *rain_hold = true;
+        return FORECAST_RAIN_RECHECK_SEC;
+    }
+    return crossing_sec(c, c.now_h, minimal);
+}
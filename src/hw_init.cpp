@@ -0,0 +1,114 @@
+/**
+ * hw_init.cpp - Hardware module registry
+ *
+ * Table order is init order: dependencies come first, so one pass over
+ * the expanded mask initializes everything in a valid sequence. A
+ * module's bit is set before its init runs, so an init that itself uses
+ * a module entry point cannot recurse.
+ */
+
+#include "hw_init.h"
+#include "config.h"
+#include "storage.h"
+#include "adc_sampler.h"
+#include "sensor.h"
+#include "battery.h"
+#include "actuator.h"
+#include "watering.h"
+#include "water_level.h"
+#include "leds.h"
+#include "buttons.h"
+#include "telemetry_log.h"
+#include "profiler.h"
+
+typedef struct {
+    uint16_t    bit;
+    uint16_t    deps;
+    const char *name;
+    void      (*init)();
+} HwModuleEntry;
+
+static void storage_start() {
+    if (!storage_init()) {
+        // NVS failure — flash error LED and continue with defaults
+        #if DEBUG_SERIAL
+        Serial.println("[HW] ERROR: Storage init failed!");
+        #endif
+        PLAY_PATTERN(NVS_FAIL);
+    }
+}
+
+static void actuator_start_module() {
+    ActiveActuator::init();
+}
+
+static const HwModuleEntry s_modules[] = {
+    { HW_STORAGE,       0,          "storage",   storage_start },
+    { HW_LEDS,          0,          "leds",      leds_init },
+    { HW_ADC,           0,          "adc",       adc_sampler_init },
+    { HW_SENSOR,        HW_STORAGE, "sensor",    sensor_init },
+    { HW_BATTERY,       0,          "battery",   battery_init },
+    { HW_ACTUATOR,      0,          "actuator",  actuator_start_module },
+    { HW_WATERING,      HW_STORAGE, "watering",  watering_init },
+    { HW_WATER_LEVEL,   0,          "water_lvl", water_level_init },
+#if CONTROL_HAS_BUTTONS
+    { HW_BUTTONS,       0,          "buttons",   buttons_init },
+#endif
+    { HW_TELEMETRY_LOG, HW_STORAGE, "tlm_log",   telemetry_log_init },
+};
+
+#define HW_MODULE_COUNT  (sizeof(s_modules) / sizeof(s_modules[0]))
+
+static uint16_t s_ready = 0;
+static uint32_t s_init_us[HW_MODULE_COUNT];
+
+void hw_require(uint16_t modules) {
+    if ((s_ready & modules) == modules) {
+        return;
+    }
+
+    // Deps point to earlier entries only, so one backwards pass expands
+    // the mask fully.
+    for (int8_t i = (int8_t)HW_MODULE_COUNT - 1; i >= 0; --i) {
+        if (modules & s_modules[i].bit) {
+            modules |= s_modules[i].deps;
+        }
+    }
+
+    for (uint8_t i = 0; i < HW_MODULE_COUNT; ++i) {
+        const HwModuleEntry &m = s_modules[i];
+        if ((modules & m.bit) == 0 || (s_ready & m.bit) != 0) {
+            continue;
+        }
+        s_ready |= m.bit;
+        const uint32_t start_us = micros();
+        m.init();
+        s_init_us[i] = micros() - start_us;
+        profiler_add(PROF_INIT, s_init_us[i]);
+    }
+}
+
+bool hw_ready(uint16_t modules) {
+    return (s_ready & modules) == modules;
+}
+
+void hw_report_boot_times() {
+    #if DEBUG_SERIAL
+    uint32_t total_us = 0;
+    Serial.print("[HW] Init times:");
+    for (uint8_t i = 0; i < HW_MODULE_COUNT; ++i) {
+        if ((s_ready & s_modules[i].bit) == 0) {
+            continue;
+        }
+        Serial.print(' ');
+        Serial.print(s_modules[i].name);
+        Serial.print('=');
+        Serial.print(s_init_us[i]);
+        Serial.print("us");
+        total_us += s_init_us[i];
+    }
+    Serial.print(", total ");
+    Serial.print(total_us);
+    Serial.println(" us");
+    #endif
+}
@@ -1,9 +1,135 @@
 /**
  * leds.cpp - LED control implementation
+ *
+ * Player: a ring buffer of {leds, ms} segments. The one-shot esp_timer
+ * callback shows the next segment and re-arms itself for its duration;
+ * an empty queue switches the LEDs off and leaves the timer idle until the
+ * next segment is queued.
  */
 
 #include "leds.h"
 #include "config.h"
+#include "hw_init.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#define LED_BIT_GREEN   (1u << 0)
+#define LED_BIT_RED     (1u << 1)
+
+typedef struct {
+    uint16_t ms;
+    uint8_t  leds;
+} LedSegment;
+
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static LedSegment s_queue[LED_QUEUE_LEN];
+static uint8_t s_head = 0;
+static uint8_t s_count = 0;
+static volatile uint8_t s_lit_queued = 0;    // queued segments with an LED on
+static volatile uint8_t s_showing = 0;       // LED bits of the segment on display
+static volatile bool s_playing = false;      // timer armed for a segment
+static esp_timer_handle_t s_timer = nullptr;
+
+static inline void write_leds(uint8_t leds) {
+    digitalWrite(PIN_LED_GREEN, (leds & LED_BIT_GREEN) ? HIGH : LOW);
+    digitalWrite(PIN_LED_RED, (leds & LED_BIT_RED) ? HIGH : LOW);
+}
+
+// =============================================================================
+// PLAYER
+// =============================================================================
+
+// Show the next segment, or stop with the LEDs off. Runs in the timer task
+// and, to kick off an idle player, in the task that queued a segment.
+static void advance(void *arg) {
+    (void)arg;
+    LedSegment seg = {0, 0};
+    bool have = false;
+
+    portENTER_CRITICAL(&s_mux);
+    if (s_count > 0) {
+        seg = s_queue[s_head];
+        s_head = (uint8_t)((s_head + 1) % LED_QUEUE_LEN);
+        s_count--;
+        if (seg.leds) s_lit_queued--;
+        have = true;
+    }
+    s_playing = have;
+    s_showing = seg.leds;
+    write_leds(seg.leds);
+    portEXIT_CRITICAL(&s_mux);
+
+    if (have) {
+        esp_timer_start_once(s_timer, (uint64_t)seg.ms * 1000ULL);
+    }
+}
+
+static void enqueue(uint8_t leds, uint16_t ms) {
+    if (ms == 0) {
+        return;
+    }
+    hw_require(HW_LEDS);
+
+    bool kick = false;
+    for (;;) {
+        portENTER_CRITICAL(&s_mux);
+        const bool room = s_count < LED_QUEUE_LEN;
+        if (room) {
+            s_queue[(s_head + s_count) % LED_QUEUE_LEN] = {ms, leds};
+            s_count++;
+            if (leds) s_lit_queued++;
+            kick = !s_playing;
+            s_playing = true;
+        }
+        portEXIT_CRITICAL(&s_mux);
+        if (room) {
+            break;
+        }
+        delay(LED_QUEUE_POLL_MS);   // full: wait for the player to catch up
+    }
+
+    if (kick) {
+        advance(nullptr);
+    }
+}
+
+static void cancel() {
+    if (s_timer != nullptr) {
+        esp_timer_stop(s_timer);
+    }
+    portENTER_CRITICAL(&s_mux);
+    s_count = 0;
+    s_lit_queued = 0;
+    s_showing = 0;
+    s_playing = false;
+    write_leds(0);
+    portEXIT_CRITICAL(&s_mux);
+}
+
+bool leds_busy() {
+    return s_playing;
+}
+
+void leds_wait_idle() {
+    while (s_playing) {
+        delay(LED_QUEUE_POLL_MS);
+    }
+}
+
+void leds_finish(uint32_t max_ms) {
+    if (!hw_ready(HW_LEDS)) {
+        return;
+    }
+    const uint32_t start_ms = millis();
+    while ((s_lit_queued > 0 || s_showing != 0) && (millis() - start_ms) < max_ms) {
+        delay(LED_QUEUE_POLL_MS);
+    }
+    cancel();
+}
+
+void leds_pause(uint16_t ms) {
+    enqueue(0, ms);
+}
 
 // =============================================================================
 // INITIALIZATION
@@ -12,9 +138,16 @@
 void leds_init() {
     pinMode(PIN_LED_GREEN, OUTPUT);
     pinMode(PIN_LED_RED, OUTPUT);
-    
+
+    if (s_timer == nullptr) {
+        esp_timer_create_args_t args = {};
+        args.callback = advance;
+        args.name = "leds";
+        esp_timer_create(&args, &s_timer);
+    }
+
     // Start with LEDs off
-    leds_all_off();
+    cancel();
 }
 
 // =============================================================================
@@ -22,46 +155,58 @@ void leds_init() {
 // =============================================================================
 
 void led_green_on() {
+    hw_require(HW_LEDS);
+    leds_wait_idle();
     digitalWrite(PIN_LED_GREEN, HIGH);
 }
 
 void led_green_off() {
+    if (!hw_ready(HW_LEDS)) {
+        return;
+    }
+    leds_wait_idle();
     digitalWrite(PIN_LED_GREEN, LOW);
 }
 
 void led_red_on() {
+    hw_require(HW_LEDS);
+    leds_wait_idle();
     digitalWrite(PIN_LED_RED, HIGH);
 }
 
 void led_red_off() {
+    if (!hw_ready(HW_LEDS)) {
+        return;
+    }
+    leds_wait_idle();
     digitalWrite(PIN_LED_RED, LOW);
 }
 
 void leds_all_off() {
-    digitalWrite(PIN_LED_GREEN, LOW);
-    digitalWrite(PIN_LED_RED, LOW);
+    if (!hw_ready(HW_LEDS)) {
+        return;   // never configured this wake, pins are not driven
+    }
+    leds_wait_idle();
+    write_leds(0);
 }
 
 // =============================================================================
 // FLASH PATTERNS
 // =============================================================================
 
-void led_green_blink(uint8_t count, uint16_t duration_ms) {
+static void blink(uint8_t leds, uint8_t count, uint16_t duration_ms) {
     for (uint8_t i = 0; i < count; i++) {
-        led_green_on();
-        delay(duration_ms);
-        led_green_off();
-        delay(LED_PAUSE_MS);
+        enqueue(leds, duration_ms);
+        enqueue(0, LED_PAUSE_MS);
     }
 }
 
+void led_green_blink(uint8_t count, uint16_t duration_ms) {
+    blink(LED_BIT_GREEN, count, duration_ms);
+}
+
 void led_red_blink(uint8_t count, uint16_t duration_ms) {
-    for (uint8_t i = 0; i < count; i++) {
-        led_red_on();
-        delay(duration_ms);
-        led_red_off();
-        delay(LED_PAUSE_MS);
-    }
+    blink(LED_BIT_RED, count, duration_ms);
 }
 
 // =============================================================================
@@ -73,33 +218,25 @@ void leds_play_pattern(const LedStep steps[], uint8_t length,
     for (uint8_t i = 0; i < length; i++) {
         uint16_t g = steps[i].green_ms;
         uint16_t r = steps[i].red_ms;
-
-        if (g > 0) led_green_on();
-        if (r > 0) led_red_on();
+        uint8_t leds = (g > 0 ? LED_BIT_GREEN : 0) | (r > 0 ? LED_BIT_RED : 0);
 
         // Hold for the longer of the two durations
-        delay((g > r) ? g : r);
-        leds_all_off();
+        enqueue(leds, (g > r) ? g : r);
 
         // Pause between steps (skip after last step)
         if (pause_ms > 0 && i < length - 1) {
-            delay(pause_ms);
+            enqueue(0, pause_ms);
         }
     }
 
-    if (gap_ms > 0) delay(gap_ms);
+    enqueue(0, gap_ms);
 }
 
 // =============================================================================
 // VALUE DISPLAY (humidity = green, battery = red)
 // =============================================================================
 
-static inline void led_on(bool use_red)  { use_red ? led_red_on()  : led_green_on();  }
-static inline void led_off(bool use_red) { use_red ? led_red_off() : led_green_off(); }
-
-static inline void led_blink(bool use_red, uint8_t count, uint16_t ms) {
-    use_red ? led_red_blink(count, ms) : led_green_blink(count, ms);
-}
+static inline uint8_t led_bit(bool use_red) { return use_red ? LED_BIT_RED : LED_BIT_GREEN; }
 
 void led_display_value(uint8_t value, bool use_red) {
     if (value > 100) value = 100;
@@ -108,30 +245,23 @@ void led_display_value(uint8_t value, bool use_red) {
     uint8_t ones = value % 10;
 
     // Start indicator — both LEDs briefly
-    led_green_on();
-    led_red_on();
-    delay(LED_NUMBER_START_MS);
-    leds_all_off();
-    delay(LED_DIGIT_PAUSE_MS);
+    enqueue(LED_BIT_GREEN | LED_BIT_RED, LED_NUMBER_START_MS);
+    enqueue(0, LED_DIGIT_PAUSE_MS);
 
     // Tens digit (long flashes)
-    if (tens > 0) {
-        led_blink(use_red, tens, LED_LONG);
-    }
+    blink(led_bit(use_red), tens, LED_LONG);
 
-    delay(LED_DIGIT_PAUSE_MS);
+    enqueue(0, LED_DIGIT_PAUSE_MS);
 
     // Ones digit (short flashes) or zero indicator
     if (ones > 0) {
-        led_blink(use_red, ones, LED_SHORT);
+        blink(led_bit(use_red), ones, LED_SHORT);
     } else {
-        led_on(!use_red);
-        delay(LED_RAPID);
-        led_off(!use_red);
+        enqueue(led_bit(!use_red), LED_RAPID);
     }
 
     // End indicator — double flash (pattern from config.h)
-    delay(LED_PAUSE_MS);
+    enqueue(0, LED_PAUSE_MS);
     PLAY_PATTERN(NUM_END);
 }
 
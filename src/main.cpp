@@ -10,9 +10,11 @@
  * WAKE CYCLE:
  * 1. Wake from deep sleep (timer or button)
  * 2. Initialize hardware
- * 3. Determine wake reason
- * 4. Execute appropriate action
- * 5. Return to deep sleep
+ * 3. Determine wake reason, start WiFi/MQTT bring-up in background
+ *    (timer wakes only every TELEMETRY_UPLOAD_EVERY_WAKES)
+ * 4. Execute appropriate action, log telemetry record (timer wake)
+ * 5. Upload telemetry log, MQTT command window (once link is up)
+ * 6. Return to deep sleep
  * 
  * POWER CONSUMPTION:
  * - Deep sleep: ~10 µA
@@ -26,43 +28,26 @@
 #include "soc/soc_caps.h"
 #include "config.h"
 #include "storage.h"
+#include "adc_sampler.h"
 #include "sensor.h"
 #include "battery.h"
-#include "pump.h"
-#include "motor.h"
+#include "actuator.h"
 #include "watering.h"
 #include "leds.h"
 #include "buttons.h"
 #include "water_level.h"
 #include "mqtt_control.h"
-
-#if (CONTROL_MODE == CONTROL_MODE_BUTTONS || CONTROL_MODE == CONTROL_MODE_BOTH)
-#define CONTROL_HAS_BUTTONS 1
-#else
-#define CONTROL_HAS_BUTTONS 0
-#endif
-
-#if (CONTROL_MODE == CONTROL_MODE_MQTT || CONTROL_MODE == CONTROL_MODE_BOTH)
-#define CONTROL_HAS_MQTT 1
-#else
-#define CONTROL_HAS_MQTT 0
-#endif
-
-static inline void actuator_init() {
-#if (ACTUATOR_TYPE == ACTUATOR_TYPE_STEPPER)
-    motor_init();
-#else
-    pump_init();
-#endif
-}
-
-static inline void actuator_emergency_stop() {
-#if (ACTUATOR_TYPE == ACTUATOR_TYPE_STEPPER)
-    motor_emergency_stop();
-#else
-    pump_emergency_stop();
-#endif
-}
+#include "telemetry_log.h"
+#include "sleep_monitor.h"
+#include "hw_init.h"
+#include "profiler.h"
+#include "power_log.h"
+#include "esp_system.h"
+#include "wake_scheduler.h"
+#include "always_on.h"
+#include "measurement.h"
+#include "ota_update.h"
+#include "espnow_gateway.h"
 
 // =============================================================================
 // WAKE REASON TRACKING
@@ -82,14 +67,14 @@ typedef enum {
 WakeReason determine_wake_reason() {
     esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.print("[MAIN] Wake cause code: ");
     Serial.println(cause);
     #endif
     
     switch (cause) {
         case ESP_SLEEP_WAKEUP_TIMER:
-            #ifdef DEBUG_SERIAL
+            #if DEBUG_SERIAL
             Serial.println("[MAIN] Wake reason: TIMER");
             #endif
             return WAKE_TIMER;
@@ -101,20 +86,20 @@ WakeReason determine_wake_reason() {
 #if SOC_PM_SUPPORT_EXT1_WAKEUP
         case ESP_SLEEP_WAKEUP_EXT1:      // Original ESP32 only
 #endif
-            #ifdef DEBUG_SERIAL
+            #if DEBUG_SERIAL
             Serial.println("[MAIN] Wake reason: BUTTON");
             #endif
             return WAKE_BUTTON;
             
         case ESP_SLEEP_WAKEUP_UNDEFINED:
             // No wake cause = first boot or reset
-            #ifdef DEBUG_SERIAL
+            #if DEBUG_SERIAL
             Serial.println("[MAIN] Wake reason: POWER_ON");
             #endif
             return WAKE_POWER_ON;
             
         default:
-            #ifdef DEBUG_SERIAL
+            #if DEBUG_SERIAL
             Serial.println("[MAIN] Wake reason: UNKNOWN");
             #endif
             return WAKE_UNKNOWN;
@@ -130,12 +115,16 @@ WakeReason determine_wake_reason() {
  * Sets up timer wake and GPIO wake sources.
  * 
  * @param sleep_seconds  How long to sleep; defaults to MEASUREMENT_INTERVAL_SEC.
- *                       Pass ALERT_INTERVAL_SEC for faster wake when alerts are active.
+ *                       Normally the adaptive wake_scheduler_next_interval(), or
+ *                       ALERT_INTERVAL_SEC for faster wake when alerts are active.
+ * @param allow_monitor  Let the wake stub monitor skip uneventful slices
+ *                       (sleep_monitor.h); false for alert sleeps.
  *
  * Note: ESP32-C3 uses per-pin gpio_wakeup_enable() configuration
  */
-void enter_deep_sleep(uint32_t sleep_seconds = MEASUREMENT_INTERVAL_SEC) {
-    #ifdef DEBUG_SERIAL
+void enter_deep_sleep(uint32_t sleep_seconds = MEASUREMENT_INTERVAL_SEC,
+                      bool allow_monitor = true) {
+    #if DEBUG_SERIAL
     Serial.print("[MAIN] Preparing for deep sleep, duration: ");
     Serial.print(sleep_seconds);
     Serial.println(" seconds");
@@ -144,20 +133,29 @@ void enter_deep_sleep(uint32_t sleep_seconds = MEASUREMENT_INTERVAL_SEC) {
     // Ensure pump is off before sleeping
     actuator_emergency_stop();
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.println("[MAIN] Actuator stopped");
     #endif
     
+    // Long sleeps are cut into slices checked by the wake stub; alert
+    // sleeps (allow_monitor false) always wake the app.
+    const uint32_t first_sleep_sec = allow_monitor ? sleep_monitor_arm(sleep_seconds) : sleep_seconds;
+    
     // Close NVS cleanly
     storage_close();
+    power_log_stop();
     
-    // Turn off LEDs before sleep
-    leds_all_off();
+    // Let queued LED output finish (trailing pauses are skipped), then off
+    leds_finish(LED_SLEEP_WAIT_MAX_MS);
     
     // Configure timer wake (use provided interval)
-    esp_sleep_enable_timer_wakeup((uint64_t)sleep_seconds * SEC_TO_US);
+    esp_sleep_enable_timer_wakeup((uint64_t)first_sleep_sec * SEC_TO_US);
     
     #if CONTROL_HAS_BUTTONS
+    // Button pull-ups must be configured before they are held, even on
+    // wakes that never read the buttons.
+    hw_require(HW_BUTTONS);
+
     // Configure GPIO wake for buttons (ESP32-C3 deep sleep compatible)
     uint64_t wake_mask = (1ULL << PIN_BTN_MAIN) |
                          (1ULL << PIN_BTN_CAL_WET) |
@@ -180,11 +178,12 @@ void enter_deep_sleep(uint32_t sleep_seconds = MEASUREMENT_INTERVAL_SEC) {
 // =============================================================================
 
 /**
- * Initialize all hardware peripherals.
- * Called once after each wake from deep sleep.
+ * Bring up what every wake needs.
+ * Called once after each wake from deep sleep; peripherals are
+ * initialized lazily by the code paths that use them.
  */
 void init_hardware() {
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.println("[MAIN] Initializing hardware...");
     #endif
     
@@ -195,37 +194,20 @@ void init_hardware() {
     gpio_hold_dis(PIN_BTN_CAL_DRY);
     gpio_deep_sleep_hold_dis();
     #endif
+    // Disarm the wake stub monitor (also releases the float switch hold)
+    sleep_monitor_boot(nullptr);
     
-    // Initialize storage first (needed by other modules)
-    if (!storage_init()) {
-        // NVS failure — flash error LED and continue with defaults
-        #ifdef DEBUG_SERIAL
-        Serial.println("[MAIN] ERROR: Storage init failed!");
-        #endif
-        PLAY_PATTERN(NVS_FAIL);
+    // Storage first (settings, persistent time); every other module is
+    // initialized on first use (hw_init.h).
+    hw_require(HW_STORAGE);
+
+    // Brown-out: the telemetry log must move its RTC ring to flash now,
+    // even on a wake that would not touch the log otherwise.
+    if (esp_reset_reason() == ESP_RST_BROWNOUT) {
+        hw_require(HW_TELEMETRY_LOG);
     }
     
-    // Configure ADC once (shared by sensor + battery)
-    analogReadResolution(ADC_RESOLUTION);
-    analogSetAttenuation(ADC_ATTENUATION);
-    
-    // Initialize sensors and actuators
-    #ifdef DEBUG_SERIAL
-    Serial.println("[MAIN] Initializing sensors and actuators...");
-    #endif
-    sensor_init();
-    battery_init();
-    actuator_init();
-    watering_init();
-    water_level_init();
-    
-    // Initialize LEDs and buttons using their modules
-    leds_init();
-#if CONTROL_HAS_BUTTONS
-    buttons_init();
-#endif
-    
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.println("[MAIN] Hardware initialization complete");
     #endif
 }
@@ -251,10 +233,10 @@ void show_alerts(bool *out_blocks_actions, bool *out_has_alert) {
     bool blocks = false;
     bool alert  = false;
     
-    // Check water reservoir level
-    bool reservoir_low = water_level_low();
+    // Check water reservoir level (shared snapshot, also used for watering)
+    bool reservoir_low = !measurement_get()->water_ok;
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.print("[MAIN] Water level pin (GPIO10) raw: ");
     Serial.println(digitalRead(PIN_WATER_LEVEL));
     Serial.print("[MAIN] Water level low: ");
@@ -270,7 +252,7 @@ void show_alerts(bool *out_blocks_actions, bool *out_has_alert) {
     // Check battery
     BatteryState batt = battery_get_state();
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.print("[MAIN] Battery state: ");
     switch(batt) {
         case BATTERY_OK:       Serial.println("OK"); break;
@@ -299,20 +281,23 @@ void show_alerts(bool *out_blocks_actions, bool *out_has_alert) {
 
 /**
  * Handle periodic timer wake.
- * Main purpose: check soil moisture and water if needed.
+ * Main purpose: check soil moisture and water every channel if needed.
  * Also signals alerts for low water reservoir or low battery.
+ *
+ * @param results Receives each channel's result (logged to telemetry)
+ * @return Most significant result over all channels (drives the LEDs)
  */
-void handle_timer_wake() {
-    #ifdef DEBUG_SERIAL
+WateringResult handle_timer_wake(WateringResult results[PLANT_CHANNEL_COUNT]) {
+    #if DEBUG_SERIAL
     Serial.println("[MAIN] Handling timer wake - checking watering...");
     #endif
     
     // Execute main watering logic.
     // Water level and battery are also checked inside watering_check_and_execute()
     // as safety guards, so no redundant pre-check needed here.
-    WateringResult result = watering_check_and_execute();
+    WateringResult result = watering_check_and_execute(results);
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.print("[MAIN] Watering result: ");
     switch(result) {
         case WATER_OK:           Serial.println("OK"); break;
@@ -358,22 +343,26 @@ void handle_timer_wake() {
             PLAY_PATTERN(PUMP_FAIL);
             break;
     }
+
+    return result;
 }
 
 // =============================================================================
 // BUTTON WAKE HANDLER
 // =============================================================================
 
+#if CONTROL_HAS_BUTTONS
 /**
  * Handle button press wake.
  * Delegates to button module for full interaction handling.
  */
 void handle_button_wake() {
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.println("[MAIN] Handling button wake...");
     #endif
     buttons_handle_interaction(true);
 }
+#endif
 
 // =============================================================================
 // FIRST BOOT HANDLER
@@ -384,7 +373,7 @@ void handle_button_wake() {
  * Runs self-test and shows initial status.
  */
 void handle_first_boot() {
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.println("First boot - running initialization...");
     #endif
     
@@ -393,18 +382,18 @@ void handle_first_boot() {
     
     // Alerts (low water / low battery) already shown by show_alerts() in setup().
     
-    // Check sensor
-    uint16_t raw = sensor_read_raw();
+    // Check sensor (channel 0; the LEDs show a single plant)
+    uint16_t raw = sensor_read_raw(0);
     if (!sensor_reading_valid(raw)) {
         led_show_error();
-        #ifdef DEBUG_SERIAL
+        #if DEBUG_SERIAL
         Serial.println("WARNING: Sensor reading invalid!");
         #endif
     }
     
     // Show current humidity (convert from raw to avoid a second ADC read)
-    uint8_t humidity = sensor_raw_to_humidity_percent(raw);
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
+    uint8_t humidity = sensor_raw_to_humidity_percent(0, raw);
     Serial.print("Current humidity: ");
     Serial.print(humidity);
     Serial.println("%");
@@ -425,26 +414,116 @@ void handle_first_boot() {
 // Track wake start time for debug logging
 static uint32_t wake_start_ms = 0;
 
+// Always-on mode: millis() at which the next periodic measurement is due
+static uint32_t s_next_measure_ms = 0;
+
+/** Append this wake's per-channel watering results to the telemetry log. */
+static void log_watering_results(const WateringResult *results) {
+    uint8_t logged[PLANT_CHANNEL_COUNT];
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        logged[ch] = (uint8_t)results[ch];
+    }
+    telemetry_log_record_wake(logged);
+}
+
+/**
+ * Always-on mode: run the measurement a timer wake would run and schedule
+ * the next one with the same adaptive interval deep sleep uses.
+ */
+static void run_scheduled_measurement() {
+    measurement_new_cycle();
+    WateringResult results[PLANT_CHANNEL_COUNT];
+    handle_timer_wake(results);
+    log_watering_results(results);
+    #if CONTROL_HAS_MQTT
+    mqtt_control_publish_telemetry();
+    #endif
+    s_next_measure_ms = millis() + wake_scheduler_next_interval(results) * 1000UL;
+}
+
+#if OTA_ENABLED
+/**
+ * Timer wake of a new image that has not reached the broker yet. Deep
+ * sleep would reset into the bootloader, which rolls a pending image
+ * back, so it light-sleeps until the next measurement instead and then
+ * does what a timer wake does: measure and water, retry the broker and
+ * confirm the image or count the failed attempt (ota_update_confirm
+ * rolls back after OTA_CONFIRM_ATTEMPTS).
+ */
+static void run_ota_trial_wake() {
+    const int32_t until_measure = (int32_t)(s_next_measure_ms - millis());
+    if (until_measure > 0) {
+        storage_commit();
+        #if DEBUG_SERIAL
+        Serial.flush();  // UART output is lost once the clocks stop
+        #endif
+        esp_sleep_enable_timer_wakeup((uint64_t)until_measure * 1000ULL);
+        esp_light_sleep_start();
+    }
+
+    mqtt_control_begin_async();
+    run_scheduled_measurement();
+    const bool online = mqtt_control_wait_connected();
+    telemetry_log_upload_attempted();
+    if (online) {
+        mqtt_control_upload_telemetry_log();
+        mqtt_control_process_for(MQTT_COMMAND_WINDOW_MS);
+        mqtt_control_service_ota();
+    } else {
+        ota_update_confirm(false);
+    }
+}
+#endif
+
 void setup() {
     // Record wake time immediately
     wake_start_ms = millis();
+    profiler_mark_setup();
     
     // Initialize serial for debugging (optional, uses power)
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.begin(115200);
     delay(100);
     Serial.println("\n========================================");
     Serial.println("ESP32 Plant Watering System - Wake");
     Serial.println("========================================");
     #endif
+
+#if GATEWAY_ROLE
+    // Bridge only (espnow_gateway.h): no plant hardware, no deep sleep.
+    espnow_gateway_init();
+    return;
+#endif
     
     // Initialize all hardware
     init_hardware();
+    #if POWER_LOG_ENABLED && POWER_LOG_WHOLE_WAKE
+    if (!power_log_start()) {
+        #if DEBUG_SERIAL
+        Serial.println("[MAIN] ADC stream unavailable, power log off");
+        #endif
+    }
+    #endif
 
     // Determine why we woke up
     WakeReason reason = determine_wake_reason();
+
+#if CONTROL_HAS_MQTT
+    // Start WiFi/MQTT in the background so the join overlaps with the
+    // sensor read and watering decision below. Timer wakes only bring the
+    // radio up when the telemetry log upload is due; other wakes (and
+    // always-on mode) are interactive and always connect.
+    const bool radio_wake = (reason != WAKE_TIMER) ||
+                            telemetry_log_upload_due() ||
+                            ota_update_pending() ||
+                            ota_update_verify_pending() ||
+                            !storage_get_deep_sleep_enabled();
+    if (radio_wake) {
+        mqtt_control_begin_async();
+    }
+#endif
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.print("Wake reason: ");
     switch(reason) {
         case WAKE_TIMER:    Serial.println("TIMER");    break;
@@ -459,15 +538,10 @@ void setup() {
     Serial.println(" hours");
     #endif
     
-    // Update persistent time tracking BEFORE handling wake reason.
-    // This ensures watering logic sees the correct current time
-    // (including the sleep duration that just elapsed).
-    // NOTE: awake_duration is negligible (<1 s) vs. sleep (3600 s)
-    // and is omitted here to keep time accurate for the watering check.
-    uint32_t sleep_sec = (reason == WAKE_TIMER || reason == WAKE_BUTTON) 
-                         ? MEASUREMENT_INTERVAL_SEC : 0;
+    // Persistent time runs on the RTC timer (restored in storage_init);
+    // only the boot counter needs updating here.
     if (reason != WAKE_UNKNOWN) {
-        storage_increment_boot_count(sleep_sec, 0);
+        storage_increment_boot_count(reason == WAKE_POWER_ON);
     }
 
     // Alert flags — filled by show_alerts() when it runs
@@ -479,13 +553,27 @@ void setup() {
     // For all other wake reasons alerts are shown before the handler.
     if (reason != WAKE_BUTTON) {
         show_alerts(&alert_blocks_actions, &alert_needs_short_sleep);
+#if CONTROL_HAS_MQTT
+        // The decision snapshot exists now: hand it to the bring-up task,
+        // which publishes as soon as the link is up (before any watering).
+        if (radio_wake) {
+            mqtt_control_publish_telemetry();
+        }
+#endif
     }
     
+    // Per-channel watering results of this wake (timer wakes only)
+    WateringResult results[PLANT_CHANNEL_COUNT];
+    bool watering_checked = false;
+
     // Handle based on wake reason
     switch (reason) {
-        case WAKE_TIMER:
-            handle_timer_wake();
+        case WAKE_TIMER: {
+            handle_timer_wake(results);
+            watering_checked = true;
+            log_watering_results(results);
             break;
+        }
             
         case WAKE_BUTTON:
 #if CONTROL_HAS_BUTTONS
@@ -502,23 +590,54 @@ void setup() {
             
         case WAKE_UNKNOWN:
             // Unexpected - just go back to sleep
-            #ifdef DEBUG_SERIAL
+            #if DEBUG_SERIAL
             Serial.println("Unknown wake reason, returning to sleep");
             #endif
             break;
     }
 
 #if CONTROL_HAS_MQTT
-    // MQTT runs during wake window (setup), before returning to deep sleep.
-    mqtt_control_init();
-    mqtt_control_process_for(MQTT_COMMAND_WINDOW_MS);
-    mqtt_control_publish_telemetry();
+    // MQTT command window runs once the background bring-up has finished.
+    // The wake's telemetry went out from the bring-up task; waiting only
+    // publishes it if that did not happen (button wakes, late link).
+    const bool online = radio_wake && mqtt_control_wait_connected();
+    if (radio_wake) {
+        telemetry_log_upload_attempted();   // offline too: no retry on every wake
+    }
+    if (online) {
+        mqtt_control_upload_telemetry_log();
+        mqtt_control_process_for(MQTT_COMMAND_WINDOW_MS);
+    }
+#if OTA_ENABLED
+    // A freshly updated image proves itself by reaching the broker; it
+    // stays pending (no deep sleep, see run_ota_trial_wake) and is rolled
+    // back after OTA_CONFIRM_ATTEMPTS offline wakes.
+    if (online) {
+        mqtt_control_service_ota();
+    } else {
+        ota_update_confirm(false);
+    }
+#endif
 #endif
 
-    const bool deep_sleep_enabled = storage_get_deep_sleep_enabled();
+    // Close this wake's profile; offline wakes stay queued in RTC memory
+    // until the next wake with a broker connection.
+    profiler_finish_wake();
+#if CONTROL_HAS_MQTT
+    if (online) {
+        mqtt_control_publish_profile();
+    }
+#endif
+
+    bool deep_sleep_enabled = storage_get_deep_sleep_enabled();
+#if OTA_ENABLED
+    // A pending OTA image continues in loop() without deep sleep
+    deep_sleep_enabled = deep_sleep_enabled && !ota_update_verify_pending();
+#endif
     
     // All done, go to deep sleep
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
+    hw_report_boot_times();
     Serial.print("Awake for ");
     Serial.print(millis() - wake_start_ms);
     Serial.println(" ms");
@@ -527,26 +646,65 @@ void setup() {
     #endif
     
     if (!deep_sleep_enabled) {
+        s_next_measure_ms = millis() +
+            wake_scheduler_next_interval(watering_checked ? results : nullptr) * 1000UL;
         return;
     }
 
     // Use shorter alert interval if water reservoir or battery needs attention.
     // Reuse the result from show_alerts() to avoid redundant sensor reads.
-    enter_deep_sleep(alert_needs_short_sleep ? ALERT_INTERVAL_SEC 
-                                             : MEASUREMENT_INTERVAL_SEC);
+    enter_deep_sleep(alert_needs_short_sleep ? ALERT_INTERVAL_SEC
+                                             : wake_scheduler_next_interval(watering_checked ? results : nullptr),
+                     !alert_needs_short_sleep);
 }
 
 void loop() {
+#if GATEWAY_ROLE
+    espnow_gateway_process();
+    return;
+#endif
+
     if (storage_get_deep_sleep_enabled()) {
-        enter_deep_sleep();
+        #if OTA_ENABLED
+        if (ota_update_verify_pending()) {
+            run_ota_trial_wake();
+            return;
+        }
+        #endif
+        enter_deep_sleep(wake_scheduler_next_interval(nullptr));
     }
 
-    // Poll interfaces while deep sleep is disabled by runtime config.
+    // Deep sleep is disabled by runtime config: light-sleep between polls
+    // and run the periodic measurement from here.
+    always_on_enter();
+
     #if CONTROL_HAS_MQTT
     mqtt_control_process();
     #endif
+    #if OTA_ENABLED
+    // Also confirms a pending image once the link comes back
+    if (ota_update_due() || ota_update_verify_pending()) {
+        mqtt_control_service_ota();
+    }
+    #endif
     #if CONTROL_HAS_BUTTONS
-    buttons_handle_interaction();
+    hw_require(HW_BUTTONS);
+    if (buttons_pending()) {
+        buttons_handle_interaction();
+    }
     #endif
-    delay(10);
+    int32_t until_measure = (int32_t)(s_next_measure_ms - millis());
+    if (until_measure <= 0) {
+        run_scheduled_measurement();
+        until_measure = (int32_t)(s_next_measure_ms - millis());
+    }
+    // No storage_close() in always-on mode: flush setting changes here.
+    storage_commit();
+
+    // Idle until a button edge, the next MQTT poll or the next measurement.
+    uint32_t idle_ms = ALWAYS_ON_POLL_MS;
+    if (until_measure >= 0 && (uint32_t)until_measure < idle_ms) {
+        idle_ms = (uint32_t)until_measure;
+    }
+    always_on_idle(idle_ms);
 }
@@ -0,0 +1,58 @@
+/**
+ * measurement.cpp - Per-wake measurement snapshot implementation
+ */
+
+#include "measurement.h"
+#include "battery.h"
+#include "storage.h"
+#include "water_level.h"
+
+static Measurement s_snapshot;
+static bool s_valid = false;
+static bool s_decision_taken = false;   // this cycle's filtered reading done
+
+static void capture() {
+    if (!s_decision_taken) {
+        sensor_measure_all(s_snapshot.raw);
+        s_decision_taken = true;
+    } else {
+        sensor_read_raw_all(s_snapshot.raw);
+    }
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        s_snapshot.humidity[ch] = sensor_raw_to_humidity_percent(ch, s_snapshot.raw[ch]);
+        s_snapshot.fault[ch]    = sensor_get_fault(ch);
+    }
+    s_snapshot.battery_mv = battery_read_voltage_mv();
+    s_snapshot.water_ok   = water_level_ok();
+    s_snapshot.ts         = storage_get_persistent_time();
+    s_snapshot.taken_ms   = millis();
+    s_valid = true;
+
+    #if DEBUG_SERIAL
+    Serial.print("[MEAS] Snapshot taken, battery ");
+    Serial.print(s_snapshot.battery_mv);
+    Serial.print(" mV, reservoir ");
+    Serial.println(s_snapshot.water_ok ? "OK" : "LOW");
+    #endif
+}
+
+const Measurement *measurement_get(uint32_t max_age_ms) {
+    if (!s_valid || measurement_age_ms() > max_age_ms) {
+        capture();
+    }
+    return &s_snapshot;
+}
+
+uint32_t measurement_age_ms() {
+    return s_valid ? millis() - s_snapshot.taken_ms : UINT32_MAX;
+}
+
+void measurement_invalidate() {
+    s_valid = false;
+}
+
+void measurement_new_cycle() {
+    s_valid = false;
+    s_decision_taken = false;
+    battery_refresh();
+}
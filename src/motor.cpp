@@ -1,11 +1,45 @@
 #include "motor.h"
 #include "config.h"
+#include "driver/gpio.h"
+#include "soc/gpio_reg.h"
+
+#if STEPPER_HW_PULSES
+#if (STEPPER_DRIVER_TYPE == STEPPER_DRIVER_DRV8833)
+#include "esp_timer.h"
+#else
+#include "driver/ledc.h"
+#include "soc/gpio_sig_map.h"
+#endif
+#endif
 
 static bool motor_running = false;
 
+#if STEPPER_HW_PULSES
+// Steps emitted by the hardware generator since the run started, and the
+// count at which it stops stepping (0 = no limit, timed runs).
+static volatile uint32_t gen_steps = 0;
+static volatile uint32_t gen_step_limit = 0;
+#endif
+
+// =============================================================================
+// DRIVER POLICIES
+// =============================================================================
+// Each policy is a static, constexpr-parameterized view of one driver
+// family. Exactly one is compiled (its pins only exist for the selected
+// wiring profile) and bound to StepperDriver; the motor_* API below is
+// driver-agnostic and fully inlined against it.
+//
+// Policy interface:
+//   name, pin_mask                constexpr
+//   init()                        outputs configured, driver idle
+//   enable(bool)                  power stage on/off
+//   energize()                    hold current position after enable
+//   step_once()                   advance one step (half step on DRV8833)
+//   idle_outputs()                all step outputs low / coasting
+//   gen_init/gen_set_rate/gen_stop  hardware step generator
+//   gen_count(bool)               count emitted steps into gen_steps
+
 #if (STEPPER_DRIVER_TYPE == STEPPER_DRIVER_DRV8833)
-static uint8_t drv8833_phase_idx = 0;
-static int8_t drv8833_phase_delta = 1;
 
 enum Drv8833BridgeCmd : uint8_t {
 	DRV8833_BRIDGE_COAST = 0,
@@ -13,167 +47,349 @@ enum Drv8833BridgeCmd : uint8_t {
 	DRV8833_BRIDGE_REV,
 };
 
-typedef struct {
-	Drv8833BridgeCmd a;
-	Drv8833BridgeCmd b;
-} Drv8833Phase;
-
-// Half-step sequence for bipolar stepper on dual H-bridge.
-static const Drv8833Phase DRV8833_HALFSTEP_SEQ[] = {
-	{DRV8833_BRIDGE_FWD,   DRV8833_BRIDGE_COAST},
-	{DRV8833_BRIDGE_FWD,   DRV8833_BRIDGE_FWD},
-	{DRV8833_BRIDGE_COAST, DRV8833_BRIDGE_FWD},
-	{DRV8833_BRIDGE_REV,   DRV8833_BRIDGE_FWD},
-	{DRV8833_BRIDGE_REV,   DRV8833_BRIDGE_COAST},
-	{DRV8833_BRIDGE_REV,   DRV8833_BRIDGE_REV},
-	{DRV8833_BRIDGE_COAST, DRV8833_BRIDGE_REV},
-	{DRV8833_BRIDGE_FWD,   DRV8833_BRIDGE_REV},
+static constexpr uint32_t drv8833_bridge_mask(gpio_num_t in1, gpio_num_t in2, Drv8833BridgeCmd cmd) {
+	return (cmd == DRV8833_BRIDGE_FWD) ? (1UL << in1) : (cmd == DRV8833_BRIDGE_REV) ? (1UL << in2) : 0UL;
+}
+
+// Output-set mask for one phase of the two bridges.
+static constexpr uint32_t drv8833_phase(Drv8833BridgeCmd a, Drv8833BridgeCmd b) {
+	return drv8833_bridge_mask(PIN_DRV8833_AN1, PIN_DRV8833_AN2, a) |
+	       drv8833_bridge_mask(PIN_DRV8833_BN1, PIN_DRV8833_BN2, b);
+}
+
+struct Drv8833Driver {
+	static constexpr const char *name = "DRV8833";
+
+	// Bridge inputs driven by the step table; STBY is handled separately.
+	static constexpr uint32_t bridge_pins = (1UL << PIN_DRV8833_AN1) | (1UL << PIN_DRV8833_AN2) |
+	                                        (1UL << PIN_DRV8833_BN1) | (1UL << PIN_DRV8833_BN2);
+	static constexpr uint64_t pin_mask = bridge_pins | (1ULL << PIN_DRV8833_STBY);
+
+	// Half-step sequence for bipolar stepper on dual H-bridge, as output-set masks.
+	static constexpr uint32_t seq[] = {
+		drv8833_phase(DRV8833_BRIDGE_FWD,   DRV8833_BRIDGE_COAST),
+		drv8833_phase(DRV8833_BRIDGE_FWD,   DRV8833_BRIDGE_FWD),
+		drv8833_phase(DRV8833_BRIDGE_COAST, DRV8833_BRIDGE_FWD),
+		drv8833_phase(DRV8833_BRIDGE_REV,   DRV8833_BRIDGE_FWD),
+		drv8833_phase(DRV8833_BRIDGE_REV,   DRV8833_BRIDGE_COAST),
+		drv8833_phase(DRV8833_BRIDGE_REV,   DRV8833_BRIDGE_REV),
+		drv8833_phase(DRV8833_BRIDGE_COAST, DRV8833_BRIDGE_REV),
+		drv8833_phase(DRV8833_BRIDGE_FWD,   DRV8833_BRIDGE_REV),
+	};
+	static constexpr uint8_t seq_len = sizeof(seq) / sizeof(seq[0]);
+
+	static uint8_t phase_idx;
+	static int8_t  phase_delta;
+
+	static inline void coast() {
+		REG_WRITE(GPIO_OUT_W1TC_REG, bridge_pins);
+	}
+
+	static inline void apply_phase(uint8_t idx) {
+		// Short coast break-before-make helps prevent harsh direction transitions.
+		coast();
+		delayMicroseconds(20);
+		REG_WRITE(GPIO_OUT_W1TS_REG, seq[idx % seq_len]);
+	}
+
+	static void init() {
+		gpio_config_t io = {};
+		io.pin_bit_mask = pin_mask;
+		io.mode = GPIO_MODE_OUTPUT;
+		gpio_config(&io);
+
+		phase_idx = 0;
+		phase_delta = STEPPER_DEFAULT_DIR_CW ? 1 : -1;
+		coast();
+		gpio_set_level(PIN_DRV8833_STBY, 0);
+	}
+
+	static inline void enable(bool on) {
+		gpio_set_level(PIN_DRV8833_STBY, on ? 1 : 0);
+		if (!on) {
+			coast();
+		} else {
+			// Give bridge logic time to wake from standby.
+			delayMicroseconds(100);
+		}
+	}
+
+	static inline void energize() {
+		apply_phase(phase_idx);
+	}
+
+	static inline void step_once() {
+		phase_idx = (phase_delta > 0) ? (uint8_t)((phase_idx + 1U) % seq_len)
+		                              : (uint8_t)((phase_idx + seq_len - 1U) % seq_len);
+		apply_phase(phase_idx);
+	}
+
+	static inline void idle_outputs() {
+		coast();
+	}
+
+#if STEPPER_HW_PULSES
+	// Phase patterns cannot come from a single PWM pin, so a one-shot
+	// esp_timer advances the half-step sequence in the timer task and
+	// re-arms itself. A rate change only updates the period, which takes
+	// effect at the next edge: restarting a timer every ramp slice would
+	// never let a period longer than the slice expire.
+	static esp_timer_handle_t step_timer;
+	static volatile uint32_t step_period_us;
+	static volatile bool gen_running;
+
+	static void step_timer_cb(void *) {
+		if (!gen_running) {
+			return;  // stale edge armed just before gen_stop()
+		}
+		if (gen_step_limit != 0 && gen_steps >= gen_step_limit) {
+			return;  // exact count reached, the run loop stops the generator
+		}
+		step_once();
+		gen_steps++;
+		esp_timer_start_once(step_timer, step_period_us);
+	}
+
+	static bool gen_init() {
+		if (step_timer != nullptr) {
+			return true;
+		}
+		esp_timer_create_args_t args = {};
+		args.callback = step_timer_cb;
+		args.name = "stepper";
+		return esp_timer_create(&args, &step_timer) == ESP_OK;
+	}
+
+	static void gen_set_rate(uint32_t hz) {
+		step_period_us = 1000000UL / hz;
+		if (!gen_running) {
+			gen_running = true;
+			esp_timer_start_once(step_timer, step_period_us);
+		}
+	}
+
+	static void gen_stop() {
+		gen_running = false;
+		esp_timer_stop(step_timer);  // not armed if the limit was reached: ignore error
+	}
+
+	// Steps are counted in step_timer_cb.
+	static void gen_count(bool) {}
+#endif
 };
 
-static inline void drv8833_write_bridge(gpio_num_t in1, gpio_num_t in2, Drv8833BridgeCmd cmd) {
-	switch (cmd) {
-		case DRV8833_BRIDGE_FWD:
-			digitalWrite(in1, HIGH);
-			digitalWrite(in2, LOW);
-			break;
-		case DRV8833_BRIDGE_REV:
-			digitalWrite(in1, LOW);
-			digitalWrite(in2, HIGH);
-			break;
-		default:
-			digitalWrite(in1, LOW);
-			digitalWrite(in2, LOW);
-			break;
+uint8_t Drv8833Driver::phase_idx = 0;
+int8_t  Drv8833Driver::phase_delta = 1;
+#if STEPPER_HW_PULSES
+esp_timer_handle_t Drv8833Driver::step_timer = nullptr;
+volatile uint32_t  Drv8833Driver::step_period_us = 0;
+volatile bool      Drv8833Driver::gen_running = false;
+#endif
+
+using StepperDriver = Drv8833Driver;
+
+#else // A4988 / DRV8825
+
+// STEP/DIR/ENABLE drivers differ only in minimum STEP pulse width.
+template <uint16_t PulseUs>
+struct StepDirDriver {
+	static constexpr const char *name = (PulseUs > 1) ? "DRV8825" : "A4988";
+	static constexpr uint16_t pulse_us = PulseUs;
+	static constexpr uint64_t pin_mask = (1ULL << PIN_STEPPER_STEP) |
+	                                     (1ULL << PIN_STEPPER_DIR) |
+	                                     (1ULL << PIN_STEPPER_EN);
+
+	static void init() {
+		gpio_config_t io = {};
+		io.pin_bit_mask = pin_mask;
+		io.mode = GPIO_MODE_OUTPUT;
+		gpio_config(&io);
+
+		gpio_set_level(PIN_STEPPER_STEP, 0);
+		gpio_set_level(PIN_STEPPER_DIR, STEPPER_DEFAULT_DIR_CW ? 1 : 0);
+		enable(false);
 	}
-}
 
-static inline void drv8833_set_all_coast() {
-	drv8833_write_bridge(PIN_DRV8833_AN1, PIN_DRV8833_AN2, DRV8833_BRIDGE_COAST);
-	drv8833_write_bridge(PIN_DRV8833_BN1, PIN_DRV8833_BN2, DRV8833_BRIDGE_COAST);
-}
+	static inline void enable(bool on) {
+		// Active-low ENABLE.
+		gpio_set_level(PIN_STEPPER_EN, on ? 0 : 1);
+	}
 
-static inline void drv8833_apply_phase(uint8_t idx) {
-	const uint8_t seq_len = (uint8_t)(sizeof(DRV8833_HALFSTEP_SEQ) / sizeof(DRV8833_HALFSTEP_SEQ[0]));
-	const Drv8833Phase phase = DRV8833_HALFSTEP_SEQ[idx % seq_len];
+	static inline void energize() {}
 
-	// Short coast break-before-make helps prevent harsh direction transitions.
-	drv8833_set_all_coast();
-	delayMicroseconds(20);
-	drv8833_write_bridge(PIN_DRV8833_AN1, PIN_DRV8833_AN2, phase.a);
-	drv8833_write_bridge(PIN_DRV8833_BN1, PIN_DRV8833_BN2, phase.b);
-}
+	static inline void step_once() {
+		gpio_set_level(PIN_STEPPER_STEP, 1);
+		delayMicroseconds(pulse_us);
+		gpio_set_level(PIN_STEPPER_STEP, 0);
+		delayMicroseconds(pulse_us);
+	}
 
-static inline void drv8833_step_once() {
-	const uint8_t seq_len = (uint8_t)(sizeof(DRV8833_HALFSTEP_SEQ) / sizeof(DRV8833_HALFSTEP_SEQ[0]));
-	if (drv8833_phase_delta > 0) {
-		drv8833_phase_idx = (uint8_t)((drv8833_phase_idx + 1U) % seq_len);
-	} else {
-		drv8833_phase_idx = (uint8_t)((drv8833_phase_idx + seq_len - 1U) % seq_len);
+	static inline void idle_outputs() {
+		gpio_set_level(PIN_STEPPER_STEP, 0);
+	}
+
+#if STEPPER_HW_PULSES
+	// STEP is a 50% duty LEDC square wave; one rising edge per step.
+	// Any supported rate gives a high time far above pulse_us.
+	static bool gen_init() {
+		ledc_timer_config_t timer_cfg = {};
+		timer_cfg.speed_mode = LEDC_LOW_SPEED_MODE;
+		timer_cfg.duty_resolution = LEDC_TIMER_10_BIT;
+		timer_cfg.timer_num = STEPPER_LEDC_TIMER;
+		timer_cfg.freq_hz = STEPPER_START_HZ;
+		timer_cfg.clk_cfg = LEDC_AUTO_CLK;
+		if (ledc_timer_config(&timer_cfg) != ESP_OK) {
+			return false;
+		}
+
+		ledc_channel_config_t ch_cfg = {};
+		ch_cfg.gpio_num = PIN_STEPPER_STEP;
+		ch_cfg.speed_mode = LEDC_LOW_SPEED_MODE;
+		ch_cfg.channel = STEPPER_LEDC_CHANNEL;
+		ch_cfg.timer_sel = STEPPER_LEDC_TIMER;
+		ch_cfg.duty = 0;  // idle low until a run starts
+		ch_cfg.hpoint = 0;
+		return ledc_channel_config(&ch_cfg) == ESP_OK;
+	}
+
+	static void gen_set_rate(uint32_t hz) {
+		ledc_set_freq(LEDC_LOW_SPEED_MODE, STEPPER_LEDC_TIMER, hz);
+		ledc_set_duty(LEDC_LOW_SPEED_MODE, STEPPER_LEDC_CHANNEL, 1U << 9);  // 50% of 10 bit
+		ledc_update_duty(LEDC_LOW_SPEED_MODE, STEPPER_LEDC_CHANNEL);
+	}
+
+	static void gen_stop() {
+		ledc_stop(LEDC_LOW_SPEED_MODE, STEPPER_LEDC_CHANNEL, 0);
+		// Hand STEP back to LEDC if step_edge_isr() took it (idle low now)
+		ledc_set_pin(PIN_STEPPER_STEP, LEDC_LOW_SPEED_MODE, STEPPER_LEDC_CHANNEL);
+	}
+
+	// LEDC cannot count (and the C3 has no PCNT), so read STEP back and
+	// count rising edges. The edge that reaches gen_step_limit ends the
+	// run right here: after the minimum pulse width STEP is switched from
+	// the LEDC signal to a plain GPIO output held low, so no further edge
+	// can get out whatever the run loop is doing.
+	static void IRAM_ATTR step_edge_isr() {
+		if (++gen_steps != gen_step_limit) {
+			return;
+		}
+		delayMicroseconds(pulse_us);
+		REG_WRITE(GPIO_OUT_W1TC_REG, 1UL << PIN_STEPPER_STEP);
+		REG_WRITE(GPIO_FUNC0_OUT_SEL_CFG_REG + 4 * PIN_STEPPER_STEP, SIG_GPIO_OUT_IDX);
+	}
+
+	static void gen_count(bool on) {
+		if (on) {
+			gpio_input_enable(PIN_STEPPER_STEP);
+			attachInterrupt(digitalPinToInterrupt(PIN_STEPPER_STEP), step_edge_isr, RISING);
+		} else {
+			detachInterrupt(digitalPinToInterrupt(PIN_STEPPER_STEP));
+		}
 	}
-	drv8833_apply_phase(drv8833_phase_idx);
-}
 #endif
+};
 
-// Driver families can require slightly different minimum STEP pulse widths.
-static inline uint16_t step_pulse_us() {
 #if (STEPPER_DRIVER_TYPE == STEPPER_DRIVER_DRV8825)
-	return 2;  // DRV8825 min is ~1.9us
+using StepperDriver = StepDirDriver<2>;  // DRV8825 min is ~1.9us
 #else
-	return 1;  // A4988 min is ~1.0us
+using StepperDriver = StepDirDriver<1>;  // A4988 min is ~1.0us
 #endif
-}
 
-static inline void stepper_enable(bool enable) {
-	#if (STEPPER_DRIVER_TYPE == STEPPER_DRIVER_DRV8833)
-	digitalWrite(PIN_DRV8833_STBY, enable ? HIGH : LOW);
-	if (!enable) {
-		drv8833_set_all_coast();
-	} else {
-		// Give bridge logic time to wake from standby.
-		delayMicroseconds(100);
-	}
-	#else
-	// A4988/DRV8825 use active-low ENABLE.
-	digitalWrite(PIN_STEPPER_EN, enable ? LOW : HIGH);
-	#endif
+#endif // STEPPER_DRIVER_TYPE
+
+// =============================================================================
+// STEP RATE PROFILE
+// =============================================================================
+
+// Trapezoid step-rate profile: linear STEPPER_START_HZ -> STEPPER_STEP_HZ over
+// STEPPER_RAMP_MS at both ends of the run; short runs get symmetric, shorter ramps.
+static uint32_t stepper_rate_hz(uint32_t elapsed_ms, uint32_t duration_ms) {
+	const uint32_t lo = (STEPPER_START_HZ < STEPPER_STEP_HZ) ? STEPPER_START_HZ : STEPPER_STEP_HZ;
+	uint32_t ramp_ms = STEPPER_RAMP_MS;
+	if (ramp_ms * 2U > duration_ms) {
+		ramp_ms = duration_ms / 2U;
+	}
+	if (ramp_ms == 0 || elapsed_ms >= duration_ms) {
+		return (elapsed_ms >= duration_ms) ? lo : (uint32_t)STEPPER_STEP_HZ;
+	}
+
+	const uint32_t edge_ms = (elapsed_ms < duration_ms - elapsed_ms) ? elapsed_ms : (duration_ms - elapsed_ms);
+	if (edge_ms >= ramp_ms) {
+		return STEPPER_STEP_HZ;
+	}
+	return lo + ((STEPPER_STEP_HZ - lo) * edge_ms) / ramp_ms;
 }
 
-static void stepper_pulse_steps(uint32_t steps) {
-	#if (STEPPER_DRIVER_TYPE == STEPPER_DRIVER_DRV8833)
-	for (uint32_t i = 0; i < steps; ++i) {
-		drv8833_step_once();
+// Same trapezoid over a fixed step count: each ramp covers the steps a
+// STEPPER_RAMP_MS ramp would take at the mean ramp rate.
+static uint32_t stepper_rate_hz_at_step(uint32_t step, uint32_t steps) {
+	const uint32_t lo = (STEPPER_START_HZ < STEPPER_STEP_HZ) ? STEPPER_START_HZ : STEPPER_STEP_HZ;
+	uint32_t ramp_steps = ((lo + STEPPER_STEP_HZ) * STEPPER_RAMP_MS) / 2000U;
+	if (ramp_steps * 2U > steps) {
+		ramp_steps = steps / 2U;
 	}
-	#else
-	const uint16_t pulse_us = step_pulse_us();
-	for (uint32_t i = 0; i < steps; ++i) {
-		digitalWrite(PIN_STEPPER_STEP, HIGH);
-		delayMicroseconds(pulse_us);
-		digitalWrite(PIN_STEPPER_STEP, LOW);
-		delayMicroseconds(pulse_us);
+
+	const uint32_t edge = (step < steps - step) ? step : (steps - step);
+	if (ramp_steps == 0 || edge >= ramp_steps) {
+		return STEPPER_STEP_HZ;
 	}
-	#endif
+	return lo + ((STEPPER_STEP_HZ - lo) * edge) / ramp_steps;
 }
 
+// =============================================================================
+// PUBLIC API
+// =============================================================================
+
+#if STEPPER_HW_PULSES
+static bool step_gen_ready = false;
+#endif
+
 void motor_init() {
-	#if (STEPPER_DRIVER_TYPE == STEPPER_DRIVER_DRV8833)
-	pinMode(PIN_DRV8833_AN1, OUTPUT);
-	pinMode(PIN_DRV8833_AN2, OUTPUT);
-	pinMode(PIN_DRV8833_BN1, OUTPUT);
-	pinMode(PIN_DRV8833_BN2, OUTPUT);
-	pinMode(PIN_DRV8833_STBY, OUTPUT);
-
-	drv8833_phase_idx = 0;
-	drv8833_phase_delta = STEPPER_DEFAULT_DIR_CW ? 1 : -1;
-	drv8833_set_all_coast();
-	digitalWrite(PIN_DRV8833_STBY, LOW);
-	#ifdef DEBUG_SERIAL
-	Serial.println("[MOTOR] DRV8833 initialized");
+	StepperDriver::init();
+	#if STEPPER_HW_PULSES
+	step_gen_ready = StepperDriver::gen_init();
 	#endif
-	#else
-	pinMode(PIN_STEPPER_STEP, OUTPUT);
-	pinMode(PIN_STEPPER_DIR, OUTPUT);
-	pinMode(PIN_STEPPER_EN, OUTPUT);
-
-	digitalWrite(PIN_STEPPER_STEP, LOW);
-	digitalWrite(PIN_STEPPER_DIR, STEPPER_DEFAULT_DIR_CW ? HIGH : LOW);
-	stepper_enable(false);
-	#ifdef DEBUG_SERIAL
-	Serial.println("[MOTOR] Stepper driver initialized");
+	#if DEBUG_SERIAL
+	Serial.print("[MOTOR] ");
+	Serial.print(StepperDriver::name);
+	Serial.println(" initialized");
+	#if STEPPER_HW_PULSES
+	if (!step_gen_ready) {
+		Serial.println("[MOTOR] Step generator init failed, using busy-wait pulses");
+	}
 	#endif
 	#endif
 	motor_running = false;
 }
 
 void motor_on() {
-	stepper_enable(true);
-	#if (STEPPER_DRIVER_TYPE == STEPPER_DRIVER_DRV8833)
-	drv8833_apply_phase(drv8833_phase_idx);
-	#endif
+	StepperDriver::enable(true);
+	StepperDriver::energize();
 	motor_running = true;
-	#ifdef DEBUG_SERIAL
+	#if DEBUG_SERIAL
 	Serial.println("[MOTOR] Enabled");
 	#endif
 }
 
 void motor_off() {
-#if (MOTOR_DISABLE_WHEN_IDLE)
-	stepper_enable(false);
+#if (STEPPER_DISABLE_WHEN_IDLE)
+	StepperDriver::enable(false);
 #endif
 	motor_running = false;
-	#ifdef DEBUG_SERIAL
+	#if DEBUG_SERIAL
 	Serial.println("[MOTOR] Disabled");
 	#endif
 }
 
 bool motor_run_timed(uint32_t duration_ms) {
 	if (duration_ms == 0) {
-		#ifdef DEBUG_SERIAL
+		#if DEBUG_SERIAL
 		Serial.println("[MOTOR] Zero duration requested");
 		#endif
 		return true;
 	}
 
-	#ifdef DEBUG_SERIAL
+	#if DEBUG_SERIAL
 	Serial.print("[MOTOR] Running for ");
 	Serial.print(duration_ms);
 	Serial.println(" ms");
@@ -182,36 +398,124 @@ bool motor_run_timed(uint32_t duration_ms) {
 	motor_on();
 
 	const uint32_t start_ms = millis();
-	while ((millis() - start_ms) < duration_ms) {
-		// Emit one step then pace to configured step frequency.
-		stepper_pulse_steps(1);
-		if (STEPPER_STEP_HZ > 0) {
-			delayMicroseconds((uint32_t)(1000000UL / STEPPER_STEP_HZ));
-		} else {
+	#if STEPPER_HW_PULSES
+	if (step_gen_ready) {
+		// Steps come from the peripheral; only the rate is updated here, so
+		// the CPU is free (or idle) between ramp slices.
+		uint32_t rate_hz = 0;
+		uint32_t elapsed_ms;
+		while ((elapsed_ms = millis() - start_ms) < duration_ms) {
+			const uint32_t hz = stepper_rate_hz(elapsed_ms, duration_ms);
+			if (hz != rate_hz) {
+				StepperDriver::gen_set_rate(hz);
+				rate_hz = hz;
+			}
+			const uint32_t left_ms = duration_ms - elapsed_ms;
+			delay(left_ms < STEPPER_RAMP_SLICE_MS ? left_ms : STEPPER_RAMP_SLICE_MS);
+		}
+		StepperDriver::gen_stop();
+	} else
+	#endif
+	{
+		uint32_t elapsed_ms;
+		while ((elapsed_ms = millis() - start_ms) < duration_ms) {
+			// Emit one step then pace to the (ramped) step frequency.
+			StepperDriver::step_once();
+			if (STEPPER_STEP_HZ > 0) {
+				delayMicroseconds(1000000UL / stepper_rate_hz(elapsed_ms, duration_ms));
+			} else {
+				yield();
+			}
 			yield();
 		}
-		yield();
 	}
 
 	motor_off();
-	
-	#ifdef DEBUG_SERIAL
+
+	#if DEBUG_SERIAL
 	Serial.println("[MOTOR] Run complete");
 	#endif
-	
+
 	return true;
 }
 
+bool motor_run_steps(uint32_t steps, uint32_t timeout_ms) {
+	if (steps == 0) {
+		return true;
+	}
+
+	#if DEBUG_SERIAL
+	Serial.print("[MOTOR] Running ");
+	Serial.print(steps);
+	Serial.println(" steps");
+	#endif
+
+	motor_on();
+
+	bool complete = true;
+	const uint32_t start_ms = millis();
+	#if STEPPER_HW_PULSES
+	if (step_gen_ready) {
+		gen_steps = 0;
+		gen_step_limit = steps;
+		StepperDriver::gen_count(true);
+
+		uint32_t rate_hz = 0;
+		uint32_t done;
+		while ((done = gen_steps) < steps) {
+			if (millis() - start_ms >= timeout_ms) {
+				complete = false;
+				break;
+			}
+			const uint32_t hz = stepper_rate_hz_at_step(done, steps);
+			if (hz != rate_hz) {
+				StepperDriver::gen_set_rate(hz);
+				rate_hz = hz;
+			}
+			// The last edge stops the steps itself (gen_step_limit), so
+			// this only paces the ramp and the check for the end.
+			const uint32_t left_ms = ((steps - done) * 1000UL) / hz;
+			delay(left_ms == 0 ? 1 : (left_ms < STEPPER_RAMP_SLICE_MS ? left_ms : STEPPER_RAMP_SLICE_MS));
+		}
+		StepperDriver::gen_stop();
+		StepperDriver::gen_count(false);
+		gen_step_limit = 0;
+	} else
+	#endif
+	{
+		for (uint32_t done = 0; done < steps; ++done) {
+			if (millis() - start_ms >= timeout_ms) {
+				complete = false;
+				break;
+			}
+			StepperDriver::step_once();
+			if (STEPPER_STEP_HZ > 0) {
+				delayMicroseconds(1000000UL / stepper_rate_hz_at_step(done, steps));
+			}
+			yield();
+		}
+	}
+
+	motor_off();
+
+	#if DEBUG_SERIAL
+	Serial.println(complete ? "[MOTOR] Steps complete" : "[MOTOR] Step run timed out");
+	#endif
+
+	return complete;
+}
+
 void motor_emergency_stop() {
-	stepper_enable(false);
-	#if (STEPPER_DRIVER_TYPE == STEPPER_DRIVER_DRV8833)
-	drv8833_set_all_coast();
-	#else
-	digitalWrite(PIN_STEPPER_STEP, LOW);
+	#if STEPPER_HW_PULSES
+	if (step_gen_ready) {
+		StepperDriver::gen_stop();
+	}
 	#endif
+	StepperDriver::enable(false);
+	StepperDriver::idle_outputs();
 	motor_running = false;
-	
-	#ifdef DEBUG_SERIAL
+
+	#if DEBUG_SERIAL
 	Serial.println("[MOTOR] EMERGENCY STOP");
 	#endif
 }
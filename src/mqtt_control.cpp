@@ -1,25 +1,72 @@
 #include "mqtt_control.h"
+#include "config.h"
 
+// Button-only builds leave the whole MQTT stack (WiFi client objects,
+// PubSubClient) out of the image; only the radio query remains.
+#if CONTROL_HAS_MQTT
 #include <WiFi.h>
 #include <PubSubClient.h>
 
-#include "config.h"
 #include "watering.h"
 #include "sensor.h"
+#include "measurement.h"
 #include "battery.h"
 #include "storage.h"
-#include "water_level.h"
 #include "leds.h"
 #include "mqtt_diag.h"
+#include "telemetry_log.h"
+#include "wire_format.h"
+#include "rtc_clock.h"
+#include "hw_init.h"
+#include "profiler.h"
+#include "power_log.h"
+#include "ota_update.h"
+#include "control_link.h"
+#include "device_topic.h"
+#include "forecast.h"
+#include "esp_attr.h"
+#include "esp_random.h"
+#include "esp_ota_ops.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <ctype.h>
 #include <string.h>
 
 static WiFiClient s_wifi;
-static PubSubClient s_mqtt(s_wifi);
+static PubSubClient s_mqtt(s_wifi);   // WiFi link only, see control_link_mqtt()
 static uint32_t s_last_reconnect_ms = 0;
-static String s_plant_name = MQTT_PLANT_NAME;
-static String s_last_command_id;
+static char s_plant_name[MQTT_PLANT_NAME_MAX_LEN + 1] = MQTT_PLANT_NAME;
+static char s_last_command_id[STORAGE_CMD_ID_MAX_LEN + 1];
+static char s_group[MQTT_GROUP_MAX_LEN + 1];   // joined command group, "" = none
 static int s_last_disconnect_reason = -1;
 
+// Transport for everything below (control_link.h)
+#if CONTROL_TRANSPORT == CONTROL_TRANSPORT_ESPNOW
+static const ControlLink *const s_link = control_link_espnow();
+#else
+static const ControlLink *const s_link = control_link_mqtt();
+#endif
+
+// Async bring-up: while the bring-up task runs it owns the link and the
+// main task must not touch them. Set once, never cleared within a wake.
+static volatile bool s_bringup_running = false;
+static volatile bool s_bringup_stop = false;           // main task is waiting for the task
+static volatile bool s_first_publish_pending = false;  // wake's first telemetry not sent yet
+static QueueHandle_t s_snapshot_queue = nullptr;       // main -> bring-up task, length 1
+static uint32_t s_bringup_start_ms = 0;
+
+// Adaptive command window: set when the host sends MQTT_CMD_END_OF_COMMANDS,
+// s_last_rx_ms tracks the end of the most recently handled message.
+static bool s_end_of_commands = false;
+
+// Per-wake token sent in the awake marker. The host echoes it as the id of
+// its end sentinel; with a persistent session a sentinel queued for an
+// earlier wake would otherwise close this window early.
+static char s_wake_token[12];
+static uint32_t s_last_rx_ms = 0;
+
 static const char *wifi_status_text(wl_status_t status) {
     switch (status) {
         case WL_NO_SHIELD: return "NO_SHIELD";
@@ -62,7 +109,7 @@ static bool wifi_reason_is_auth_rejected() {
 static void on_wifi_event(WiFiEvent_t event, WiFiEventInfo_t info) {
     if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
         s_last_disconnect_reason = (int)info.wifi_sta_disconnected.reason;
-#ifdef DEBUG_SERIAL
+#if DEBUG_SERIAL
         Serial.print("[MQTT] WiFi disconnected reason=");
         Serial.print(s_last_disconnect_reason);
         Serial.print(" (");
@@ -72,10 +119,14 @@ static void on_wifi_event(WiFiEvent_t event, WiFiEventInfo_t info) {
     }
 }
 
+// Modem sleep (always-on mode); wakes keep the radio fully on for the
+// fastest join and command window.
+static bool s_wifi_power_save = false;
+
 static void configure_wpa2_safe_sta_profile() {
     WiFi.persistent(false);
     WiFi.setAutoReconnect(false);
-    WiFi.setSleep(false);
+    WiFi.setSleep(s_wifi_power_save ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE);
     WiFi.setMinSecurity(WIFI_AUTH_WPA2_PSK);
 }
 
@@ -107,11 +158,14 @@ static void wifi_begin_with_scan_hint() {
     }
 }
 
-static bool wifi_try_single_join(uint32_t timeout_ms) {
+static bool wifi_try_single_join(uint32_t timeout_ms, bool reset_radio) {
     s_last_disconnect_reason = -1;
 
-    WiFi.disconnect(false, true);
-    delay(100);
+    // A fresh boot has no association to tear down; only reset on retries.
+    if (reset_radio) {
+        WiFi.disconnect(false, true);
+        delay(100);
+    }
     WiFi.mode(WIFI_STA);
     configure_wpa2_safe_sta_profile();
     WiFi.setAutoReconnect(true);
@@ -132,7 +186,7 @@ static bool wifi_try_single_join(uint32_t timeout_ms) {
         // Some AP/security combinations can stay in IDLE forever after begin().
         // Retry once with plain begin() to force a new auth/assoc state machine run.
         if (!idle_fallback_retry_done && now_status == WL_IDLE_STATUS && (now_ms - start_ms) > 5000UL) {
-#ifdef DEBUG_SERIAL
+#if DEBUG_SERIAL
             Serial.println("[MQTT] WiFi idle fallback retry...");
 #endif
             WiFi.disconnect(false, true);
@@ -150,311 +204,1083 @@ static bool wifi_try_single_join(uint32_t timeout_ms) {
     return WiFi.status() == WL_CONNECTED;
 }
 
+// =============================================================================
+// FAST-JOIN CACHE (RTC memory, survives deep sleep, cleared on power loss)
+// =============================================================================
+
+#define WIFI_FAST_JOIN_MAGIC  0x57464A31UL   // "WFJ1"
+
 typedef struct {
-    String command;
-    String command_id;
-} ParsedCommand;
+    uint32_t magic;
+    uint8_t  bssid[6];
+    uint8_t  channel;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+} WifiFastJoinCache;
+
+static RTC_DATA_ATTR WifiFastJoinCache s_fast_join;
+
+static bool wifi_fast_join_valid() {
+    return s_fast_join.magic == WIFI_FAST_JOIN_MAGIC && s_fast_join.channel > 0;
+}
+
+static void wifi_fast_join_invalidate() {
+    s_fast_join.magic = 0;
+}
+
+static void wifi_fast_join_store() {
+    const uint8_t *bssid = WiFi.BSSID();
+    const int32_t channel = WiFi.channel();
+    if (bssid == nullptr || channel <= 0) {
+        return;
+    }
+
+    memcpy(s_fast_join.bssid, bssid, sizeof(s_fast_join.bssid));
+    s_fast_join.channel = (uint8_t)channel;
+    s_fast_join.ip      = (uint32_t)WiFi.localIP();
+    s_fast_join.gateway = (uint32_t)WiFi.gatewayIP();
+    s_fast_join.subnet  = (uint32_t)WiFi.subnetMask();
+    s_fast_join.dns     = (uint32_t)WiFi.dnsIP(0);
+    s_fast_join.magic   = WIFI_FAST_JOIN_MAGIC;
+}
+
+/**
+ * Join the cached BSSID/channel directly: no scan, no radio reset.
+ * Any disconnect event means the hint is stale, so give up immediately
+ * and let the caller fall back to the scan path.
+ */
+static bool wifi_try_fast_join(uint32_t timeout_ms) {
+    s_last_disconnect_reason = -1;
+
+    WiFi.mode(WIFI_STA);
+    configure_wpa2_safe_sta_profile();
+#if MQTT_WIFI_REUSE_IP_LEASE
+    if (s_fast_join.ip != 0) {
+        WiFi.config(IPAddress(s_fast_join.ip),
+                    IPAddress(s_fast_join.gateway),
+                    IPAddress(s_fast_join.subnet),
+                    IPAddress(s_fast_join.dns));
+    }
+#endif
+    WiFi.begin(MQTT_WIFI_SSID, MQTT_WIFI_PASSWORD, s_fast_join.channel, s_fast_join.bssid, true);
 
-static void normalize_plant_name(String &name) {
-    name.trim();
-    if (name.length() == 0) {
-        name = MQTT_PLANT_NAME;
+    const uint32_t start_ms = millis();
+    while (WiFi.status() != WL_CONNECTED && (millis() - start_ms) < timeout_ms) {
+        if (s_last_disconnect_reason >= 0) {
+            break;
+        }
+        delay(20);
+        yield();
     }
-    if (name.length() > MQTT_PLANT_NAME_MAX_LEN) {
-        name = name.substring(0, MQTT_PLANT_NAME_MAX_LEN);
+
+    if (WiFi.status() == WL_CONNECTED) {
+        return true;
     }
 
-    for (size_t i = 0; i < name.length(); ++i) {
-        const char c = name.charAt(i);
+#if MQTT_WIFI_REUSE_IP_LEASE
+    // Back to DHCP for the scan path in case the cached lease is the problem.
+    WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
+#endif
+    return false;
+}
+
+// Non-owning view into a payload; never NUL-terminated.
+typedef struct {
+    const char *ptr;
+    size_t len;
+} Slice;
+
+static void normalize_plant_name(Slice src, char *out, size_t out_size) {
+    while (src.len > 0 && isspace((unsigned char)src.ptr[0])) {
+        ++src.ptr;
+        --src.len;
+    }
+    while (src.len > 0 && isspace((unsigned char)src.ptr[src.len - 1])) {
+        --src.len;
+    }
+    if (src.len == 0) {
+        src.ptr = MQTT_PLANT_NAME;
+        src.len = strlen(MQTT_PLANT_NAME);
+    }
+    if (src.len > out_size - 1) {
+        src.len = out_size - 1;
+    }
+
+    for (size_t i = 0; i < src.len; ++i) {
+        const char c = src.ptr[i];
         const bool ok = (c >= 'a' && c <= 'z') ||
                         (c >= 'A' && c <= 'Z') ||
                         (c >= '0' && c <= '9') ||
                         c == ' ' || c == '_' || c == '-';
-        if (!ok) {
-            name.setCharAt(i, '_');
-        }
+        out[i] = ok ? c : '_';
     }
+    out[src.len] = '\0';
+}
+
+// Publish on this device's topic plant/<id>/<suffix>.
+static bool link_publish_frame(const char *suffix, const uint8_t *payload, size_t len, bool retained) {
+    char topic[MQTT_TOPIC_MAX_LEN];
+    return device_topic(topic, sizeof(topic), device_id(), suffix) &&
+           s_link->publish(topic, payload, len, retained);
+}
+
+static bool link_publish(const char *suffix, const char *text, bool retained) {
+    return link_publish_frame(suffix, (const uint8_t *)text, strlen(text), retained);
 }
 
 static void mqtt_publish_status(const char *text) {
-    s_mqtt.publish(MQTT_TOPIC_STATUS, text, true);
+    link_publish(MQTT_TOPIC_STATUS, text, true);
 }
 
-static void mqtt_publish_ack(const char *cmd, bool ok, const char *detail, const String &cmd_id = "") {
-    if (!s_mqtt.connected()) {
+// While a command batch runs, entry acks are folded into its combined ack.
+static bool batch_capture_ack(bool ok, const char *detail);
+
+static void mqtt_publish_ack(const char *cmd, bool ok, const char *detail, const char *cmd_id = "") {
+    if (batch_capture_ack(ok, detail) || !s_link->connected()) {
         return;
     }
 
     const uint32_t ts = storage_get_persistent_time();
+#if MQTT_WIRE_FORMAT != MQTT_WIRE_BINARY
     char msg[240];
     snprintf(msg, sizeof(msg),
              "{\"plant\":\"%s\",\"ts\":%lu,\"id\":\"%s\",\"cmd\":\"%s\",\"ok\":%s,\"detail\":\"%s\"}",
-             s_plant_name.c_str(),
+             s_plant_name,
              (unsigned long)ts,
-             cmd_id.c_str(),
+             cmd_id,
              cmd,
              ok ? "true" : "false",
              detail);
-    s_mqtt.publish(MQTT_TOPIC_ACK, msg, false);
+    link_publish(MQTT_TOPIC_ACK, msg, false);
+#endif
+#if MQTT_WIRE_FORMAT != MQTT_WIRE_JSON
+    uint8_t frame[160];
+    const size_t len = wire_encode_ack(frame, sizeof(frame), s_plant_name, ts,
+                                       cmd_id, cmd, ok, detail);
+    if (len > 0) {
+        link_publish_frame(MQTT_TOPIC_ACK_BIN, frame, len, false);
+    }
+#endif
+}
+
+// Telemetry values of one publish. Captured by the main task (measurement,
+// battery and settings are not safe to read from the bring-up task) and
+// published by whichever task owns the link.
+typedef struct {
+    uint32_t    ts;
+    uint8_t     battery;
+    bool        water_ok;
+    bool        deep_sleep;
+    uint8_t     humidity[PLANT_CHANNEL_COUNT];
+    uint8_t     min_h[PLANT_CHANNEL_COUNT];
+    uint8_t     max_h[PLANT_CHANNEL_COUNT];
+    SensorFault fault[PLANT_CHANNEL_COUNT];
+} TelemetrySnapshot;
+
+static void telemetry_capture(TelemetrySnapshot *out) {
+    // Same snapshot the watering decision used, unless a pulse invalidated it
+    const Measurement *m = measurement_get();
+    out->ts = m->ts;
+    out->battery = battery_get_percent();
+    out->water_ok = m->water_ok;
+    out->deep_sleep = storage_get_deep_sleep_enabled();
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        out->humidity[ch] = m->humidity[ch];
+        out->min_h[ch] = storage_get_minimal_humidity(ch);
+        out->max_h[ch] = storage_get_max_humidity(ch);
+        out->fault[ch] = m->fault[ch];
+    }
+}
+
+// One telemetry message per plant channel. The JSON form only carries
+// "ch" on multi-plant builds so single-plant payloads stay unchanged.
+static void telemetry_publish(const TelemetrySnapshot &snap) {
+    if (!s_link->connected()) {
+        return;
+    }
+
+    const uint32_t ts = snap.ts;
+    const uint8_t batt = snap.battery;
+    const bool water_ok = snap.water_ok;
+    const bool deep_sleep_enabled = snap.deep_sleep;
+
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        const uint8_t humidity = snap.humidity[ch];
+        const uint8_t min_h = snap.min_h[ch];
+        const uint8_t max_h = snap.max_h[ch];
+        const SensorFault fault = snap.fault[ch];
+
+#if MQTT_WIRE_FORMAT != MQTT_WIRE_BINARY
+        char msg[232];
+        snprintf(msg, sizeof(msg),
+#if PLANT_CHANNEL_COUNT > 1
+                 "{\"plant\":\"%s\",\"ch\":%u,\"ts\":%lu,\"humidity\":%u,\"battery\":%u,\"water_ok\":%s,\"min\":%u,\"max\":%u,\"deep_sleep\":%s,\"sensor\":\"%s\"}",
+                 s_plant_name,
+                 ch,
+#else
+                 "{\"plant\":\"%s\",\"ts\":%lu,\"humidity\":%u,\"battery\":%u,\"water_ok\":%s,\"min\":%u,\"max\":%u,\"deep_sleep\":%s,\"sensor\":\"%s\"}",
+                 s_plant_name,
+#endif
+                 (unsigned long)ts,
+                 humidity,
+                 batt,
+                 water_ok ? "true" : "false",
+                 min_h,
+                 max_h,
+                 deep_sleep_enabled ? "true" : "false",
+                 sensor_fault_name(fault));
+        link_publish(MQTT_TOPIC_TELEMETRY, msg, false);
+#endif
+#if MQTT_WIRE_FORMAT != MQTT_WIRE_JSON
+        WireTelemetry t;
+        t.ts = ts;
+        t.humidity = humidity;
+        t.battery = batt;
+        t.min_h = min_h;
+        t.max_h = max_h;
+        t.flags = (water_ok ? WIRE_FLAG_WATER_OK : 0) | (deep_sleep_enabled ? WIRE_FLAG_DEEP_SLEEP : 0) |
+                  (uint8_t)(fault << WIRE_FLAG_FAULT_SHIFT);
+        t.channel = ch;
+        uint8_t frame[16 + MQTT_PLANT_NAME_MAX_LEN];
+        const size_t len = wire_encode_telemetry(frame, sizeof(frame), s_plant_name, &t);
+        if (len > 0) {
+            link_publish_frame(MQTT_TOPIC_TELEMETRY_BIN, frame, len, false);
+        }
+#endif
+    }
 }
 
 void mqtt_control_publish_telemetry() {
-    if (!s_mqtt.connected()) {
+    TelemetrySnapshot snap;
+    telemetry_capture(&snap);
+    if (s_bringup_running) {
+        // Handed to the bring-up task, which publishes once the link is up
+        if (s_snapshot_queue != nullptr) {
+            xQueueOverwrite(s_snapshot_queue, &snap);
+        }
         return;
     }
+    s_first_publish_pending = false;
+    telemetry_publish(snap);
+}
 
-    const uint32_t ts = storage_get_persistent_time();
-    const uint8_t humidity = sensor_read_humidity_percent();
-    const uint8_t batt = battery_get_percent();
-    const bool water_ok = water_level_ok();
-    const uint8_t min_h = storage_get_minimal_humidity();
-    const uint8_t max_h = storage_get_max_humidity();
-    const bool deep_sleep_enabled = storage_get_deep_sleep_enabled();
+// One batch message: {"plant":..,"r":[[seq,ts,raw,humidity,battery_mv,flags,result],...]}
+// Takes the records that fit into the buffer (long names and large seq /
+// ts values leave room for fewer than TELEMETRY_BATCH_RECORDS).
+static uint16_t mqtt_publish_telemetry_batch_json(const TelemetryRecord *records, uint16_t count) {
+    char msg[MQTT_BUFFER_SIZE - 64];
+    const size_t tail = 2;   // "]}"
+    size_t len = (size_t)snprintf(msg, sizeof(msg), "{\"plant\":\"%s\",\"r\":[", s_plant_name);
+    uint16_t n = 0;
+    while (n < count && len < sizeof(msg)) {
+        const TelemetryRecord &r = records[n];
+        char rec[64];
+        const size_t rec_len = (size_t)snprintf(rec, sizeof(rec), "%s[%lu,%lu,%u,%u,%u,%u,%u]",
+                                                (n > 0) ? "," : "",
+                                                (unsigned long)r.seq,
+                                                (unsigned long)r.ts,
+                                                r.raw_soil,
+                                                r.humidity,
+                                                r.battery_mv,
+                                                r.flags,
+                                                r.result);
+        if (len + rec_len + tail >= sizeof(msg)) {
+            break;
+        }
+        memcpy(msg + len, rec, rec_len);
+        len += rec_len;
+        n++;
+    }
+    if (n == 0) {
+#if DEBUG_SERIAL
+        Serial.println("[MQTT] Telemetry record does not fit the batch buffer");
+#endif
+        return 0;
+    }
+    len += (size_t)snprintf(msg + len, sizeof(msg) - len, "]}");
+    return link_publish(MQTT_TOPIC_TELEMETRY_BATCH, msg, false) ? n : 0;
+}
 
-    char msg[224];
-    snprintf(msg, sizeof(msg),
-             "{\"plant\":\"%s\",\"ts\":%lu,\"humidity\":%u,\"battery\":%u,\"water_ok\":%s,\"min\":%u,\"max\":%u,\"deep_sleep\":%s}",
-             s_plant_name.c_str(),
-             (unsigned long)ts,
-             humidity,
-             batt,
-             water_ok ? "true" : "false",
-             min_h,
-             max_h,
-             deep_sleep_enabled ? "true" : "false");
-    s_mqtt.publish(MQTT_TOPIC_TELEMETRY, msg, false);
+static uint16_t mqtt_publish_telemetry_batch_bin(const TelemetryRecord *records, uint16_t count) {
+    uint8_t frame[MQTT_BUFFER_SIZE - 64];
+    const size_t len = wire_encode_telemetry_batch(frame, sizeof(frame), s_plant_name, records, count);
+    if (len == 0) {
+#if DEBUG_SERIAL
+        Serial.println("[MQTT] Binary telemetry batch exceeds buffer, lower TELEMETRY_BATCH_RECORDS");
+#endif
+        return 0;
+    }
+    return link_publish_frame(MQTT_TOPIC_TELEMETRY_BATCH_BIN, frame, len, false) ? count : 0;
+}
+
+// Both formats carry the same records: the binary batch follows the
+// count the JSON one could fit.
+static uint16_t mqtt_publish_telemetry_batch(const TelemetryRecord *records, uint16_t count) {
+    if (!s_link->connected()) {
+        return 0;
+    }
+#if MQTT_WIRE_FORMAT != MQTT_WIRE_BINARY
+    count = mqtt_publish_telemetry_batch_json(records, count);
+    if (count == 0) {
+        return 0;
+    }
+#endif
+#if MQTT_WIRE_FORMAT != MQTT_WIRE_JSON
+    count = mqtt_publish_telemetry_batch_bin(records, count);
+#endif
+    return count;
+}
+
+void mqtt_control_upload_telemetry_log() {
+    if (s_bringup_running || !s_link->connected()) {
+        return;
+    }
+    const uint32_t pending = telemetry_log_pending();
+    if (pending == 0) {
+        return;
+    }
+    const uint32_t sent = telemetry_log_upload(mqtt_publish_telemetry_batch);
+#if DEBUG_SERIAL
+    Serial.print("[MQTT] Telemetry log uploaded ");
+    Serial.print(sent);
+    Serial.print("/");
+    Serial.println(pending);
+#else
+    (void)sent;
+#endif
 }
 
-static bool extract_json_string_field(const String &json, const char *key, String &out) {
-    const String pattern = String("\"") + key + "\"";
-    int key_pos = json.indexOf(pattern);
-    if (key_pos < 0) {
+// One wake per message: {"plant","boot","awake_ms","setup_us","uah","spans":{name:[us,n]}}
+static bool mqtt_publish_profile_record(const ProfileRecord *rec) {
+    char msg[384];
+    size_t len = (size_t)snprintf(msg, sizeof(msg),
+                                  "{\"plant\":\"%s\",\"boot\":%lu,\"awake_ms\":%lu,\"setup_us\":%lu,\"uah\":%lu,\"spans\":{",
+                                  s_plant_name,
+                                  (unsigned long)rec->boot,
+                                  (unsigned long)(rec->awake_us / 1000),
+                                  (unsigned long)rec->setup_us,
+                                  (unsigned long)profiler_charge_uah(rec));
+    bool first = true;
+    for (uint8_t i = 0; i < PROF_SPAN_COUNT && len < sizeof(msg); ++i) {
+        if (rec->span_n[i] == 0) {
+            continue;
+        }
+        len += (size_t)snprintf(msg + len, sizeof(msg) - len, "%s\"%s\":[%lu,%u]",
+                                first ? "" : ",",
+                                profiler_span_name((ProfileSpan)i),
+                                (unsigned long)rec->span_us[i],
+                                (unsigned)rec->span_n[i]);
+        first = false;
+    }
+    if (len < sizeof(msg)) {
+        len += (size_t)snprintf(msg + len, sizeof(msg) - len, "}}");
+    }
+    if (len >= sizeof(msg)) {
         return false;
     }
+    return link_publish(MQTT_TOPIC_PROFILE, msg, false);
+}
+
+static void ota_progress(uint32_t done, uint32_t total) {
+    s_link->poll();   // keep the broker link alive during long downloads
+    #if DEBUG_SERIAL
+    Serial.print("[MQTT] OTA ");
+    Serial.print(done);
+    Serial.print('/');
+    Serial.println(total);
+    #else
+    (void)done;
+    (void)total;
+    #endif
+}
+
+void mqtt_control_service_ota() {
+    if (!s_link->connected()) {
+        return;
+    }
+    if (ota_update_confirm(true)) {
+        const esp_app_desc_t *app = esp_app_get_description();
+        mqtt_publish_ack("ota", true, app->version);
+    }
+    if (!ota_update_due()) {
+        return;
+    }
 
-    int colon_pos = json.indexOf(':', key_pos + pattern.length());
-    if (colon_pos < 0) {
+    const char *detail = "";
+    const OtaStatus status = ota_update_service(OTA_WAKE_BUDGET_MS, ota_progress, &detail);
+    if (status == OTA_IN_PROGRESS) {
+        char progress[32];
+        const StorageOtaJob *job = storage_get_ota_job();
+        snprintf(progress, sizeof(progress), "%s %lu/%lu", detail,
+                 (unsigned long)job->offset, (unsigned long)job->size);
+        mqtt_publish_ack("ota", true, progress);
+        return;
+    }
+    mqtt_publish_ack("ota", status == OTA_READY, detail);
+    if (status == OTA_READY) {
+        // Let the ack leave before the restart
+        const uint32_t start = millis();
+        while (millis() - start < 200) {
+            s_link->poll();
+            delay(10);
+        }
+        storage_close();
+        esp_restart();
+    }
+}
+
+void mqtt_control_publish_profile() {
+    if (s_bringup_running || !s_link->connected()) {
+        return;
+    }
+    const uint16_t sent = profiler_drain(mqtt_publish_profile_record);
+#if DEBUG_SERIAL
+    Serial.print("[MQTT] Profile records sent: ");
+    Serial.println(sent);
+#else
+    (void)sent;
+#endif
+}
+
+// =============================================================================
+// COMMAND PARSING
+// =============================================================================
+// Zero-copy: name/arg are slices into the MQTT payload (or the decoded
+// binary frame). Only the command id is copied, because acks and the
+// dedup cache outlive the payload buffer.
+//
+// An optional "<digit>/" prefix selects the plant channel ("2/water");
+// without it commands address channel 0.
+
+typedef struct {
+    Slice name;       // before ':'
+    Slice arg;        // after ':', trimmed
+    bool has_arg;
+    uint8_t ch;       // requested plant channel (validated by the dispatcher)
+    Slice batch;      // contents of a "cmds":[...] array, empty for single commands
+    char id[STORAGE_CMD_ID_MAX_LEN + 1];
+} ParsedCommand;
+
+static Slice slice_trim(Slice s) {
+    while (s.len > 0 && isspace((unsigned char)s.ptr[0])) {
+        ++s.ptr;
+        --s.len;
+    }
+    while (s.len > 0 && isspace((unsigned char)s.ptr[s.len - 1])) {
+        --s.len;
+    }
+    return s;
+}
+
+// Case-insensitive compare against a lowercase literal, strcmp-style.
+static int slice_compare_ci(Slice s, const char *lit) {
+    for (size_t i = 0; i < s.len; ++i) {
+        const int a = tolower((unsigned char)s.ptr[i]);
+        const int b = (unsigned char)lit[i];
+        if (b == 0 || a != b) {
+            return a - b;
+        }
+    }
+    return -(int)(unsigned char)lit[s.len];
+}
+
+static bool slice_equals_ci(Slice s, const char *lit) {
+    return slice_compare_ci(s, lit) == 0;
+}
+
+// Plain decimal; values are saturated well above any valid argument.
+static bool slice_to_uint(Slice s, uint32_t *out) {
+    if (s.len == 0) {
         return false;
     }
+    uint32_t v = 0;
+    for (size_t i = 0; i < s.len; ++i) {
+        const char c = s.ptr[i];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        if (v < 100000) {
+            v = v * 10 + (uint32_t)(c - '0');
+        }
+    }
+    *out = v;
+    return true;
+}
+
+// Closing quote of the JSON string whose contents start at p, stepping
+// over backslash escapes (\" and \\); nullptr if it is not terminated.
+static const char *json_string_end(const char *p, const char *end) {
+    while (p < end) {
+        if (*p == '"') {
+            return p;
+        }
+        if (*p == '\\' && end - p < 2) {
+            break;
+        }
+        p += (*p == '\\') ? 2 : 1;
+    }
+    return nullptr;
+}
+
+// Just past "key": of the first member named key, or nullptr. Strings
+// are skipped whole, so a value equal to key or holding escaped quotes
+// is never taken for a key.
+static const char *json_member_value(Slice json, const char *key) {
+    const size_t key_len = strlen(key);
+    const char *end = json.ptr + json.len;
+    const char *p = json.ptr;
+    while ((p = (const char *)memchr(p, '"', (size_t)(end - p))) != nullptr) {
+        const char *name = p + 1;
+        const char *close = json_string_end(name, end);
+        if (close == nullptr) {
+            return nullptr;
+        }
+        const char *q = close + 1;
+        while (q < end && isspace((unsigned char)*q)) ++q;
+        if (q < end && *q == ':' && (size_t)(close - name) == key_len &&
+            memcmp(name, key, key_len) == 0) {
+            ++q;
+            while (q < end && isspace((unsigned char)*q)) ++q;
+            return q;
+        }
+        p = close + 1;
+    }
+    return nullptr;
+}
 
-    int first_quote = json.indexOf('"', colon_pos + 1);
-    if (first_quote < 0) {
+// Value of "key": "value" (first occurrence). Escapes are left as sent;
+// no command name or argument contains one.
+static bool json_string_field(Slice json, const char *key, Slice *out) {
+    const char *end = json.ptr + json.len;
+    const char *q = json_member_value(json, key);
+    if (q == nullptr || q >= end || *q != '"') {
         return false;
     }
+    const char *value = q + 1;
+    const char *close = json_string_end(value, end);
+    if (close == nullptr) {
+        return false;
+    }
+    out->ptr = value;
+    out->len = (size_t)(close - value);
+    return true;
+}
 
-    int second_quote = json.indexOf('"', first_quote + 1);
-    if (second_quote < 0) {
+// Contents of "key": [ ... ] (between the brackets, strings respected).
+static bool json_array_field(Slice json, const char *key, Slice *out) {
+    const char *end = json.ptr + json.len;
+    const char *q = json_member_value(json, key);
+    if (q == nullptr || q >= end || *q != '[') {
         return false;
     }
+    const char *items = ++q;
+    for (; q < end; ++q) {
+        if (*q == '"') {
+            q = json_string_end(q + 1, end);
+            if (q == nullptr) {
+                return false;
+            }
+        } else if (*q == ']') {
+            out->ptr = items;
+            out->len = (size_t)(q - items);
+            return true;
+        }
+    }
+    return false;
+}
 
-    out = json.substring(first_quote + 1, second_quote);
+// Next string of an array slice from json_array_field(); consumes it.
+static bool json_next_string(Slice *items, Slice *out) {
+    const char *end = items->ptr + items->len;
+    const char *p = (const char *)memchr(items->ptr, '"', items->len);
+    if (p == nullptr) {
+        return false;
+    }
+    const char *value = p + 1;
+    p = json_string_end(value, end);
+    if (p == nullptr) {
+        return false;
+    }
+    out->ptr = value;
+    out->len = (size_t)(p - value);
+    items->ptr = p + 1;
+    items->len = (size_t)(end - items->ptr);
     return true;
 }
 
-static ParsedCommand parse_command(const String &raw_payload) {
-    ParsedCommand parsed;
-    parsed.command = raw_payload;
-    parsed.command_id = "";
-    parsed.command.trim();
+static void parse_command_text(Slice text, ParsedCommand *out) {
+    text = slice_trim(text);
+    out->ch = 0;
+    if (text.len >= 2 && text.ptr[0] >= '0' && text.ptr[0] <= '9' && text.ptr[1] == '/') {
+        out->ch = (uint8_t)(text.ptr[0] - '0');
+        text = slice_trim(Slice{text.ptr + 2, text.len - 2});
+    }
+    const char *colon = (const char *)memchr(text.ptr, ':', text.len);
+    out->has_arg = (colon != nullptr);
+    if (colon == nullptr) {
+        out->name = text;
+        out->arg = Slice{text.ptr + text.len, 0};
+        return;
+    }
+    out->name = Slice{text.ptr, (size_t)(colon - text.ptr)};
+    out->arg = slice_trim(Slice{colon + 1, (size_t)(text.ptr + text.len - colon - 1)});
+}
 
-    if (!parsed.command.startsWith("{")) {
-        return parsed;
+static void parse_command_id(Slice id, ParsedCommand *out) {
+    id = slice_trim(id);
+    if (id.len > sizeof(out->id) - 1) {
+        id.len = sizeof(out->id) - 1;
+        // The id is echoed into the ack JSON: do not cut an escape in half
+        size_t slashes = 0;
+        while (slashes < id.len && id.ptr[id.len - 1 - slashes] == '\\') ++slashes;
+        id.len -= slashes % 2;
     }
+    memcpy(out->id, id.ptr, id.len);
+    out->id[id.len] = '\0';
+}
 
-    String command_from_json;
-    if (extract_json_string_field(parsed.command, "cmd", command_from_json)) {
-        parsed.command = command_from_json;
-        parsed.command.trim();
+// Accepts a bare command ("set_min:45"), {"id":"...","cmd":"..."} or a
+// batch {"id":"...","cmds":["...",...]}.
+static void parse_command(Slice payload, ParsedCommand *out) {
+    out->id[0] = '\0';
+    out->batch = Slice{nullptr, 0};
+    const Slice trimmed = slice_trim(payload);
+    if (trimmed.len == 0 || trimmed.ptr[0] != '{') {
+        parse_command_text(trimmed, out);
+        return;
     }
 
-    String id_from_json;
-    if (extract_json_string_field(raw_payload, "id", id_from_json)) {
-        parsed.command_id = id_from_json;
-        parsed.command_id.trim();
+    Slice field;
+    if (json_array_field(trimmed, "cmds", &out->batch)) {
+        parse_command_text(Slice{trimmed.ptr, 0}, out);
+    } else {
+        parse_command_text(json_string_field(trimmed, "cmd", &field) ? field : trimmed, out);
+    }
+    if (json_string_field(trimmed, "id", &field)) {
+        parse_command_id(field, out);
     }
+}
 
-    return parsed;
+// =============================================================================
+// COMMAND HANDLERS
+// =============================================================================
+// Each handler sends its own ack and returns true when the device state
+// changed, so the dispatcher follows up with fresh telemetry.
+
+typedef bool (*CommandHandler)(const ParsedCommand &cmd);
+
+static bool cmd_water(const ParsedCommand &c) {
+    const WateringResult r = watering_manual(c.ch, true);
+    if (r == WATER_OK || r == WATER_PARTIAL) {
+        mqtt_publish_ack("water", true, "watered", c.id);
+    } else if (r == WATER_BATTERY_LOW) {
+        mqtt_publish_ack("water", false, "battery_low", c.id);
+    } else if (r == WATER_RESERVOIR_LOW) {
+        mqtt_publish_ack("water", false, "reservoir_low", c.id);
+    } else {
+        mqtt_publish_ack("water", false, "watering_failed", c.id);
+    }
+    return true;
+}
+
+static bool cmd_calibrate_wet(const ParsedCommand &c) {
+    sensor_calibrate_wet(c.ch);
+    mqtt_publish_ack("calibrate_wet", true, "ok", c.id);
+    return true;
+}
+
+static bool cmd_calibrate_dry(const ParsedCommand &c) {
+    sensor_calibrate_dry(c.ch);
+    mqtt_publish_ack("calibrate_dry", true, "ok", c.id);
+    return true;
+}
+
+static bool cmd_toggle_sleep(const ParsedCommand &c) {
+    const bool new_state = !storage_get_deep_sleep_enabled();
+    storage_set_deep_sleep_enabled(new_state);
+    mqtt_publish_ack("set_sleep", true, new_state ? "on" : "off", c.id);
+    return true;
+}
+
+static bool cmd_sleep_status(const ParsedCommand &c) {
+    const bool state = storage_get_deep_sleep_enabled();
+    mqtt_publish_ack("set_sleep", true, state ? "on" : "off", c.id);
+    return true;
 }
 
-static bool parse_non_negative_int_arg(const String &input, const char *prefix, int &out) {
-    const String p(prefix);
-    if (!input.startsWith(p)) {
+static bool cmd_set_sleep(const ParsedCommand &c) {
+    bool new_state;
+    if (slice_equals_ci(c.arg, "on") || slice_equals_ci(c.arg, "1") || slice_equals_ci(c.arg, "true")) {
+        new_state = true;
+    } else if (slice_equals_ci(c.arg, "off") || slice_equals_ci(c.arg, "0") || slice_equals_ci(c.arg, "false")) {
+        new_state = false;
+    } else {
+        mqtt_publish_ack("set_sleep", false, "invalid_value", c.id);
         return false;
     }
-    String value = input.substring(p.length());
-    value.trim();
-    if (value.length() == 0) {
+
+    storage_set_deep_sleep_enabled(new_state);
+    mqtt_publish_ack("set_sleep", true, new_state ? "on" : "off", c.id);
+    return true;
+}
+
+static bool set_threshold(const ParsedCommand &c, const char *ack_cmd, void (*setter)(uint8_t, uint8_t)) {
+    uint32_t value = 0;
+    if (!slice_to_uint(c.arg, &value)) {
+        mqtt_publish_ack(ack_cmd, false, "invalid_value", c.id);
         return false;
     }
+    if (value > 100) value = 100;
+    setter(c.ch, (uint8_t)value);
+    mqtt_publish_ack(ack_cmd, true, "ok", c.id);
+    return true;
+}
 
-    for (size_t i = 0; i < value.length(); ++i) {
-        const char c = value.charAt(i);
-        if (c < '0' || c > '9') {
+static bool cmd_set_min(const ParsedCommand &c) {
+    return set_threshold(c, "set_min", storage_set_minimal_humidity);
+}
+
+static bool cmd_set_max(const ParsedCommand &c) {
+    return set_threshold(c, "set_max", storage_set_max_humidity);
+}
+
+static bool cmd_set_name(const ParsedCommand &c) {
+    normalize_plant_name(c.arg, s_plant_name, sizeof(s_plant_name));
+    storage_set_plant_name(s_plant_name);
+    mqtt_publish_ack("set_name", true, "ok", c.id);
+    return true;
+}
+
+static void mqtt_link_change_group(const char *old_group, const char *new_group);
+
+static bool group_name_valid(Slice s) {
+    if (s.len > MQTT_GROUP_MAX_LEN) {
+        return false;
+    }
+    for (size_t i = 0; i < s.len; ++i) {
+        const char c = s.ptr[i];
+        if (!isalnum((unsigned char)c) && c != '_' && c != '-') {
             return false;
         }
     }
+    return true;
+}
+
+// "set_group:<name>" joins plant/group/<name>/cmd, "set_group:" leaves it.
+static bool cmd_set_group(const ParsedCommand &c) {
+    if (!group_name_valid(c.arg)) {
+        mqtt_publish_ack("set_group", false, "invalid_value", c.id);
+        return false;
+    }
+    char group[MQTT_GROUP_MAX_LEN + 1];
+    memcpy(group, c.arg.ptr, c.arg.len);
+    group[c.arg.len] = '\0';
+
+    mqtt_link_change_group(s_group, group);
+    strncpy(s_group, group, sizeof(s_group) - 1);
+    storage_set_group(s_group);
+    mqtt_publish_ack("set_group", true, (s_group[0] != '\0') ? s_group : "none", c.id);
+    return false;
+}
+
+static int hex_nibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c = (char)tolower((unsigned char)c);
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
 
-    out = value.toInt();
+static bool slice_to_sha256(Slice s, uint8_t out[32]) {
+    if (s.len != 64) {
+        return false;
+    }
+    for (size_t i = 0; i < 32; ++i) {
+        const int hi = hex_nibble(s.ptr[2 * i]);
+        const int lo = hex_nibble(s.ptr[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        out[i] = (uint8_t)((hi << 4) | lo);
+    }
     return true;
 }
 
-static void handle_command(const ParsedCommand &parsed_cmd) {
-    String raw = parsed_cmd.command;
-    raw.trim();
+// "ota:<url> <sha256 hex>"; the download runs after the command window.
+static bool cmd_ota(const ParsedCommand &c) {
+    const char *space = nullptr;
+    for (size_t i = c.arg.len; i > 0; --i) {
+        if (isspace((unsigned char)c.arg.ptr[i - 1])) {
+            space = c.arg.ptr + i - 1;
+            break;
+        }
+    }
+    if (space == nullptr) {
+        mqtt_publish_ack("ota", false, "invalid_value", c.id);
+        return false;
+    }
+    const Slice url = slice_trim(Slice{c.arg.ptr, (size_t)(space - c.arg.ptr)});
+    const Slice hash = Slice{space + 1, (size_t)(c.arg.ptr + c.arg.len - space - 1)};
+    uint8_t sha256[32];
+    if (!slice_to_sha256(hash, sha256)) {
+        mqtt_publish_ack("ota", false, "invalid_hash", c.id);
+        return false;
+    }
+    if (!ota_update_queue(url.ptr, url.len, sha256)) {
+        mqtt_publish_ack("ota", false, OTA_ENABLED ? "invalid_url" : "disabled", c.id);
+        return false;
+    }
+    mqtt_publish_ack("ota", true, "queued", c.id);
+    return false;
+}
 
-    String cmd = raw;
-    cmd.toLowerCase();
+// "forecast:<ET in 0.1 mm/day> <rain %>", e.g. "forecast:42 70"; applies
+// to every channel (forecast.h).
+static bool cmd_forecast(const ParsedCommand &c) {
+    const char *space = (const char *)memchr(c.arg.ptr, ' ', c.arg.len);
+    uint32_t et_x10 = 0;
+    uint32_t rain_pct = 0;
+    if (space == nullptr ||
+        !slice_to_uint(Slice{c.arg.ptr, (size_t)(space - c.arg.ptr)}, &et_x10) ||
+        !slice_to_uint(slice_trim(Slice{space + 1, (size_t)(c.arg.ptr + c.arg.len - space - 1)}), &rain_pct) ||
+        !forecast_set(et_x10, rain_pct)) {
+        mqtt_publish_ack("forecast", false, "invalid_value", c.id);
+        return false;
+    }
+    mqtt_publish_ack("forecast", true, forecast_rain_likely() ? "rain_hold" : "ok", c.id);
+    return false;
+}
 
-    if (parsed_cmd.command_id.length() > 0 && parsed_cmd.command_id == s_last_command_id) {
-        mqtt_publish_ack("duplicate", true, "already_processed", parsed_cmd.command_id);
-        return;
+static bool is_batch_running();
+
+static bool cmd_status(const ParsedCommand &c) {
+    if (is_batch_running()) {
+        mqtt_publish_ack("status", true, "ok", c.id);
+        return true;   // the batch publishes telemetry once at its end
     }
+    mqtt_control_publish_telemetry();
+    mqtt_publish_ack("status", true, "ok", c.id);
+    return false;
+}
 
-    auto mark_processed = [&](void) {
-        if (parsed_cmd.command_id.length() == 0) {
-            return;
+typedef struct {
+    const char *name;        // lowercase; table is sorted by name
+    bool takes_arg;          // "name:<arg>" form
+    CommandHandler handler;
+} CommandEntry;
+
+static const CommandEntry k_commands[] = {
+    {"calibrate_dry", false, cmd_calibrate_dry},
+    {"calibrate_wet", false, cmd_calibrate_wet},
+    {"forecast",      true,  cmd_forecast},
+    {"ota",           true,  cmd_ota},
+    {"set_group",     true,  cmd_set_group},
+    {"set_max",       true,  cmd_set_max},
+    {"set_min",       true,  cmd_set_min},
+    {"set_name",      true,  cmd_set_name},
+    {"set_sleep",     true,  cmd_set_sleep},
+    {"sleep_status",  false, cmd_sleep_status},
+    {"status",        false, cmd_status},
+    {"toggle_sleep",  false, cmd_toggle_sleep},
+    {"water",         false, cmd_water},
+};
+
+static const CommandEntry *find_command(Slice name) {
+    size_t lo = 0;
+    size_t hi = sizeof(k_commands) / sizeof(k_commands[0]);
+    while (lo < hi) {
+        const size_t mid = (lo + hi) / 2;
+        const int cmp = slice_compare_ci(name, k_commands[mid].name);
+        if (cmp == 0) {
+            return &k_commands[mid];
         }
-        s_last_command_id = parsed_cmd.command_id;
-        storage_set_last_command_id(s_last_command_id);
-    };
-
-    if (cmd == "water") {
-        WateringResult r = watering_manual(true);
-        if (r == WATER_OK || r == WATER_PARTIAL) {
-            mqtt_publish_ack("water", true, "watered", parsed_cmd.command_id);
-        } else if (r == WATER_BATTERY_LOW) {
-            mqtt_publish_ack("water", false, "battery_low", parsed_cmd.command_id);
-        } else if (r == WATER_RESERVOIR_LOW) {
-            mqtt_publish_ack("water", false, "reservoir_low", parsed_cmd.command_id);
+        if (cmp < 0) {
+            hi = mid;
         } else {
-            mqtt_publish_ack("water", false, "watering_failed", parsed_cmd.command_id);
+            lo = mid + 1;
         }
-        mark_processed();
-        mqtt_control_publish_telemetry();
-        return;
     }
+    return nullptr;
+}
 
-    if (cmd == "calibrate_wet") {
-        sensor_calibrate_wet();
-        mqtt_publish_ack("calibrate_wet", true, "ok", parsed_cmd.command_id);
-        mark_processed();
-        mqtt_control_publish_telemetry();
+static void mark_processed(const ParsedCommand &c) {
+    if (c.id[0] == '\0') {
         return;
     }
+    strncpy(s_last_command_id, c.id, sizeof(s_last_command_id) - 1);
+    s_last_command_id[sizeof(s_last_command_id) - 1] = '\0';
+    storage_set_last_command_id(s_last_command_id);
+}
 
-    if (cmd == "calibrate_dry") {
-        sensor_calibrate_dry();
-        mqtt_publish_ack("calibrate_dry", true, "ok", parsed_cmd.command_id);
-        mark_processed();
-        mqtt_control_publish_telemetry();
-        return;
+// Runs one command (acks included); true when telemetry should follow.
+static bool run_command(const ParsedCommand &c) {
+    if (c.ch >= PLANT_CHANNEL_COUNT) {
+        mqtt_publish_ack("unknown", false, "invalid_channel", c.id);
+        return false;
     }
 
-    if (cmd == "toggle_sleep") {
-        const bool new_state = !storage_get_deep_sleep_enabled();
-        storage_set_deep_sleep_enabled(new_state);
-        mqtt_publish_ack("set_sleep", true, new_state ? "on" : "off", parsed_cmd.command_id);
-        mark_processed();
-        mqtt_control_publish_telemetry();
-        return;
+    const CommandEntry *entry = find_command(c.name);
+    if (entry == nullptr || entry->takes_arg != c.has_arg) {
+        mqtt_publish_ack("unknown", false, "unknown_command", c.id);
+        return false;
     }
+    return entry->handler(c);
+}
 
-    if (cmd == "sleep_status") {
-        const bool state = storage_get_deep_sleep_enabled();
-        mqtt_publish_ack("set_sleep", true, state ? "on" : "off", parsed_cmd.command_id);
-        mark_processed();
-        mqtt_control_publish_telemetry();
-        return;
-    }
+// =============================================================================
+// COMMAND BATCHES
+// =============================================================================
+// {"id":"..","cmds":["set_min:45","set_max:70","set_name:Fern"]} provisions
+// a device in one message. Entries run in order under the batch id: one
+// dedup entry, one ack {"cmd":"batch","ok":<all entries ok>,"detail":
+// "ok,ok,ok"} carrying each entry's detail, and at most one telemetry
+// publish. The storage cache already defers NVS writes, so the settings
+// reach flash together in the next storage_commit().
+//
+// Binary command frames carry a single command; batches are JSON only.
 
-    if (cmd.startsWith("set_sleep:")) {
-        bool new_state = storage_get_deep_sleep_enabled();
-        bool known = true;
-        const String value = cmd.substring(String("set_sleep:").length());
-        if (value == "on" || value == "1" || value == "true") {
-            new_state = true;
-        } else if (value == "off" || value == "0" || value == "false") {
-            new_state = false;
-        } else {
-            known = false;
-        }
+typedef struct {
+    bool active;
+    bool ok;
+    size_t len;
+    char detail[MQTT_BATCH_DETAIL_LEN];
+} CommandBatch;
 
-        if (!known) {
-            mqtt_publish_ack("set_sleep", false, "invalid_value", parsed_cmd.command_id);
-            mark_processed();
-            return;
-        }
+static CommandBatch s_batch;
 
-        storage_set_deep_sleep_enabled(new_state);
-        mqtt_publish_ack("set_sleep", true, new_state ? "on" : "off", parsed_cmd.command_id);
-        mark_processed();
-        mqtt_control_publish_telemetry();
-        return;
+static bool is_batch_running() {
+    return s_batch.active;
+}
+
+static bool batch_capture_ack(bool ok, const char *detail) {
+    if (!s_batch.active) {
+        return false;
     }
+    s_batch.ok = s_batch.ok && ok;
+    const int n = snprintf(s_batch.detail + s_batch.len, sizeof(s_batch.detail) - s_batch.len,
+                           (s_batch.len > 0) ? ",%s" : "%s", detail);
+    if (n > 0) {
+        s_batch.len += (size_t)n;
+        if (s_batch.len >= sizeof(s_batch.detail)) {
+            s_batch.len = sizeof(s_batch.detail) - 1;   // truncated, the ok flag still counts all
+        }
+    }
+    return true;
+}
 
-    int min_h = 0;
-    if (parse_non_negative_int_arg(cmd, "set_min:", min_h)) {
-        if (min_h > 100) min_h = 100;
-        storage_set_minimal_humidity((uint8_t)min_h);
-        mqtt_publish_ack("set_min", true, "ok", parsed_cmd.command_id);
-        mark_processed();
-        mqtt_control_publish_telemetry();
+static void handle_batch(const ParsedCommand &c) {
+    Slice items = c.batch;
+    Slice text;
+    uint8_t count = 0;
+    while (json_next_string(&items, &text)) {
+        ++count;
+    }
+    if (count == 0 || count > MQTT_BATCH_MAX_COMMANDS) {
+        mqtt_publish_ack("batch", false, (count == 0) ? "empty" : "too_many", c.id);
         return;
     }
 
-    if (cmd.startsWith("set_min:")) {
-        mqtt_publish_ack("set_min", false, "invalid_value", parsed_cmd.command_id);
-        mark_processed();
-        return;
+    s_batch.active = true;
+    s_batch.ok = true;
+    s_batch.len = 0;
+    s_batch.detail[0] = '\0';
+
+    bool changed = false;
+    items = c.batch;
+    while (json_next_string(&items, &text)) {
+        ParsedCommand entry;
+        parse_command_text(text, &entry);
+        entry.batch = Slice{nullptr, 0};
+        entry.id[0] = '\0';
+        if (!entry.has_arg && slice_equals_ci(entry.name, MQTT_CMD_END_OF_COMMANDS)) {
+            batch_capture_ack(false, "unknown_command");
+            continue;
+        }
+        changed = run_command(entry) || changed;
     }
 
-    int max_h = 0;
-    if (parse_non_negative_int_arg(cmd, "set_max:", max_h)) {
-        if (max_h > 100) max_h = 100;
-        storage_set_max_humidity((uint8_t)max_h);
-        mqtt_publish_ack("set_max", true, "ok", parsed_cmd.command_id);
-        mark_processed();
+    s_batch.active = false;
+    mqtt_publish_ack("batch", s_batch.ok, s_batch.detail, c.id);
+    if (changed) {
         mqtt_control_publish_telemetry();
-        return;
     }
+}
 
-    if (cmd.startsWith("set_max:")) {
-        mqtt_publish_ack("set_max", false, "invalid_value", parsed_cmd.command_id);
-        mark_processed();
+static void handle_command(const ParsedCommand &c) {
+    if (c.id[0] != '\0' && strcmp(c.id, s_last_command_id) == 0) {
+        mqtt_publish_ack("duplicate", true, "already_processed", c.id);
         return;
     }
 
-    if (cmd.startsWith("set_name:")) {
-        String name = raw.substring(String("set_name:").length());
-        normalize_plant_name(name);
-        s_plant_name = name;
-        storage_set_plant_name(s_plant_name);
-        mqtt_publish_ack("set_name", true, "ok", parsed_cmd.command_id);
-        mark_processed();
-        mqtt_control_publish_telemetry();
+    if (c.batch.ptr != nullptr) {
+        handle_batch(c);
+        mark_processed(c);
         return;
     }
 
-    if (cmd == "status") {
+    const bool changed = run_command(c);
+    mark_processed(c);
+    if (changed) {
         mqtt_control_publish_telemetry();
-        mqtt_publish_ack("status", true, "ok", parsed_cmd.command_id);
-        mark_processed();
-        return;
     }
+}
 
-    mqtt_publish_ack("unknown", false, "unknown_command", parsed_cmd.command_id);
-    mark_processed();
+// Commands come on this device's, the broadcast or the joined group's
+// topic; anything else is not addressed to us.
+static bool command_topic_for_us(const TopicParts &parts) {
+    switch (parts.scope) {
+        case TOPIC_SCOPE_DEVICE:    return device_topic_target_is(&parts, device_id());
+        case TOPIC_SCOPE_BROADCAST: return true;
+        case TOPIC_SCOPE_GROUP:     return s_group[0] != '\0' && device_topic_target_is(&parts, s_group);
+    }
+    return false;
 }
 
-static void mqtt_callback(char *topic, uint8_t *payload, unsigned int length) {
-    (void)topic;
-    String raw_payload;
-    raw_payload.reserve(length);
-    for (unsigned int i = 0; i < length; ++i) {
-        raw_payload += (char)payload[i];
+static void on_control_message(const char *topic, const uint8_t *payload, size_t length) {
+    TopicParts parts;
+    if (!device_topic_parse(topic, &parts) || !command_topic_for_us(parts)) {
+#if DEBUG_SERIAL
+        Serial.print("[MQTT] Ignored message on ");
+        Serial.println(topic);
+#endif
+        s_last_rx_ms = millis();
+        return;
     }
-    ParsedCommand parsed = parse_command(raw_payload);
-    handle_command(parsed);
+
+    ParsedCommand parsed;
+#if MQTT_WIRE_FORMAT != MQTT_WIRE_JSON
+    WireCommand wire_cmd;  // parsed points into it, keep in scope
+    if (strcmp(parts.suffix, MQTT_TOPIC_COMMAND_BIN) == 0) {
+        if (!wire_decode_command(payload, length, &wire_cmd)) {
+#if DEBUG_SERIAL
+            Serial.println("[MQTT] Dropped malformed binary command");
+#endif
+            s_last_rx_ms = millis();
+            return;
+        }
+        parse_command_text(Slice{wire_cmd.cmd, strlen(wire_cmd.cmd)}, &parsed);
+        parse_command_id(Slice{wire_cmd.id, strlen(wire_cmd.id)}, &parsed);
+        parsed.batch = Slice{nullptr, 0};
+    } else
+#endif
+    {
+        parse_command(Slice{(const char *)payload, length}, &parsed);
+    }
+
+    if (!parsed.has_arg && slice_equals_ci(parsed.name, MQTT_CMD_END_OF_COMMANDS)) {
+        // Host flushed its queue; no ack, no dedup for the sentinel. Hosts
+        // without wake tokens send no id; anything else must match this wake.
+        // Only the device topic counts: a fleet-wide sentinel would close
+        // windows the host never flushed.
+        if (parts.scope == TOPIC_SCOPE_DEVICE &&
+            (parsed.id[0] == '\0' || strcmp(parsed.id, s_wake_token) == 0)) {
+            s_end_of_commands = true;
+        }
+    } else {
+        handle_command(parsed);
+    }
+    s_last_rx_ms = millis();
 }
 
 static void wifi_ensure_connected() {
@@ -462,15 +1288,57 @@ static void wifi_ensure_connected() {
         return;
     }
 
-#ifdef DEBUG_SERIAL
+#if DEBUG_SERIAL
     Serial.println("[MQTT] WiFi connecting...");
 #endif
     mqtt_diag_wifi_connect_start();
 
+    bool reset_radio = (WiFi.status() != WL_NO_SHIELD);
+
+#if MQTT_WIFI_FAST_JOIN
+    if (wifi_fast_join_valid()) {
+        const uint32_t fast_start_ms = millis();
+        const bool fast_ok = wifi_try_fast_join(MQTT_WIFI_FAST_JOIN_TIMEOUT_MS);
+        (void)fast_start_ms;
+#if DEBUG_SERIAL
+        Serial.print("[MQTT] WiFi join path=fast ch=");
+        Serial.print(s_fast_join.channel);
+        Serial.print(fast_ok ? " ok in " : " FAILED after ");
+        Serial.print(millis() - fast_start_ms);
+        Serial.println(" ms");
+#endif
+        if (fast_ok) {
+            wifi_fast_join_store();
+#if DEBUG_SERIAL
+            Serial.print("[MQTT] WiFi connected, IP=");
+            Serial.println(WiFi.localIP());
+#endif
+            mqtt_diag_wifi_connect_ok();
+            return;
+        }
+        // Stale hint (AP moved channel, BSSID changed, lease lost): forget it.
+        wifi_fast_join_invalidate();
+        reset_radio = true;
+    }
+#endif
+
     const uint8_t max_attempts = 3;
     for (uint8_t attempt = 1; attempt <= max_attempts; ++attempt) {
-        if (wifi_try_single_join(15000UL)) {
-#ifdef DEBUG_SERIAL
+        const uint32_t scan_start_ms = millis();
+        const bool joined = wifi_try_single_join(15000UL, reset_radio || attempt > 1);
+        (void)scan_start_ms;
+#if DEBUG_SERIAL
+        Serial.print("[MQTT] WiFi join path=scan attempt ");
+        Serial.print(attempt);
+        Serial.print(joined ? " ok in " : " FAILED after ");
+        Serial.print(millis() - scan_start_ms);
+        Serial.println(" ms");
+#endif
+        if (joined) {
+#if MQTT_WIFI_FAST_JOIN
+            wifi_fast_join_store();
+#endif
+#if DEBUG_SERIAL
             Serial.print("[MQTT] WiFi connected, IP=");
             Serial.println(WiFi.localIP());
 #endif
@@ -478,7 +1346,7 @@ static void wifi_ensure_connected() {
             return;
         }
 
-#ifdef DEBUG_SERIAL
+#if DEBUG_SERIAL
         wl_status_t status = (wl_status_t)WiFi.status();
         Serial.print("[MQTT] WiFi attempt ");
         Serial.print(attempt);
@@ -500,7 +1368,7 @@ static void wifi_ensure_connected() {
 
         if (attempt < max_attempts) {
             if (wifi_reason_is_auth_rejected()) {
-#ifdef DEBUG_SERIAL
+#if DEBUG_SERIAL
                 Serial.println("[MQTT] Auth rejected by AP; aborting remaining WiFi attempts");
 #endif
                 break;
@@ -510,7 +1378,7 @@ static void wifi_ensure_connected() {
         }
     }
 
-#ifdef DEBUG_SERIAL
+#if DEBUG_SERIAL
     Serial.print("[MQTT] WiFi connect timeout, status=");
     Serial.print((int)WiFi.status());
     Serial.print(" (");
@@ -520,7 +1388,7 @@ static void wifi_ensure_connected() {
     wl_status_t final_status = (wl_status_t)WiFi.status();
     if (final_status != WL_CONNECTED) {
         WiFi.disconnect(false, false);
-#ifdef DEBUG_SERIAL
+#if DEBUG_SERIAL
         if (s_last_disconnect_reason >= 0) {
             Serial.print("[MQTT] last disconnect reason=");
             Serial.print(s_last_disconnect_reason);
@@ -534,87 +1402,367 @@ static void wifi_ensure_connected() {
     }
 }
 
-static void mqtt_try_reconnect() {
-    if (s_mqtt.connected()) {
-        return;
+// =============================================================================
+// WIFI + BROKER LINK (control_link.h)
+// =============================================================================
+
+static ControlLinkRxFn s_mqtt_rx = nullptr;
+static bool s_mqtt_client_ready = false;
+
+static void mqtt_link_on_message(char *topic, uint8_t *payload, unsigned int length) {
+    if (s_mqtt_rx != nullptr) {
+        s_mqtt_rx(topic, payload, length);
     }
+}
 
-    const uint32_t now = millis();
-    if ((now - s_last_reconnect_ms) < MQTT_RECONNECT_MS) {
+static void mqtt_link_setup() {
+    if (s_mqtt_client_ready) {
         return;
     }
-    wifi_ensure_connected();
-    // Timestamp after the (potentially long) connect attempt to avoid
-    // immediate duplicate retries in the same wake cycle.
-    s_last_reconnect_ms = millis();
-    if (WiFi.status() != WL_CONNECTED) {
-#ifdef DEBUG_SERIAL
-        Serial.println("[MQTT] Skip broker reconnect: WiFi not connected");
+    s_mqtt.setServer(MQTT_BROKER_HOST, MQTT_BROKER_PORT);
+    s_mqtt.setBufferSize(MQTT_BUFFER_SIZE);
+    s_mqtt.setCallback(mqtt_link_on_message);
+    WiFi.onEvent(on_wifi_event);
+    s_mqtt_client_ready = true;
+
+#if DEBUG_SERIAL
+    Serial.println("[MQTT] WiFi strategy=attempts-v2");
 #endif
+}
+
+#if MQTT_WIRE_FORMAT != MQTT_WIRE_JSON || GATEWAY_ROLE
+#define MQTT_LINK_BINARY_COMMANDS  1
+#else
+#define MQTT_LINK_BINARY_COMMANDS  0
+#endif
+
+static void mqtt_link_subscribe_group(const char *group, bool subscribe) {
+    char topic[MQTT_TOPIC_MAX_LEN];
+    if (group_topic(topic, sizeof(topic), group, MQTT_TOPIC_COMMAND)) {
+        subscribe ? s_mqtt.subscribe(topic, MQTT_COMMAND_QOS) : s_mqtt.unsubscribe(topic);
+    }
+#if MQTT_LINK_BINARY_COMMANDS
+    if (group_topic(topic, sizeof(topic), group, MQTT_TOPIC_COMMAND_BIN)) {
+        subscribe ? s_mqtt.subscribe(topic, MQTT_COMMAND_QOS) : s_mqtt.unsubscribe(topic);
+    }
+#endif
+}
+
+// The persistent session would keep the old group's subscription, so it
+// is dropped right away; the new one is also renewed on every connect.
+static void mqtt_link_change_group(const char *old_group, const char *new_group) {
+    if (!s_mqtt.connected() || strcmp(old_group, new_group) == 0) {
         return;
     }
+    if (old_group[0] != '\0') {
+        mqtt_link_subscribe_group(old_group, false);
+    }
+    if (new_group[0] != '\0') {
+        mqtt_link_subscribe_group(new_group, true);
+    }
+}
 
-    bool ok = false;
-    if (strlen(MQTT_BROKER_USER) > 0) {
-        ok = s_mqtt.connect(MQTT_CLIENT_ID, MQTT_BROKER_USER, MQTT_BROKER_PASSWORD);
-    } else {
-        ok = s_mqtt.connect(MQTT_CLIENT_ID);
+static void mqtt_link_subscribe_commands() {
+#if GATEWAY_ROLE
+    // Bridging for nodes: every device's command topics, broadcast and
+    // groups included (nodes filter groups themselves)
+    s_mqtt.subscribe(MQTT_TOPIC_ROOT "/+/" MQTT_TOPIC_COMMAND, MQTT_COMMAND_QOS);
+    s_mqtt.subscribe(MQTT_TOPIC_ROOT "/+/" MQTT_TOPIC_COMMAND_BIN, MQTT_COMMAND_QOS);
+    s_mqtt.subscribe(MQTT_TOPIC_ROOT "/" MQTT_TOPIC_GROUP "/+/" MQTT_TOPIC_COMMAND, MQTT_COMMAND_QOS);
+    s_mqtt.subscribe(MQTT_TOPIC_ROOT "/" MQTT_TOPIC_GROUP "/+/" MQTT_TOPIC_COMMAND_BIN,
+                     MQTT_COMMAND_QOS);
+#else
+    const char *const levels[] = {device_id(), MQTT_TOPIC_BROADCAST};
+    char topic[MQTT_TOPIC_MAX_LEN];
+    for (const char *level : levels) {
+        if (device_topic(topic, sizeof(topic), level, MQTT_TOPIC_COMMAND)) {
+            s_mqtt.subscribe(topic, MQTT_COMMAND_QOS);
+        }
+#if MQTT_LINK_BINARY_COMMANDS
+        if (device_topic(topic, sizeof(topic), level, MQTT_TOPIC_COMMAND_BIN)) {
+            s_mqtt.subscribe(topic, MQTT_COMMAND_QOS);
+        }
+#endif
     }
+    if (s_group[0] != '\0') {
+        mqtt_link_subscribe_group(s_group, true);
+    }
+#endif
+}
+
+static bool mqtt_link_connect(ControlLinkRxFn on_rx) {
+    s_mqtt_rx = on_rx;
+    mqtt_link_setup();
+    if (WiFi.status() != WL_CONNECTED) {
+        const int64_t join_span = profiler_start();
+        power_log_phase(POWER_PHASE_WIFI, true);
+        wifi_ensure_connected();
+        power_log_phase(POWER_PHASE_WIFI, false);
+        profiler_stop(PROF_WIFI_JOIN, join_span);
+    }
+    if (WiFi.status() != WL_CONNECTED) {
+#if DEBUG_SERIAL
+        Serial.println("[MQTT] Skip broker reconnect: WiFi not connected");
+#endif
+        return false;
+    }
+    // WiFi is up anyway: let NTP discipline the clock (answer is
+    // picked up by mqtt_control_process()).
+    rtc_clock_ntp_start();
+
+    const char *user = (strlen(MQTT_BROKER_USER) > 0) ? MQTT_BROKER_USER : nullptr;
+    const char *password = (user != nullptr) ? MQTT_BROKER_PASSWORD : nullptr;
+    const int64_t connect_span = profiler_start();
+    power_log_phase(POWER_PHASE_MQTT, true);
+    char client_id[sizeof(MQTT_CLIENT_ID_PREFIX) + DEVICE_ID_LEN];
+    snprintf(client_id, sizeof(client_id), MQTT_CLIENT_ID_PREFIX "%s", device_id());
+    const bool ok = s_mqtt.connect(client_id, user, password,
+                                   nullptr, 0, false, nullptr,
+                                   !MQTT_PERSISTENT_SESSION);  // cleanSession
 
     if (!ok) {
-#ifdef DEBUG_SERIAL
+#if DEBUG_SERIAL
         Serial.print("[MQTT] Broker connect failed, state=");
         Serial.println(s_mqtt.state());
 #endif
+        power_log_phase(POWER_PHASE_MQTT, false);
+        profiler_stop(PROF_MQTT_CONNECT, connect_span);
         mqtt_diag_mqtt_connect_fail();
-        return;
+        return false;
     }
 
-    s_mqtt.subscribe(MQTT_TOPIC_COMMAND);
-#ifdef DEBUG_SERIAL
-    Serial.print("[MQTT] Broker connected, subscribed topic=");
-    Serial.println(MQTT_TOPIC_COMMAND);
+    // Re-subscribing is harmless with a persistent session and covers a
+    // broker that dropped it (restart without persistence, session expiry).
+    mqtt_link_subscribe_commands();
+    power_log_phase(POWER_PHASE_MQTT, false);
+    profiler_stop(PROF_MQTT_CONNECT, connect_span);
+#if DEBUG_SERIAL
+    Serial.print("[MQTT] Broker connected as ");
+    Serial.print(client_id);
+    Serial.print(s_group[0] != '\0' ? ", group=" : "");
+    Serial.println(s_group);
 #endif
     mqtt_diag_mqtt_connect_ok();
+    return true;
+}
+
+static bool mqtt_link_connected() {
+    return s_mqtt.connected();
+}
+
+static bool mqtt_link_publish(const char *topic, const uint8_t *payload, size_t len, bool retained) {
+    return s_mqtt.connected() && s_mqtt.publish(topic, payload, (unsigned int)len, retained);
+}
+
+static void mqtt_link_poll() {
+    if (s_mqtt.connected()) {
+        s_mqtt.loop();
+    }
+}
+
+static const ControlLink k_mqtt_link = {
+    "mqtt",
+    mqtt_link_connect,
+    mqtt_link_connected,
+    mqtt_link_publish,
+    mqtt_link_poll,
+};
+
+const ControlLink *control_link_mqtt() {
+    return &k_mqtt_link;
+}
+
+// =============================================================================
+// CONNECT
+// =============================================================================
+
+static void mqtt_connect_now() {
+    const bool ok = s_link->connect(on_control_message);
+    // Timestamp after the (potentially long) connect attempt to avoid
+    // immediate duplicate retries in the same wake cycle.
+    s_last_reconnect_ms = millis();
+    if (!ok) {
+#if CONTROL_TRANSPORT == CONTROL_TRANSPORT_WIFI
+        // A failed join or broker connect leaves STA mode on; switch the
+        // radio off for the rest of the wake (soak light sleep, deep
+        // sleep). The next connect attempt starts it again.
+        WiFi.disconnect(true);
+        WiFi.mode(WIFI_OFF);
+#endif
+        return;
+    }
+
     const uint32_t ts = storage_get_persistent_time();
     const bool deep_sleep_enabled = storage_get_deep_sleep_enabled();
     char msg[128];
-    snprintf(msg, sizeof(msg), "{\"plant\":\"%s\",\"state\":\"online\",\"ts\":%lu,\"deep_sleep\":%s}",
-             s_plant_name.c_str(),
+    // epoch: Unix time from the last NTP sync (0 until the first one)
+    snprintf(msg, sizeof(msg), "{\"plant\":\"%s\",\"state\":\"online\",\"ts\":%lu,\"epoch\":%lu,\"deep_sleep\":%s}",
+             s_plant_name,
              (unsigned long)ts,
+             (unsigned long)rtc_clock_epoch_now(),
              deep_sleep_enabled ? "true" : "false");
     mqtt_publish_status(msg);
+
+    // Awake marker: tells the host we are listening, so it can flush its
+    // pending commands and close the window with the end sentinel.
+    snprintf(msg, sizeof(msg), "{\"plant\":\"%s\",\"ts\":%lu,\"window_ms\":%lu,\"wake\":\"%s\"}",
+             s_plant_name,
+             (unsigned long)ts,
+             (unsigned long)MQTT_COMMAND_WINDOW_MS,
+             s_wake_token);
+    s_end_of_commands = false;
+    link_publish(MQTT_TOPIC_AWAKE, msg, false);
+}
+
+static void mqtt_try_reconnect() {
+    if (s_link->connected()) {
+        return;
+    }
+
+    const uint32_t now = millis();
+    if ((now - s_last_reconnect_ms) < MQTT_RECONNECT_MS) {
+        return;
+    }
+    mqtt_connect_now();
+}
+
+static void mqtt_setup_client() {
+    const char *persisted_name = storage_get_plant_name();
+    normalize_plant_name(Slice{persisted_name, strlen(persisted_name)}, s_plant_name, sizeof(s_plant_name));
+    strncpy(s_last_command_id, storage_get_last_command_id(), sizeof(s_last_command_id) - 1);
+    strncpy(s_group, storage_get_group(), sizeof(s_group) - 1);
+    snprintf(s_wake_token, sizeof(s_wake_token), "%08lx", (unsigned long)esp_random());
 }
 
 void mqtt_control_init() {
-    s_mqtt.setServer(MQTT_BROKER_HOST, MQTT_BROKER_PORT);
-    s_mqtt.setCallback(mqtt_callback);
-    WiFi.onEvent(on_wifi_event);
+    mqtt_setup_client();
+    mqtt_connect_now();
+}
 
-#ifdef DEBUG_SERIAL
-    Serial.println("[MQTT] WiFi strategy=attempts-v2");
+// =============================================================================
+// ASYNC BRING-UP
+// =============================================================================
+
+// The task never reads the measurement, battery or settings itself: the
+// main task is using the ADC meanwhile. Once connected it publishes the
+// snapshot the main task hands over (mqtt_control_publish_telemetry) as
+// soon as it arrives, or gives up when the main task starts waiting.
+static void mqtt_bringup_task(void *arg) {
+    (void)arg;
+    mqtt_connect_now();
+
+    TelemetrySnapshot snap;
+    while (s_first_publish_pending && !s_bringup_stop && s_link->connected()) {
+        if (xQueueReceive(s_snapshot_queue, &snap, pdMS_TO_TICKS(10)) == pdTRUE) {
+            s_first_publish_pending = false;
+            telemetry_publish(snap);
+        }
+    }
+
+#if DEBUG_SERIAL
+    Serial.print("[MQTT] Async bring-up finished in ");
+    Serial.print(millis() - s_bringup_start_ms);
+    Serial.print(s_link->connected() ? " ms (online" : " ms (offline");
+    Serial.println(s_first_publish_pending ? ")" : ", telemetry sent)");
 #endif
 
-    String persisted_name = storage_get_plant_name();
-    normalize_plant_name(persisted_name);
-    s_plant_name = persisted_name;
-    s_last_command_id = storage_get_last_command_id();
+    s_bringup_running = false;
+    vTaskDelete(nullptr);
+}
 
-    mqtt_try_reconnect();
+void mqtt_control_begin_async() {
+    mqtt_setup_client();
+    // Initialize what the bring-up task touches (diag LEDs) here, so lazy
+    // init never runs on two tasks at once.
+    hw_require(HW_LEDS);
+    if (s_snapshot_queue == nullptr) {
+        s_snapshot_queue = xQueueCreate(1, sizeof(TelemetrySnapshot));
+    }
+
+    s_bringup_start_ms = millis();
+    s_first_publish_pending = true;
+    s_bringup_stop = false;
+    s_bringup_running = true;
+    if (s_snapshot_queue == nullptr ||
+        xTaskCreate(mqtt_bringup_task, "mqtt_up", MQTT_BRINGUP_TASK_STACK,
+                    nullptr, 1, nullptr) != pdPASS) {
+        // No memory for the task: fall back to the blocking path.
+#if DEBUG_SERIAL
+        Serial.println("[MQTT] Bring-up task create failed, connecting inline");
+#endif
+        s_bringup_running = false;
+        mqtt_connect_now();
+    }
+}
+
+bool mqtt_control_wait_connected() {
+    s_bringup_stop = true;
+    while (s_bringup_running) {
+        delay(10);
+    }
+    // Nothing sent yet (snapshot handed over late, or never): publish now
+    if (s_first_publish_pending) {
+        TelemetrySnapshot snap;
+        if (s_snapshot_queue == nullptr || xQueueReceive(s_snapshot_queue, &snap, 0) != pdTRUE) {
+            telemetry_capture(&snap);
+        }
+        s_first_publish_pending = false;
+        telemetry_publish(snap);
+    }
+    return s_link->connected();
+}
+
+bool mqtt_control_radio_active() {
+    return s_bringup_running || s_link->connected();
+}
+
+void mqtt_control_set_power_save(bool on) {
+    s_wifi_power_save = on;
+    if (WiFi.status() == WL_CONNECTED) {
+        WiFi.setSleep(on ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE);
+    }
 }
 
 void mqtt_control_process() {
-    mqtt_try_reconnect();
-    if (s_mqtt.connected()) {
-        s_mqtt.loop();
+    if (s_bringup_running) {
+        return;
     }
+    mqtt_try_reconnect();
+    s_link->poll();
+    rtc_clock_ntp_poll();
 }
 
 void mqtt_control_process_for(uint32_t duration_ms) {
+    const int64_t window_span = profiler_start();
     const uint32_t start_ms = millis();
+    s_last_rx_ms = start_ms;
     while ((millis() - start_ms) < duration_ms) {
         mqtt_control_process();
+
+        // Leave early once the host has signalled the end of its queue, or
+        // nothing arrived for MQTT_COMMAND_IDLE_MS (host not running).
+        if (s_end_of_commands) {
+            break;
+        }
+        if ((millis() - s_last_rx_ms) >= MQTT_COMMAND_IDLE_MS) {
+            break;
+        }
         delay(10);
         yield();
     }
+
+#if DEBUG_SERIAL
+    Serial.print("[MQTT] Command window closed after ");
+    Serial.print(millis() - start_ms);
+    Serial.println(s_end_of_commands ? " ms (end sentinel)" : " ms (idle/limit)");
+#endif
+    profiler_stop(PROF_CMD_WINDOW, window_span);
+}
+
+#else
+
+bool mqtt_control_radio_active() {
+    return false;
 }
+
+#endif // CONTROL_HAS_MQTT
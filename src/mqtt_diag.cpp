@@ -2,10 +2,10 @@
 
 #include "leds.h"
 
+static const LedStep DIAG_WIFI_START[] = { LED_G(80) };
+
 void mqtt_diag_wifi_connect_start() {
-    led_green_on();
-    delay(80);
-    led_green_off();
+    leds_play_pattern(DIAG_WIFI_START, ARRAY_LEN(DIAG_WIFI_START), 0, 0);
 }
 
 void mqtt_diag_wifi_connect_ok() {
@@ -23,11 +23,11 @@ void mqtt_diag_wifi_status_code(int wifi_status) {
         count = (uint8_t)wifi_status + 1;
     }
 
-    delay(140);
+    leds_pause(140);
     led_green_blink(1, 220);
-    delay(140);
+    leds_pause(140);
     led_red_blink(count, 80);
-    delay(500);
+    leds_pause(500);
 }
 
 void mqtt_diag_mqtt_connect_ok() {
@@ -0,0 +1,343 @@
+/**
+ * ota_update.cpp - Resumable OTA firmware update implementation
+ *
+ * The update slot is written with the raw partition API instead of
+ * esp_ota_begin(), which would erase the whole slot on every wake and
+ * lose the progress. Every sector is erased right before it is written.
+ */
+
+#include "ota_update.h"
+#include "storage.h"
+#include "battery.h"
+#include <string.h>
+
+#if OTA_ENABLED
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "mbedtls/sha256.h"
+
+#define OTA_RETRY_MS  60000   // Pause after a transient error (always-on mode)
+
+static uint8_t s_chunk[OTA_CHUNK_SIZE];
+static uint32_t s_retry_after_ms = 0;
+static bool s_retry_wait = false;
+static uint8_t s_confirm_failures = 0;   // offline wakes of a pending image, this boot
+
+// The Arduino core confirms a pending image right at boot unless this
+// returns true; ota_update_confirm() does it after the health check.
+extern "C" bool verifyRollbackLater() {
+    return true;
+}
+
+// =============================================================================
+// FLASH
+// =============================================================================
+
+static bool write_sector(const esp_partition_t *part, uint32_t offset, const uint8_t *data, size_t len) {
+    return esp_partition_erase_range(part, offset, OTA_CHUNK_SIZE) == ESP_OK &&
+           esp_partition_write(part, offset, data, len) == ESP_OK;
+}
+
+// Hash what actually landed in flash, not what was received.
+static bool image_hash_matches(const esp_partition_t *part, uint32_t size, const uint8_t expected[32]) {
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    bool ok = true;
+    for (uint32_t offset = 0; offset < size && ok; offset += OTA_CHUNK_SIZE) {
+        const size_t len = (size - offset < OTA_CHUNK_SIZE) ? (size_t)(size - offset) : OTA_CHUNK_SIZE;
+        ok = esp_partition_read(part, offset, s_chunk, len) == ESP_OK;
+        if (ok) {
+            mbedtls_sha256_update(&ctx, s_chunk, len);
+        }
+    }
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&ctx, digest);
+    mbedtls_sha256_free(&ctx);
+    return ok && memcmp(digest, expected, sizeof(digest)) == 0;
+}
+
+// =============================================================================
+// JOB
+// =============================================================================
+
+bool ota_update_queue(const char *url, size_t url_len, const uint8_t sha256[32]) {
+    if (url_len == 0 || url_len > OTA_URL_MAX_LEN) {
+        return false;
+    }
+    StorageOtaJob job = {};
+    memcpy(job.url, url, url_len);
+    job.url[url_len] = '\0';
+    memcpy(job.sha256, sha256, sizeof(job.sha256));
+    storage_set_ota_job(&job);
+    s_retry_wait = false;
+
+    #if DEBUG_SERIAL
+    Serial.print("[OTA] Queued ");
+    Serial.println(job.url);
+    #endif
+    return true;
+}
+
+bool ota_update_pending() {
+    return storage_get_ota_job()->url[0] != '\0';
+}
+
+bool ota_update_due() {
+    return ota_update_pending() &&
+           !(s_retry_wait && (int32_t)(millis() - s_retry_after_ms) < 0);
+}
+
+static OtaStatus fail(const char *reason, const char **detail) {
+    storage_set_ota_job(nullptr);
+    storage_commit();
+    *detail = reason;
+    #if DEBUG_SERIAL
+    Serial.print("[OTA] Failed: ");
+    Serial.println(reason);
+    #endif
+    return OTA_FAILED;
+}
+
+static OtaStatus retry_later(const char *reason, const char **detail) {
+    storage_commit();
+    s_retry_wait = true;
+    s_retry_after_ms = millis() + OTA_RETRY_MS;
+    *detail = reason;
+    #if DEBUG_SERIAL
+    Serial.print("[OTA] Paused: ");
+    Serial.println(reason);
+    #endif
+    return OTA_IN_PROGRESS;
+}
+
+// =============================================================================
+// DOWNLOAD
+// =============================================================================
+
+OtaStatus ota_update_service(uint32_t budget_ms, OtaProgressFn on_progress, const char **detail) {
+    const char *unused;
+    if (detail == nullptr) {
+        detail = &unused;
+    }
+    *detail = "idle";
+    if (!ota_update_pending()) {
+        return OTA_IDLE;
+    }
+    if (!ota_update_due()) {
+        *detail = "waiting";
+        return OTA_IN_PROGRESS;
+    }
+    s_retry_wait = false;
+    if (WiFi.status() != WL_CONNECTED) {
+        *detail = "offline";
+        return OTA_IN_PROGRESS;
+    }
+    if (battery_read_voltage_mv() < OTA_MIN_BATTERY_MV) {
+        return retry_later("battery_low", detail);
+    }
+
+    const esp_partition_t *part = esp_ota_get_next_update_partition(nullptr);
+    if (part == nullptr) {
+        return fail("no_ota_slot", detail);
+    }
+
+    const StorageOtaJob *job = storage_get_ota_job();
+    uint32_t offset = job->offset;
+    const bool https = strncmp(job->url, "https://", 8) == 0;
+    if (!https && strncmp(job->url, "http://", 7) != 0) {
+        return fail("invalid_url", detail);
+    }
+
+    WiFiClient plain;
+    WiFiClientSecure secure;
+    if (https) {
+        const char *ca = OTA_CA_CERT;
+        if (ca != nullptr) {
+            secure.setCACert(ca);
+        } else {
+            secure.setInsecure();   // integrity comes from the SHA-256
+        }
+    }
+    WiFiClient &client = https ? static_cast<WiFiClient &>(secure) : plain;
+
+    HTTPClient http;
+    http.setTimeout(OTA_HTTP_TIMEOUT_MS);
+    if (!http.begin(client, String(job->url))) {
+        return fail("invalid_url", detail);
+    }
+    if (offset > 0) {
+        http.addHeader("Range", "bytes=" + String(offset) + "-");
+    }
+
+    const int code = http.GET();
+    if (code >= 400 && code < 500) {
+        http.end();
+        return fail("http_error", detail);
+    }
+    if (code != HTTP_CODE_OK && code != HTTP_CODE_PARTIAL_CONTENT) {
+        http.end();
+        return retry_later("http_unavailable", detail);
+    }
+    if (code == HTTP_CODE_OK) {
+        offset = 0;   // server ignored the range: start over
+    }
+    const int remaining = http.getSize();
+    if (remaining <= 0) {
+        http.end();
+        return fail("no_length", detail);
+    }
+    const uint32_t total = offset + (uint32_t)remaining;
+    if (total > part->size) {
+        http.end();
+        return fail("too_large", detail);
+    }
+    if (job->size != 0 && job->size != total) {
+        // Different file behind the URL: restart it from scratch
+        storage_set_ota_progress(0, 0);
+        http.end();
+        return retry_later("size_changed", detail);
+    }
+    storage_set_ota_progress(offset, total);
+
+    #if DEBUG_SERIAL
+    Serial.print("[OTA] Downloading from ");
+    Serial.print(offset);
+    Serial.print(" of ");
+    Serial.println(total);
+    #endif
+
+    WiFiClient *stream = http.getStreamPtr();
+    stream->setTimeout(OTA_HTTP_TIMEOUT_MS);
+    const uint32_t start_ms = millis();
+    size_t fill = 0;
+    while (offset < total && millis() - start_ms < budget_ms) {
+        const uint32_t left = total - offset - (uint32_t)fill;
+        const size_t want = (left < OTA_CHUNK_SIZE - fill) ? (size_t)left : OTA_CHUNK_SIZE - fill;
+        const size_t got = stream->readBytes(s_chunk + fill, want);
+        if (got == 0) {
+            break;   // stalled or closed: resume from the last full sector
+        }
+        fill += got;
+        if (fill == OTA_CHUNK_SIZE || offset + fill == total) {
+            if (!write_sector(part, offset, s_chunk, fill)) {
+                http.end();
+                return fail("flash_error", detail);
+            }
+            offset += (uint32_t)fill;
+            fill = 0;
+            storage_set_ota_progress(offset, total);
+            if (on_progress != nullptr) {
+                on_progress(offset, total);
+            }
+        }
+    }
+    http.end();
+
+    if (offset < total) {
+        storage_commit();   // progress survives a brown-out before sleep
+        *detail = "downloading";
+        return OTA_IN_PROGRESS;
+    }
+
+    if (!image_hash_matches(part, total, job->sha256)) {
+        return fail("hash_mismatch", detail);
+    }
+    if (esp_ota_set_boot_partition(part) != ESP_OK) {
+        return fail("invalid_image", detail);
+    }
+    storage_set_ota_job(nullptr);
+    storage_commit();
+    *detail = "rebooting";
+
+    #if DEBUG_SERIAL
+    Serial.println("[OTA] Image verified, boot slot switched");
+    #endif
+    return OTA_READY;
+}
+
+// =============================================================================
+// BOOT CONFIRMATION
+// =============================================================================
+
+bool ota_update_verify_pending() {
+    esp_ota_img_states_t state;
+    return esp_ota_get_state_partition(esp_ota_get_running_partition(), &state) == ESP_OK &&
+           state == ESP_OTA_IMG_PENDING_VERIFY;
+}
+
+bool ota_update_confirm(bool healthy) {
+    if (!ota_update_verify_pending()) {
+        return false;
+    }
+    if (healthy) {
+        esp_ota_mark_app_valid_cancel_rollback();
+        #if DEBUG_SERIAL
+        Serial.println("[OTA] New image confirmed");
+        #endif
+        return true;
+    }
+
+    // An offline wake (no WiFi or broker) says nothing about the image:
+    // it stays pending, so any reset (crash, watchdog, power loss) still
+    // boots the previous one, and the caller keeps it out of deep sleep.
+    // The count lives in RAM, a pending image never survives a reset.
+    s_confirm_failures++;
+    if (s_confirm_failures < OTA_CONFIRM_ATTEMPTS) {
+        #if DEBUG_SERIAL
+        Serial.print("[OTA] New image offline, attempt ");
+        Serial.print(s_confirm_failures);
+        Serial.print("/");
+        Serial.println(OTA_CONFIRM_ATTEMPTS);
+        #endif
+        return false;
+    }
+
+    #if DEBUG_SERIAL
+    Serial.println("[OTA] New image failed its health check, rolling back");
+    Serial.flush();
+    #endif
+    storage_close();
+    esp_ota_mark_app_invalid_rollback_and_reboot();
+    return false;
+}
+
+#else  // !OTA_ENABLED
+
+bool ota_update_queue(const char *url, size_t url_len, const uint8_t sha256[32]) {
+    (void)url;
+    (void)url_len;
+    (void)sha256;
+    return false;
+}
+
+bool ota_update_pending() {
+    return false;
+}
+
+bool ota_update_due() {
+    return false;
+}
+
+OtaStatus ota_update_service(uint32_t budget_ms, OtaProgressFn on_progress, const char **detail) {
+    (void)budget_ms;
+    (void)on_progress;
+    if (detail != nullptr) {
+        *detail = "disabled";
+    }
+    return OTA_IDLE;
+}
+
+bool ota_update_verify_pending() {
+    return false;
+}
+
+bool ota_update_confirm(bool healthy) {
+    (void)healthy;
+    return false;
+}
+
+#endif // OTA_ENABLED
@@ -0,0 +1,240 @@
+/**
+ * power_log.cpp - Streaming power logger implementation
+ *
+ * The ADC stream task calls on_sample() for every conversion. Battery
+ * conversions pace the output: every POWER_LOG_DECIMATE of them close one
+ * set (mean of each logged channel since the last set), and a frame goes
+ * out when it holds POWER_LOG_FRAME_SETS sets or the phase flags change.
+ * All frame building happens in the stream task; other tasks only touch
+ * the phase counters.
+ */
+
+#include "power_log.h"
+
+#if POWER_LOG_ENABLED
+
+#include "adc_sampler.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+
+#define POWER_LOG_CHANNELS      (1 + POWER_LOG_HAS_SENSE)
+#define POWER_LOG_DECIMATE      (ADC_SAMPLER_RATE_HZ / ADC_CH_COUNT / POWER_LOG_RATE_HZ)
+#define POWER_LOG_INFO_EVERY    256
+#define POWER_LOG_SERIAL_BAUD   115200
+
+#define FRAME_HEADER_BYTES      8      // sync, version, type, seq, len
+#define FRAME_DATA_HEAD_BYTES   8      // t_us, phases, channels, sets, pad
+#define FRAME_CRC_BYTES         2
+#define FRAME_MAX_BYTES         (FRAME_HEADER_BYTES + FRAME_DATA_HEAD_BYTES + \
+                                 POWER_LOG_FRAME_SETS * POWER_LOG_CHANNELS * 2 + FRAME_CRC_BYTES)
+
+// ADC reference voltage in millivolts (11 dB attenuation), as in battery.cpp
+#define ADC_REF_VOLTAGE_MV      3300
+
+static volatile bool s_running = false;
+static bool s_serial_ready = false;
+
+// Phase counters (any task) and the mask derived from them
+static portMUX_TYPE s_phase_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t s_phase_count[8];
+static volatile uint8_t s_phases = 0;
+
+// Stream task state
+static uint32_t s_sum[POWER_LOG_CHANNELS];
+static uint16_t s_n[POWER_LOG_CHANNELS];
+static uint16_t s_last_mv[POWER_LOG_CHANNELS];
+static uint8_t  s_frame[FRAME_MAX_BYTES];
+static uint8_t  s_sets = 0;
+static uint8_t  s_frame_phases = 0;
+static uint32_t s_frame_t_us = 0;
+static uint16_t s_seq = 0;
+
+// =============================================================================
+// FRAME ENCODING
+// =============================================================================
+
+static void put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+// CRC-16/CCITT-FALSE
+static uint16_t crc16(const uint8_t *data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    while (len--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (uint8_t b = 0; b < 8; ++b) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// Header + crc around payload_len bytes already at s_frame + header.
+// Dropped (sequence number still used) if the USB buffer is full.
+static void send_frame(PowerFrameType type, uint16_t payload_len) {
+    s_frame[0] = POWER_LOG_SYNC0;
+    s_frame[1] = POWER_LOG_SYNC1;
+    s_frame[2] = POWER_LOG_VERSION;
+    s_frame[3] = (uint8_t)type;
+    put_u16(&s_frame[4], s_seq++);
+    put_u16(&s_frame[6], payload_len);
+    const size_t body = FRAME_HEADER_BYTES + payload_len;
+    put_u16(&s_frame[body], crc16(&s_frame[2], body - 2));
+
+    const size_t len = body + FRAME_CRC_BYTES;
+    if ((size_t)Serial.availableForWrite() >= len) {
+        Serial.write(s_frame, len);
+    }
+}
+
+static void send_info() {
+    uint8_t *p = &s_frame[FRAME_HEADER_BYTES];
+    put_u32(p, POWER_LOG_RATE_HZ);
+    p[4] = POWER_LOG_CHANNELS;
+    p[5] = POWER_KIND_BATTERY_MV;
+#if POWER_LOG_HAS_SENSE
+    p[6] = POWER_KIND_SENSE_MV;
+#endif
+    send_frame(POWER_FRAME_INFO, (uint16_t)(5 + POWER_LOG_CHANNELS));
+}
+
+static void flush_data() {
+    if (s_sets == 0) {
+        return;
+    }
+    uint8_t *p = &s_frame[FRAME_HEADER_BYTES];
+    put_u32(p, s_frame_t_us);
+    p[4] = s_frame_phases;
+    p[5] = POWER_LOG_CHANNELS;
+    p[6] = s_sets;
+    p[7] = 0;
+    send_frame(POWER_FRAME_DATA,
+               (uint16_t)(FRAME_DATA_HEAD_BYTES + s_sets * POWER_LOG_CHANNELS * 2));
+    s_sets = 0;
+
+    if ((s_seq % POWER_LOG_INFO_EVERY) == 0) {
+        send_info();
+    }
+}
+
+// =============================================================================
+// SAMPLING
+// =============================================================================
+
+static uint16_t raw_to_mv(uint8_t idx, uint32_t raw) {
+    const uint32_t mv = (raw * ADC_REF_VOLTAGE_MV) / ADC_MAX_VALUE;
+    return (idx == 0) ? (uint16_t)(mv * BATTERY_DIVIDER_RATIO) : (uint16_t)mv;
+}
+
+static void close_set() {
+    const uint8_t phases = s_phases;
+    if (s_sets > 0 && phases != s_frame_phases) {
+        flush_data();
+    }
+    if (s_sets == 0) {
+        s_frame_t_us = (uint32_t)esp_timer_get_time();
+        s_frame_phases = phases;
+    }
+
+    uint8_t *out = &s_frame[FRAME_HEADER_BYTES + FRAME_DATA_HEAD_BYTES +
+                            s_sets * POWER_LOG_CHANNELS * 2];
+    for (uint8_t i = 0; i < POWER_LOG_CHANNELS; ++i) {
+        if (s_n[i] > 0) {
+            s_last_mv[i] = raw_to_mv(i, s_sum[i] / s_n[i]);
+        }
+        put_u16(out + i * 2, s_last_mv[i]);
+        s_sum[i] = 0;
+        s_n[i] = 0;
+    }
+    if (++s_sets == POWER_LOG_FRAME_SETS) {
+        flush_data();
+    }
+}
+
+static void on_sample(AdcChannel ch, uint16_t raw) {
+    uint8_t idx;
+    if (ch == ADC_CH_BATTERY) {
+        idx = 0;
+#if POWER_LOG_HAS_SENSE
+    } else if (ch == ADC_CH_POWER_SENSE) {
+        idx = 1;
+#endif
+    } else {
+        return;
+    }
+    s_sum[idx] += raw;
+    s_n[idx]++;
+    if (idx == 0 && s_n[0] >= POWER_LOG_DECIMATE) {
+        close_set();
+    }
+}
+
+// =============================================================================
+// API
+// =============================================================================
+
+bool power_log_start() {
+    if (s_running) {
+        return true;
+    }
+    if (!s_serial_ready) {
+        Serial.begin(POWER_LOG_SERIAL_BAUD);
+        s_serial_ready = true;
+    }
+    memset(s_sum, 0, sizeof(s_sum));
+    memset(s_n, 0, sizeof(s_n));
+    s_sets = 0;
+    send_info();   // before the stream task owns s_frame
+
+    s_running = adc_sampler_stream_start(on_sample);
+    return s_running;
+}
+
+void power_log_stop() {
+    if (!s_running) {
+        return;
+    }
+    adc_sampler_stream_stop();
+    s_running = false;
+    flush_data();
+    Serial.flush();
+}
+
+void power_log_phase(PowerPhase phase, bool active) {
+    const uint8_t bit = (uint8_t)__builtin_ctz((unsigned)phase);
+    portENTER_CRITICAL(&s_phase_mux);
+    if (active) {
+        if (s_phase_count[bit] != UINT8_MAX) s_phase_count[bit]++;
+    } else if (s_phase_count[bit] > 0) {
+        s_phase_count[bit]--;
+    }
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < 8; ++i) {
+        if (s_phase_count[i] > 0) mask |= (uint8_t)(1u << i);
+    }
+    s_phases = mask;
+    portEXIT_CRITICAL(&s_phase_mux);
+}
+
+#else // !POWER_LOG_ENABLED
+
+bool power_log_start() {
+    return false;
+}
+
+void power_log_stop() {
+}
+
+void power_log_phase(PowerPhase phase, bool active) {
+    (void)phase;
+    (void)active;
+}
+
+#endif // POWER_LOG_ENABLED
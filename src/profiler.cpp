@@ -0,0 +1,172 @@
+/**
+ * profiler.cpp - Wake-cycle span profiler implementation
+ *
+ * The current wake accumulates in RAM under a spinlock (spans arrive from
+ * the main task and the MQTT bring-up task); profiler_finish_wake() copies
+ * it into the RTC ring, overwriting the oldest record when full.
+ */
+
+#include "profiler.h"
+#include "storage.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+
+#define PROFILE_MAGIC  0x50524F32UL   // "PRO2"
+
+typedef struct {
+    uint32_t magic;
+    uint8_t  head;     // oldest record
+    uint8_t  count;
+    ProfileRecord records[PROFILE_HISTORY];
+} ProfileHistory;
+
+static RTC_DATA_ATTR ProfileHistory s_hist;
+
+static ProfileRecord s_wake;
+static portMUX_TYPE s_prof_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *const SPAN_NAMES[PROF_SPAN_COUNT] = {
+    "init", "sensor", "battery", "wifi", "mqtt", "cmd_window", "pump", "soak"
+};
+
+// Extra supply current of each span on top of PROFILE_UA_AWAKE
+static const uint32_t SPAN_EXTRA_UA[PROF_SPAN_COUNT] = {
+    0,
+    PROFILE_UA_SENSOR,
+    PROFILE_UA_BATTERY,
+    PROFILE_UA_WIFI_JOIN,
+    PROFILE_UA_MQTT_CONNECT,
+    PROFILE_UA_CMD_WINDOW,
+    PROFILE_UA_PUMP,
+    0                      // soak: handled separately, replaces awake current
+};
+
+// =============================================================================
+// RECORDING
+// =============================================================================
+
+void profiler_mark_setup() {
+#if PROFILER_ENABLED
+    portENTER_CRITICAL(&s_prof_mux);
+    s_wake.setup_us = (uint32_t)esp_timer_get_time();
+    portEXIT_CRITICAL(&s_prof_mux);
+#endif
+}
+
+int64_t profiler_start() {
+    return esp_timer_get_time();
+}
+
+void profiler_add(ProfileSpan span, uint32_t duration_us) {
+#if PROFILER_ENABLED
+    if (span >= PROF_SPAN_COUNT) {
+        return;
+    }
+    portENTER_CRITICAL(&s_prof_mux);
+    s_wake.span_us[span] += duration_us;
+    if (s_wake.span_n[span] != UINT16_MAX) {
+        s_wake.span_n[span]++;
+    }
+    portEXIT_CRITICAL(&s_prof_mux);
+#else
+    (void)span;
+    (void)duration_us;
+#endif
+}
+
+void profiler_stop(ProfileSpan span, int64_t start_us) {
+    profiler_add(span, (uint32_t)(esp_timer_get_time() - start_us));
+}
+
+// =============================================================================
+// WAKE HISTORY
+// =============================================================================
+
+void profiler_finish_wake() {
+#if PROFILER_ENABLED
+    if (s_hist.magic != PROFILE_MAGIC || s_hist.count > PROFILE_HISTORY ||
+        s_hist.head >= PROFILE_HISTORY) {
+        memset(&s_hist, 0, sizeof(s_hist));
+        s_hist.magic = PROFILE_MAGIC;
+    }
+
+    portENTER_CRITICAL(&s_prof_mux);
+    ProfileRecord rec = s_wake;
+    memset(&s_wake, 0, sizeof(s_wake));
+    portEXIT_CRITICAL(&s_prof_mux);
+    rec.boot = storage_get_boot_count();
+    rec.awake_us = (uint32_t)esp_timer_get_time();
+
+    if (s_hist.count == PROFILE_HISTORY) {
+        s_hist.head = (uint8_t)((s_hist.head + 1) % PROFILE_HISTORY);   // drop oldest
+        s_hist.count--;
+    }
+    s_hist.records[(s_hist.head + s_hist.count) % PROFILE_HISTORY] = rec;
+    s_hist.count++;
+
+    #if DEBUG_SERIAL
+    Serial.print("[PROF] awake=");
+    Serial.print(rec.awake_us / 1000);
+    Serial.print("ms setup=");
+    Serial.print(rec.setup_us);
+    Serial.print("us");
+    for (uint8_t i = 0; i < PROF_SPAN_COUNT; ++i) {
+        if (rec.span_n[i] == 0) {
+            continue;
+        }
+        Serial.print(' ');
+        Serial.print(SPAN_NAMES[i]);
+        Serial.print('=');
+        Serial.print(rec.span_us[i] / 1000);
+        Serial.print("ms/");
+        Serial.print(rec.span_n[i]);
+    }
+    Serial.print(" charge=");
+    Serial.print(profiler_charge_uah(&rec));
+    Serial.println("uAh");
+    #endif
+#endif
+}
+
+uint16_t profiler_drain(ProfileSink sink) {
+    if (s_hist.magic != PROFILE_MAGIC) {
+        return 0;
+    }
+    uint16_t sent = 0;
+    while (s_hist.count > 0) {
+        if (!sink(&s_hist.records[s_hist.head])) {
+            break;
+        }
+        s_hist.head = (uint8_t)((s_hist.head + 1) % PROFILE_HISTORY);
+        s_hist.count--;
+        sent++;
+    }
+    return sent;
+}
+
+// =============================================================================
+// REPORTING
+// =============================================================================
+
+uint64_t profiler_charge_ua_us(const ProfileRecord *record) {
+    const uint32_t soak_us = record->span_us[PROF_SOAK];
+    const uint32_t active_us = (record->awake_us > soak_us) ? record->awake_us - soak_us : 0;
+
+    uint64_t ua_us = (uint64_t)active_us * PROFILE_UA_AWAKE +
+                     (uint64_t)soak_us * PROFILE_UA_SOAK_SLEEP;
+    for (uint8_t i = 0; i < PROF_SPAN_COUNT; ++i) {
+        ua_us += (uint64_t)record->span_us[i] * SPAN_EXTRA_UA[i];
+    }
+    return ua_us;
+}
+
+uint32_t profiler_charge_uah(const ProfileRecord *record) {
+    // 1 uAh = 3.6e9 uA*us
+    return (uint32_t)(profiler_charge_ua_us(record) / 3600000000ULL);
+}
+
+const char *profiler_span_name(ProfileSpan span) {
+    return (span < PROF_SPAN_COUNT) ? SPAN_NAMES[span] : "?";
+}
@@ -5,22 +5,27 @@
 #include "pump.h"
 #include "config.h"
 
-// Track pump state
-static bool pump_running = false;
+// Track pump state, one bit per channel
+static uint8_t pump_running_mask = 0;
+
+static gpio_num_t pump_pin(uint8_t ch) {
+    return PLANT_CHANNELS[(ch < PLANT_CHANNEL_COUNT) ? ch : 0].pump_pin;
+}
 
 // =============================================================================
 // INITIALIZATION
 // =============================================================================
 
 void pump_init() {
-    // Configure pump control pin as output
-    pinMode(PIN_PUMP, OUTPUT);
-
-    // Ensure pump starts OFF (LOW = MOSFET off = pump off)
-    digitalWrite(PIN_PUMP, LOW);
-    pump_running = false;
+    // Configure every channel's pump pin as output, starting OFF
+    // (LOW = MOSFET off = pump off)
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        pinMode(pump_pin(ch), OUTPUT);
+        digitalWrite(pump_pin(ch), LOW);
+    }
+    pump_running_mask = 0;
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.println("[PUMP] Initialized");
     #endif
 }
@@ -29,21 +34,23 @@ void pump_init() {
 // BASIC CONTROL
 // =============================================================================
 
-void pump_on() {
-    digitalWrite(PIN_PUMP, HIGH);  // HIGH = MOSFET on = pump runs
-    pump_running = true;
+void pump_on(uint8_t ch) {
+    digitalWrite(pump_pin(ch), HIGH);  // HIGH = MOSFET on = pump runs
+    pump_running_mask |= (uint8_t)(1u << ch);
     
-    #ifdef DEBUG_SERIAL
-    Serial.println("[PUMP] Turned ON");
+    #if DEBUG_SERIAL
+    Serial.print("[PUMP] Turned ON ch");
+    Serial.println(ch);
     #endif
 }
 
-void pump_off() {
-    digitalWrite(PIN_PUMP, LOW);   // LOW = MOSFET off = pump stops
-    pump_running = false;
+void pump_off(uint8_t ch) {
+    digitalWrite(pump_pin(ch), LOW);   // LOW = MOSFET off = pump stops
+    pump_running_mask &= (uint8_t)~(1u << ch);
     
-    #ifdef DEBUG_SERIAL
-    Serial.println("[PUMP] Turned OFF");
+    #if DEBUG_SERIAL
+    Serial.print("[PUMP] Turned OFF ch");
+    Serial.println(ch);
     #endif
 }
 
@@ -51,10 +58,10 @@ void pump_off() {
 // TIMED OPERATION
 // =============================================================================
 
-bool pump_run_timed(uint32_t duration_ms) {
+bool pump_run_timed(uint8_t ch, uint32_t duration_ms) {
     // Enforce safety maximum
     if (duration_ms > PUMP_MAX_DURATION_MS) {
-        #ifdef DEBUG_SERIAL
+        #if DEBUG_SERIAL
         Serial.print("[PUMP] Duration capped to ");
         Serial.print(PUMP_MAX_DURATION_MS);
         Serial.println(" ms");
@@ -62,14 +69,14 @@ bool pump_run_timed(uint32_t duration_ms) {
         duration_ms = PUMP_MAX_DURATION_MS;
     }
 
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.print("[PUMP] Running for ");
     Serial.print(duration_ms);
     Serial.println(" ms");
     #endif
 
     // Start pump
-    pump_on();
+    pump_on(ch);
 
     // Wait for duration (simple blocking delay)
     uint32_t start_time = millis();
@@ -79,29 +86,43 @@ bool pump_run_timed(uint32_t duration_ms) {
     }
 
     // Stop pump
-    pump_off();
+    pump_off(ch);
 
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.println("[PUMP] Run complete");
     #endif
 
     return true;
 }
 
+uint32_t pump_volume_ms(uint32_t volume_ul, uint16_t supply_mv) {
+    if (supply_mv == 0) {
+        supply_mv = PUMP_FLOW_REF_MV;
+    }
+    uint64_t flow_ul_per_s = ((uint64_t)PUMP_FLOW_UL_PER_S * supply_mv) / PUMP_FLOW_REF_MV;
+    if (flow_ul_per_s == 0) {
+        flow_ul_per_s = 1;
+    }
+    const uint64_t ms = ((uint64_t)volume_ul * 1000ULL + flow_ul_per_s - 1) / flow_ul_per_s;
+    return (ms > PUMP_MAX_DURATION_MS) ? PUMP_MAX_DURATION_MS : (uint32_t)ms;
+}
+
 // =============================================================================
 // SAFETY
 // =============================================================================
 
 void pump_emergency_stop() {
-    // Immediately stop pump, no checks
-    digitalWrite(PIN_PUMP, LOW);
-    pump_running = false;
+    // Immediately stop every pump, no checks
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        digitalWrite(pump_pin(ch), LOW);
+    }
+    pump_running_mask = 0;
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.println("[PUMP] EMERGENCY STOP");
     #endif
 }
 
 bool pump_is_running() {
-    return pump_running;
+    return pump_running_mask != 0;
 }
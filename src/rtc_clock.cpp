@@ -0,0 +1,216 @@
+/**
+ * rtc_clock.cpp - Persistent clock implementation
+ *
+ * Persistent time = anchor_ms + corrected RTC time since the anchor. An
+ * NTP sync re-anchors at the current (corrected) reading, so persistent
+ * time never steps; the difference to Unix time goes into epoch_offset_ms.
+ *
+ * Drift: RTC span vs. NTP span between the reference sync and a sync at
+ * least CLOCK_DRIFT_MIN_SPAN_SEC later, smoothed with an EMA. The SNTP
+ * callback runs in the lwIP task and only captures the RTC reading; the
+ * math happens in rtc_clock_ntp_poll() on the main task.
+ */
+
+#include "rtc_clock.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp32c3/rtc.h"
+#include "freertos/FreeRTOS.h"
+#if CLOCK_NTP_ENABLED
+#include "esp_sntp.h"
+#endif
+
+#define RTC_CLOCK_MAGIC  0x52434C31UL   // "RCL1"
+
+typedef struct {
+    uint32_t magic;
+    int32_t  drift_ppm;          // positive: RTC runs fast
+    bool     drift_valid;
+    bool     synced;             // epoch_offset_ms / last_sync_us valid
+    bool     ref_valid;
+    uint64_t anchor_rtc_us;      // raw RTC timer at the anchor
+    uint64_t anchor_ms;          // persistent time at the anchor
+    uint64_t ref_rtc_us;         // raw RTC timer at the drift reference sync
+    int64_t  ref_epoch_ms;       // NTP time at the drift reference sync
+    int64_t  epoch_offset_ms;    // Unix ms - persistent ms
+    uint64_t last_sync_us;       // raw RTC timer at the last sync
+} RtcClockState;
+
+static RTC_DATA_ATTR RtcClockState s_clk;
+
+// Filled by the SNTP callback, consumed by rtc_clock_ntp_poll()
+static portMUX_TYPE s_sync_mux = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool s_sync_pending = false;
+static uint64_t s_sync_rtc_us = 0;
+static int64_t s_sync_epoch_ms = 0;
+static bool s_ntp_started = false;
+
+// =============================================================================
+// TIME BASE
+// =============================================================================
+
+// RTC time since the anchor with the drift estimate removed. Split into
+// whole seconds and remainder so elapsed * ppm cannot overflow.
+static uint64_t corrected_elapsed_us(uint64_t rtc_us) {
+    const int64_t elapsed = (int64_t)(rtc_us - s_clk.anchor_rtc_us);
+    if (!s_clk.drift_valid) {
+        return (uint64_t)elapsed;
+    }
+    const int64_t ppm = s_clk.drift_ppm;
+    const int64_t correction = (elapsed / 1000000) * ppm + ((elapsed % 1000000) * ppm) / 1000000;
+    return (uint64_t)(elapsed - correction);
+}
+
+static uint64_t persistent_ms_at(uint64_t rtc_us) {
+    return s_clk.anchor_ms + corrected_elapsed_us(rtc_us) / 1000;
+}
+
+static void anchor_at(uint64_t rtc_us, uint64_t persistent_ms) {
+    s_clk.anchor_rtc_us = rtc_us;
+    s_clk.anchor_ms = persistent_ms;
+}
+
+// =============================================================================
+// API
+// =============================================================================
+
+void rtc_clock_init(uint32_t restored_sec) {
+    const uint64_t rtc_us = esp_rtc_get_time_us();
+    const bool valid = (s_clk.magic == RTC_CLOCK_MAGIC);
+    if (valid && esp_reset_reason() != ESP_RST_POWERON && rtc_us >= s_clk.anchor_rtc_us) {
+        return;   // RTC timer kept running: nothing to restore
+    }
+
+    // Power loss or RTC timer reset. The drift estimate describes the
+    // oscillator, not the timeline, so keep it if RTC memory survived.
+    if (!valid) {
+        s_clk.drift_ppm = 0;
+        s_clk.drift_valid = false;
+    }
+    anchor_at(rtc_us, (uint64_t)restored_sec * 1000);
+    s_clk.synced = false;
+    s_clk.ref_valid = false;
+    s_clk.epoch_offset_ms = 0;
+    s_clk.magic = RTC_CLOCK_MAGIC;
+
+    #if DEBUG_SERIAL
+    Serial.print("[CLOCK] Restarted at ");
+    Serial.print(restored_sec);
+    Serial.println(" s");
+    #endif
+}
+
+uint32_t rtc_clock_now_sec() {
+    return (uint32_t)(persistent_ms_at(esp_rtc_get_time_us()) / 1000);
+}
+
+void rtc_clock_reset(uint32_t sec) {
+    // The drift reference is raw RTC vs. NTP time and stays usable
+    anchor_at(esp_rtc_get_time_us(), (uint64_t)sec * 1000);
+    s_clk.synced = false;
+    s_clk.epoch_offset_ms = 0;
+}
+
+uint32_t rtc_clock_epoch_now() {
+    if (!s_clk.synced) {
+        return 0;
+    }
+    const int64_t ms = (int64_t)persistent_ms_at(esp_rtc_get_time_us()) + s_clk.epoch_offset_ms;
+    return (ms > 0) ? (uint32_t)(ms / 1000) : 0;
+}
+
+int32_t rtc_clock_drift_ppm() {
+    return s_clk.drift_valid ? s_clk.drift_ppm : 0;
+}
+
+// =============================================================================
+// NTP DISCIPLINE
+// =============================================================================
+
+#if CLOCK_NTP_ENABLED
+static void on_ntp_sync(struct timeval *tv) {
+    const uint64_t rtc_us = esp_rtc_get_time_us();
+    portENTER_CRITICAL(&s_sync_mux);
+    s_sync_rtc_us = rtc_us;
+    s_sync_epoch_ms = (int64_t)tv->tv_sec * 1000 + tv->tv_usec / 1000;
+    s_sync_pending = true;
+    portEXIT_CRITICAL(&s_sync_mux);
+}
+#endif
+
+void rtc_clock_ntp_start() {
+#if CLOCK_NTP_ENABLED
+    if (s_ntp_started) {
+        return;
+    }
+    if (s_clk.synced &&
+        (esp_rtc_get_time_us() - s_clk.last_sync_us) < (uint64_t)CLOCK_NTP_MIN_INTERVAL_SEC * 1000000ULL) {
+        return;
+    }
+    s_ntp_started = true;
+    sntp_set_time_sync_notification_cb(on_ntp_sync);
+    configTime(0, 0, CLOCK_NTP_SERVER);
+
+    #if DEBUG_SERIAL
+    Serial.println("[CLOCK] NTP sync requested");
+    #endif
+#endif
+}
+
+// Drift in ppm of the RTC span against the NTP span since the reference.
+// diff / span_seconds is microseconds per second, i.e. ppm.
+static bool measure_drift(uint64_t rtc_us, int64_t epoch_ms, int32_t *ppm) {
+    const int64_t true_us = (epoch_ms - s_clk.ref_epoch_ms) * 1000;
+    const int64_t rtc_span_us = (int64_t)(rtc_us - s_clk.ref_rtc_us);
+    const int64_t measured = (rtc_span_us - true_us) / (true_us / 1000000);
+    if (measured > CLOCK_DRIFT_MAX_PPM || measured < -CLOCK_DRIFT_MAX_PPM) {
+        return false;
+    }
+    *ppm = (int32_t)measured;
+    return true;
+}
+
+void rtc_clock_ntp_poll() {
+    if (!s_sync_pending) {
+        return;
+    }
+    portENTER_CRITICAL(&s_sync_mux);
+    const uint64_t rtc_us = s_sync_rtc_us;
+    const int64_t epoch_ms = s_sync_epoch_ms;
+    s_sync_pending = false;
+    portEXIT_CRITICAL(&s_sync_mux);
+
+    // Re-anchor with the old estimate, so the new one only applies from now
+    const uint64_t persistent_ms = persistent_ms_at(rtc_us);
+    anchor_at(rtc_us, persistent_ms);
+    s_clk.epoch_offset_ms = epoch_ms - (int64_t)persistent_ms;
+    s_clk.last_sync_us = rtc_us;
+    s_clk.synced = true;
+
+    // Short spans keep the old reference so the baseline keeps growing
+    const int64_t span_ms = epoch_ms - s_clk.ref_epoch_ms;
+    bool new_ref = !s_clk.ref_valid || span_ms < 0;
+    if (s_clk.ref_valid && span_ms >= (int64_t)CLOCK_DRIFT_MIN_SPAN_SEC * 1000) {
+        int32_t measured;
+        if (measure_drift(rtc_us, epoch_ms, &measured)) {
+            s_clk.drift_ppm = s_clk.drift_valid
+                ? s_clk.drift_ppm + ((measured - s_clk.drift_ppm) >> CLOCK_DRIFT_EMA_SHIFT)
+                : measured;
+            s_clk.drift_valid = true;
+        }
+        new_ref = true;
+    }
+    if (new_ref) {
+        s_clk.ref_rtc_us = rtc_us;
+        s_clk.ref_epoch_ms = epoch_ms;
+        s_clk.ref_valid = true;
+    }
+
+    #if DEBUG_SERIAL
+    Serial.print("[CLOCK] NTP sync, epoch=");
+    Serial.print((unsigned long)(epoch_ms / 1000));
+    Serial.print(" drift=");
+    Serial.print(rtc_clock_drift_ppm());
+    Serial.println(" ppm");
+    #endif
+}
@@ -5,16 +5,120 @@
 #include "sensor.h"
 #include "config.h"
 #include "storage.h"
+#include "adc_sampler.h"
+#include "hw_init.h"
+#include "profiler.h"
+#include "measurement.h"
+#include "esp_attr.h"
+#include <string.h>
+
+// =============================================================================
+// CALIBRATION CONTEXT
+// =============================================================================
+
+// Precomputed from the stored dry/wet values so the raw → percent
+// conversion costs a subtract, a multiply and a table load: no NVS
+// access and no divide per call.
+typedef struct {
+    uint16_t dry;              // raw at 0%
+    uint16_t wet;              // raw at 100%
+    uint32_t scale_q24;        // ceil((100 << 24) / |dry - wet|), 0 = degenerate
+    bool     inverted;         // dry > wet (capacitive sensor, normal case)
+#if SENSOR_CURVE_ENABLED
+    uint8_t  curve[101];       // linear % → reported %
+#endif
+} SensorCalibration;
+
+static SensorCalibration s_cal[PLANT_CHANNEL_COUNT];   // filled by sensor_calibration_reload()
+
+// =============================================================================
+// FILTER STATE (RTC memory, survives deep sleep)
+// =============================================================================
+
+#define SENSOR_FILTER_MAGIC  0x53464C31UL   // "SFL1"
+
+typedef struct {
+    uint32_t magic;
+    uint16_t ema_q4[PLANT_CHANNEL_COUNT];     // average << 4, 0 = no average yet
+    uint16_t last_raw[PLANT_CHANNEL_COUNT];   // previous decision reading
+    uint8_t  unchanged[PLANT_CHANNEL_COUNT];  // consecutive noise-free repeats
+    uint8_t  fault[PLANT_CHANNEL_COUNT];      // SensorFault
+} SensorFilterState;
+
+static RTC_DATA_ATTR SensorFilterState s_filter;
+
+static uint8_t clamp_channel(uint8_t ch) {
+    return (ch < PLANT_CHANNEL_COUNT) ? ch : 0;
+}
+
+#if SENSOR_CURVE_ENABLED
+static void build_curve_table(SensorCalibration &cal) {
+    const uint8_t n = (uint8_t)ARRAY_LEN(SENSOR_CURVE);
+    uint8_t seg = 0;
+    for (uint8_t x = 0; x <= 100; ++x) {
+        while (seg + 2 < n && x > SENSOR_CURVE[seg + 1].linear) {
+            seg++;
+        }
+        const SensorCurvePoint a = SENSOR_CURVE[seg];
+        const SensorCurvePoint b = SENSOR_CURVE[seg + 1];
+        int32_t y;
+        if (x <= a.linear)      y = a.percent;
+        else if (x >= b.linear) y = b.percent;
+        else y = a.percent + (int32_t)(x - a.linear) * (b.percent - a.percent) / (b.linear - a.linear);
+        cal.curve[x] = (uint8_t)constrain(y, 0, 100);
+    }
+}
+#endif
+
+static void calibration_load(uint8_t ch) {
+    SensorCalibration &cal = s_cal[ch];
+    cal.dry = storage_get_sensor_dry(ch);
+    cal.wet = storage_get_sensor_wet(ch);
+    cal.inverted = (cal.dry > cal.wet);
+
+    const uint32_t span = cal.inverted ? (uint32_t)(cal.dry - cal.wet)
+                                       : (uint32_t)(cal.wet - cal.dry);
+    // Q24, not Q16: the rounded-up scale then never lifts delta * scale
+    // into the next percent for 12-bit spans (delta * span < 2^24), so the
+    // result equals 100 * delta / span exactly.
+    cal.scale_q24 = (span == 0) ? 0 : (uint32_t)(((100ULL << 24) + span - 1) / span);
+
+#if SENSOR_CURVE_ENABLED
+    build_curve_table(cal);
+#endif
+
+    #if DEBUG_SERIAL
+    Serial.print("[SENSOR] Calibration ch");
+    Serial.print(ch);
+    Serial.print(" dry=");
+    Serial.print(cal.dry);
+    Serial.print(" wet=");
+    Serial.println(cal.wet);
+    #endif
+}
+
+void sensor_calibration_reload() {
+    if (!hw_ready(HW_SENSOR)) {
+        return;   // loaded on first use
+    }
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        calibration_load(ch);
+    }
+}
 
 // =============================================================================
 // INITIALIZATION
 // =============================================================================
 
 void sensor_init() {
-    // ADC resolution + attenuation are configured globally in init_hardware()
-    pinMode(PIN_SOIL_SENSOR, INPUT);
+    // Pin and ADC are configured by adc_sampler_init() on the first read
+    if (s_filter.magic != SENSOR_FILTER_MAGIC) {
+        memset(&s_filter, 0, sizeof(s_filter));
+        s_filter.magic = SENSOR_FILTER_MAGIC;
+    }
+    sensor_calibration_reload();
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.println("[SENSOR] Initialized");
     #endif
 }
@@ -23,110 +127,219 @@ void sensor_init() {
 // RAW READING
 // =============================================================================
 
-uint16_t sensor_read_raw() {
-    // Take multiple samples and average for noise reduction
-    uint32_t sum = 0;
-    
-    for (int i = 0; i < ADC_SAMPLES; i++) {
-        sum += analogRead(PIN_SOIL_SENSOR);
-        delayMicroseconds(100);  // Small delay between samples
-    }
+uint16_t sensor_read_raw(uint8_t ch) {
+    hw_require(HW_SENSOR);
+    // One DMA burst, reduced to reject outliers
+    const int64_t span = profiler_start();
+    uint16_t raw = adc_sampler_read(adc_soil_channel(clamp_channel(ch)), ADC_SAMPLER_SAMPLES, SENSOR_ADC_REDUCE);
+    profiler_stop(PROF_SENSOR, span);
     
-    uint16_t raw = (uint16_t)(sum / ADC_SAMPLES);
-    
-    #ifdef DEBUG_SERIAL
-    Serial.print("[SENSOR] Raw reading: ");
+    #if DEBUG_SERIAL
+    Serial.print("[SENSOR] Raw reading ch");
+    Serial.print(ch);
+    Serial.print(": ");
     Serial.println(raw);
     #endif
     
     return raw;
 }
 
+void sensor_read_raw_all(uint16_t raw[PLANT_CHANNEL_COUNT]) {
+    hw_require(HW_SENSOR);
+    // All soil channels in one scan pattern: a single ADC start/stop per wake
+    const int64_t span = profiler_start();
+    adc_sampler_read_group(ADC_CH_SOIL, PLANT_CHANNEL_COUNT, ADC_SAMPLER_SAMPLES, SENSOR_ADC_REDUCE, raw);
+    profiler_stop(PROF_SENSOR, span);
+
+    #if DEBUG_SERIAL
+    Serial.print("[SENSOR] Raw readings:");
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        Serial.print(' ');
+        Serial.print(raw[ch]);
+    }
+    Serial.println();
+    #endif
+}
+
+// =============================================================================
+// FILTERED READING
+// =============================================================================
+
+// Classify one decision reading; updates the stuck history of the channel.
+static SensorFault classify(uint8_t ch, uint16_t raw, uint16_t spread) {
+    if (raw < SENSOR_RAW_MIN || raw > SENSOR_RAW_MAX) {
+        return SENSOR_FAULT_DISCONNECTED;
+    }
+    if (spread > SENSOR_NOISE_MAX) {
+        return SENSOR_FAULT_NOISY;
+    }
+    // A live sensor always shows some ADC noise; a flat, unchanging
+    // burst wake after wake means the input is stuck.
+    const uint16_t last = s_filter.last_raw[ch];
+    const uint16_t delta = (raw > last) ? (raw - last) : (last - raw);
+    if (spread == 0 && delta <= SENSOR_STUCK_DELTA) {
+        if (s_filter.unchanged[ch] < UINT8_MAX) s_filter.unchanged[ch]++;
+    } else {
+        s_filter.unchanged[ch] = 0;
+    }
+    s_filter.last_raw[ch] = raw;
+    return (s_filter.unchanged[ch] >= SENSOR_STUCK_WAKES) ? SENSOR_FAULT_STUCK : SENSOR_OK;
+}
+
+static uint16_t average_update(uint8_t ch, uint16_t raw) {
+#if SENSOR_EMA_ENABLED
+    const int32_t x = (int32_t)raw << 4;
+    const int32_t ema = s_filter.ema_q4[ch];
+    if (ema == 0 || abs(x - ema) > ((int32_t)SENSOR_EMA_RESET_DELTA << 4)) {
+        s_filter.ema_q4[ch] = (uint16_t)x;
+    } else {
+        s_filter.ema_q4[ch] = (uint16_t)(ema + (x - ema) * SENSOR_EMA_WEIGHT_PCT / 100);
+    }
+    return (uint16_t)((s_filter.ema_q4[ch] + 8) >> 4);
+#else
+    (void)ch;
+    return raw;
+#endif
+}
+
+void sensor_measure_all(uint16_t filtered[PLANT_CHANNEL_COUNT]) {
+    hw_require(HW_SENSOR);
+    const int64_t span = profiler_start();
+    uint16_t raw[PLANT_CHANNEL_COUNT];
+    uint16_t spread[PLANT_CHANNEL_COUNT];
+    adc_sampler_read_group(ADC_CH_SOIL, PLANT_CHANNEL_COUNT, ADC_SAMPLER_SAMPLES, SENSOR_ADC_REDUCE,
+                           raw, spread);
+
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        if (spread[ch] > SENSOR_NOISE_MAX) {
+            // Burst hit by a transient: one longer median burst of this channel only
+            adc_sampler_read_group(adc_soil_channel(ch), 1, SENSOR_NOISE_RETRY_SAMPLES, ADC_REDUCE_MEDIAN,
+                                   &raw[ch], &spread[ch]);
+        }
+        const SensorFault fault = classify(ch, raw[ch], spread[ch]);
+        s_filter.fault[ch] = (uint8_t)fault;
+        filtered[ch] = (fault == SENSOR_OK) ? average_update(ch, raw[ch]) : raw[ch];
+
+        #if DEBUG_SERIAL
+        Serial.print("[SENSOR] ch");
+        Serial.print(ch);
+        Serial.print(" raw=");
+        Serial.print(raw[ch]);
+        Serial.print(" noise=");
+        Serial.print(spread[ch]);
+        Serial.print(" filtered=");
+        Serial.print(filtered[ch]);
+        Serial.print(' ');
+        Serial.println(sensor_fault_name(fault));
+        #endif
+    }
+    profiler_stop(PROF_SENSOR, span);
+}
+
+SensorFault sensor_get_fault(uint8_t ch) {
+    return (SensorFault)s_filter.fault[clamp_channel(ch)];
+}
+
+const char *sensor_fault_name(SensorFault fault) {
+    switch (fault) {
+        case SENSOR_OK:                 return "ok";
+        case SENSOR_FAULT_DISCONNECTED: return "disconnected";
+        case SENSOR_FAULT_NOISY:        return "noisy";
+        case SENSOR_FAULT_STUCK:        return "stuck";
+        default:                        return "unknown";
+    }
+}
+
 // =============================================================================
 // PERCENTAGE CONVERSION
 // =============================================================================
 
-uint8_t sensor_raw_to_humidity_percent(uint16_t raw) {
-    // Load calibration values from NVS
-    uint16_t dry_value = storage_get_sensor_dry();   // High ADC = dry = 0%
-    uint16_t wet_value = storage_get_sensor_wet();   // Low ADC = wet = 100%
-    
-    // Prevent division by zero
-    if (dry_value == wet_value) {
+#if SENSOR_CURVE_ENABLED
+#define SENSOR_CURVE_APPLY(p)  (cal.curve[(p)])
+#else
+#define SENSOR_CURVE_APPLY(p)  ((uint8_t)(p))
+#endif
+
+uint8_t sensor_raw_to_humidity_percent(uint8_t ch, uint16_t raw) {
+    hw_require(HW_SENSOR);
+    const SensorCalibration &cal = s_cal[clamp_channel(ch)];
+
+    // Prevent division by zero (dry == wet)
+    if (cal.scale_q24 == 0) {
         return 50;
     }
-    
-    int32_t percent;
-    
-    if (dry_value > wet_value) {
+
+    uint32_t delta;
+    if (cal.inverted) {
         // Normal case: dry ADC > wet ADC (inverted capacitive sensor)
-        if (raw >= dry_value)      percent = 0;
-        else if (raw <= wet_value) percent = 100;
-        else percent = (int32_t)(dry_value - raw) * 100 / (dry_value - wet_value);
+        if (raw >= cal.dry) return SENSOR_CURVE_APPLY(0);
+        if (raw <= cal.wet) return SENSOR_CURVE_APPLY(100);
+        delta = cal.dry - raw;
     } else {
         // Unusual case: dry ADC < wet ADC (non-inverted sensor)
-        if (raw <= dry_value)      percent = 0;
-        else if (raw >= wet_value) percent = 100;
-        else percent = (int32_t)(raw - dry_value) * 100 / (wet_value - dry_value);
+        if (raw <= cal.dry) return SENSOR_CURVE_APPLY(0);
+        if (raw >= cal.wet) return SENSOR_CURVE_APPLY(100);
+        delta = raw - cal.dry;
     }
-    
-    if (percent < 0)   percent = 0;
+
+    uint32_t percent = (uint32_t)(((uint64_t)delta * cal.scale_q24) >> 24);
     if (percent > 100) percent = 100;
-    
-    return (uint8_t)percent;
+
+    return SENSOR_CURVE_APPLY(percent);
 }
 
-uint8_t sensor_read_humidity_percent() {
-    return sensor_raw_to_humidity_percent(sensor_read_raw());
+uint8_t sensor_read_humidity_percent(uint8_t ch) {
+    return sensor_raw_to_humidity_percent(ch, sensor_read_raw(ch));
 }
 
 // =============================================================================
 // CALIBRATION
 // =============================================================================
 
-uint16_t sensor_calibrate_dry() {
-    // Average sensor value over adjustable calibration time
+// Average large bursts over adjustable calibration time
+static uint16_t calibration_average(uint8_t ch, const char *label) {
     unsigned long calibrating_time = SENSOR_CALIBRATION_TIME_MS;
     unsigned long start_time = millis();
     uint32_t sum = 0;
     uint32_t count = 0;
-    #ifdef DEBUG_SERIAL
-    Serial.println("Dry calibration started. Keep sensor dry for " + String(calibrating_time / 1000) + " seconds.");
+    #if DEBUG_SERIAL
+    Serial.println(String(label) + " calibration started. Keep sensor " + label + " for " + String(calibrating_time / 1000) + " seconds.");
+    #else
+    (void)label;
     #endif
     while (millis() - start_time < calibrating_time) {
-        sum += sensor_read_raw();
+        sum += adc_sampler_read(adc_soil_channel(ch), SENSOR_CALIBRATION_SAMPLES, ADC_REDUCE_TRIMMED_MEAN);
         count++;
-        delay(10);
+        delay(1);
     }
     uint16_t avg_val = (count > 0) ? (uint16_t)(sum / count) : 0;
-    storage_set_sensor_dry(avg_val);
-    #ifdef DEBUG_SERIAL
-    Serial.print("Dry calibration complete. Value: ");
-    Serial.println(avg_val);
+    #if DEBUG_SERIAL
+    Serial.print(String(label) + " calibration complete. Value: ");
+    Serial.print(avg_val);
+    Serial.print(" (");
+    Serial.print(count);
+    Serial.println(" bursts)");
     #endif
     return avg_val;
 }
 
-uint16_t sensor_calibrate_wet() {
-    // Average sensor value over adjustable calibration time
-    unsigned long calibrating_time = SENSOR_CALIBRATION_TIME_MS;
-    unsigned long start_time = millis();
-    uint32_t sum = 0;
-    uint32_t count = 0;
-    #ifdef DEBUG_SERIAL
-    Serial.println("Wet calibration started. Keep sensor wet for " + String(calibrating_time / 1000) + " seconds.");
-    #endif
-    while (millis() - start_time < calibrating_time) {
-        sum += sensor_read_raw();
-        count++;
-        delay(10);
-    }
-    uint16_t avg_val = (count > 0) ? (uint16_t)(sum / count) : 0;
-    storage_set_sensor_wet(avg_val);
-    #ifdef DEBUG_SERIAL
-    Serial.print("Wet calibration complete. Value: ");
-    Serial.println(avg_val);
-    #endif
+uint16_t sensor_calibrate_dry(uint8_t ch) {
+    hw_require(HW_SENSOR);
+    ch = clamp_channel(ch);
+    uint16_t avg_val = calibration_average(ch, "Dry");
+    storage_set_sensor_dry(ch, avg_val);
+    calibration_load(ch);
+    measurement_invalidate();
+    return avg_val;
+}
+
+uint16_t sensor_calibrate_wet(uint8_t ch) {
+    hw_require(HW_SENSOR);
+    ch = clamp_channel(ch);
+    uint16_t avg_val = calibration_average(ch, "Wet");
+    storage_set_sensor_wet(ch, avg_val);
+    calibration_load(ch);
+    measurement_invalidate();
     return avg_val;
 }
 
@@ -138,14 +351,14 @@ bool sensor_reading_valid(uint16_t raw_value) {
     // Check for extreme values that indicate hardware problems
     
     // Value of 0 or max usually indicates disconnected sensor
-    if (raw_value < 100) {
-        #ifdef DEBUG_SERIAL
+    if (raw_value < SENSOR_RAW_MIN) {
+        #if DEBUG_SERIAL
         Serial.println("[SENSOR] ERROR: Reading too low (sensor disconnected?)");
         #endif
         return false;
     }
-    if (raw_value > ADC_MAX_VALUE - 100) {
-        #ifdef DEBUG_SERIAL
+    if (raw_value > SENSOR_RAW_MAX) {
+        #if DEBUG_SERIAL
         Serial.println("[SENSOR] ERROR: Reading too high (sensor disconnected?)");
         #endif
         return false;
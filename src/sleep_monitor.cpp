@@ -0,0 +1,302 @@
+/**
+ * sleep_monitor.cpp - Deep sleep wake stub monitor implementation
+ *
+ * Everything the stub touches lives in RTC fast memory: the state below
+ * (RTC_DATA_ATTR) and the stub functions (RTC_IRAM_ATTR). It may only use
+ * register access and ROM code; no flash, no heap, no strings. The app
+ * side precomputes every threshold as a raw ADC value, and the RTC slow
+ * clock rate, when arming.
+ *
+ * The stub programs the RTC timer and re-enters deep sleep through the
+ * RTC_CNTL registers itself, the way the ESP-IDF 5 esp_wake_stub helpers
+ * do, so it builds on the ESP-IDF 4.4 Arduino core that has no such
+ * helpers.
+ */
+
+#include "sleep_monitor.h"
+#include "adc_sampler.h"
+#include "sensor.h"
+#include "storage.h"
+#include "watering.h"
+#include "water_level.h"
+#include "esp_attr.h"
+#include "esp_sleep.h"
+#include "driver/gpio.h"
+
+#if SLEEP_MONITOR_ENABLED
+#include "soc/rtc.h"
+#include "soc/rtc_cntl_reg.h"
+#include "soc/gpio_reg.h"
+#include "soc/apb_saradc_reg.h"
+#include "soc/system_reg.h"
+#endif
+
+#define SLEEP_MONITOR_MAGIC   0x534D4F31UL   // "SMO1"
+#define STUB_ADC_SAMPLES      4
+#define STUB_ADC_TIMEOUT      2000           // polls per conversion
+
+typedef struct {
+    uint8_t  adc_channel;     // ADC1 channel of the soil input
+    bool     inverted;        // dry reads higher than wet
+    uint16_t raw_wake;        // readings past this (drier) wake the app
+    uint16_t raw_lo;          // plausible reading window
+    uint16_t raw_hi;
+    uint32_t unlock_sec;      // watering lockout left at arm time
+} MonitorChannel;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t total_sec;       // planned sleep until the next full wake
+    uint32_t elapsed_sec;     // slept so far
+    uint32_t programmed_sec;  // length of the slice in progress
+    uint32_t slow_ticks_per_sec;  // RTC slow clock, measured at arm time
+    uint16_t stub_wakes;
+    uint8_t  trigger;         // MonitorTrigger
+    bool     water_low;       // reservoir state at arm time
+    MonitorChannel ch[PLANT_CHANNEL_COUNT];
+} MonitorState;
+
+static RTC_DATA_ATTR MonitorState s_mon;
+
+#if SLEEP_MONITOR_ENABLED
+
+// =============================================================================
+// WAKE STUB
+// =============================================================================
+
+// Raw 12-bit one-shot conversion on ADC1 at 11 dB, 0xFFFF on timeout.
+static uint16_t RTC_IRAM_ATTR stub_adc_read(uint8_t channel) {
+    REG_SET_BIT(SYSTEM_PERIP_CLK_EN0_REG, SYSTEM_APB_SARADC_CLK_EN);
+    REG_CLR_BIT(SYSTEM_PERIP_RST_EN0_REG, SYSTEM_APB_SARADC_RST);
+    REG_SET_BIT(APB_SARADC_CLKM_CONF_REG, APB_SARADC_CLK_EN);
+    REG_SET_FIELD(APB_SARADC_CTRL_REG, APB_SARADC_XPD_SAR_FORCE, 3);
+    REG_SET_FIELD(APB_SARADC_ONETIME_SAMPLE_REG, APB_SARADC_ONETIME_CHANNEL, channel);
+    REG_SET_FIELD(APB_SARADC_ONETIME_SAMPLE_REG, APB_SARADC_ONETIME_ATTEN, 3);
+    REG_SET_BIT(APB_SARADC_ONETIME_SAMPLE_REG, APB_SARADC1_ONETIME_SAMPLE);
+
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < STUB_ADC_SAMPLES; ++i) {
+        REG_WRITE(APB_SARADC_INT_CLR_REG, APB_SARADC_ADC1_DONE_INT_CLR);
+        REG_SET_BIT(APB_SARADC_ONETIME_SAMPLE_REG, APB_SARADC_ONETIME_START);
+        uint32_t polls = 0;
+        while ((REG_READ(APB_SARADC_INT_RAW_REG) & APB_SARADC_ADC1_DONE_INT_RAW) == 0) {
+            if (++polls >= STUB_ADC_TIMEOUT) {
+                sum = 0xFFFFUL * STUB_ADC_SAMPLES;
+                break;
+            }
+        }
+        REG_CLR_BIT(APB_SARADC_ONETIME_SAMPLE_REG, APB_SARADC_ONETIME_START);
+        if (polls >= STUB_ADC_TIMEOUT) {
+            break;
+        }
+        sum += REG_GET_FIELD(APB_SARADC_1_DATA_STATUS_REG, APB_SARADC_ADC1_DATA) & 0xFFF;
+    }
+
+    REG_CLR_BIT(APB_SARADC_ONETIME_SAMPLE_REG, APB_SARADC1_ONETIME_SAMPLE);
+    REG_SET_FIELD(APB_SARADC_CTRL_REG, APB_SARADC_XPD_SAR_FORCE, 0);
+    REG_CLR_BIT(SYSTEM_PERIP_CLK_EN0_REG, SYSTEM_APB_SARADC_CLK_EN);
+    return (uint16_t)(sum / STUB_ADC_SAMPLES);
+}
+
+// RTC timer, in slow clock ticks since power-up.
+static uint64_t RTC_IRAM_ATTR stub_rtc_ticks() {
+    REG_SET_BIT(RTC_CNTL_TIME_UPDATE_REG, RTC_CNTL_TIME_UPDATE);
+    return REG_READ(RTC_CNTL_TIME0_REG) | ((uint64_t)REG_READ(RTC_CNTL_TIME1_REG) << 32);
+}
+
+// Arm the RTC timer sec from now and go back to deep sleep, entering
+// this stub again on wakeup. Does not return.
+static void RTC_IRAM_ATTR stub_sleep_for(uint32_t sec) {
+    const uint64_t alarm = stub_rtc_ticks() + (uint64_t)sec * s_mon.slow_ticks_per_sec;
+    REG_WRITE(RTC_CNTL_SLP_TIMER0_REG, (uint32_t)alarm);
+    REG_WRITE(RTC_CNTL_SLP_TIMER1_REG, (uint32_t)(alarm >> 32));
+    REG_SET_BIT(RTC_CNTL_INT_CLR_REG, RTC_CNTL_MAIN_TIMER_INT_CLR);
+    REG_SET_BIT(RTC_CNTL_SLP_TIMER1_REG, RTC_CNTL_MAIN_TIMER_ALARM_EN);
+
+    REG_WRITE(RTC_ENTRY_ADDR_REG, (uint32_t)(uintptr_t)&esp_wake_deep_sleep);
+    REG_CLR_BIT(RTC_CNTL_STATE0_REG, RTC_CNTL_SLEEP_EN);
+    REG_SET_BIT(RTC_CNTL_STATE0_REG, RTC_CNTL_SLEEP_EN);
+    while (true) {
+        // the chip powers down within a few cycles
+    }
+}
+
+// Decide whether the slice just ended needs the app. Sets s_mon.trigger
+// and returns false to boot, true to sleep again.
+static bool RTC_IRAM_ATTR stub_keep_sleeping() {
+    if (s_mon.magic != SLEEP_MONITOR_MAGIC ||
+        (REG_GET_FIELD(RTC_CNTL_SLP_WAKEUP_CAUSE_REG, RTC_CNTL_WAKEUP_CAUSE) &
+         RTC_TIMER_TRIG_EN) == 0) {
+        s_mon.trigger = MONITOR_TRIGGER_NONE;
+        return false;
+    }
+
+    s_mon.elapsed_sec += s_mon.programmed_sec;
+    if (s_mon.elapsed_sec >= s_mon.total_sec) {
+        s_mon.trigger = MONITOR_TRIGGER_SCHEDULED;
+        return false;
+    }
+
+    const bool water_low = (REG_READ(GPIO_IN_REG) & BIT(PIN_WATER_LEVEL)) == 0;
+    if (water_low != s_mon.water_low) {
+        s_mon.trigger = MONITOR_TRIGGER_RESERVOIR;
+        return false;
+    }
+
+    for (uint8_t i = 0; i < PLANT_CHANNEL_COUNT; ++i) {
+        const MonitorChannel &c = s_mon.ch[i];
+        if (s_mon.elapsed_sec < c.unlock_sec) {
+            continue;   // could not be watered anyway
+        }
+        const uint16_t raw = stub_adc_read(c.adc_channel);
+        if (raw < c.raw_lo || raw > c.raw_hi) {
+            s_mon.trigger = MONITOR_TRIGGER_SENSOR;
+            return false;
+        }
+        if (c.inverted ? (raw > c.raw_wake) : (raw < c.raw_wake)) {
+            s_mon.trigger = MONITOR_TRIGGER_SOIL;
+            return false;
+        }
+    }
+
+    const uint32_t left = s_mon.total_sec - s_mon.elapsed_sec;
+    s_mon.programmed_sec = (left < SLEEP_MONITOR_SLICE_SEC) ? left : SLEEP_MONITOR_SLICE_SEC;
+    s_mon.stub_wakes++;
+    return true;
+}
+
+extern "C" void RTC_IRAM_ATTR esp_wake_deep_sleep(void) {
+    esp_default_wake_deep_sleep();
+    if (!stub_keep_sleeping()) {
+        return;   // continue into the normal boot
+    }
+    stub_sleep_for(s_mon.programmed_sec);
+}
+
+// =============================================================================
+// ARMING
+// =============================================================================
+
+/**
+ * Driest raw reading that still counts as at least target_pct humidity.
+ * sensor_raw_to_humidity_percent() is monotonic, so binary search the
+ * 12-bit range; this also folds in the sensor curve.
+ */
+static uint16_t raw_limit_for(uint8_t ch, uint8_t target_pct, bool inverted) {
+    uint16_t lo = 0;
+    uint16_t hi = 4095;
+    while (lo < hi) {
+        if (inverted) {
+            // Humidity falls with raw: last raw with humidity >= target
+            const uint16_t mid = (uint16_t)((lo + hi + 1) / 2);
+            if (sensor_raw_to_humidity_percent(ch, mid) >= target_pct) lo = mid;
+            else hi = (uint16_t)(mid - 1);
+        } else {
+            // Humidity rises with raw: first raw with humidity >= target
+            const uint16_t mid = (uint16_t)((lo + hi) / 2);
+            if (sensor_raw_to_humidity_percent(ch, mid) >= target_pct) hi = mid;
+            else lo = (uint16_t)(mid + 1);
+        }
+    }
+    return lo;
+}
+
+static bool arm_channel(uint8_t ch, MonitorChannel *out) {
+    uint8_t channel;
+    if (!adc_sampler_adc1_channel(PLANT_CHANNELS[ch].soil_pin, &channel)) {
+        return false;
+    }
+    const uint16_t dry = storage_get_sensor_dry(ch);
+    const uint16_t wet = storage_get_sensor_wet(ch);
+    if (dry == wet) {
+        return false;   // not calibrated, the stub could not tell wet from dry
+    }
+
+    uint16_t target = (uint16_t)storage_get_minimal_humidity(ch) + SLEEP_MONITOR_MARGIN_PCT;
+    if (target > 100) {
+        target = 100;
+    }
+    const uint16_t lo = (dry < wet) ? dry : wet;
+    const uint16_t hi = (dry < wet) ? wet : dry;
+
+    out->adc_channel = channel;
+    out->inverted = dry > wet;
+    out->raw_wake = raw_limit_for(ch, (uint8_t)target, out->inverted);
+    out->raw_lo = (lo > SLEEP_MONITOR_RAW_SLACK) ? (uint16_t)(lo - SLEEP_MONITOR_RAW_SLACK) : 0;
+    out->raw_hi = (uint16_t)(hi + SLEEP_MONITOR_RAW_SLACK);
+    out->unlock_sec = watering_get_seconds_until_allowed(ch);
+    return true;
+}
+
+#endif // SLEEP_MONITOR_ENABLED
+
+// =============================================================================
+// API
+// =============================================================================
+
+uint32_t sleep_monitor_arm(uint32_t sleep_sec) {
+    s_mon.magic = 0;
+#if SLEEP_MONITOR_ENABLED
+    // Reservoir alerts already use the short alert interval
+    if (sleep_sec <= SLEEP_MONITOR_SLICE_SEC || water_level_low()) {
+        return sleep_sec;
+    }
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        if (!arm_channel(ch, &s_mon.ch[ch])) {
+            return sleep_sec;
+        }
+    }
+
+    // Calibrated slow clock period in us, Q(RTC_CLK_CAL_FRACT)
+    const uint32_t cal = REG_READ(RTC_SLOW_CLK_CAL_REG);
+    if (cal == 0) {
+        return sleep_sec;
+    }
+    s_mon.slow_ticks_per_sec = (uint32_t)(((uint64_t)SEC_TO_US << RTC_CLK_CAL_FRACT) / cal);
+
+    s_mon.total_sec = sleep_sec;
+    s_mon.elapsed_sec = 0;
+    s_mon.programmed_sec = SLEEP_MONITOR_SLICE_SEC;
+    s_mon.stub_wakes = 0;
+    s_mon.trigger = MONITOR_TRIGGER_NONE;
+    s_mon.water_low = false;
+    s_mon.magic = SLEEP_MONITOR_MAGIC;
+
+    // Keep the float switch pull-up and input enable through deep sleep
+    // so the stub can read it.
+    gpio_hold_en(PIN_WATER_LEVEL);
+    gpio_deep_sleep_hold_en();
+    esp_set_deep_sleep_wake_stub(&esp_wake_deep_sleep);
+
+    #if DEBUG_SERIAL
+    Serial.print("[MONITOR] Armed, ");
+    Serial.print(sleep_sec / SLEEP_MONITOR_SLICE_SEC);
+    Serial.print(" slices, ch0 wake raw ");
+    Serial.println(s_mon.ch[0].raw_wake);
+    #endif
+    return SLEEP_MONITOR_SLICE_SEC;
+#else
+    return sleep_sec;
+#endif
+}
+
+MonitorTrigger sleep_monitor_boot(uint16_t *stub_wakes) {
+    const bool armed = (s_mon.magic == SLEEP_MONITOR_MAGIC);
+    const MonitorTrigger trigger = armed ? (MonitorTrigger)s_mon.trigger : MONITOR_TRIGGER_NONE;
+    if (stub_wakes != nullptr) {
+        *stub_wakes = armed ? s_mon.stub_wakes : 0;
+    }
+    s_mon.magic = 0;
+    gpio_hold_dis(PIN_WATER_LEVEL);
+
+    #if DEBUG_SERIAL
+    if (armed) {
+        Serial.print("[MONITOR] Woken by trigger ");
+        Serial.print((int)trigger);
+        Serial.print(" after ");
+        Serial.print(s_mon.stub_wakes);
+        Serial.println(" stub wakes");
+    }
+    #endif
+    return trigger;
+}
@@ -0,0 +1,95 @@
+/**
+ * soil_model.cpp - Learned soil response implementation
+ *
+ * Both values are exponential moving averages so a single bad reading
+ * (sensor noise, drainage) only moves the model by 1 / 2^SOIL_MODEL_EMA_SHIFT.
+ */
+
+#include "soil_model.h"
+#include "config.h"
+#include "storage.h"
+
+static uint32_t clamp_u32(uint32_t v, uint32_t lo, uint32_t hi) {
+    return (v < lo) ? lo : (v > hi) ? hi : v;
+}
+
+static uint32_t ema(uint32_t current, uint32_t observed) {
+    if (current == 0) {
+        return observed;  // first observation
+    }
+    return current - (current >> SOIL_MODEL_EMA_SHIFT) + (observed >> SOIL_MODEL_EMA_SHIFT);
+}
+
+// =============================================================================
+// PLANNING
+// =============================================================================
+
+uint32_t soil_model_pulse_ms(uint8_t ch, uint8_t humidity, uint8_t target) {
+#if SOIL_MODEL_ENABLED
+    const uint16_t gain = storage_get_soil_gain(ch);
+    if (gain == 0) {
+        return PUMP_RUN_DURATION_MS;
+    }
+    if (humidity >= target) {
+        return PUMP_MIN_PULSE_MS;
+    }
+
+    // gap [%] * fraction / gain [0.001 %/s] -> ms
+    const uint32_t gap = target - humidity;
+    const uint32_t ms = (gap * SOIL_MODEL_TARGET_PCT * 10000UL) / gain;
+    return clamp_u32(ms, PUMP_MIN_PULSE_MS, PUMP_MAX_DURATION_MS);
+#else
+    (void)ch;
+    return PUMP_RUN_DURATION_MS;
+#endif
+}
+
+uint32_t soil_model_soak_ms(uint8_t ch) {
+#if SOIL_MODEL_ENABLED
+    const uint32_t settle_ms = storage_get_soil_settle_ms(ch);
+    if (settle_ms == 0) {
+        return SOAK_WAIT_TIME_MS;
+    }
+    return clamp_u32(settle_ms + settle_ms / 4, SOAK_MIN_MS, SOAK_WAIT_TIME_MS);
+#else
+    (void)ch;
+    return SOAK_WAIT_TIME_MS;
+#endif
+}
+
+// =============================================================================
+// LEARNING
+// =============================================================================
+
+void soil_model_learn(uint8_t ch, uint32_t pulse_ms, uint8_t before, uint8_t after,
+                      uint32_t soaked_ms, bool settled) {
+#if SOIL_MODEL_ENABLED
+    uint32_t gain = storage_get_soil_gain(ch);
+    uint32_t settle_ms = storage_get_soil_settle_ms(ch);
+
+    // Gain: only a rise is informative; no change or a drop is noise or
+    // drainage and would drive the next pulse to the maximum.
+    if (after > before && pulse_ms > 0) {
+        const uint32_t observed = clamp_u32(((uint32_t)(after - before) * 1000000UL) / pulse_ms,
+                                            1, UINT16_MAX);
+        gain = ema(gain, observed);
+    }
+
+    // Settle: an unsettled soak means the limit was too short, so push it up.
+    const uint32_t observed_settle = settled ? soaked_ms
+                                             : clamp_u32(soaked_ms + soaked_ms / 2, SOAK_MIN_MS, SOAK_WAIT_TIME_MS);
+    settle_ms = ema(settle_ms, observed_settle);
+
+    storage_set_soil_model(ch, (uint16_t)clamp_u32(gain, 0, UINT16_MAX), settle_ms);
+
+    #if DEBUG_SERIAL
+    Serial.print("[MODEL] ch");
+    Serial.print(ch);
+    Serial.print(" gain=");
+    Serial.print(gain);
+    Serial.print(" m%/s settle=");
+    Serial.print(settle_ms);
+    Serial.println(" ms");
+    #endif
+#endif
+}
@@ -1,14 +1,183 @@
 /**
  * storage.cpp - NVS persistent storage implementation
+ *
+ * All values are mirrored in an RTC-memory cache that survives deep sleep.
+ * Getters are served from RAM; setters update the cache and mark the entry
+ * dirty. Dirty entries are written to NVS together in storage_commit()
+ * (called from storage_close() before deep sleep).
+ *
+ * Boot count / total time change on every wake and are only written every
+ * STORAGE_COUNTER_COMMIT_WAKES wakes, on power-on, and after a brown-out.
+ *
+ * Those counters, the watering timestamps, the last command id and the
+ * telemetry upload cursor go to the append-only counter log (counter_log.h)
+ * rather than NVS while it is usable; NVS keeps their last values from
+ * before the log and takes over again if an append fails.
  */
 
 #include "storage.h"
 #include "config.h"
+#include "rtc_clock.h"
+#include "counter_log.h"
 #include <Preferences.h>
+#include "esp_attr.h"
+#include "esp_system.h"
+#include <string.h>
 
 // Preferences instance (ESP32 NVS wrapper)
 static Preferences prefs;
 
+// =============================================================================
+// RTC CACHE
+// =============================================================================
+
+#define STORAGE_CACHE_MAGIC  0x53544336UL   // "STC6", bump on layout change
+
+enum : uint16_t {
+    DIRTY_SENSOR_DRY    = 1u << 0,
+    DIRTY_SENSOR_WET    = 1u << 1,
+    DIRTY_MIN_HUMIDITY  = 1u << 2,
+    DIRTY_MAX_HUMIDITY  = 1u << 3,
+    DIRTY_PLANT_NAME    = 1u << 4,
+    DIRTY_DEEP_SLEEP    = 1u << 5,
+    DIRTY_LAST_CMD_ID   = 1u << 6,
+    DIRTY_LAST_WATERING = 1u << 7,
+    DIRTY_COUNTERS      = 1u << 8,   // boot count + total time, forced commit
+    DIRTY_SOIL_MODEL    = 1u << 9,
+    DIRTY_TLM_UPLOAD    = 1u << 10,
+    DIRTY_OTA_JOB       = 1u << 11,
+    DIRTY_OTA_PROGRESS  = 1u << 12,
+    DIRTY_GROUP         = 1u << 13,
+};
+
+// Entries kept in the counter log; one append covers all of them.
+static const uint16_t DIRTY_COUNTER_LOG = DIRTY_LAST_CMD_ID | DIRTY_LAST_WATERING |
+                                          DIRTY_COUNTERS | DIRTY_TLM_UPLOAD;
+
+// Per plant channel values. A dirty bit covers the field of every channel.
+typedef struct {
+    uint16_t sensor_dry;
+    uint16_t sensor_wet;
+    uint8_t  minimal_humidity;
+    uint8_t  max_humidity;
+    uint16_t soil_gain;
+    uint32_t soil_settle_ms;
+    uint32_t last_watering;
+} StorageChannel;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t dirty;
+    bool     deep_sleep_enabled;
+    uint32_t boot_count;
+    uint32_t total_time;             // last persistent time written to NVS
+    uint16_t wakes_since_commit;     // counter updates not yet in NVS
+    uint32_t tlm_upload_seq;
+    StorageChannel ch[PLANT_CHANNEL_COUNT];
+    char     plant_name[MQTT_PLANT_NAME_MAX_LEN + 1];
+    char     group[MQTT_GROUP_MAX_LEN + 1];
+    char     last_cmd_id[STORAGE_CMD_ID_MAX_LEN + 1];
+    StorageOtaJob ota;
+} StorageCache;
+
+static RTC_DATA_ATTR StorageCache s_cache;
+static bool s_counter_log = false;   // counter log usable this wake
+
+static void copy_bounded(char *dst, size_t dst_size, const char *src) {
+    const size_t len = strnlen(src, dst_size - 1);
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+// Out-of-range channels map to channel 0 instead of reading past the table.
+static StorageChannel &chan(uint8_t ch) {
+    return s_cache.ch[(ch < PLANT_CHANNEL_COUNT) ? ch : 0];
+}
+
+// NVS key of a per-channel value: channel 0 keeps the single-plant key,
+// channel N appends its digit (keys stay under the 15 character limit).
+typedef struct { char text[16]; } ChannelKey;
+
+static ChannelKey channel_key(const char *base, uint8_t ch) {
+    ChannelKey key;
+    if (ch == 0) {
+        snprintf(key.text, sizeof(key.text), "%s", base);
+    } else {
+        snprintf(key.text, sizeof(key.text), "%s%u", base, (unsigned)ch);
+    }
+    return key;
+}
+
+static void cache_load_from_nvs() {
+#if DEBUG_NO_SLEEP
+    const bool default_sleep = false;
+#else
+    const bool default_sleep = true;
+#endif
+    for (uint8_t i = 0; i < PLANT_CHANNEL_COUNT; ++i) {
+        StorageChannel &c = s_cache.ch[i];
+        c.sensor_dry       = prefs.getUShort(channel_key(NVS_KEY_SENSOR_DRY, i).text, DEFAULT_SENSOR_DRY);
+        c.sensor_wet       = prefs.getUShort(channel_key(NVS_KEY_SENSOR_WET, i).text, DEFAULT_SENSOR_WET);
+        c.minimal_humidity = prefs.getUChar(channel_key(NVS_KEY_MINIMAL_HUMIDITY, i).text, DEFAULT_MINIMAL_HUMIDITY);
+        c.max_humidity     = prefs.getUChar(channel_key(NVS_KEY_MAX_HUMIDITY, i).text, DEFAULT_MAX_HUMIDITY);
+        c.last_watering    = prefs.getULong(channel_key(NVS_KEY_LAST_WATERING, i).text, 0);
+        c.soil_gain        = prefs.getUShort(channel_key(NVS_KEY_SOIL_GAIN, i).text, 0);
+        c.soil_settle_ms   = prefs.getULong(channel_key(NVS_KEY_SOIL_SETTLE, i).text, 0);
+    }
+    s_cache.deep_sleep_enabled = prefs.getBool(NVS_KEY_DEEP_SLEEP_ENABLED, default_sleep);
+    s_cache.boot_count         = prefs.getULong(NVS_KEY_BOOT_COUNT, 0);
+    s_cache.total_time         = prefs.getULong(NVS_KEY_TOTAL_TIME, 0);
+    s_cache.tlm_upload_seq     = prefs.getULong(NVS_KEY_TLM_UPLOAD_SEQ, 0);
+    copy_bounded(s_cache.plant_name, sizeof(s_cache.plant_name),
+                 prefs.getString(NVS_KEY_PLANT_NAME, MQTT_PLANT_NAME).c_str());
+    copy_bounded(s_cache.group, sizeof(s_cache.group),
+                 prefs.getString(NVS_KEY_GROUP, "").c_str());
+    copy_bounded(s_cache.last_cmd_id, sizeof(s_cache.last_cmd_id),
+                 prefs.getString(NVS_KEY_LAST_CMD_ID, "").c_str());
+    copy_bounded(s_cache.ota.url, sizeof(s_cache.ota.url),
+                 prefs.getString(NVS_KEY_OTA_URL, "").c_str());
+    if (prefs.getBytes(NVS_KEY_OTA_SHA256, s_cache.ota.sha256, sizeof(s_cache.ota.sha256)) !=
+        sizeof(s_cache.ota.sha256)) {
+        s_cache.ota.url[0] = '\0';   // incomplete job: drop it
+    }
+    s_cache.ota.size   = prefs.getULong(NVS_KEY_OTA_SIZE, 0);
+    s_cache.ota.offset = prefs.getULong(NVS_KEY_OTA_OFFSET, 0);
+    s_cache.wakes_since_commit = 0;
+    s_cache.dirty = 0;
+    s_cache.magic = STORAGE_CACHE_MAGIC;
+
+    // Newer than NVS for everything it holds
+    CounterSnapshot snap;
+    if (counter_log_latest(&snap)) {
+        s_cache.boot_count     = snap.boot_count;
+        s_cache.total_time     = snap.total_time;
+        s_cache.tlm_upload_seq = snap.tlm_upload_seq;
+        for (uint8_t i = 0; i < PLANT_CHANNEL_COUNT; ++i) {
+            s_cache.ch[i].last_watering = snap.last_watering[i];
+        }
+        snap.last_cmd_id[sizeof(snap.last_cmd_id) - 1] = '\0';
+        copy_bounded(s_cache.last_cmd_id, sizeof(s_cache.last_cmd_id), snap.last_cmd_id);
+    }
+}
+
+static bool counter_log_commit() {
+    CounterSnapshot snap;
+    memset(&snap, 0, sizeof(snap));
+    snap.boot_count     = s_cache.boot_count;
+    snap.total_time     = rtc_clock_now_sec();
+    snap.tlm_upload_seq = s_cache.tlm_upload_seq;
+    for (uint8_t i = 0; i < PLANT_CHANNEL_COUNT; ++i) {
+        snap.last_watering[i] = s_cache.ch[i].last_watering;
+    }
+    copy_bounded(snap.last_cmd_id, sizeof(snap.last_cmd_id), s_cache.last_cmd_id);
+    if (!counter_log_append(&snap)) {
+        return false;
+    }
+    s_cache.total_time = snap.total_time;
+    s_cache.wakes_since_commit = 0;
+    return true;
+}
+
 // =============================================================================
 // INITIALIZATION
 // =============================================================================
@@ -17,19 +186,95 @@ bool storage_init() {
     // Open NVS namespace in read-write mode
     // Second param: false = read-write, true = read-only
     bool result = prefs.begin(NVS_NAMESPACE, false);
+    s_counter_log = counter_log_init();
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     if (result) {
         Serial.println("[STORAGE] NVS initialized successfully");
     } else {
         Serial.println("[STORAGE] ERROR: NVS initialization failed!");
     }
     #endif
+
+    const esp_reset_reason_t reset = esp_reset_reason();
+    if (s_cache.magic != STORAGE_CACHE_MAGIC || reset == ESP_RST_POWERON) {
+        // RTC memory lost (power cycle) or never filled: NVS is authoritative.
+        cache_load_from_nvs();
+        #if DEBUG_SERIAL
+        Serial.println("[STORAGE] Cache loaded from NVS");
+        #endif
+    } else if (reset == ESP_RST_BROWNOUT) {
+        // Cache survived, but the supply is failing: persist counters now.
+        s_cache.dirty |= DIRTY_COUNTERS;
+        storage_commit();
+    }
+
+    // Seeds the clock only if its RTC state was lost. Never restart
+    // before a logged watering, or the lockout would be skipped.
+    uint32_t restored = s_cache.total_time;
+    for (uint8_t i = 0; i < PLANT_CHANNEL_COUNT; ++i) {
+        if (s_cache.ch[i].last_watering > restored) {
+            restored = s_cache.ch[i].last_watering;
+        }
+    }
+    rtc_clock_init(restored);
     
     return result;
 }
 
+void storage_commit() {
+    const uint16_t all = s_cache.dirty;
+    uint16_t dirty = all;   // entries left for NVS
+    if (dirty == 0) {
+        return;
+    }
+    if ((dirty & DIRTY_COUNTER_LOG) != 0 && counter_log_commit()) {
+        dirty &= (uint16_t)~DIRTY_COUNTER_LOG;
+    }
+
+    for (uint8_t i = 0; i < PLANT_CHANNEL_COUNT; ++i) {
+        const StorageChannel &c = s_cache.ch[i];
+        if (dirty & DIRTY_SENSOR_DRY)    prefs.putUShort(channel_key(NVS_KEY_SENSOR_DRY, i).text, c.sensor_dry);
+        if (dirty & DIRTY_SENSOR_WET)    prefs.putUShort(channel_key(NVS_KEY_SENSOR_WET, i).text, c.sensor_wet);
+        if (dirty & DIRTY_MIN_HUMIDITY)  prefs.putUChar(channel_key(NVS_KEY_MINIMAL_HUMIDITY, i).text, c.minimal_humidity);
+        if (dirty & DIRTY_MAX_HUMIDITY)  prefs.putUChar(channel_key(NVS_KEY_MAX_HUMIDITY, i).text, c.max_humidity);
+        if (dirty & DIRTY_LAST_WATERING) prefs.putULong(channel_key(NVS_KEY_LAST_WATERING, i).text, c.last_watering);
+        if (dirty & DIRTY_SOIL_MODEL) {
+            prefs.putUShort(channel_key(NVS_KEY_SOIL_GAIN, i).text, c.soil_gain);
+            prefs.putULong(channel_key(NVS_KEY_SOIL_SETTLE, i).text, c.soil_settle_ms);
+        }
+    }
+    if (dirty & DIRTY_PLANT_NAME)    prefs.putString(NVS_KEY_PLANT_NAME, s_cache.plant_name);
+    if (dirty & DIRTY_GROUP)         prefs.putString(NVS_KEY_GROUP, s_cache.group);
+    if (dirty & DIRTY_DEEP_SLEEP)    prefs.putBool(NVS_KEY_DEEP_SLEEP_ENABLED, s_cache.deep_sleep_enabled);
+    if (dirty & DIRTY_LAST_CMD_ID)   prefs.putString(NVS_KEY_LAST_CMD_ID, s_cache.last_cmd_id);
+    if (dirty & DIRTY_TLM_UPLOAD)    prefs.putULong(NVS_KEY_TLM_UPLOAD_SEQ, s_cache.tlm_upload_seq);
+    if (dirty & DIRTY_OTA_JOB) {
+        prefs.putString(NVS_KEY_OTA_URL, s_cache.ota.url);
+        prefs.putBytes(NVS_KEY_OTA_SHA256, s_cache.ota.sha256, sizeof(s_cache.ota.sha256));
+    }
+    if (dirty & (DIRTY_OTA_JOB | DIRTY_OTA_PROGRESS)) {
+        prefs.putULong(NVS_KEY_OTA_SIZE, s_cache.ota.size);
+        prefs.putULong(NVS_KEY_OTA_OFFSET, s_cache.ota.offset);
+    }
+    if (dirty & DIRTY_COUNTERS) {
+        prefs.putULong(NVS_KEY_BOOT_COUNT, s_cache.boot_count);
+        s_cache.total_time = rtc_clock_now_sec();
+        prefs.putULong(NVS_KEY_TOTAL_TIME, s_cache.total_time);
+        s_cache.wakes_since_commit = 0;
+    }
+    s_cache.dirty = 0;
+
+    #if DEBUG_SERIAL
+    Serial.print("[STORAGE] Committed dirty mask 0x");
+    Serial.print(all, 16);
+    Serial.print(", NVS 0x");
+    Serial.println(dirty, 16);
+    #endif
+}
+
 void storage_close() {
+    storage_commit();
     prefs.end();
 }
 
@@ -37,28 +282,29 @@ void storage_close() {
 // CALIBRATION VALUES
 // =============================================================================
 
-uint16_t storage_get_sensor_dry() {
-    // Return stored value, or default if key doesn't exist
-    return prefs.getUShort(NVS_KEY_SENSOR_DRY, DEFAULT_SENSOR_DRY);
+uint16_t storage_get_sensor_dry(uint8_t ch) {
+    return chan(ch).sensor_dry;
 }
 
-uint16_t storage_get_sensor_wet() {
-    return prefs.getUShort(NVS_KEY_SENSOR_WET, DEFAULT_SENSOR_WET);
+uint16_t storage_get_sensor_wet(uint8_t ch) {
+    return chan(ch).sensor_wet;
 }
 
-void storage_set_sensor_dry(uint16_t value) {
-    prefs.putUShort(NVS_KEY_SENSOR_DRY, value);
+void storage_set_sensor_dry(uint8_t ch, uint16_t value) {
+    chan(ch).sensor_dry = value;
+    s_cache.dirty |= DIRTY_SENSOR_DRY;
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.print("[STORAGE] Sensor dry value set to: ");
     Serial.println(value);
     #endif
 }
 
-void storage_set_sensor_wet(uint16_t value) {
-    prefs.putUShort(NVS_KEY_SENSOR_WET, value);
+void storage_set_sensor_wet(uint8_t ch, uint16_t value) {
+    chan(ch).sensor_wet = value;
+    s_cache.dirty |= DIRTY_SENSOR_WET;
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.print("[STORAGE] Sensor wet value set to: ");
     Serial.println(value);
     #endif
@@ -68,32 +314,34 @@ void storage_set_sensor_wet(uint16_t value) {
 // HUMIDITY SETPOINT
 // =============================================================================
 
-uint8_t storage_get_minimal_humidity() {
-    return prefs.getUChar(NVS_KEY_MINIMAL_HUMIDITY, DEFAULT_MINIMAL_HUMIDITY);
+uint8_t storage_get_minimal_humidity(uint8_t ch) {
+    return chan(ch).minimal_humidity;
 }
 
-void storage_set_minimal_humidity(uint8_t percent) {
+void storage_set_minimal_humidity(uint8_t ch, uint8_t percent) {
     // Clamp to valid range
     if (percent > 100) percent = 100;
-    prefs.putUChar(NVS_KEY_MINIMAL_HUMIDITY, percent);
+    chan(ch).minimal_humidity = percent;
+    s_cache.dirty |= DIRTY_MIN_HUMIDITY;
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.print("[STORAGE] Minimal humidity set to: ");
     Serial.print(percent);
     Serial.println("%");
     #endif
 }
 
-uint8_t storage_get_max_humidity() {
-    return prefs.getUChar(NVS_KEY_MAX_HUMIDITY, DEFAULT_MAX_HUMIDITY);
+uint8_t storage_get_max_humidity(uint8_t ch) {
+    return chan(ch).max_humidity;
 }
 
-void storage_set_max_humidity(uint8_t percent) {
+void storage_set_max_humidity(uint8_t ch, uint8_t percent) {
     // Clamp to valid range
     if (percent > 100) percent = 100;
-    prefs.putUChar(NVS_KEY_MAX_HUMIDITY, percent);
+    chan(ch).max_humidity = percent;
+    s_cache.dirty |= DIRTY_MAX_HUMIDITY;
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.print("[STORAGE] Max humidity set to: ");
     Serial.print(percent);
     Serial.println("%");
@@ -104,12 +352,26 @@ void storage_set_max_humidity(uint8_t percent) {
 // PLANT NAME
 // =============================================================================
 
-String storage_get_plant_name() {
-    return prefs.getString(NVS_KEY_PLANT_NAME, MQTT_PLANT_NAME);
+const char *storage_get_plant_name() {
+    return s_cache.plant_name;
 }
 
-void storage_set_plant_name(const String &name) {
-    prefs.putString(NVS_KEY_PLANT_NAME, name);
+void storage_set_plant_name(const char *name) {
+    copy_bounded(s_cache.plant_name, sizeof(s_cache.plant_name), name);
+    s_cache.dirty |= DIRTY_PLANT_NAME;
+}
+
+// =============================================================================
+// MQTT GROUP
+// =============================================================================
+
+const char *storage_get_group() {
+    return s_cache.group;
+}
+
+void storage_set_group(const char *group) {
+    copy_bounded(s_cache.group, sizeof(s_cache.group), group);
+    s_cache.dirty |= DIRTY_GROUP;
 }
 
 // =============================================================================
@@ -117,18 +379,14 @@ void storage_set_plant_name(const String &name) {
 // =============================================================================
 
 bool storage_get_deep_sleep_enabled() {
-#if DEBUG_NO_SLEEP
-    const bool default_enabled = false;
-#else
-    const bool default_enabled = true;
-#endif
-    return prefs.getBool(NVS_KEY_DEEP_SLEEP_ENABLED, default_enabled);
+    return s_cache.deep_sleep_enabled;
 }
 
 void storage_set_deep_sleep_enabled(bool enabled) {
-    prefs.putBool(NVS_KEY_DEEP_SLEEP_ENABLED, enabled);
+    s_cache.deep_sleep_enabled = enabled;
+    s_cache.dirty |= DIRTY_DEEP_SLEEP;
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.print("[STORAGE] Deep sleep ");
     Serial.println(enabled ? "ENABLED" : "DISABLED");
     #endif
@@ -138,77 +396,142 @@ void storage_set_deep_sleep_enabled(bool enabled) {
 // MQTT COMMAND DEDUPLICATION
 // =============================================================================
 
-String storage_get_last_command_id() {
-    return prefs.getString(NVS_KEY_LAST_CMD_ID, "");
+const char *storage_get_last_command_id() {
+    return s_cache.last_cmd_id;
 }
 
-void storage_set_last_command_id(const String &cmd_id) {
-    prefs.putString(NVS_KEY_LAST_CMD_ID, cmd_id);
+void storage_set_last_command_id(const char *cmd_id) {
+    copy_bounded(s_cache.last_cmd_id, sizeof(s_cache.last_cmd_id), cmd_id);
+    s_cache.dirty |= DIRTY_LAST_CMD_ID;
 }
 
 // =============================================================================
 // WATERING TIMESTAMP
 // =============================================================================
 
-uint32_t storage_get_last_watering_time() {
-    return prefs.getULong(NVS_KEY_LAST_WATERING, 0);
+uint32_t storage_get_last_watering_time(uint8_t ch) {
+    return chan(ch).last_watering;
 }
 
-void storage_set_last_watering_time(uint32_t timestamp) {
-    prefs.putULong(NVS_KEY_LAST_WATERING, timestamp);
+void storage_set_last_watering_time(uint8_t ch, uint32_t timestamp) {
+    chan(ch).last_watering = timestamp;
+    s_cache.dirty |= DIRTY_LAST_WATERING;
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.print("[STORAGE] Last watering time set to: ");
     Serial.println(timestamp);
     #endif
 }
 
+// =============================================================================
+// SOIL RESPONSE MODEL
+// =============================================================================
+
+uint16_t storage_get_soil_gain(uint8_t ch) {
+    return chan(ch).soil_gain;
+}
+
+uint32_t storage_get_soil_settle_ms(uint8_t ch) {
+    return chan(ch).soil_settle_ms;
+}
+
+void storage_set_soil_model(uint8_t ch, uint16_t gain, uint32_t settle_ms) {
+    StorageChannel &c = chan(ch);
+    if (gain == c.soil_gain && settle_ms == c.soil_settle_ms) {
+        return;
+    }
+    c.soil_gain = gain;
+    c.soil_settle_ms = settle_ms;
+    s_cache.dirty |= DIRTY_SOIL_MODEL;
+}
+
+// =============================================================================
+// TELEMETRY LOG CURSOR
+// =============================================================================
+
+uint32_t storage_get_telemetry_upload_seq() {
+    return s_cache.tlm_upload_seq;
+}
+
+void storage_set_telemetry_upload_seq(uint32_t seq) {
+    if (seq == s_cache.tlm_upload_seq) {
+        return;
+    }
+    s_cache.tlm_upload_seq = seq;
+    s_cache.dirty |= DIRTY_TLM_UPLOAD;
+}
+
+// =============================================================================
+// OTA UPDATE JOB
+// =============================================================================
+
+const StorageOtaJob *storage_get_ota_job() {
+    return &s_cache.ota;
+}
+
+void storage_set_ota_job(const StorageOtaJob *job) {
+    if (job == nullptr) {
+        memset(&s_cache.ota, 0, sizeof(s_cache.ota));
+    } else {
+        s_cache.ota = *job;
+        s_cache.ota.url[sizeof(s_cache.ota.url) - 1] = '\0';
+    }
+    s_cache.dirty |= DIRTY_OTA_JOB;
+}
+
+void storage_set_ota_progress(uint32_t offset, uint32_t size) {
+    if (offset == s_cache.ota.offset && size == s_cache.ota.size) {
+        return;
+    }
+    s_cache.ota.offset = offset;
+    s_cache.ota.size   = size;
+    s_cache.dirty |= DIRTY_OTA_PROGRESS;
+}
+
 // =============================================================================
 // PERSISTENT TIME TRACKING
 // =============================================================================
 
 /**
- * Persistent time is calculated by accumulating:
- *   sleep_duration_sec  (time spent in deep sleep before this wake)
- *   awake_duration_sec  (time spent awake during this cycle)
- *
- * Caller passes the appropriate sleep duration:
- *   Timer wake  → MEASUREMENT_INTERVAL_SEC
- *   Power-on    → 0 (no prior sleep)
- *   Button wake → not called (no time added)
+ * Persistent time comes from rtc_clock (RTC timer, NTP disciplined). NVS
+ * only receives it together with the boot counter, so the clock can be
+ * seeded after a power loss without writing flash on every wake.
  */
 
 uint32_t storage_get_persistent_time() {
-    return prefs.getULong(NVS_KEY_TOTAL_TIME, 0);
+    return rtc_clock_now_sec();
 }
 
-void storage_increment_boot_count(uint32_t sleep_duration_sec,
-                                  uint32_t awake_duration_sec) {
-    uint32_t boot_count = prefs.getULong(NVS_KEY_BOOT_COUNT, 0);
-    uint32_t total_time = prefs.getULong(NVS_KEY_TOTAL_TIME, 0);
-    
-    boot_count++;
-    prefs.putULong(NVS_KEY_BOOT_COUNT, boot_count);
-    
-    
-    total_time += sleep_duration_sec + awake_duration_sec;
-    prefs.putULong(NVS_KEY_TOTAL_TIME, total_time);
+void storage_increment_boot_count(bool power_on) {
+    ++s_cache.boot_count;
+
+    // Counters live in RTC memory; flash only gets them every N wakes and
+    // on power-on to limit wear.
+    const uint16_t commit_wakes = s_counter_log ? COUNTER_LOG_COMMIT_WAKES : STORAGE_COUNTER_COMMIT_WAKES;
+    s_cache.wakes_since_commit++;
+    if (power_on || s_cache.wakes_since_commit >= commit_wakes) {
+        s_cache.dirty |= DIRTY_COUNTERS;
+    }
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.print("[STORAGE] Boot count: ");
-    Serial.print(boot_count);
+    Serial.print(s_cache.boot_count);
     Serial.print(", Total time: ");
-    Serial.print(total_time / 3600);
+    Serial.print(rtc_clock_now_sec() / 3600);
     Serial.println(" hours");
     #endif
 }
 
 uint32_t storage_get_boot_count() {
-    return prefs.getULong(NVS_KEY_BOOT_COUNT, 0);
+    return s_cache.boot_count;
 }
 
 void storage_reset_time_tracking() {
-    prefs.putULong(NVS_KEY_BOOT_COUNT, 0);
-    prefs.putULong(NVS_KEY_TOTAL_TIME, 0);
-    prefs.putULong(NVS_KEY_LAST_WATERING, 0);
+    s_cache.boot_count = 0;
+    s_cache.total_time = 0;
+    rtc_clock_reset(0);
+    for (uint8_t i = 0; i < PLANT_CHANNEL_COUNT; ++i) {
+        s_cache.ch[i].last_watering = 0;
+    }
+    s_cache.dirty |= DIRTY_COUNTERS | DIRTY_LAST_WATERING;
 }
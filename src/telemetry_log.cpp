@@ -0,0 +1,331 @@
+/**
+ * telemetry_log.cpp - On-device telemetry history implementation
+ *
+ * Sequence number seq lives at:
+ *   RTC ring   ring[seq % TELEMETRY_RTC_RECORDS]   for flash_seq <= seq < write_seq
+ *   flash      record (seq % capacity)             for seq < flash_seq
+ *
+ * Flash is written one 16-byte record at a time into pre-erased slots;
+ * a sector is erased when the first record of it is written, so at least
+ * (capacity - one sector) of history is always readable.
+ */
+
+#include "telemetry_log.h"
+#include "config.h"
+#include "storage.h"
+#include "measurement.h"
+#include "hw_init.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_partition.h"
+#include <string.h>
+
+static_assert(sizeof(TelemetryRecord) == 16, "TelemetryRecord must stay 16 bytes");
+
+#define TLM_MAGIC               0x544C4731UL   // "TLG1"
+#define TLM_SECTOR_SIZE         4096U
+#define TLM_RECORDS_PER_SECTOR  (TLM_SECTOR_SIZE / sizeof(TelemetryRecord))
+#define TLM_SEQ_ERASED          0xFFFFFFFFUL
+
+// =============================================================================
+// STATE
+// =============================================================================
+
+typedef struct {
+    uint32_t magic;
+    uint32_t write_seq;            // next sequence number to assign
+    uint32_t flash_seq;            // first seq not yet spilled to flash
+    uint32_t upload_seq;           // first seq not yet uploaded
+    uint16_t wakes_since_upload;
+    TelemetryRecord ring[TELEMETRY_RTC_RECORDS];
+} TelemetryLogState;
+
+static RTC_DATA_ATTR TelemetryLogState s_log;
+
+// Flash ring, looked up each wake (0 capacity = RTC only)
+static const esp_partition_t *s_part = nullptr;
+static uint32_t s_capacity = 0;
+
+// =============================================================================
+// RECORD HELPERS
+// =============================================================================
+
+static uint8_t crc8(const uint8_t *data, size_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+        crc ^= *data++;
+        for (uint8_t i = 0; i < 8; ++i) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void record_seal(TelemetryRecord *rec) {
+    rec->crc = crc8((const uint8_t *)rec, sizeof(*rec) - 1);
+}
+
+static bool record_valid(const TelemetryRecord &rec) {
+    return rec.seq != TLM_SEQ_ERASED &&
+           rec.crc == crc8((const uint8_t *)&rec, sizeof(rec) - 1);
+}
+
+// =============================================================================
+// FLASH RING
+// =============================================================================
+
+static size_t flash_offset(uint32_t seq) {
+    return (size_t)(seq % s_capacity) * sizeof(TelemetryRecord);
+}
+
+static bool flash_read(uint32_t seq, TelemetryRecord *out) {
+    return esp_partition_read(s_part, flash_offset(seq), out, sizeof(*out)) == ESP_OK &&
+           record_valid(*out) && out->seq == seq;
+}
+
+static bool flash_write(const TelemetryRecord &rec) {
+    const size_t offset = flash_offset(rec.seq);
+    if ((offset % TLM_SECTOR_SIZE) == 0 &&
+        esp_partition_erase_range(s_part, offset, TLM_SECTOR_SIZE) != ESP_OK) {
+        return false;
+    }
+    return esp_partition_write(s_part, offset, &rec, sizeof(rec)) == ESP_OK;
+}
+
+/**
+ * Find the next sequence number after power loss: the sector whose
+ * first record has the highest seq is the head, the last valid record
+ * in it is the newest.
+ */
+static uint32_t flash_recover_write_seq() {
+    const uint32_t sectors = s_capacity / TLM_RECORDS_PER_SECTOR;
+    int32_t head = -1;
+    uint32_t head_seq = 0;
+    TelemetryRecord rec;
+
+    for (uint32_t s = 0; s < sectors; ++s) {
+        if (esp_partition_read(s_part, s * TLM_SECTOR_SIZE, &rec, sizeof(rec)) != ESP_OK ||
+            !record_valid(rec)) {
+            continue;
+        }
+        if (head < 0 || rec.seq > head_seq) {
+            head = (int32_t)s;
+            head_seq = rec.seq;
+        }
+    }
+    if (head < 0) {
+        return 0;   // empty ring
+    }
+
+    uint32_t next = head_seq;
+    for (uint32_t i = 0; i < TLM_RECORDS_PER_SECTOR; ++i) {
+        const size_t offset = (size_t)head * TLM_SECTOR_SIZE + i * sizeof(rec);
+        if (esp_partition_read(s_part, offset, &rec, sizeof(rec)) != ESP_OK ||
+            !record_valid(rec) || rec.seq != head_seq + i) {
+            break;
+        }
+        next = rec.seq + 1;
+    }
+    return next;
+}
+
+static void spill_to_flash() {
+    if (s_capacity == 0) {
+        return;
+    }
+    while (s_log.flash_seq < s_log.write_seq) {
+        if (!flash_write(s_log.ring[s_log.flash_seq % TELEMETRY_RTC_RECORDS])) {
+            #if DEBUG_SERIAL
+            Serial.println("[TLM] Flash write failed");
+            #endif
+            break;
+        }
+        s_log.flash_seq++;
+    }
+}
+
+// Lowest seq still guaranteed readable
+static uint32_t oldest_available_seq() {
+    if (s_capacity == 0) {
+        return s_log.flash_seq;
+    }
+    const uint32_t keep = s_capacity - TLM_RECORDS_PER_SECTOR;
+    return (s_log.flash_seq > keep) ? s_log.flash_seq - keep : 0;
+}
+
+static bool read_record(uint32_t seq, TelemetryRecord *out) {
+    if (seq >= s_log.flash_seq) {
+        *out = s_log.ring[seq % TELEMETRY_RTC_RECORDS];
+        return true;
+    }
+    return s_capacity != 0 && flash_read(seq, out);
+}
+
+// =============================================================================
+// API
+// =============================================================================
+
+void telemetry_log_init() {
+#if TELEMETRY_LOG_ENABLED
+    s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                      TELEMETRY_FLASH_PARTITION);
+    s_capacity = 0;
+    if (s_part != nullptr) {
+        uint32_t sectors = s_part->size / TLM_SECTOR_SIZE;
+        if (sectors > TELEMETRY_FLASH_SECTORS) sectors = TELEMETRY_FLASH_SECTORS;
+        if (sectors >= 2) {
+            s_capacity = sectors * TLM_RECORDS_PER_SECTOR;
+        }
+    }
+
+    const esp_reset_reason_t reset = esp_reset_reason();
+    if (s_log.magic != TLM_MAGIC || reset == ESP_RST_POWERON) {
+        memset(&s_log, 0, sizeof(s_log));
+        s_log.magic = TLM_MAGIC;
+        s_log.write_seq = (s_capacity != 0) ? flash_recover_write_seq() : 0;
+        s_log.flash_seq = s_log.write_seq;
+        s_log.upload_seq = storage_get_telemetry_upload_seq();
+        if (s_log.upload_seq > s_log.write_seq) {
+            s_log.upload_seq = s_log.write_seq;   // flash was erased
+        }
+        #if DEBUG_SERIAL
+        Serial.print("[TLM] Log restored, next seq ");
+        Serial.print(s_log.write_seq);
+        Serial.print(", flash records ");
+        Serial.println(s_capacity);
+        #endif
+    } else if (reset == ESP_RST_BROWNOUT) {
+        // RTC survived but the supply is failing: move the ring to flash now.
+        spill_to_flash();
+    }
+#endif
+}
+
+void telemetry_log_record_wake(const uint8_t results[PLANT_CHANNEL_COUNT]) {
+    hw_require(HW_TELEMETRY_LOG);
+#if TELEMETRY_LOG_ENABLED
+    const Measurement *m      = measurement_get();
+    const uint32_t ts         = m->ts;
+    const uint16_t battery_mv = m->battery_mv;
+    const uint8_t  water_flag = m->water_ok ? TELEMETRY_FLAG_WATER_OK : 0;
+
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        TelemetryRecord rec;
+        rec.seq        = s_log.write_seq;
+        rec.ts         = ts;
+        rec.raw_soil   = m->raw[ch];
+        rec.battery_mv = battery_mv;
+        rec.humidity   = m->humidity[ch];
+        rec.flags      = water_flag | (uint8_t)(ch << TELEMETRY_FLAG_CHANNEL_SHIFT) |
+                         (uint8_t)(m->fault[ch] << TELEMETRY_FLAG_FAULT_SHIFT);
+        rec.result     = results[ch];
+        record_seal(&rec);
+
+        if (s_log.write_seq - s_log.flash_seq >= TELEMETRY_RTC_RECORDS) {
+            spill_to_flash();
+        }
+        if (s_log.write_seq - s_log.flash_seq >= TELEMETRY_RTC_RECORDS) {
+            s_log.flash_seq++;   // no flash: drop the oldest RTC record
+        }
+        s_log.ring[rec.seq % TELEMETRY_RTC_RECORDS] = rec;
+        s_log.write_seq++;
+    }
+    if (s_log.wakes_since_upload < UINT16_MAX) {
+        s_log.wakes_since_upload++;
+    }
+
+    #if DEBUG_SERIAL
+    Serial.print("[TLM] Wake logged (");
+    Serial.print(PLANT_CHANNEL_COUNT);
+    Serial.print(" records), pending ");
+    Serial.println(telemetry_log_pending());
+    #endif
+#else
+    (void)results;
+#endif
+}
+
+bool telemetry_log_upload_due() {
+    hw_require(HW_TELEMETRY_LOG);
+#if TELEMETRY_LOG_ENABLED
+    // Checked before this wake's record is appended.
+    return (uint32_t)s_log.wakes_since_upload + 1U >= TELEMETRY_UPLOAD_EVERY_WAKES;
+#else
+    return true;
+#endif
+}
+
+void telemetry_log_upload_attempted() {
+    hw_require(HW_TELEMETRY_LOG);
+#if TELEMETRY_LOG_ENABLED
+    // Also reset when the link never came up, so an offline WiFi or
+    // broker costs one radio wake per batch period, not one per wake.
+    s_log.wakes_since_upload = 0;
+#endif
+}
+
+uint32_t telemetry_log_pending() {
+    hw_require(HW_TELEMETRY_LOG);
+    const uint32_t oldest = oldest_available_seq();
+    const uint32_t from = (s_log.upload_seq > oldest) ? s_log.upload_seq : oldest;
+    return (s_log.write_seq > from) ? s_log.write_seq - from : 0;
+}
+
+uint16_t telemetry_log_recent(uint8_t ch, TelemetryRecord *out, uint16_t max) {
+    hw_require(HW_TELEMETRY_LOG);
+    uint16_t n = 0;
+#if TELEMETRY_LOG_ENABLED
+    // The ring keeps its content after a spill, so the last
+    // TELEMETRY_RTC_RECORDS seqs are readable from RTC whatever flash_seq is.
+    const uint32_t depth = (s_log.write_seq < TELEMETRY_RTC_RECORDS) ? s_log.write_seq
+                                                                     : TELEMETRY_RTC_RECORDS;
+    for (uint32_t i = 1; i <= depth && n < max; ++i) {
+        const uint32_t seq = s_log.write_seq - i;
+        const TelemetryRecord &rec = s_log.ring[seq % TELEMETRY_RTC_RECORDS];
+        if (!record_valid(rec) || rec.seq != seq) {
+            break;   // not written since power-on
+        }
+        if (((rec.flags & TELEMETRY_FLAG_CHANNEL_MASK) >> TELEMETRY_FLAG_CHANNEL_SHIFT) == ch) {
+            out[n++] = rec;
+        }
+    }
+#else
+    (void)ch;
+    (void)out;
+    (void)max;
+#endif
+    return n;
+}
+
+uint32_t telemetry_log_upload(TelemetryBatchSink sink) {
+    hw_require(HW_TELEMETRY_LOG);
+#if TELEMETRY_LOG_ENABLED
+    const uint32_t oldest = oldest_available_seq();
+    if (s_log.upload_seq < oldest) {
+        s_log.upload_seq = oldest;   // overwritten before it could be sent
+    }
+
+    TelemetryRecord batch[TELEMETRY_BATCH_RECORDS];
+    uint32_t sent = 0;
+    while (s_log.upload_seq < s_log.write_seq) {
+        uint16_t n = 0;
+        uint32_t seq = s_log.upload_seq;
+        while (n < TELEMETRY_BATCH_RECORDS && seq < s_log.write_seq) {
+            if (read_record(seq, &batch[n])) {
+                n++;
+            }
+            seq++;
+        }
+        const uint16_t accepted = (n > 0) ? sink(batch, n) : 0;
+        if (n > 0 && accepted == 0) {
+            break;
+        }
+        s_log.upload_seq = (accepted < n) ? batch[accepted].seq : seq;
+        sent += accepted;
+    }
+    storage_set_telemetry_upload_seq(s_log.upload_seq);
+    return sent;
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,144 @@
+/**
+ * wake_scheduler.cpp - Adaptive deep sleep interval implementation
+ *
+ * Trend: least-squares slope of humidity over time for the records logged
+ * since the channel was last watered. Integer math only (at most
+ * WAKE_TREND_SAMPLES points, sums fit comfortably in int64).
+ */
+
+#include "wake_scheduler.h"
+#include "storage.h"
+#include "battery.h"
+#include "telemetry_log.h"
+#include "forecast.h"
+
+static uint32_t clamp_u32(uint32_t v, uint32_t lo, uint32_t hi) {
+    return (v < lo) ? lo : (v > hi) ? hi : v;
+}
+
+static bool watered(uint8_t result) {
+    return result == WATER_OK || result == WATER_PARTIAL;
+}
+
+// =============================================================================
+// TREND PREDICTION
+// =============================================================================
+
+/**
+ * Seconds until channel ch is expected to drop below its minimal humidity,
+ * or UINT32_MAX if it is not drying (or there is not enough history).
+ */
+static uint32_t predict_crossing_sec(uint8_t ch) {
+    TelemetryRecord recs[WAKE_TREND_SAMPLES];
+    const uint16_t found = telemetry_log_recent(ch, recs, WAKE_TREND_SAMPLES);
+
+    // Newest first; stop at the wake that watered (its reading is the
+    // post-watering start of the current drying curve).
+    uint16_t n = 0;
+    while (n < found) {
+        const uint8_t result = recs[n].result;
+        if (result == WATER_SENSOR_ERROR) {
+            break;
+        }
+        n++;
+        if (watered(result)) {
+            break;
+        }
+    }
+    if (n < 3) {
+        return UINT32_MAX;
+    }
+
+    int64_t mean_t = 0;
+    int64_t mean_h = 0;
+    for (uint16_t i = 0; i < n; ++i) {
+        mean_t += recs[i].ts;
+        mean_h += recs[i].humidity;
+    }
+    mean_t /= n;
+    mean_h /= n;
+
+    int64_t num = 0;   // sum dt * dh  [s * %]
+    int64_t den = 0;   // sum dt^2     [s^2]
+    for (uint16_t i = 0; i < n; ++i) {
+        const int64_t dt = (int64_t)recs[i].ts - mean_t;
+        const int64_t dh = (int64_t)recs[i].humidity - mean_h;
+        num += dt * dh;
+        den += dt * dt;
+    }
+    if (den == 0 || num >= 0) {
+        return UINT32_MAX;   // flat or getting wetter
+    }
+
+    const uint8_t now_h = recs[0].humidity;
+    const uint8_t min_h = storage_get_minimal_humidity(ch);
+    if (now_h <= min_h) {
+        return 0;
+    }
+    // (now - min) [%] / slope [%/s], slope = num / den
+    const int64_t sec = ((int64_t)(now_h - min_h) * den) / -num;
+    return (sec > (int64_t)UINT32_MAX) ? UINT32_MAX : (uint32_t)sec;
+}
+
+// =============================================================================
+// API
+// =============================================================================
+
+uint32_t wake_scheduler_next_interval(const WateringResult *results) {
+#if WAKE_ADAPTIVE_ENABLED
+    uint32_t interval = UINT32_MAX;
+    bool confirm = false;
+
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        if (results != nullptr && watered(results[ch])) {
+            confirm = true;
+            continue;
+        }
+        uint32_t predicted = predict_crossing_sec(ch);
+        bool rain_hold = false;
+#if FORECAST_ENABLED
+        // The forecast crossing wins when it is earlier or there is no
+        // trend; a rain hold (already below minimal) replaces the trend.
+        const uint32_t planned = forecast_next_check_sec(ch, &rain_hold);
+        if (rain_hold || planned < predicted) {
+            predicted = planned;
+        }
+#endif
+        if (predicted == UINT32_MAX) {
+            predicted = MEASUREMENT_INTERVAL_SEC;
+        } else if (!rain_hold) {
+            predicted -= (uint32_t)(((uint64_t)predicted * WAKE_PREDICT_MARGIN_PCT) / 100U);
+        }
+        // Waking before the channel may be watered again is a wasted wake
+        const uint32_t locked = watering_get_seconds_until_allowed(ch);
+        if (predicted < locked) {
+            predicted = locked;
+        }
+        if (predicted < interval) {
+            interval = predicted;
+        }
+    }
+    if (confirm && interval > WAKE_CONFIRM_INTERVAL_SEC) {
+        interval = WAKE_CONFIRM_INTERVAL_SEC;
+    }
+
+    const bool stretch = !confirm && battery_get_percent() < WAKE_BATTERY_STRETCH_PCT;
+    if (stretch) {
+        interval = (interval > UINT32_MAX / WAKE_BATTERY_STRETCH_FACTOR)
+                       ? UINT32_MAX : interval * WAKE_BATTERY_STRETCH_FACTOR;
+    }
+    interval = clamp_u32(interval, WAKE_MIN_INTERVAL_SEC, WAKE_MAX_INTERVAL_SEC);
+
+    #if DEBUG_SERIAL
+    Serial.print("[WAKE] Next interval ");
+    Serial.print(interval);
+    Serial.print(" s");
+    Serial.print(confirm ? " (confirm watering)" : "");
+    Serial.println(stretch ? " (battery stretch)" : "");
+    #endif
+    return interval;
+#else
+    (void)results;
+    return MEASUREMENT_INTERVAL_SEC;
+#endif
+}
@@ -8,6 +8,7 @@
 
 #include "water_level.h"
 #include "config.h"
+#include "hw_init.h"
 
 // =============================================================================
 // INITIALIZATION
@@ -16,7 +17,7 @@
 void water_level_init() {
     pinMode(PIN_WATER_LEVEL, INPUT_PULLUP);
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.println("[WATER_LEVEL] Initialized");
     #endif
 }
@@ -39,10 +40,11 @@ static bool water_level_low_stable() {
 // =============================================================================
 
 bool water_level_ok() {
+    hw_require(HW_WATER_LEVEL);
     // Switch open (enough water) → pin pulled HIGH
     bool status = !water_level_low_stable();
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.print("[WATER_LEVEL] Status: ");
     Serial.println(status ? "OK" : "LOW");
     #endif
@@ -51,10 +53,11 @@ bool water_level_ok() {
 }
 
 bool water_level_low() {
+    hw_require(HW_WATER_LEVEL);
     // Switch closed (water low) → pin pulled LOW
     bool status = water_level_low_stable();
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.print("[WATER_LEVEL] Check result: ");
     Serial.println(status ? "LOW" : "OK");
     #endif
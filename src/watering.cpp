@@ -1,9 +1,9 @@
 /**
  * watering.cpp - Core watering decision logic implementation
  * 
- * DECISION FLOW:
+ * DECISION FLOW (per plant channel; all sensors are read in one ADC pass):
  * ┌─────────────────────┐
- * │ Read Soil Sensor    │
+ * │ Read Soil Sensors   │
  * └──────────┬──────────┘
  *            ▼
  * ┌─────────────────────┐
@@ -32,9 +32,10 @@
  *           Yes
  *            ▼
  * ┌─────────────────────────────────────────┐
- * │ PULSE LOOP:                             │
- * │  1. Run pump (PUMP_RUN_DURATION_MS)     │
- * │  2. Wait soak time (SOAK_WAIT_TIME_MS)  │
+ * │ PULSE LOOP (per channel, concurrent):   │
+ * │  1. Run pump (model-sized pulse, up to  │
+ * │     PUMP_MAX_CONCURRENT at once)        │
+ * │  2. Soak until settled                  │
  * │  3. Re-read sensor                      │
  * │  4. Humidity >= Max? → stop (OK)        │
  * │  5. Pulses >= MAX_PUMP_PULSES? → stop   │
@@ -52,34 +53,39 @@
 #include "config.h"
 #include "storage.h"
 #include "sensor.h"
+#include "measurement.h"
 #include "battery.h"
-#include "pump.h"
-#include "motor.h"
+#include "actuator.h"
 #include "water_level.h"
-
-static inline bool actuator_run_timed(uint32_t duration_ms) {
-#if (ACTUATOR_TYPE == ACTUATOR_TYPE_STEPPER)
-    return motor_run_timed(duration_ms);
-#else
-    return pump_run_timed(duration_ms);
-#endif
-}
+#include "mqtt_control.h"
+#include "forecast.h"
+#include "soil_model.h"
+#include "hw_init.h"
+#include "profiler.h"
+#include "power_log.h"
+#include "leds.h"
+#include "esp_sleep.h"
 
 // =============================================================================
 // INTERNAL STATE
 // =============================================================================
 
-// Cache for current readings (refreshed each wake cycle)
-static int16_t  current_humidity   = -1;   // -1 = not yet read
-static uint16_t current_raw_sensor = 0;
+// Cache for current readings (refreshed each wake cycle), -1 = not yet read
+static int16_t current_humidity[PLANT_CHANNEL_COUNT];
+
+static uint8_t clamp_channel(uint8_t ch) {
+    return (ch < PLANT_CHANNEL_COUNT) ? ch : 0;
+}
 
 // =============================================================================
 // INITIALIZATION
 // =============================================================================
 
 void watering_init() {
-    // Nothing special needed; dependencies initialized separately
-    // Could add self-test here if desired
+    // Dependencies are initialized separately; only reset the reading cache
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        current_humidity[ch] = -1;
+    }
 }
 
 // =============================================================================
@@ -88,49 +94,28 @@ void watering_init() {
 
 /**
  * Get current persistent timestamp in seconds.
- * This value persists across deep sleep cycles by tracking
- * boot count and sleep intervals in NVS.
+ * This value persists across deep sleep cycles (RTC timer clock,
+ * seeded from NVS after power loss).
  */
 static uint32_t get_current_time_sec() {
     return storage_get_persistent_time();
 }
 
 /**
- * Check if minimum interval since last watering has elapsed.
+ * Get seconds remaining until watering channel ch is allowed again.
  */
-static bool interval_elapsed() {
-    uint32_t last_watering = storage_get_last_watering_time();
+static uint32_t get_seconds_until_interval_elapsed(uint8_t ch) {
+    uint32_t last_watering = storage_get_last_watering_time(ch);
     
     // If never watered (timestamp is 0), interval is considered elapsed
     if (last_watering == 0) {
-        return true;
+        return 0;
     }
     
     uint32_t current_time = get_current_time_sec();
     
     // Handle edge case where current time is less than last watering
     // (shouldn't happen, but guard against NVS corruption)
-    if (current_time < last_watering) {
-        return true;
-    }
-    
-    uint32_t elapsed = current_time - last_watering;
-    
-    return (elapsed >= MIN_WATERING_INTERVAL_SEC);
-}
-
-/**
- * Get seconds remaining until watering is allowed again.
- */
-static uint32_t get_seconds_until_interval_elapsed() {
-    uint32_t last_watering = storage_get_last_watering_time();
-    
-    if (last_watering == 0) {
-        return 0;
-    }
-    
-    uint32_t current_time = get_current_time_sec();
-    
     if (current_time < last_watering) {
         return 0;
     }
@@ -144,219 +129,619 @@ static uint32_t get_seconds_until_interval_elapsed() {
     return MIN_WATERING_INTERVAL_SEC - elapsed;
 }
 
+/**
+ * Check if minimum interval since last watering of channel ch has elapsed.
+ */
+static bool interval_elapsed(uint8_t ch) {
+    return get_seconds_until_interval_elapsed(ch) == 0;
+}
+
 // =============================================================================
-// PULSE-PUMP LOOP
+// SOAK WAIT
 // =============================================================================
 
 /**
- * Run the pulse-pump loop: pump → soak → re-read → repeat
- * until humidity >= max_humidity or safety limit reached.
- *
- * @return WATER_OK if max humidity reached,
- *         WATER_PARTIAL if pulse limit / safety stop,
- *         WATER_PUMP_FAILED if first pulse fails
+ * Wait for water to soak into the soil.
+ * Uses timer-woken light sleep: RAM (channel runs, humidity) is retained
+ * and the scheduler simply continues on wake. Falls back to delay() while
+ * the link is up or being brought up, since light sleep would drop it, and
+ * while queued LED output plays, which would freeze mid-pattern.
  */
-static WateringResult pump_until_max() {
-    uint8_t max_hum = storage_get_max_humidity();
-    uint8_t pulses  = 0;
-    bool    reached_max = false;
-
-    #ifdef DEBUG_SERIAL
-    Serial.print("[WATERING] Starting pump loop, max humidity: ");
-    Serial.print(max_hum);
-    Serial.println("%");
-    #endif
+static void soak_wait(uint32_t duration_ms) {
+#if SOAK_LIGHT_SLEEP && !DEBUG_NO_SLEEP
+    const uint32_t start_ms = millis();
+    uint32_t elapsed_ms;
+    while ((elapsed_ms = millis() - start_ms) < duration_ms) {
+        const uint32_t left_ms = duration_ms - elapsed_ms;
+        if (left_ms < SOAK_LIGHT_SLEEP_MIN_MS || mqtt_control_radio_active() || leds_busy()) {
+            delay(left_ms < SOAK_POLL_MS ? left_ms : SOAK_POLL_MS);
+            continue;
+        }
 
-    while (pulses < MAX_PUMP_PULSES) {
-        // Battery check belongs to decision logic, before each watering pulse.
-        if (!battery_watering_allowed()) {
-            return (pulses == 0) ? WATER_BATTERY_LOW : WATER_PARTIAL;
+        #if DEBUG_SERIAL
+        Serial.flush();  // UART output is lost once the clocks stop
+        #endif
+        esp_sleep_enable_timer_wakeup((uint64_t)left_ms * 1000ULL);
+        const int64_t span = profiler_start();
+        if (esp_light_sleep_start() != ESP_OK) {
+            delay(left_ms < SOAK_POLL_MS ? left_ms : SOAK_POLL_MS);
+        } else {
+            profiler_stop(PROF_SOAK, span);
         }
+    }
+#else
+    delay(duration_ms);
+#endif
+}
 
-        // Run pump for one pulse
-        bool pump_success = actuator_run_timed(PUMP_RUN_DURATION_MS);
-        if (!pump_success) {
-            #ifdef DEBUG_SERIAL
-            Serial.print("[WATERING] Pump pulse ");
-            Serial.print(pulses + 1);
-            Serial.println(" FAILED!");
-            #endif
-            // First pulse failed → pump error; later failure → partial success
-            if (pulses == 0) return WATER_PUMP_FAILED;
-            break;
+// =============================================================================
+// CHANNEL SCHEDULER
+// =============================================================================
+
+// Cooperative scheduler: the pulse-pump loop of each channel is a state
+// machine with one deadline (pump off or next soak sample). Each pass
+// handles every expired deadline, starts due pulses while the pump budget
+// allows, then sleeps until the earliest deadline. Total watering time
+// follows the slowest channel instead of the sum of all channels.
+typedef enum {
+    RUN_IDLE,        // not watering this wake
+    RUN_PUMP_DUE,    // next pulse may start
+    RUN_PUMPING,     // pump on until deadline_ms
+    RUN_SOAKING,     // sampling until settled or soak limit
+    RUN_DONE         // result is final
+} RunState;
+
+typedef struct {
+    RunState       state;
+    WateringResult result;
+    uint8_t        pulses;
+    uint8_t        before;          // humidity before the current pulse (%)
+    int16_t        previous;        // previous soak sample (%), -1 = none
+    uint32_t       pulse_ms;        // model size, pump time at nominal flow
+    uint32_t       soak_start_ms;
+    uint32_t       soak_max_ms;
+    uint32_t       deadline_ms;     // pump off (PUMPING) or next sample (SOAKING)
+    int64_t        pump_start_us;   // profiler span of the current pulse
+#if BATTERY_LOAD_AWARE
+    bool           load_pending;    // battery not yet sampled under this pulse
+    uint32_t       load_sample_ms;
+#endif
+} ChannelRun;
+
+static bool deadline_passed(uint32_t deadline_ms, uint32_t now_ms) {
+    return (int32_t)(deadline_ms - now_ms) <= 0;
+}
+
+static void run_finish(uint8_t ch, ChannelRun &run, WateringResult result) {
+    run.state  = RUN_DONE;
+    run.result = result;
+
+    #if DEBUG_SERIAL
+    Serial.print("[WATERING] ch");
+    Serial.print(ch);
+    Serial.print(" pump sequence complete: ");
+    Serial.print(run.pulses);
+    Serial.print(" pulses, result: ");
+    Serial.println(result == WATER_OK ? "OK" : "PARTIAL/STOPPED");
+    #else
+    (void)ch;
+    #endif
+}
+
+/**
+ * Pumps that may run at the same time. Every motor adds its stall
+ * current to the battery load, so a weakening battery gets fewer.
+ */
+static uint8_t pump_budget() {
+    switch (battery_get_state()) {
+        case BATTERY_OK:      return PUMP_MAX_CONCURRENT;
+        case BATTERY_WARNING: return 1;
+        default:              return 0;
+    }
+}
+
+#if BATTERY_LOAD_AWARE
+/**
+ * Headroom of one more pulse: predicted pack voltage with running + 1
+ * pumps on, minus brown-out and margin. With nothing running the resting
+ * voltage is re-read first; the pack has recovered from earlier pulses.
+ */
+static int32_t pulse_headroom_mv(uint8_t running) {
+    if (running == 0) {
+        battery_sample_rest_mv();
+    }
+    return (int32_t)battery_predict_load_mv(running + 1) -
+           (int32_t)(BATTERY_BROWNOUT_MV + BATTERY_LOAD_MARGIN_MV);
+}
+
+// One loaded reading covers every pulse that is due for one.
+static void sample_load(ChannelRun runs[PLANT_CHANNEL_COUNT], uint32_t now_ms) {
+    uint8_t pumping = 0;
+    bool due = false;
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        if (runs[ch].state != RUN_PUMPING) {
+            continue;
+        }
+        pumping++;
+        due = due || (runs[ch].load_pending && deadline_passed(runs[ch].load_sample_ms, now_ms));
+    }
+    if (!due) {
+        return;
+    }
+    battery_sample_load_mv(pumping);
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        if (runs[ch].state == RUN_PUMPING && deadline_passed(runs[ch].load_sample_ms, now_ms)) {
+            runs[ch].load_pending = false;
         }
-        pulses++;
+    }
+}
+#endif
+
+// Next sample time: every SOAK_SAMPLE_MS, never past the soak limit.
+// Without the soil model there is a single reading at the limit.
+static void schedule_sample(ChannelRun &run, uint32_t now_ms) {
+    const uint32_t limit_ms = run.soak_start_ms + run.soak_max_ms;
+#if SOIL_MODEL_ENABLED
+    const uint32_t next_ms = now_ms + SOAK_SAMPLE_MS;
+    run.deadline_ms = deadline_passed(limit_ms, next_ms) ? limit_ms : next_ms;
+#else
+    (void)now_ms;
+    run.deadline_ms = limit_ms;
+#endif
+}
 
-        #ifdef DEBUG_SERIAL
-        Serial.print("[WATERING] Pump pulse ");
-        Serial.print(pulses);
-        Serial.println(" complete, waiting for soak...");
+/**
+ * Start the next pulse of a channel, sized to land just below its target.
+ * The reservoir is re-checked before every pulse after the first; the
+ * battery is covered by the pump budget. A shortened pulse (little load
+ * headroom) delivers half the volume; the next soak lets the pack recover.
+ */
+static void run_start_pulse(uint8_t ch, ChannelRun &run, bool shorten) {
+    if (run.pulses > 0 && water_level_low()) {
+        #if DEBUG_SERIAL
+        Serial.println("[WATERING] Water level check failed during pump loop");
         #endif
+        run_finish(ch, run, WATER_PARTIAL);
+        return;
+    }
 
-        // Wait for water to soak into soil before re-reading
-        delay(SOAK_WAIT_TIME_MS);
+    const uint8_t max_hum = storage_get_max_humidity(ch);
+    run.before   = (current_humidity[ch] < 0) ? 0 : (uint8_t)current_humidity[ch];
+    run.pulse_ms = soil_model_pulse_ms(ch, run.before, max_hum);
+    if (run.pulse_ms > PUMP_MAX_DURATION_MS) {
+        run.pulse_ms = PUMP_MAX_DURATION_MS;
+    }
+    if (shorten) {
+        run.pulse_ms /= 2;
+    }
+    // Deliver the volume the model asked for; battery sag stretches the
+    // pump time instead of shrinking the dose.
+    const uint32_t volume_ul = actuator_ul_for_ms(run.pulse_ms);
+    uint32_t on_ms = 0;
+    run.pump_start_us = profiler_start();
+    if (!actuator_start_ul(ch, volume_ul, &on_ms)) {
+        #if DEBUG_SERIAL
+        Serial.print("[WATERING] ch");
+        Serial.print(ch);
+        Serial.print(" pump pulse ");
+        Serial.print(run.pulses + 1);
+        Serial.println(" FAILED!");
+        #endif
+        // First pulse failed → pump error; later failure → partial success
+        run_finish(ch, run, (run.pulses == 0) ? WATER_PUMP_FAILED : WATER_PARTIAL);
+        return;
+    }
+    power_log_phase(POWER_PHASE_PUMP, true);
+    run.pulses++;
+    run.state       = RUN_PUMPING;
+    run.deadline_ms = millis() + on_ms;
+#if BATTERY_LOAD_AWARE
+    run.load_pending   = true;
+    run.load_sample_ms = millis() + BATTERY_LOAD_SAMPLE_MS;
+#endif
 
-        // Re-read sensor
-        uint16_t raw = sensor_read_raw();
-        if (!sensor_reading_valid(raw)) {
-            #ifdef DEBUG_SERIAL
-            Serial.println("[WATERING] ERROR: Sensor invalid during pump loop!");
-            #endif
-            // Sensor error mid-loop — we already delivered water, stop safely
-            break;
-        }
-        current_humidity = sensor_raw_to_humidity_percent(raw);
+    #if DEBUG_SERIAL
+    Serial.print("[WATERING] ch");
+    Serial.print(ch);
+    Serial.print(" pump pulse ");
+    Serial.print(run.pulses);
+    Serial.print(" (");
+    Serial.print(volume_ul);
+    Serial.print(" uL, ");
+    Serial.print(on_ms);
+    Serial.print(" ms) started");
+    Serial.println(shorten ? ", shortened for battery load" : "");
+    #endif
+}
 
-        #ifdef DEBUG_SERIAL
-        Serial.print("[WATERING] Post-soak humidity: ");
-        Serial.print(current_humidity);
-        Serial.println("%");
+// Pulse done: pump off, soak before re-reading (settle detection may end it early).
+static void run_stop_pulse(ChannelRun &run, uint8_t ch, uint32_t now_ms) {
+    actuator_stop(ch);
+    measurement_invalidate();
+    profiler_stop(PROF_PUMP, run.pump_start_us);
+    power_log_phase(POWER_PHASE_PUMP, false);
+    run.state         = RUN_SOAKING;
+    run.previous      = -1;
+    run.soak_start_ms = now_ms;
+    run.soak_max_ms   = soil_model_soak_ms(ch);
+    schedule_sample(run, now_ms);
+}
+
+/**
+ * Feed one soak sample to a channel. Ends the soak once two consecutive
+ * readings differ by no more than SOAK_SETTLE_DELTA (after SOAK_MIN_MS)
+ * or the soak limit is reached, then learns from the pulse and decides
+ * whether another one is needed.
+ */
+static void run_sample(uint8_t ch, ChannelRun &run, uint16_t raw, uint32_t now_ms) {
+    const uint32_t soaked_ms = now_ms - run.soak_start_ms;
+    const bool at_limit = soaked_ms >= run.soak_max_ms;
+    const bool valid = sensor_reading_valid(raw);
+    const int16_t humidity = valid ? (int16_t)sensor_raw_to_humidity_percent(ch, raw) : -1;
+
+    bool settled = false;
+#if SOIL_MODEL_ENABLED
+    settled = valid && run.previous >= 0 &&
+              abs(humidity - run.previous) <= SOAK_SETTLE_DELTA &&
+              soaked_ms >= SOAK_MIN_MS;
+#endif
+    run.previous = humidity;
+
+    if (!settled && !at_limit) {
+        schedule_sample(run, now_ms);
+        return;
+    }
+
+    if (!valid) {
+        #if DEBUG_SERIAL
+        Serial.println("[WATERING] ERROR: Sensor invalid during pump loop!");
         #endif
+        // Sensor error mid-loop — we already delivered water, stop safely
+        run_finish(ch, run, WATER_PARTIAL);
+        return;
+    }
 
-        // Target reached?
-        if (current_humidity >= max_hum) {
-            #ifdef DEBUG_SERIAL
-            Serial.println("[WATERING] Target humidity reached!");
-            #endif
-            reached_max = true;
-            break;
+    current_humidity[ch] = humidity;
+    soil_model_learn(ch, run.pulse_ms, run.before, (uint8_t)humidity, soaked_ms, settled);
+
+    #if DEBUG_SERIAL
+    Serial.print("[WATERING] ch");
+    Serial.print(ch);
+    Serial.print(" post-soak humidity: ");
+    Serial.print(humidity);
+    Serial.println("%");
+    #endif
+
+    if (humidity >= storage_get_max_humidity(ch)) {
+        run_finish(ch, run, WATER_OK);
+    } else if (run.pulses >= MAX_PUMP_PULSES) {
+        run_finish(ch, run, WATER_PARTIAL);
+    } else {
+        run.state = RUN_PUMP_DUE;
+    }
+}
+
+// Start due pulses while the budget allows. A channel that cannot start
+// because the battery forbids any pump at all is finished. With the load
+// model, pulses start one at a time (each after the previous one was
+// sampled) and only while the predicted dip stays clear of brown-out.
+static void run_start_due(ChannelRun runs[PLANT_CHANNEL_COUNT]) {
+    uint8_t running = 0;
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        if (runs[ch].state == RUN_PUMPING) {
+            running++;
+#if BATTERY_LOAD_AWARE
+            if (runs[ch].load_pending) {
+                return;   // retried after the load sample
+            }
+#endif
         }
+    }
 
-        // Safety re-checks before next pulse
-        if (!battery_watering_allowed()) {
-            #ifdef DEBUG_SERIAL
+    uint8_t budget = 0;
+    bool budget_read = false;
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        ChannelRun &run = runs[ch];
+        if (run.state != RUN_PUMP_DUE) {
+            continue;
+        }
+        if (!budget_read) {
+            budget = pump_budget();
+            budget_read = true;
+        }
+        if (budget == 0) {
+            #if DEBUG_SERIAL
             Serial.println("[WATERING] Battery check failed during pump loop");
             #endif
-            break;
+            run_finish(ch, run, (run.pulses == 0) ? WATER_BATTERY_LOW : WATER_PARTIAL);
+            continue;
         }
-        if (water_level_low()) {
-            #ifdef DEBUG_SERIAL
-            Serial.println("[WATERING] Water level check failed during pump loop");
+        if (running >= budget) {
+            return;   // retried once a running pump stops
+        }
+#if BATTERY_LOAD_AWARE
+        const int32_t headroom = pulse_headroom_mv(running);
+        if (headroom < 0) {
+            if (running > 0) {
+                return;   // retried with fewer pumps on
+            }
+            #if DEBUG_SERIAL
+            Serial.print("[WATERING] Pulse would dip the battery to ");
+            Serial.print(battery_predict_load_mv(1));
+            Serial.println(" mV, stopping");
             #endif
-            break;
+            run_finish(ch, run, (run.pulses == 0) ? WATER_BATTERY_LOW : WATER_PARTIAL);
+            continue;
+        }
+        run_start_pulse(ch, run, headroom < BATTERY_LOAD_SHORTEN_MV);
+        if (run.state == RUN_PUMPING) {
+            return;   // the next one waits for this pulse's load sample
         }
+#else
+        run_start_pulse(ch, run, false);
+        if (run.state == RUN_PUMPING) {
+            running++;
+        }
+#endif
     }
+}
 
-    #ifdef DEBUG_SERIAL
-    Serial.print("[WATERING] Pump sequence complete: ");
-    Serial.print(pulses);
-    Serial.print(" pulses, result: ");
-    Serial.println(reached_max ? "OK" : "PARTIAL");
-    #endif
+/**
+ * Drive all RUN_PUMP_DUE channels to RUN_DONE. While a pump is on the
+ * wait is a plain delay (GPIO state is not guaranteed across light sleep
+ * and the motor load dominates anyway); pure soak waits light-sleep.
+ * Due samples of all channels share one ADC pass.
+ */
+static void run_channels(ChannelRun runs[PLANT_CHANNEL_COUNT]) {
+    for (;;) {
+        uint32_t now_ms = millis();
+        for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+            if (runs[ch].state == RUN_PUMPING && deadline_passed(runs[ch].deadline_ms, now_ms)) {
+                run_stop_pulse(runs[ch], ch, now_ms);
+            }
+        }
+#if BATTERY_LOAD_AWARE
+        sample_load(runs, now_ms);
+#endif
+
+        run_start_due(runs);
+
+        // A due channel always has a pump running ahead of it here, so
+        // nothing active means every channel is done.
+        bool active = false;
+        bool pumping = false;
+        uint32_t wait_ms = UINT32_MAX;
+        now_ms = millis();
+        for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+            const ChannelRun &run = runs[ch];
+            if (run.state != RUN_PUMPING && run.state != RUN_SOAKING) {
+                continue;
+            }
+            active = true;
+            pumping = pumping || (run.state == RUN_PUMPING);
+            const uint32_t left = deadline_passed(run.deadline_ms, now_ms) ? 0 : run.deadline_ms - now_ms;
+            if (left < wait_ms) {
+                wait_ms = left;
+            }
+#if BATTERY_LOAD_AWARE
+            if (run.state == RUN_PUMPING && run.load_pending) {
+                const uint32_t to_sample = deadline_passed(run.load_sample_ms, now_ms) ? 0 : run.load_sample_ms - now_ms;
+                if (to_sample < wait_ms) {
+                    wait_ms = to_sample;
+                }
+            }
+#endif
+        }
+        if (!active) {
+#if BATTERY_LOAD_AWARE
+            battery_sample_rest_mv();   // rested by the last soak; telemetry reports this
+#endif
+            return;
+        }
+        if (wait_ms > 0) {
+            if (pumping) {
+                delay(wait_ms);
+            } else {
+                soak_wait(wait_ms);
+            }
+        }
 
-    return reached_max ? WATER_OK : WATER_PARTIAL;
+        now_ms = millis();
+        bool sample_due = false;
+        for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+            if (runs[ch].state == RUN_SOAKING && deadline_passed(runs[ch].deadline_ms, now_ms)) {
+                sample_due = true;
+            }
+        }
+        if (!sample_due) {
+            continue;
+        }
+        uint16_t raw[PLANT_CHANNEL_COUNT];
+        sensor_read_raw_all(raw);
+        now_ms = millis();
+        for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+            ChannelRun &run = runs[ch];
+            if (run.state == RUN_SOAKING && deadline_passed(run.deadline_ms, now_ms)) {
+                run_sample(ch, run, raw[ch], now_ms);
+            }
+        }
+    }
 }
 
 // =============================================================================
 // MAIN DECISION LOGIC
 // =============================================================================
 
-WateringResult watering_check_and_execute() {
-    #ifdef DEBUG_SERIAL
-    Serial.println("[WATERING] Starting watering check...");
-    #endif
-    
-    // Step 1: Read sensor once
-    current_raw_sensor = sensor_read_raw();
-    
-    #ifdef DEBUG_SERIAL
-    Serial.print("[WATERING] Sensor raw: ");
-    Serial.println(current_raw_sensor);
+// Most significant outcome of a wake, used for the single LED/log result.
+static uint8_t result_rank(WateringResult r) {
+    switch (r) {
+        case WATER_PUMP_FAILED:   return 7;
+        case WATER_SENSOR_ERROR:  return 6;
+        case WATER_RESERVOIR_LOW: return 5;
+        case WATER_BATTERY_LOW:   return 4;
+        case WATER_PARTIAL:       return 3;
+        case WATER_OK:            return 2;
+        case WATER_TOO_SOON:      return 1;
+        default:                  return 0;  // WATER_NOT_NEEDED
+    }
+}
+
+// Pre-pump checks of one channel against the wake's snapshot; returns
+// WATER_OK if it should be watered. With a forecast, dry soil may be held
+// for likely rain and soil about to dry out is watered early; an early
+// watering that is blocked is reported as not needed.
+static WateringResult check_channel(uint8_t ch, const Measurement *m) {
+    const uint16_t raw = m->raw[ch];
+    #if DEBUG_SERIAL
+    Serial.print("[WATERING] ch");
+    Serial.print(ch);
+    Serial.print(" sensor raw: ");
+    Serial.println(raw);
     #endif
     
-    // Step 2: Validate sensor reading
-    if (!sensor_reading_valid(current_raw_sensor)) {
-        #ifdef DEBUG_SERIAL
-        Serial.println("[WATERING] ERROR: Invalid sensor reading!");
+    // Validate sensor reading (fault class from sensor_measure_all())
+    const SensorFault fault = m->fault[ch];
+    if (fault != SENSOR_OK || !sensor_reading_valid(raw)) {
+        #if DEBUG_SERIAL
+        Serial.print("[WATERING] ERROR: Invalid sensor reading (");
+        Serial.print(sensor_fault_name(fault));
+        Serial.println(")");
         #endif
         return WATER_SENSOR_ERROR;
     }
     
-    // Step 3: Convert to humidity using the same raw reading
-    current_humidity = sensor_raw_to_humidity_percent(current_raw_sensor);
+    current_humidity[ch] = m->humidity[ch];
     
-    #ifdef DEBUG_SERIAL
+    // Check if watering is needed (humidity below minimal threshold)
+    uint8_t minimal = storage_get_minimal_humidity(ch);
+    #if DEBUG_SERIAL
     Serial.print("[WATERING] Current humidity: ");
-    Serial.print(current_humidity);
-    Serial.println("%");
-    #endif
-    
-    // Step 4: Check if watering is needed (humidity below minimal threshold)
-    uint8_t minimal = storage_get_minimal_humidity();
-    #ifdef DEBUG_SERIAL
-    Serial.print("[WATERING] Minimal humidity threshold: ");
+    Serial.print(current_humidity[ch]);
+    Serial.print("%, minimal threshold: ");
     Serial.print(minimal);
     Serial.println("%");
     #endif
     
-    if (current_humidity >= minimal) {
-        #ifdef DEBUG_SERIAL
+#if FORECAST_ENABLED
+    forecast_observe(ch, (uint8_t)current_humidity[ch]);
+    const ForecastPlan plan = forecast_plan(ch, (uint8_t)current_humidity[ch], minimal);
+    if (plan == FORECAST_PLAN_HOLD_RAIN) {
+        #if DEBUG_SERIAL
+        Serial.println("[WATERING] Rain likely - holding watering");
+        #endif
+        return WATER_NOT_NEEDED;
+    }
+    const bool early = (plan == FORECAST_PLAN_WATER_EARLY);
+#else
+    const bool early = false;
+#endif
+
+    if (current_humidity[ch] >= minimal && !early) {
+        #if DEBUG_SERIAL
         Serial.println("[WATERING] Soil moisture OK - no watering needed");
         #endif
         return WATER_NOT_NEEDED;
     }
-    
-    #ifdef DEBUG_SERIAL
-    Serial.println("[WATERING] Soil moisture low - checking conditions...");
+    #if DEBUG_SERIAL
+    if (early) {
+        Serial.println("[WATERING] Forecast: minimal humidity reached soon - watering early");
+    }
     #endif
     
-    // Step 5: Check water reservoir level
-    if (water_level_low()) {
-        #ifdef DEBUG_SERIAL
+    WateringResult blocked = WATER_OK;
+    if (!m->water_ok) {
+        // Check water reservoir level
+        #if DEBUG_SERIAL
         Serial.println("[WATERING] WARNING: Water reservoir low!");
         #endif
-        return WATER_RESERVOIR_LOW;
-    }
-    
-    // Step 6: Check battery
-    if (!battery_watering_allowed()) {
-        #ifdef DEBUG_SERIAL
+        blocked = WATER_RESERVOIR_LOW;
+    } else if (!battery_watering_allowed()) {
+        // Check battery
+        #if DEBUG_SERIAL
         Serial.println("[WATERING] WARNING: Battery too low for watering!");
         #endif
-        return WATER_BATTERY_LOW;
-    }
-    
-    // Step 7: Check minimum interval
-    if (!interval_elapsed()) {
-        uint32_t seconds_left = get_seconds_until_interval_elapsed();
-        #ifdef DEBUG_SERIAL
+        blocked = WATER_BATTERY_LOW;
+    } else if (!interval_elapsed(ch)) {
+        // Check minimum interval
+        #if DEBUG_SERIAL
         Serial.print("[WATERING] Watering interval not elapsed yet. Seconds until allowed: ");
-        Serial.println(seconds_left);
+        Serial.println(get_seconds_until_interval_elapsed(ch));
         #endif
-        return WATER_TOO_SOON;
+        blocked = WATER_TOO_SOON;
     }
     
-    #ifdef DEBUG_SERIAL
-    Serial.println("[WATERING] All conditions met - starting pump sequence...");
+    return (blocked != WATER_OK && early) ? WATER_NOT_NEEDED : blocked;
+}
+
+WateringResult watering_check_and_execute(WateringResult results[PLANT_CHANNEL_COUNT]) {
+    hw_require(HW_WATERING);
+    #if DEBUG_SERIAL
+    Serial.println("[WATERING] Starting watering check...");
     #endif
     
-    // Step 8: Pulse-pump loop — water until max humidity or safety limit
-    WateringResult result = pump_until_max();
+    // Step 1: The wake's snapshot: every channel read in one filtered pass
+    const Measurement *m = measurement_get();
+    
+    // Step 2: Per-channel checks decide which channels get watered
+    ChannelRun runs[PLANT_CHANNEL_COUNT] = {};
+    bool any_due = false;
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        const WateringResult check = check_channel(ch, m);
+        if (check == WATER_OK) {
+            runs[ch].state = RUN_PUMP_DUE;
+            any_due = true;
+        } else {
+            runs[ch].state  = RUN_IDLE;
+            runs[ch].result = check;
+        }
+    }
     
-    // Step 9: Update timestamp (even for partial — water was delivered)
-    if (result == WATER_OK || result == WATER_PARTIAL) {
-        storage_set_last_watering_time(get_current_time_sec());
-        #ifdef DEBUG_SERIAL
-        Serial.println("[WATERING] Watering timestamp updated");
+    // Step 3: Interleaved pulse-pump loops — water until max humidity or safety limit
+    if (any_due) {
+        #if DEBUG_SERIAL
+        Serial.println("[WATERING] All conditions met - starting pump sequence...");
         #endif
+        run_channels(runs);
+    }
+    
+    // Step 4: Update timestamps (even for partial — water was delivered)
+    WateringResult merged = WATER_NOT_NEEDED;
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        const WateringResult result = runs[ch].result;
+        if (result == WATER_OK || result == WATER_PARTIAL) {
+            storage_set_last_watering_time(ch, get_current_time_sec());
+            #if DEBUG_SERIAL
+            Serial.print("[WATERING] Watering timestamp updated, ch");
+            Serial.println(ch);
+            #endif
+        }
+        results[ch] = result;
+        if (result_rank(result) > result_rank(merged)) {
+            merged = result;
+        }
     }
     
-    return result;
+    return merged;
 }
 
 // =============================================================================
 // MANUAL WATERING
 // =============================================================================
 
-WateringResult watering_manual(bool force_override) {
-    #ifdef DEBUG_SERIAL
-    Serial.print("[WATERING] Manual watering requested (force: ");
+WateringResult watering_manual(uint8_t ch, bool force_override) {
+    hw_require(HW_WATERING);
+    ch = clamp_channel(ch);
+
+    #if DEBUG_SERIAL
+    Serial.print("[WATERING] Manual watering requested, ch");
+    Serial.print(ch);
+    Serial.print(" (force: ");
     Serial.println(force_override ? "YES)" : "NO)");
     #endif
     
     // Check water reservoir first (never skip this)
     if (water_level_low()) {
-        #ifdef DEBUG_SERIAL
+        #if DEBUG_SERIAL
         Serial.println("[WATERING] Manual watering BLOCKED: Reservoir low");
         #endif
         return WATER_RESERVOIR_LOW;
@@ -364,38 +749,39 @@ WateringResult watering_manual(bool force_override) {
     
     // Check battery (never skip this)
     if (!battery_watering_allowed()) {
-        #ifdef DEBUG_SERIAL
+        #if DEBUG_SERIAL
         Serial.println("[WATERING] Manual watering BLOCKED: Battery low");
         #endif
         return WATER_BATTERY_LOW;
     }
     
     // Check interval unless forced
-    if (!force_override && !interval_elapsed()) {
-        #ifdef DEBUG_SERIAL
+    if (!force_override && !interval_elapsed(ch)) {
+        #if DEBUG_SERIAL
         Serial.println("[WATERING] Manual watering BLOCKED: Interval not elapsed");
         #endif
         return WATER_TOO_SOON;
     }
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.println("[WATERING] Starting manual watering pump...");
     #endif
     
     // Run pump
-    bool pump_success = actuator_run_timed(PUMP_RUN_DURATION_MS);
+    bool pump_success = actuator_dispense_ml(ch, MANUAL_WATER_ML);
+    measurement_invalidate();
     
     if (!pump_success) {
-        #ifdef DEBUG_SERIAL
+        #if DEBUG_SERIAL
         Serial.println("[WATERING] Manual watering FAILED: Pump error");
         #endif
         return WATER_PUMP_FAILED;
     }
     
     // Update timestamp
-    storage_set_last_watering_time(get_current_time_sec());
+    storage_set_last_watering_time(ch, get_current_time_sec());
     
-    #ifdef DEBUG_SERIAL
+    #if DEBUG_SERIAL
     Serial.println("[WATERING] Manual watering completed successfully");
     #endif
     
@@ -406,25 +792,28 @@ WateringResult watering_manual(bool force_override) {
 // STATUS QUERIES
 // =============================================================================
 
-bool watering_is_allowed() {
+bool watering_is_allowed(uint8_t ch) {
     // Check water level, battery, and interval (not humidity)
-    return water_level_ok() && battery_watering_allowed() && interval_elapsed();
+    return water_level_ok() && battery_watering_allowed() && interval_elapsed(clamp_channel(ch));
 }
 
-uint32_t watering_get_seconds_until_allowed() {
-    return get_seconds_until_interval_elapsed();
+uint32_t watering_get_seconds_until_allowed(uint8_t ch) {
+    return get_seconds_until_interval_elapsed(clamp_channel(ch));
 }
 
-uint8_t watering_get_current_humidity() {
-    if (current_humidity < 0) {
-        current_humidity = sensor_read_humidity_percent();
+uint8_t watering_get_current_humidity(uint8_t ch) {
+    hw_require(HW_WATERING);
+    ch = clamp_channel(ch);
+    if (current_humidity[ch] < 0) {
+        current_humidity[ch] = measurement_get()->humidity[ch];
     }
-    return (uint8_t)current_humidity;
+    return (uint8_t)current_humidity[ch];
 }
 
-bool watering_soil_needs_water() {
-    uint8_t humidity = sensor_read_humidity_percent();
-    uint8_t minimal = storage_get_minimal_humidity();
+bool watering_soil_needs_water(uint8_t ch) {
+    ch = clamp_channel(ch);
+    uint8_t humidity = measurement_get()->humidity[ch];
+    uint8_t minimal = storage_get_minimal_humidity(ch);
     
     return (humidity < minimal);
 }
@@ -0,0 +1,162 @@
+/**
+ * wire_format.cpp - Compact binary MQTT payload codec
+ *
+ * A small cursor over a fixed buffer; the first write past cap marks the
+ * cursor as overflowed and the encoder returns 0, so callers only check
+ * the result once.
+ */
+
+#include "wire_format.h"
+#include <string.h>
+
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    bool overflow;
+} WireWriter;
+
+typedef struct {
+    const uint8_t *buf;
+    size_t len;
+    size_t pos;
+    bool error;
+} WireReader;
+
+// =============================================================================
+// WRITER
+// =============================================================================
+
+static void put_u8(WireWriter *w, uint8_t v) {
+    if (w->len >= w->cap) {
+        w->overflow = true;
+        return;
+    }
+    w->buf[w->len++] = v;
+}
+
+static void put_u16(WireWriter *w, uint16_t v) {
+    put_u8(w, (uint8_t)v);
+    put_u8(w, (uint8_t)(v >> 8));
+}
+
+static void put_u32(WireWriter *w, uint32_t v) {
+    put_u16(w, (uint16_t)v);
+    put_u16(w, (uint16_t)(v >> 16));
+}
+
+static void put_str(WireWriter *w, const char *s) {
+    size_t n = (s != nullptr) ? strlen(s) : 0;
+    if (n > 0xFF) {
+        n = 0xFF;
+    }
+    put_u8(w, (uint8_t)n);
+    if (w->len + n > w->cap) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, s, n);
+    w->len += n;
+}
+
+static WireWriter writer_begin(uint8_t *out, size_t cap, WireMsgType type) {
+    WireWriter w = {out, cap, 0, false};
+    put_u8(&w, WIRE_VERSION);
+    put_u8(&w, (uint8_t)type);
+    return w;
+}
+
+static size_t writer_end(const WireWriter *w) {
+    return w->overflow ? 0 : w->len;
+}
+
+// =============================================================================
+// READER
+// =============================================================================
+
+static uint8_t get_u8(WireReader *r) {
+    if (r->pos >= r->len) {
+        r->error = true;
+        return 0;
+    }
+    return r->buf[r->pos++];
+}
+
+// Copies a length-prefixed string into dst (cap includes the terminator).
+static void get_str(WireReader *r, char *dst, size_t cap) {
+    const size_t n = get_u8(r);
+    if (r->error || n >= cap || r->pos + n > r->len) {
+        r->error = true;
+        dst[0] = '\0';
+        return;
+    }
+    memcpy(dst, r->buf + r->pos, n);
+    dst[n] = '\0';
+    r->pos += n;
+}
+
+// =============================================================================
+// ENCODE
+// =============================================================================
+
+size_t wire_encode_telemetry(uint8_t *out, size_t cap, const char *plant, const WireTelemetry *t) {
+    WireWriter w = writer_begin(out, cap, WIRE_MSG_TELEMETRY);
+    put_u32(&w, t->ts);
+    put_u8(&w, t->humidity);
+    put_u8(&w, t->battery);
+    put_u8(&w, t->min_h);
+    put_u8(&w, t->max_h);
+    put_u8(&w, t->flags);
+    put_str(&w, plant);
+    put_u8(&w, t->channel);
+    return writer_end(&w);
+}
+
+size_t wire_encode_ack(uint8_t *out, size_t cap, const char *plant, uint32_t ts,
+                       const char *cmd_id, const char *cmd, bool ok, const char *detail) {
+    WireWriter w = writer_begin(out, cap, WIRE_MSG_ACK);
+    put_u32(&w, ts);
+    put_u8(&w, ok ? 1 : 0);
+    put_str(&w, plant);
+    put_str(&w, cmd_id);
+    put_str(&w, cmd);
+    put_str(&w, detail);
+    return writer_end(&w);
+}
+
+size_t wire_encode_telemetry_batch(uint8_t *out, size_t cap, const char *plant,
+                                   const TelemetryRecord *records, uint16_t count) {
+    if (count > 0xFF) {
+        count = 0xFF;
+    }
+    WireWriter w = writer_begin(out, cap, WIRE_MSG_TELEMETRY_BATCH);
+    put_str(&w, plant);
+    put_u8(&w, (uint8_t)count);
+    for (uint16_t i = 0; i < count && !w.overflow; ++i) {
+        const TelemetryRecord &r = records[i];
+        put_u32(&w, r.seq);
+        put_u32(&w, r.ts);
+        put_u16(&w, r.raw_soil);
+        put_u16(&w, r.battery_mv);
+        put_u8(&w, r.humidity);
+        put_u8(&w, r.flags);
+        put_u8(&w, r.result);
+    }
+    return writer_end(&w);
+}
+
+// =============================================================================
+// DECODE
+// =============================================================================
+
+bool wire_decode_command(const uint8_t *in, size_t len, WireCommand *out) {
+    WireReader r = {in, len, 0, false};
+    const uint8_t version = get_u8(&r);
+    const uint8_t type = get_u8(&r);
+    if (r.error || version != WIRE_VERSION || type != WIRE_MSG_COMMAND) {
+        return false;
+    }
+    get_str(&r, out->id, sizeof(out->id));
+    get_str(&r, out->cmd, sizeof(out->cmd));
+    return !r.error;
+}
@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""
+Capture BENCH lines from the benchmark firmware and diff them against a
+stored baseline CSV.
+
+Expected firmware line format:
+    BENCH,<name>,<n>,<min>,<median>,<p99>
+
+Names ending in _us are times (lower is better), names ending in _hz are
+rates (higher is better). A benchmark regresses when its median or p99
+moves the wrong way by more than the tolerance. Exit code 1 on regression.
+"""
+
+from __future__ import annotations
+
+import argparse
+import csv
+import sys
+import time
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Dict, Iterable, List, Optional
+
+DEFAULT_BASELINE = Path("test/benchmark/data/bench_baseline.csv")
+DEFAULT_OUTPUT = Path("test/benchmark/data/bench_latest.csv")
+CSV_FIELDS = ["name", "n", "min", "median", "p99"]
+
+
+@dataclass
+class BenchResult:
+    name: str
+    n: int
+    min: int
+    median: int
+    p99: int
+
+    @property
+    def higher_is_better(self) -> bool:
+        return self.name.endswith("_hz")
+
+
+def parse_bench_line(line: str) -> Optional[BenchResult]:
+    if not line.startswith("BENCH,"):
+        return None
+    parts = line.strip().split(",")
+    if len(parts) != 6:
+        return None
+    try:
+        return BenchResult(parts[1], int(parts[2]), int(parts[3]), int(parts[4]), int(parts[5]))
+    except ValueError:
+        return None
+
+
+def parse_lines(lines: Iterable[str]) -> Dict[str, BenchResult]:
+    results: Dict[str, BenchResult] = {}
+    for line in lines:
+        result = parse_bench_line(line)
+        if result is not None:
+            results[result.name] = result
+    return results
+
+
+def capture_serial(port: str, baud: int, timeout_s: float) -> List[str]:
+    import serial  # only needed for live capture
+
+    lines: List[str] = []
+    deadline = time.monotonic() + timeout_s
+    with serial.Serial(port, baud, timeout=0.5) as ser:
+        while time.monotonic() < deadline:
+            raw = ser.readline()
+            if not raw:
+                continue
+            line = raw.decode("utf-8", errors="replace").strip()
+            print(line)
+            if line == "BENCH_DONE":
+                break
+            lines.append(line)
+        else:
+            print(f"Timed out after {timeout_s:.0f}s without BENCH_DONE", file=sys.stderr)
+    return lines
+
+
+def load_csv(path: Path) -> Dict[str, BenchResult]:
+    results: Dict[str, BenchResult] = {}
+    with path.open("r", newline="", encoding="utf-8") as f:
+        for row in csv.DictReader(f):
+            try:
+                results[row["name"]] = BenchResult(
+                    row["name"], int(row["n"]), int(row["min"]), int(row["median"]), int(row["p99"])
+                )
+            except (KeyError, ValueError):
+                continue
+    return results
+
+
+def save_csv(results: Dict[str, BenchResult], path: Path) -> None:
+    path.parent.mkdir(parents=True, exist_ok=True)
+    with path.open("w", newline="", encoding="utf-8") as f:
+        writer = csv.writer(f)
+        writer.writerow(CSV_FIELDS)
+        for r in sorted(results.values(), key=lambda r: r.name):
+            writer.writerow([r.name, r.n, r.min, r.median, r.p99])
+
+
+def change_pct(base: int, value: int, higher_is_better: bool) -> float:
+    """Signed change in percent, positive means worse."""
+    if base == 0:
+        return 0.0
+    delta = (value - base) / base * 100.0
+    return -delta if higher_is_better else delta
+
+
+def compare(current: Dict[str, BenchResult], baseline: Dict[str, BenchResult], tolerance_pct: float) -> int:
+    regressions = 0
+    print(f"{'benchmark':<28} {'base med':>10} {'med':>10} {'d med':>8} {'base p99':>10} {'p99':>10} {'d p99':>8}")
+    for name in sorted(set(current) | set(baseline)):
+        cur = current.get(name)
+        base = baseline.get(name)
+        if cur is None:
+            print(f"{name:<28} missing in this run")
+            continue
+        if base is None:
+            print(f"{name:<28} {'-':>10} {cur.median:>10} {'new':>8} {'-':>10} {cur.p99:>10}")
+            continue
+        d_med = change_pct(base.median, cur.median, cur.higher_is_better)
+        d_p99 = change_pct(base.p99, cur.p99, cur.higher_is_better)
+        worse = d_med > tolerance_pct or d_p99 > tolerance_pct
+        regressions += 1 if worse else 0
+        print(
+            f"{name:<28} {base.median:>10} {cur.median:>10} {d_med:>+7.1f}% "
+            f"{base.p99:>10} {cur.p99:>10} {d_p99:>+7.1f}%{'  REGRESSION' if worse else ''}"
+        )
+    return regressions
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Capture benchmark results and diff them against a baseline")
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--port", help="Serial port of the board running the benchmark env (for example COM8)")
+    source.add_argument("--log", help="Previously captured serial log instead of a live capture")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--timeout", type=float, default=300.0, help="Capture timeout in seconds")
+    parser.add_argument("--baseline", default=str(DEFAULT_BASELINE))
+    parser.add_argument("--out", default=str(DEFAULT_OUTPUT), help="Where to store this run as CSV")
+    parser.add_argument("--tolerance", type=float, default=15.0, help="Allowed median/p99 change in percent")
+    parser.add_argument("--update-baseline", action="store_true", help="Store this run as the new baseline")
+    args = parser.parse_args()
+
+    if args.log:
+        with Path(args.log).open("r", encoding="utf-8", errors="replace") as f:
+            lines = f.readlines()
+    else:
+        lines = capture_serial(args.port, args.baud, args.timeout)
+
+    current = parse_lines(lines)
+    if not current:
+        print("No BENCH lines found", file=sys.stderr)
+        sys.exit(2)
+    save_csv(current, Path(args.out))
+
+    baseline_path = Path(args.baseline)
+    if args.update_baseline:
+        save_csv(current, baseline_path)
+        print(f"Baseline updated: {baseline_path} ({len(current)} benchmarks)")
+        return
+    if not baseline_path.exists():
+        print(f"No baseline at {baseline_path}; run again with --update-baseline to create it")
+        return
+
+    regressions = compare(current, load_csv(baseline_path), args.tolerance)
+    if regressions:
+        print(f"{regressions} benchmark(s) regressed by more than {args.tolerance:.0f}%")
+        sys.exit(1)
+    print("No regressions")
+
+
+if __name__ == "__main__":
+    main()
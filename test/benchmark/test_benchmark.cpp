@@ -0,0 +1,350 @@
+/**
+ * test_benchmark.cpp - Hardware-in-the-loop benchmark of the firmware hot paths
+ *
+ * Links the real firmware modules (everything in src/ except main.cpp) and
+ * times them in a loop on the target board:
+ *   - soil burst read through the ADC sampler at several sample counts,
+ *     plus sensor_read_raw() with the configured ADC_SAMPLER_SAMPLES
+ *   - sensor_raw_to_humidity_percent()
+ *   - storage getters (RTC cache) and setter + storage_commit() (NVS write)
+ *   - achieved vs. requested stepper step rate (stepper builds only)
+ *   - WiFi scan join vs. fast join (cached BSSID + channel)
+ *   - MQTT connect and publish -> echo round trip
+ *
+ * Every benchmark prints one line:
+ *   BENCH,<name>,<n>,<min>,<median>,<p99>
+ * Times are in microseconds (names end in _us), step rates in Hz (_hz).
+ * test/benchmark/bench_compare.py captures these lines and diffs them
+ * against a stored baseline CSV.
+ *
+ * Runs once after boot, then prints BENCH_DONE and idles. Needs secrets.h
+ * for the WiFi / MQTT benchmarks; they are skipped when the join fails.
+ */
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "driver/gpio.h"
+
+#include "config.h"
+#include "hw_init.h"
+#include "adc_sampler.h"
+#include "sensor.h"
+#include "storage.h"
+#include "actuator.h"
+
+#define SERIAL_BAUD 115200
+
+// Iterations per benchmark. NVS writes wear the flash, keep that one small.
+#ifndef BENCH_RUNS
+#define BENCH_RUNS              200
+#endif
+#ifndef BENCH_NVS_RUNS
+#define BENCH_NVS_RUNS          20
+#endif
+#ifndef BENCH_WIFI_RUNS
+#define BENCH_WIFI_RUNS         5
+#endif
+#ifndef BENCH_MQTT_RUNS
+#define BENCH_MQTT_RUNS         20
+#endif
+#ifndef BENCH_STEPPER_RUNS
+#define BENCH_STEPPER_RUNS      3
+#endif
+
+#define BENCH_MAX_RUNS          256
+#define BENCH_WIFI_TIMEOUT_MS   10000
+#define BENCH_MQTT_TIMEOUT_MS   2000
+#define BENCH_STEPPER_RUN_MS    2000
+#define BENCH_MQTT_TOPIC        "plant/bench"
+
+static const uint16_t ADC_SAMPLE_COUNTS[] = {8, 16, 32, 64, 128};
+
+static uint32_t s_samples[BENCH_MAX_RUNS];
+
+// =============================================================================
+// STATISTICS
+// =============================================================================
+
+static void sort_u32(uint32_t *v, uint16_t n) {
+    for (uint16_t i = 1; i < n; ++i) {
+        const uint32_t x = v[i];
+        uint16_t j = i;
+        while (j > 0 && v[j - 1] > x) {
+            v[j] = v[j - 1];
+            --j;
+        }
+        v[j] = x;
+    }
+}
+
+static void bench_report(const char *name, uint32_t *v, uint16_t n) {
+    if (n == 0) {
+        Serial.printf("BENCH_SKIP,%s\n", name);
+        return;
+    }
+    sort_u32(v, n);
+    const uint32_t p99 = v[((uint32_t)(n - 1) * 99U) / 100U];
+    Serial.printf("BENCH,%s,%u,%lu,%lu,%lu\n", name, (unsigned)n,
+                  (unsigned long)v[0], (unsigned long)v[n / 2], (unsigned long)p99);
+}
+
+static uint16_t clamp_runs(uint16_t runs) {
+    return (runs > BENCH_MAX_RUNS) ? BENCH_MAX_RUNS : runs;
+}
+
+// =============================================================================
+// SENSOR / ADC
+// =============================================================================
+
+static void bench_adc() {
+    char name[40];
+    for (uint8_t k = 0; k < sizeof(ADC_SAMPLE_COUNTS) / sizeof(ADC_SAMPLE_COUNTS[0]); ++k) {
+        const uint16_t count = ADC_SAMPLE_COUNTS[k];
+        const uint16_t runs = clamp_runs(BENCH_RUNS);
+        for (uint16_t i = 0; i < runs; ++i) {
+            const int64_t t0 = esp_timer_get_time();
+            (void)adc_sampler_read(adc_soil_channel(0), count, SENSOR_ADC_REDUCE);
+            s_samples[i] = (uint32_t)(esp_timer_get_time() - t0);
+        }
+        snprintf(name, sizeof(name), "adc_read_s%u_us", (unsigned)count);
+        bench_report(name, s_samples, runs);
+    }
+
+    const uint16_t runs = clamp_runs(BENCH_RUNS);
+    for (uint16_t i = 0; i < runs; ++i) {
+        const int64_t t0 = esp_timer_get_time();
+        (void)sensor_read_raw(0);
+        s_samples[i] = (uint32_t)(esp_timer_get_time() - t0);
+    }
+    bench_report("sensor_read_raw_us", s_samples, runs);
+}
+
+static void bench_humidity() {
+    // One call is far below the timer resolution: time 100 per sample
+    const uint16_t runs = clamp_runs(BENCH_RUNS);
+    volatile uint32_t sink = 0;
+    for (uint16_t i = 0; i < runs; ++i) {
+        const int64_t t0 = esp_timer_get_time();
+        for (uint16_t raw = 0; raw < 4000; raw += 40) {
+            sink += sensor_raw_to_humidity_percent(0, raw);
+        }
+        s_samples[i] = (uint32_t)(esp_timer_get_time() - t0);
+    }
+    (void)sink;
+    bench_report("raw_to_humidity_x100_us", s_samples, runs);
+}
+
+// =============================================================================
+// STORAGE
+// =============================================================================
+
+static void bench_storage() {
+    const uint16_t runs = clamp_runs(BENCH_RUNS);
+    volatile uint32_t sink = 0;
+    for (uint16_t i = 0; i < runs; ++i) {
+        const int64_t t0 = esp_timer_get_time();
+        sink += storage_get_minimal_humidity(0);
+        sink += storage_get_sensor_dry(0);
+        sink += storage_get_last_watering_time(0);
+        s_samples[i] = (uint32_t)(esp_timer_get_time() - t0);
+    }
+    (void)sink;
+    bench_report("storage_get_x3_us", s_samples, runs);
+
+    // Toggle one setting and write it through, then restore it
+    const uint8_t original = storage_get_minimal_humidity(0);
+    const uint16_t nvs_runs = clamp_runs(BENCH_NVS_RUNS);
+    for (uint16_t i = 0; i < nvs_runs; ++i) {
+        const uint8_t value = (i & 1) ? original : (uint8_t)(original ^ 1);
+        const int64_t t0 = esp_timer_get_time();
+        storage_set_minimal_humidity(0, value);
+        storage_commit();
+        s_samples[i] = (uint32_t)(esp_timer_get_time() - t0);
+    }
+    storage_set_minimal_humidity(0, original);
+    storage_commit();
+    bench_report("storage_put_commit_us", s_samples, nvs_runs);
+}
+
+// =============================================================================
+// STEPPER
+// =============================================================================
+
+#if ACTUATOR_TYPE == ACTUATOR_TYPE_STEPPER
+// Edges are only counted on the plateau of the trapezoid profile, so the
+// result is comparable with STEPPER_STEP_HZ.
+#if (STEPPER_DRIVER_TYPE == STEPPER_DRIVER_DRV8833)
+#define BENCH_STEP_PIN          PIN_DRV8833_AN1
+#define BENCH_STEPS_PER_EDGE    8        // AN1 rises once per half-step cycle
+#else
+#define BENCH_STEP_PIN          PIN_STEPPER_STEP
+#define BENCH_STEPS_PER_EDGE    1
+#endif
+
+static volatile uint32_t s_step_edges = 0;
+static volatile int64_t s_window_start_us = 0;
+static volatile int64_t s_window_end_us = 0;
+
+static void IRAM_ATTR on_step_edge() {
+    const int64_t now = esp_timer_get_time();
+    if (now >= s_window_start_us && now < s_window_end_us) {
+        s_step_edges++;
+    }
+}
+
+static void bench_stepper() {
+    hw_require(HW_ACTUATOR);
+    gpio_input_enable(BENCH_STEP_PIN);   // read back our own output
+    attachInterrupt(digitalPinToInterrupt(BENCH_STEP_PIN), on_step_edge, RISING);
+
+    const uint32_t plateau_ms = BENCH_STEPPER_RUN_MS - 2U * STEPPER_RAMP_MS;
+    const uint16_t runs = clamp_runs(BENCH_STEPPER_RUNS);
+    for (uint16_t i = 0; i < runs; ++i) {
+        const int64_t start = esp_timer_get_time();
+        s_step_edges = 0;
+        s_window_start_us = start + (int64_t)STEPPER_RAMP_MS * 1000;
+        s_window_end_us = s_window_start_us + (int64_t)plateau_ms * 1000;
+        actuator_run_timed(0, BENCH_STEPPER_RUN_MS);
+        s_samples[i] = (uint32_t)(((uint64_t)s_step_edges * BENCH_STEPS_PER_EDGE * 1000U) / plateau_ms);
+    }
+    detachInterrupt(digitalPinToInterrupt(BENCH_STEP_PIN));
+
+    Serial.printf("# stepper requested %u Hz\n", (unsigned)STEPPER_STEP_HZ);
+    bench_report("stepper_rate_hz", s_samples, runs);
+}
+#endif
+
+// =============================================================================
+// WIFI / MQTT
+// =============================================================================
+
+static uint8_t s_bssid[6];
+static int32_t s_channel = 0;
+
+static bool wifi_join(bool fast, uint32_t *elapsed_us) {
+    WiFi.disconnect(true);
+    delay(200);
+    WiFi.mode(WIFI_STA);
+
+    const int64_t t0 = esp_timer_get_time();
+    if (fast) {
+        WiFi.begin(MQTT_WIFI_SSID, MQTT_WIFI_PASSWORD, s_channel, s_bssid, true);
+    } else {
+        WiFi.begin(MQTT_WIFI_SSID, MQTT_WIFI_PASSWORD);
+    }
+    while (WiFi.status() != WL_CONNECTED) {
+        if ((esp_timer_get_time() - t0) > (int64_t)BENCH_WIFI_TIMEOUT_MS * 1000) {
+            return false;
+        }
+        delay(1);
+    }
+    *elapsed_us = (uint32_t)(esp_timer_get_time() - t0);
+    return true;
+}
+
+static bool bench_wifi() {
+    uint16_t n = 0;
+    const uint16_t runs = clamp_runs(BENCH_WIFI_RUNS);
+    for (uint16_t i = 0; i < runs; ++i) {
+        if (wifi_join(false, &s_samples[n])) {
+            n++;
+        }
+    }
+    bench_report("wifi_scan_join_us", s_samples, n);
+    if (n == 0) {
+        return false;
+    }
+
+    // Same hint the firmware keeps in RTC memory for its fast join
+    memcpy(s_bssid, WiFi.BSSID(), sizeof(s_bssid));
+    s_channel = WiFi.channel();
+    n = 0;
+    for (uint16_t i = 0; i < runs; ++i) {
+        if (wifi_join(true, &s_samples[n])) {
+            n++;
+        }
+    }
+    bench_report("wifi_fast_join_us", s_samples, n);
+    return WiFi.status() == WL_CONNECTED;
+}
+
+static WiFiClient s_wifi_client;
+static PubSubClient s_mqtt(s_wifi_client);
+static volatile bool s_echo = false;
+
+static void on_bench_message(char *topic, uint8_t *payload, unsigned int length) {
+    (void)topic;
+    (void)payload;
+    (void)length;
+    s_echo = true;
+}
+
+static void bench_mqtt() {
+    const char *user = (strlen(MQTT_BROKER_USER) > 0) ? MQTT_BROKER_USER : nullptr;
+    const char *password = (user != nullptr) ? MQTT_BROKER_PASSWORD : nullptr;
+    s_mqtt.setServer(MQTT_BROKER_HOST, MQTT_BROKER_PORT);
+    s_mqtt.setCallback(on_bench_message);
+
+    uint16_t n = 0;
+    const uint16_t runs = clamp_runs(BENCH_MQTT_RUNS);
+    for (uint16_t i = 0; i < runs; ++i) {
+        s_mqtt.disconnect();
+        const int64_t t0 = esp_timer_get_time();
+        if (s_mqtt.connect(MQTT_CLIENT_ID "-bench", user, password)) {
+            s_samples[n++] = (uint32_t)(esp_timer_get_time() - t0);
+        }
+    }
+    bench_report("mqtt_connect_us", s_samples, n);
+    if (!s_mqtt.connected()) {
+        return;
+    }
+
+    s_mqtt.subscribe(BENCH_MQTT_TOPIC);
+    n = 0;
+    for (uint16_t i = 0; i < runs; ++i) {
+        s_echo = false;
+        const int64_t t0 = esp_timer_get_time();
+        s_mqtt.publish(BENCH_MQTT_TOPIC, "bench");
+        while (!s_echo && (esp_timer_get_time() - t0) < (int64_t)BENCH_MQTT_TIMEOUT_MS * 1000) {
+            s_mqtt.loop();
+        }
+        if (s_echo) {
+            s_samples[n++] = (uint32_t)(esp_timer_get_time() - t0);
+        }
+    }
+    bench_report("mqtt_publish_rtt_us", s_samples, n);
+    s_mqtt.disconnect();
+}
+
+// =============================================================================
+// ENTRY
+// =============================================================================
+
+void setup() {
+    Serial.begin(SERIAL_BAUD);
+    delay(2000);
+    Serial.println("BENCH_START");
+
+    // Module init is not part of any measurement
+    hw_require(HW_STORAGE | HW_ADC | HW_SENSOR);
+
+    bench_adc();
+    bench_humidity();
+    bench_storage();
+#if ACTUATOR_TYPE == ACTUATOR_TYPE_STEPPER
+    bench_stepper();
+#endif
+    if (bench_wifi()) {
+        bench_mqtt();
+    }
+    WiFi.disconnect(true);
+
+    Serial.println("BENCH_DONE");
+}
+
+void loop() {
+    delay(1000);
+}
@@ -0,0 +1,292 @@
+#!/usr/bin/env python3
+"""
+Capture the binary power log stream (include/power_log.h) from the
+firmware, write it to CSV as it arrives and optionally plot it live.
+
+Frames (little-endian):
+    A5 5A | version u8 | type u8 | seq u16 | len u16 | payload | crc16 u16
+
+Bytes between frames are debug text (DEBUG_SERIAL builds) and are echoed
+line by line. Memory use stays flat: samples go straight to disk, the live
+plot only keeps a decimated window.
+"""
+
+from __future__ import annotations
+
+import argparse
+import csv
+import json
+import struct
+import time
+from collections import deque
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import Deque, Iterator, List, Optional, Tuple, Union
+
+SYNC = b"\xa5\x5a"
+VERSION = 1
+FRAME_DATA = 1
+FRAME_INFO = 2
+HEADER = struct.Struct("<BBHH")  # version, type, seq, len (after the sync bytes)
+DATA_HEAD = struct.Struct("<IBBBB")  # t_us, phases, channels, sets, pad
+MAX_PAYLOAD = 4096
+
+PHASE_NAMES = {0: "pump", 1: "wifi", 2: "mqtt", 7: "user"}
+KIND_NAMES = {0: "battery_mv", 1: "sense_mv"}
+
+DEFAULT_CONFIG_PATH = Path("test/power_log/capture_config.json")
+
+
+def crc16_ccitt(data: bytes) -> int:
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+@dataclass
+class InfoFrame:
+    seq: int
+    rate_hz: int
+    kinds: List[int]
+
+
+@dataclass
+class DataFrame:
+    seq: int
+    t_us: int
+    phases: int
+    channels: int
+    sets: List[Tuple[int, ...]]
+
+
+@dataclass
+class FrameDecoder:
+    """Incremental decoder: feed() arbitrary chunks, get frames and text lines."""
+
+    buf: bytearray = field(default_factory=bytearray)
+    crc_errors: int = 0
+
+    def feed(self, chunk: bytes) -> Iterator[Union[InfoFrame, DataFrame, str]]:
+        self.buf.extend(chunk)
+        while True:
+            idx = self.buf.find(SYNC)
+            text_end = idx if idx >= 0 else max(0, len(self.buf) - 1)
+            yield from self._take_text(text_end)
+            if idx < 0:
+                return
+            idx = self.buf.find(SYNC)
+            if idx > 0:
+                # Text without a trailing newline right before a frame
+                line = self.buf[:idx].decode("utf-8", errors="replace").strip()
+                del self.buf[:idx]
+                if line:
+                    yield line
+            if len(self.buf) < 2 + HEADER.size:
+                return
+
+            version, ftype, seq, length = HEADER.unpack_from(self.buf, 2)
+            if version != VERSION or length > MAX_PAYLOAD:
+                del self.buf[:1]  # false sync inside text
+                continue
+            total = 2 + HEADER.size + length + 2
+            if len(self.buf) < total:
+                return
+
+            body = bytes(self.buf[2 : total - 2])
+            (crc,) = struct.unpack_from("<H", self.buf, total - 2)
+            if crc16_ccitt(body) != crc:
+                self.crc_errors += 1
+                del self.buf[:1]
+                continue
+            del self.buf[:total]
+
+            frame = self._parse(ftype, seq, body[HEADER.size :])
+            if frame is not None:
+                yield frame
+
+    def _take_text(self, end: int) -> Iterator[str]:
+        while True:
+            nl = self.buf.find(b"\n", 0, end)
+            if nl < 0:
+                return
+            line = self.buf[:nl].decode("utf-8", errors="replace").strip()
+            del self.buf[: nl + 1]
+            end -= nl + 1
+            if line:
+                yield line
+
+    @staticmethod
+    def _parse(ftype: int, seq: int, payload: bytes) -> Optional[Union[InfoFrame, DataFrame]]:
+        if ftype == FRAME_INFO and len(payload) >= 5:
+            rate_hz, channels = struct.unpack_from("<IB", payload)
+            return InfoFrame(seq, rate_hz, list(payload[5 : 5 + channels]))
+        if ftype == FRAME_DATA and len(payload) >= DATA_HEAD.size:
+            t_us, phases, channels, n_sets, _ = DATA_HEAD.unpack_from(payload)
+            values = struct.unpack_from(f"<{n_sets * channels}H", payload, DATA_HEAD.size)
+            sets = [tuple(values[i * channels : (i + 1) * channels]) for i in range(n_sets)]
+            return DataFrame(seq, t_us, phases, channels, sets)
+        return None
+
+
+def phase_label(phases: int) -> str:
+    names = [name for bit, name in PHASE_NAMES.items() if phases & (1 << bit)]
+    return "+".join(names) if names else "idle"
+
+
+class LivePlot:
+    """Decimated rolling plot of the first channel."""
+
+    def __init__(self, title: str, window_s: float, decimate: int) -> None:
+        import matplotlib.pyplot as plt
+
+        self._plt = plt
+        plt.ion()
+        self.fig, self.ax = plt.subplots(figsize=(12, 5))
+        (self.line,) = self.ax.plot([], [], linewidth=1.0)
+        self.ax.set_title(title)
+        self.ax.set_xlabel("Time (s) [ESP timer]")
+        self.ax.set_ylabel("mV")
+        self.ax.grid(True, alpha=0.3)
+        self.decimate = max(1, decimate)
+        self.window_s = window_s
+        self.points: Deque[Tuple[float, float]] = deque()
+        self._count = 0
+
+    def add(self, t_s: float, mv: int) -> None:
+        self._count += 1
+        if self._count % self.decimate:
+            return
+        self.points.append((t_s, float(mv)))
+        while self.points and self.points[0][0] < t_s - self.window_s:
+            self.points.popleft()
+
+    def is_open(self) -> bool:
+        return self._plt.fignum_exists(self.fig.number)
+
+    def redraw(self) -> None:
+        if not self.points:
+            return
+        xs = [p[0] for p in self.points]
+        ys = [p[1] for p in self.points]
+        self.line.set_data(xs, ys)
+        self.ax.set_xlim(xs[0], max(xs[-1], xs[0] + 0.1))
+        pad = max(10.0, 0.1 * (max(ys) - min(ys)))
+        self.ax.set_ylim(min(ys) - pad, max(ys) + pad)
+        self.fig.canvas.draw_idle()
+        self.fig.canvas.flush_events()
+
+
+def load_config(path: Path) -> dict:
+    if not path.exists():
+        return {}
+    with path.open("r", encoding="utf-8") as f:
+        data = json.load(f)
+        return data if isinstance(data, dict) else {}
+
+
+def guess_serial_port() -> Optional[str]:
+    from serial.tools import list_ports
+
+    ports = list(list_ports.comports())
+    for p in ports:
+        if "303A:1001" in (p.hwid or "").upper():
+            return p.device
+    return ports[0].device if ports else None
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Capture the binary power log stream to CSV")
+    parser.add_argument("--config", default=str(DEFAULT_CONFIG_PATH), help="Path to JSON config file")
+    parser.add_argument("--port", default=None, help="Serial port (for example COM8)")
+    parser.add_argument("--baud", type=int, default=None)
+    parser.add_argument("--duration", type=float, default=None, help="Seconds to capture; 0 = until Ctrl+C / plot closed")
+    parser.add_argument("--csv", default=None)
+    parser.add_argument("--live", action="store_true", help="Show a decimated live plot")
+    parser.add_argument("--live-window", type=float, default=None, help="Seconds shown in the live plot")
+    parser.add_argument("--live-decimate", type=int, default=None, help="Plot every Nth set")
+    parser.add_argument("--sense-ma-per-mv", type=float, default=None, help="Scale for the sense channel (adds a current column)")
+    args = parser.parse_args()
+
+    import serial
+
+    cfg = load_config(Path(args.config))
+    port = args.port or cfg.get("port") or guess_serial_port()
+    if not port:
+        raise RuntimeError("No serial port found. Connect ESP32 and pass --port COMx")
+    baud = int(args.baud if args.baud is not None else cfg.get("baud", 115200))
+    duration = float(args.duration if args.duration is not None else cfg.get("measurement_time_s", 0))
+    out_csv = Path(args.csv or cfg.get("output_csv", "test/power_log/data/power_log.csv"))
+    live = args.live or bool(cfg.get("live", False))
+    window_s = float(args.live_window if args.live_window is not None else cfg.get("live_window_s", 10.0))
+    decimate = int(args.live_decimate if args.live_decimate is not None else cfg.get("live_decimate", 20))
+    sense_scale = args.sense_ma_per_mv if args.sense_ma_per_mv is not None else cfg.get("sense_ma_per_mv")
+
+    decoder = FrameDecoder()
+    plot = LivePlot(f"Power log ({port})", window_s, decimate) if live else None
+    info: Optional[InfoFrame] = None
+    last_seq: Optional[int] = None
+    rows = 0
+    lost = 0
+    writer = None
+
+    out_csv.parent.mkdir(parents=True, exist_ok=True)
+    print(f"Opening {port} @ {baud} baud, writing {out_csv}")
+    start = time.monotonic()
+    last_draw = start
+
+    with out_csv.open("w", newline="", encoding="utf-8") as f, serial.Serial(port, baud, timeout=0.05) as ser:
+        try:
+            while True:
+                for item in decoder.feed(ser.read(4096)):
+                    if isinstance(item, str):
+                        print(item)
+                        continue
+                    if last_seq is not None:
+                        lost += (item.seq - last_seq - 1) & 0xFFFF
+                    last_seq = item.seq
+                    if isinstance(item, InfoFrame):
+                        if info is None:
+                            print(f"rate={item.rate_hz} Hz channels={[KIND_NAMES.get(k, k) for k in item.kinds]}")
+                        info = item
+                        continue
+                    if info is None:
+                        continue  # wait for the channel layout
+                    if writer is None:
+                        header = ["t_us", "seq", "phases"] + [KIND_NAMES.get(k, f"ch{k}") for k in info.kinds]
+                        if sense_scale is not None and 1 in info.kinds:
+                            header.append("sense_ma")
+                        writer = csv.writer(f)
+                        writer.writerow(header)
+
+                    period_us = 1_000_000 // max(1, info.rate_hz)
+                    label = phase_label(item.phases)
+                    for i, values in enumerate(item.sets):
+                        t_us = (item.t_us + i * period_us) & 0xFFFFFFFF
+                        row = [t_us, item.seq, label, *values]
+                        if sense_scale is not None and 1 in info.kinds:
+                            row.append(f"{values[info.kinds.index(1)] * sense_scale:.3f}")
+                        writer.writerow(row)
+                        rows += 1
+                        if plot is not None:
+                            plot.add(t_us / 1e6, values[0])
+
+                now = time.monotonic()
+                if plot is not None and now - last_draw >= 0.2:
+                    if not plot.is_open():
+                        break
+                    plot.redraw()
+                    last_draw = now
+                if duration > 0 and now - start >= duration:
+                    break
+        except KeyboardInterrupt:
+            pass
+
+    print(f"Saved {rows} sets to {out_csv} (lost frames: {lost}, crc errors: {decoder.crc_errors})")
+
+
+if __name__ == "__main__":
+    main()
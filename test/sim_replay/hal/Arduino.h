@@ -0,0 +1,95 @@
+/**
+ * Arduino.h - Host shim of the Arduino core for the replay simulator
+ *
+ * Only what the simulated firmware modules use. Time runs on the simulated
+ * clock (sim_world.h): delay(), delayMicroseconds() and yield() advance it
+ * instead of waiting, so a one-minute soak costs nothing on the host.
+ * analogRead() and digitalRead() return the simulated plant, battery and
+ * float switch; digitalWrite() on a pump pin runs the simulated pump.
+ */
+
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include "esp_attr.h"
+#include "driver/gpio.h"
+
+#define HIGH          1
+#define LOW           0
+#define INPUT         0x01
+#define OUTPUT        0x03
+#define INPUT_PULLUP  0x05
+#define ADC_11db      3
+
+typedef bool boolean;
+
+// =============================================================================
+// TIME (simulated clock)
+// =============================================================================
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+// =============================================================================
+// GPIO / ADC
+// =============================================================================
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+static inline void analogReadResolution(uint8_t) {}
+static inline void analogSetAttenuation(int) {}
+
+template <class T, class L, class H>
+static inline T constrain(T x, L lo, H hi) { return (x < lo) ? lo : ((x > hi) ? hi : x); }
+
+static inline void configTime(long, int, const char *, const char * = nullptr, const char * = nullptr) {}
+
+// =============================================================================
+// STRING / SERIAL
+// =============================================================================
+
+class String {
+public:
+    String(const char *s = "") : s_(s ? s : "") {}
+    String(const std::string &s) : s_(s) {}
+    String(unsigned long v) : s_(std::to_string(v)) {}
+    String(long v) : s_(std::to_string(v)) {}
+    String(int v) : s_(std::to_string(v)) {}
+    String(unsigned int v) : s_(std::to_string(v)) {}
+    const char *c_str() const { return s_.c_str(); }
+    unsigned int length() const { return (unsigned int)s_.size(); }
+    bool operator==(const String &o) const { return s_ == o.s_; }
+    String &operator+=(const String &o) { s_ += o.s_; return *this; }
+    friend String operator+(const String &a, const String &b) { return String(a.s_ + b.s_); }
+    friend String operator+(const String &a, const char *b) { return String(a.s_ + b); }
+    friend String operator+(const char *a, const String &b) { return String(a + b.s_); }
+private:
+    std::string s_;
+};
+
+// Serial output is dropped; the simulator builds with DEBUG_SERIAL=0.
+class SimSerial {
+public:
+    void begin(unsigned long) {}
+    void flush() {}
+    template <typename T> size_t print(const T &, int = 0) { return 0; }
+    template <typename T> size_t println(const T &, int = 0) { return 0; }
+    size_t println() { return 0; }
+    operator bool() const { return false; }
+};
+
+extern SimSerial Serial;
+
+#endif // SIM_ARDUINO_H
@@ -0,0 +1,41 @@
+/**
+ * Preferences.h - Host shim of the Arduino NVS wrapper
+ *
+ * Entries live in the simulator's shared state (sim_world.h), so settings
+ * and counters written in one simulated wake are read by the next.
+ */
+
+#ifndef SIM_PREFERENCES_H
+#define SIM_PREFERENCES_H
+
+#include <Arduino.h>
+
+class Preferences {
+public:
+    bool begin(const char *name, bool read_only = false);
+    void end();
+
+    uint8_t  getUChar(const char *key, uint8_t def = 0);
+    uint16_t getUShort(const char *key, uint16_t def = 0);
+    uint32_t getULong(const char *key, uint32_t def = 0);
+    bool     getBool(const char *key, bool def = false);
+    String   getString(const char *key, const String &def = String());
+    size_t   getBytes(const char *key, void *buf, size_t max_len);
+
+    size_t putUChar(const char *key, uint8_t value)   { return put(key, &value, sizeof(value)); }
+    size_t putUShort(const char *key, uint16_t value) { return put(key, &value, sizeof(value)); }
+    size_t putULong(const char *key, uint32_t value)  { return put(key, &value, sizeof(value)); }
+    size_t putBool(const char *key, bool value)       { const uint8_t v = value ? 1 : 0; return put(key, &v, 1); }
+    size_t putString(const char *key, const char *value);
+    size_t putBytes(const char *key, const void *value, size_t len) { return put(key, value, len); }
+
+private:
+    size_t put(const char *key, const void *value, size_t len);
+    bool get(const char *key, void *out, size_t len);
+
+    char ns_[16] = {0};
+    bool open_ = false;
+    bool read_only_ = false;
+};
+
+#endif // SIM_PREFERENCES_H
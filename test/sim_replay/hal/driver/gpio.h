@@ -0,0 +1,20 @@
+/**
+ * driver/gpio.h - Host shim: pin numbers, holds are no-ops
+ */
+
+#ifndef SIM_DRIVER_GPIO_H
+#define SIM_DRIVER_GPIO_H
+
+typedef enum {
+    GPIO_NUM_NC = -1,
+    GPIO_NUM_0 = 0, GPIO_NUM_1, GPIO_NUM_2, GPIO_NUM_3, GPIO_NUM_4, GPIO_NUM_5,
+    GPIO_NUM_6, GPIO_NUM_7, GPIO_NUM_8, GPIO_NUM_9, GPIO_NUM_10,
+    GPIO_NUM_18 = 18, GPIO_NUM_19, GPIO_NUM_20, GPIO_NUM_21
+} gpio_num_t;
+
+static inline int gpio_hold_en(gpio_num_t) { return 0; }
+static inline int gpio_hold_dis(gpio_num_t) { return 0; }
+static inline void gpio_deep_sleep_hold_en(void) {}
+static inline void gpio_deep_sleep_hold_dis(void) {}
+
+#endif // SIM_DRIVER_GPIO_H
@@ -0,0 +1,13 @@
+/**
+ * esp32c3/rtc.h - Host shim: RTC timer of the simulated board
+ */
+
+#ifndef SIM_ESP32C3_RTC_H
+#define SIM_ESP32C3_RTC_H
+
+#include <stdint.h>
+
+/** Microseconds since the simulated power-on; keeps counting through sleep. */
+uint64_t esp_rtc_get_time_us(void);
+
+#endif // SIM_ESP32C3_RTC_H
@@ -0,0 +1,20 @@
+/**
+ * esp_attr.h - Host shim: RTC memory of the replay simulator
+ *
+ * RTC_DATA_ATTR variables of every firmware module go to one section,
+ * sim_rtc. sim_main saves it when a simulated wake ends and restores it
+ * into the next wake's fresh process, so RTC state survives "deep sleep"
+ * while all other RAM starts over, as on the board. The __start_/__stop_
+ * section symbols need a GNU (ELF) linker.
+ */
+
+#ifndef SIM_ESP_ATTR_H
+#define SIM_ESP_ATTR_H
+
+#define RTC_DATA_ATTR    __attribute__((section("sim_rtc")))
+#define RTC_NOINIT_ATTR  __attribute__((section("sim_rtc")))
+#define RTC_IRAM_ATTR
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+#endif // SIM_ESP_ATTR_H
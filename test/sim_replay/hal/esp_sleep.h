@@ -0,0 +1,33 @@
+/**
+ * esp_sleep.h - Host shim: light sleep advances the simulated clock
+ */
+
+#ifndef SIM_ESP_SLEEP_H
+#define SIM_ESP_SLEEP_H
+
+#include <stdint.h>
+#include "esp_system.h"
+
+typedef enum {
+    ESP_SLEEP_WAKEUP_UNDEFINED,
+    ESP_SLEEP_WAKEUP_TIMER = 4,
+    ESP_SLEEP_WAKEUP_GPIO = 7
+} esp_sleep_wakeup_cause_t;
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause();
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_us);
+
+typedef enum {
+    ESP_GPIO_WAKEUP_GPIO_LOW = 0,
+    ESP_GPIO_WAKEUP_GPIO_HIGH = 1
+} esp_deepsleep_gpio_wake_up_mode_t;
+
+esp_err_t esp_deep_sleep_enable_gpio_wakeup(uint64_t gpio_pin_mask, esp_deepsleep_gpio_wake_up_mode_t mode);
+
+/** Sleeps until the timer set by esp_sleep_enable_timer_wakeup(). */
+esp_err_t esp_light_sleep_start();
+
+/** Ends the simulated wake; the next one starts after the timer. */
+[[noreturn]] void esp_deep_sleep_start();
+
+#endif // SIM_ESP_SLEEP_H
@@ -0,0 +1,13 @@
+/**
+ * esp_sntp.h - Host shim: there is no network, NTP never syncs
+ */
+
+#ifndef SIM_ESP_SNTP_H
+#define SIM_ESP_SNTP_H
+
+#include <sys/time.h>
+
+typedef void (*sntp_sync_time_cb_t)(struct timeval *tv);
+static inline void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t) {}
+
+#endif // SIM_ESP_SNTP_H
@@ -0,0 +1,15 @@
+/**
+ * freertos/FreeRTOS.h - Host shim: critical sections are no-ops
+ *
+ * A simulated wake runs on a single thread.
+ */
+
+#ifndef SIM_FREERTOS_H
+#define SIM_FREERTOS_H
+
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED  {0}
+#define portENTER_CRITICAL(mux)       ((void)(mux))
+#define portEXIT_CRITICAL(mux)        ((void)(mux))
+
+#endif // SIM_FREERTOS_H
@@ -0,0 +1,8 @@
+/**
+ * soc/soc_caps.h - Host shim: an ESP32-C3 has no EXT0 / EXT1 wakeup
+ */
+
+#ifndef SIM_SOC_CAPS_H
+#define SIM_SOC_CAPS_H
+
+#endif // SIM_SOC_CAPS_H
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+"""
+Replay a recorded telemetry trace through one simulator build per policy
+and tabulate their SIM lines side by side.
+
+Expected simulator line format:
+    SIM,<metric>,<value>
+
+The trace comes from a receiver database (--db, the logged records of
+host_app/data/plants/<plant>.db), an existing CSV (--trace), or is
+generated (--synthetic-days, a made-up diurnal drying curve for smoke
+tests, not a measurement). Each env is built with `pio run -e <env>` and
+run on the same trace and plant options.
+"""
+
+from __future__ import annotations
+
+import argparse
+import csv
+import math
+import sqlite3
+import subprocess
+import sys
+from pathlib import Path
+from typing import Dict, Iterable, List
+
+DEFAULT_ENVS = ["sim_replay", "sim_replay_fixed_interval", "sim_replay_fixed_pulse"]
+DEFAULT_TRACE = Path("test/sim_replay/data/trace.csv")
+DEFAULT_OUTPUT = Path("test/sim_replay/data/replay_latest.csv")
+TRACE_FIELDS = ["ts", "raw", "battery_mv", "result"]
+# Options passed through to every simulator run
+SIM_OPTIONS = ["loops", "pot_ml", "soak_s", "flow_pct", "reservoir_ml", "sag_mv", "brownout_mv", "noise",
+               "boot_ms", "sleep_ua"]
+
+
+def export_db(db: Path, out: Path) -> int:
+    """Write the logged records of a plant database as a trace CSV."""
+    con = sqlite3.connect(f"file:{db}?mode=ro", uri=True)
+    try:
+        rows = con.execute(
+            "SELECT ts, raw, battery_mv, result FROM samples "
+            "WHERE logged = 1 AND ts IS NOT NULL AND raw IS NOT NULL ORDER BY ts"
+        ).fetchall()
+    finally:
+        con.close()
+    write_trace(out, rows)
+    return len(rows)
+
+
+def synthetic_rows(days: int, interval_s: int = 3600) -> List[list]:
+    """Hourly samples of a pot drying faster by day, watered back near 75 %."""
+    dry, wet = 3200, 1400
+    raw = 2200.0
+    battery = 5100.0
+    rows: List[list] = []
+    for i in range(days * 86400 // interval_s):
+        ts = i * interval_s
+        hour = (ts % 86400) / 3600.0
+        # The wake logs the raw it decided on, then waters
+        watered = raw > wet + 0.7 * (dry - wet)
+        rows.append([ts, int(raw), int(battery), "ok" if watered else "not_needed"])
+        if watered:
+            raw = wet + 0.25 * (dry - wet)
+        day_rate = max(0.0, math.sin((hour - 6.0) / 12.0 * math.pi))
+        raw += (2.0 + 14.0 * day_rate) * interval_s / 3600.0
+        battery -= 0.4 * interval_s / 3600.0
+    return rows
+
+
+def write_trace(path: Path, rows: Iterable[list]) -> None:
+    path.parent.mkdir(parents=True, exist_ok=True)
+    with path.open("w", newline="", encoding="utf-8") as f:
+        writer = csv.writer(f)
+        writer.writerow(TRACE_FIELDS)
+        writer.writerows(rows)
+
+
+def parse_sim_lines(lines: Iterable[str]) -> Dict[str, str]:
+    metrics: Dict[str, str] = {}
+    for line in lines:
+        parts = line.strip().split(",", 2)
+        if len(parts) == 3 and parts[0] == "SIM":
+            metrics[parts[1]] = parts[2]
+    return metrics
+
+
+def run_env(env: str, trace: Path, options: List[str], build: bool) -> Dict[str, str]:
+    if build:
+        subprocess.run(["pio", "run", "-e", env], check=True, stdout=subprocess.DEVNULL)
+    program = Path(".pio/build") / env / "program"
+    proc = subprocess.run([str(program), str(trace), *options], capture_output=True, text=True)
+    if proc.returncode != 0:
+        print(f"{env}: simulator failed ({proc.returncode})\n{proc.stderr}", file=sys.stderr)
+        return {}
+    return parse_sim_lines(proc.stdout.splitlines())
+
+
+def print_table(results: Dict[str, Dict[str, str]]) -> None:
+    envs = list(results)
+    metrics: List[str] = []
+    for r in results.values():
+        metrics += [m for m in r if m not in metrics]
+    width = max(14, *(len(e) for e in envs)) + 2
+    print(f"{'metric':<22}" + "".join(f"{env:>{width}}" for env in envs))
+    for m in metrics:
+        print(f"{m:<22}" + "".join(f"{results[env].get(m, '-'):>{width}}" for env in envs))
+
+
+def save_csv(results: Dict[str, Dict[str, str]], path: Path) -> None:
+    path.parent.mkdir(parents=True, exist_ok=True)
+    with path.open("w", newline="", encoding="utf-8") as f:
+        writer = csv.writer(f)
+        writer.writerow(["env", "metric", "value"])
+        for env, metrics in results.items():
+            for name, value in metrics.items():
+                writer.writerow([env, name, value])
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Compare watering policies on a replayed telemetry trace")
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--db", help="Receiver database of one plant (host_app/data/plants/<plant>.db)")
+    source.add_argument("--trace", help="Existing trace CSV (ts, raw[, battery_mv, result])")
+    source.add_argument("--synthetic-days", type=int, help="Generate a synthetic trace of this many days")
+    parser.add_argument("--trace-out", default=str(DEFAULT_TRACE), help="Where --db / --synthetic-days write the trace")
+    parser.add_argument("--envs", nargs="+", default=DEFAULT_ENVS, help="Simulator envs (one per policy)")
+    parser.add_argument("--no-build", action="store_true", help="Run the existing .pio/build/<env>/program")
+    parser.add_argument("--out", default=str(DEFAULT_OUTPUT), help="Where to store the results as CSV")
+    for name in SIM_OPTIONS:
+        parser.add_argument("--" + name.replace("_", "-"), help="Passed to the simulator")
+    args = parser.parse_args()
+
+    if args.trace:
+        trace = Path(args.trace)
+    else:
+        trace = Path(args.trace_out)
+        if args.db:
+            count = export_db(Path(args.db), trace)
+        else:
+            rows = synthetic_rows(args.synthetic_days)
+            write_trace(trace, rows)
+            count = len(rows)
+        print(f"Trace: {trace} ({count} rows)")
+
+    options: List[str] = []
+    for name in SIM_OPTIONS:
+        value = getattr(args, name)
+        if value is not None:
+            options += ["--" + name.replace("_", "-"), value]
+
+    results = {env: run_env(env, trace, options, not args.no_build) for env in args.envs}
+    if not any(results.values()):
+        print("No SIM lines found", file=sys.stderr)
+        sys.exit(2)
+    print_table(results)
+    save_csv(results, Path(args.out))
+
+
+if __name__ == "__main__":
+    main()
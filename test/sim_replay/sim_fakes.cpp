@@ -0,0 +1,90 @@
+/**
+ * sim_fakes.cpp - Modules the replay does not simulate
+ *
+ * LEDs, buttons, the wake stub monitor and the power logger have no effect
+ * on what gets watered; they are replaced by inert versions so main.cpp
+ * links unchanged. LED output only costs awake time on the board (the wake
+ * waits for queued patterns), which the replay leaves out.
+ */
+
+#include <Arduino.h>
+#include "config.h"
+#include "leds.h"
+#include "buttons.h"
+#include "sleep_monitor.h"
+#include "power_log.h"
+#include "always_on.h"
+#include <stdio.h>
+
+#if ACTUATOR_TYPE != ACTUATOR_TYPE_PUMP
+#error "sim_replay models pumps only (ACTUATOR_TYPE_PUMP)"
+#endif
+
+// =============================================================================
+// LEDS
+// =============================================================================
+
+void leds_init() {}
+void led_green_on() {}
+void led_green_off() {}
+void led_red_on() {}
+void led_red_off() {}
+void leds_all_off() {}
+bool leds_busy() { return false; }
+void leds_wait_idle() {}
+void leds_finish(uint32_t) {}
+void leds_pause(uint16_t) {}
+void led_green_blink(uint8_t, uint16_t) {}
+void led_red_blink(uint8_t, uint16_t) {}
+void leds_play_pattern(const LedStep[], uint8_t, uint16_t, uint16_t) {}
+void led_display_value(uint8_t, bool) {}
+void led_show_battery_warning() {}
+void led_show_battery_critical() {}
+void led_show_calibration_confirm() {}
+void led_show_error() {}
+void led_show_success() {}
+
+// =============================================================================
+// BUTTONS (never pressed)
+// =============================================================================
+
+void buttons_init(void) {}
+void buttons_handle_interaction(bool) {}
+bool buttons_pending(void) { return false; }
+void buttons_wait_event(uint32_t) {}
+
+// =============================================================================
+// WAKE STUB MONITOR (every sleep wakes the app)
+// =============================================================================
+
+uint32_t sleep_monitor_arm(uint32_t sleep_sec) {
+    return sleep_sec;
+}
+
+MonitorTrigger sleep_monitor_boot(uint16_t *stub_wakes) {
+    if (stub_wakes != nullptr) {
+        *stub_wakes = 0;
+    }
+    return MONITOR_TRIGGER_NONE;
+}
+
+// =============================================================================
+// POWER LOG
+// =============================================================================
+
+bool power_log_start() { return false; }
+void power_log_stop() {}
+void power_log_phase(PowerPhase, bool) {}
+
+// =============================================================================
+// ALWAYS-ON MODE
+// =============================================================================
+
+// Deep sleep is never disabled without buttons or MQTT; reaching this means
+// the stored settings are off.
+void always_on_enter() {
+    fprintf(stderr, "sim_replay: deep sleep disabled in settings, always-on mode is not simulated\n");
+    _Exit(3);
+}
+
+void always_on_idle(uint32_t) {}
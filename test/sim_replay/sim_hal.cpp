@@ -0,0 +1,246 @@
+/**
+ * sim_hal.cpp - Arduino / ESP-IDF shims on the simulated board
+ *
+ * The firmware modules call these as on the ESP32-C3; each one reads or
+ * drives the shared simulator state (sim_world.h).
+ */
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "esp_sleep.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "esp32c3/rtc.h"
+#include "sim_world.h"
+
+SimSerial Serial;
+
+// =============================================================================
+// TIME
+// =============================================================================
+
+uint32_t millis() {
+    return (uint32_t)(sim_uptime_us() / 1000ULL);
+}
+
+uint32_t micros() {
+    return (uint32_t)sim_uptime_us();
+}
+
+void delay(uint32_t ms) {
+    sim_advance_us((uint64_t)ms * 1000ULL);
+}
+
+void delayMicroseconds(uint32_t us) {
+    sim_advance_us(us);
+}
+
+// Busy-wait loops poll with yield(); let the clock move
+void yield() {
+    sim_advance_us(1000);
+}
+
+int64_t esp_timer_get_time() {
+    return (int64_t)sim_uptime_us();
+}
+
+uint64_t esp_rtc_get_time_us(void) {
+    return sim_world()->now_us;
+}
+
+// =============================================================================
+// GPIO / ADC
+// =============================================================================
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+    sim_digital_write(pin, level);
+}
+
+int digitalRead(uint8_t pin) {
+    return sim_digital_read(pin);
+}
+
+uint16_t analogRead(uint8_t pin) {
+    return sim_analog_read(pin);
+}
+
+// =============================================================================
+// RESET / SLEEP
+// =============================================================================
+
+esp_reset_reason_t esp_reset_reason() {
+    return (esp_reset_reason_t)sim_world()->reset_reason;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+    return (esp_sleep_wakeup_cause_t)sim_world()->wake_cause;
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_us) {
+    sim_world()->timer_wakeup_us = time_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_deep_sleep_enable_gpio_wakeup(uint64_t, esp_deepsleep_gpio_wake_up_mode_t) {
+    return ESP_OK;   // buttons are never pressed
+}
+
+esp_err_t esp_light_sleep_start() {
+    sim_advance_us(sim_world()->timer_wakeup_us);
+    return ESP_OK;
+}
+
+void esp_deep_sleep_start() {
+    sim_end_wake(sim_world()->timer_wakeup_us);
+}
+
+// =============================================================================
+// FLASH PARTITION
+// =============================================================================
+
+static const esp_partition_t s_partition = {
+    ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, 0, SIM_FLASH_BYTES, "spiffs"
+};
+
+static bool in_partition(size_t offset, size_t size) {
+    return offset <= SIM_FLASH_BYTES && size <= SIM_FLASH_BYTES - offset;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t,
+                                                const char *label) {
+    if (type != ESP_PARTITION_TYPE_DATA || (label != nullptr && strcmp(label, s_partition.label) != 0)) {
+        return nullptr;
+    }
+    return &s_partition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *, size_t offset, void *dst, size_t size) {
+    if (!in_partition(offset, size)) {
+        return ESP_FAIL;
+    }
+    memcpy(dst, sim_flash() + offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *, size_t offset, const void *src, size_t size) {
+    if (!in_partition(offset, size)) {
+        return ESP_FAIL;
+    }
+    // NOR flash: programming can only clear bits
+    const uint8_t *in = (const uint8_t *)src;
+    for (size_t i = 0; i < size; ++i) {
+        sim_flash()[offset + i] &= in[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *, size_t offset, size_t size) {
+    if (!in_partition(offset, size) || (offset % 4096U) != 0 || (size % 4096U) != 0) {
+        return ESP_FAIL;
+    }
+    memset(sim_flash() + offset, 0xFF, size);
+    return ESP_OK;
+}
+
+// =============================================================================
+// PREFERENCES (NVS)
+// =============================================================================
+
+static SimNvsEntry *nvs_find(const char *ns, const char *key, bool create) {
+    char full[SIM_NVS_KEY_LEN];
+    snprintf(full, sizeof(full), "%s/%s", ns, key);
+    SimNvsEntry *free_entry = nullptr;
+    for (uint16_t i = 0; i < SIM_NVS_ENTRIES; ++i) {
+        SimNvsEntry &e = sim_nvs()[i];
+        if (e.key[0] == '\0') {
+            if (free_entry == nullptr) {
+                free_entry = &e;
+            }
+        } else if (strcmp(e.key, full) == 0) {
+            return &e;
+        }
+    }
+    if (create && free_entry != nullptr) {
+        memcpy(free_entry->key, full, sizeof(full));
+        free_entry->len = 0;
+        return free_entry;
+    }
+    return nullptr;
+}
+
+bool Preferences::begin(const char *name, bool read_only) {
+    snprintf(ns_, sizeof(ns_), "%s", name);
+    open_ = true;
+    read_only_ = read_only;
+    return true;
+}
+
+void Preferences::end() {
+    open_ = false;
+}
+
+size_t Preferences::put(const char *key, const void *value, size_t len) {
+    if (!open_ || read_only_ || len > SIM_NVS_VALUE_LEN) {
+        return 0;
+    }
+    SimNvsEntry *e = nvs_find(ns_, key, true);
+    if (e == nullptr) {
+        return 0;
+    }
+    memcpy(e->value, value, len);
+    e->len = (uint16_t)len;
+    return len;
+}
+
+bool Preferences::get(const char *key, void *out, size_t len) {
+    const SimNvsEntry *e = open_ ? nvs_find(ns_, key, false) : nullptr;
+    if (e == nullptr || e->len != len) {
+        return false;
+    }
+    memcpy(out, e->value, len);
+    return true;
+}
+
+uint8_t Preferences::getUChar(const char *key, uint8_t def) {
+    uint8_t v = def;
+    return get(key, &v, sizeof(v)) ? v : def;
+}
+
+uint16_t Preferences::getUShort(const char *key, uint16_t def) {
+    uint16_t v = def;
+    return get(key, &v, sizeof(v)) ? v : def;
+}
+
+uint32_t Preferences::getULong(const char *key, uint32_t def) {
+    uint32_t v = def;
+    return get(key, &v, sizeof(v)) ? v : def;
+}
+
+bool Preferences::getBool(const char *key, bool def) {
+    uint8_t v = 0;
+    return get(key, &v, sizeof(v)) ? (v != 0) : def;
+}
+
+String Preferences::getString(const char *key, const String &def) {
+    const SimNvsEntry *e = open_ ? nvs_find(ns_, key, false) : nullptr;
+    if (e == nullptr) {
+        return def;
+    }
+    return String(std::string((const char *)e->value, e->len));
+}
+
+size_t Preferences::putString(const char *key, const char *value) {
+    return put(key, value, strlen(value));
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t max_len) {
+    const SimNvsEntry *e = open_ ? nvs_find(ns_, key, false) : nullptr;
+    if (e == nullptr || e->len > max_len) {
+        return 0;
+    }
+    memcpy(buf, e->value, e->len);
+    return e->len;
+}
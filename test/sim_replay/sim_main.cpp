@@ -0,0 +1,323 @@
+/**
+ * sim_main.cpp - Record-and-replay simulator of the watering engine
+ *
+ * Replays a recorded telemetry trace (sim_trace.h) through the firmware's
+ * own setup() / loop(): every timer wake runs the real measurement,
+ * watering decision, pump pulses and wake scheduling against the simulated
+ * board (sim_world.h), then "deep sleeps" until the interval the firmware
+ * picked. At the end one line per metric is printed:
+ *
+ *   SIM,<metric>,<value>
+ *
+ * replay_compare.py runs one build per policy and tabulates these.
+ *
+ * Each wake is a fork() of the pristine parent, so RAM starts over as after
+ * a real deep sleep and only the RTC section, NVS and flash carry over.
+ * The parent never runs firmware code.
+ */
+
+#include <Arduino.h>
+#include "config.h"
+#include "profiler.h"
+#include "sensor.h"
+#include "storage.h"
+#include "esp_sleep.h"
+#include "esp_system.h"
+#include "sim_world.h"
+#include <signal.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifndef SIM_POLICY
+#define SIM_POLICY  "default"
+#endif
+
+#define SIM_WAKE_TIMEOUT_S  10      // host seconds before a wake counts as hung
+#define US_PER_HOUR         3600000000.0
+#define US_PER_DAY          (24.0 * US_PER_HOUR)
+
+// Firmware entry points (main.cpp)
+void setup();
+void loop();
+
+typedef struct {
+    const char *trace_path;
+    const char *log_path;
+    double      loops;
+    double      pot_ml;
+    double      soak_s;
+    double      flow_pct;
+    double      reservoir_ml;
+    double      boot_ms;
+    unsigned    sag_mv;
+    unsigned    brownout_mv;
+    unsigned    noise;
+    unsigned    sleep_ua;
+} SimOptions;
+
+// =============================================================================
+// WAKE (child process)
+// =============================================================================
+
+static double s_wake_charge_ua_us = 0.0;
+static uint16_t s_wake_records = 0;
+
+static bool charge_sink(const ProfileRecord *record) {
+    s_wake_charge_ua_us += (double)profiler_charge_ua_us(record);
+    s_wake_records++;
+    return true;
+}
+
+// Lowest raw at which the channel reads below its minimal humidity
+static uint16_t dry_threshold_raw(uint8_t ch) {
+    const uint8_t minimal = storage_get_minimal_humidity(ch);
+    uint16_t lo = SENSOR_RAW_MIN;
+    uint16_t hi = SENSOR_RAW_MAX;
+    if (sensor_raw_to_humidity_percent(ch, hi) >= minimal) {
+        return 0;
+    }
+    while (lo < hi) {
+        const uint16_t mid = (uint16_t)((lo + hi) / 2);
+        if (sensor_raw_to_humidity_percent(ch, mid) < minimal) {
+            hi = mid;
+        } else {
+            lo = (uint16_t)(mid + 1);
+        }
+    }
+    return lo;
+}
+
+void sim_end_wake(uint64_t sleep_us) {
+    SimWorld &w = *sim_world();
+
+    // The records a radio wake would publish: the wake's charge estimate.
+    // A brown-out ends the wake before its record is closed.
+    profiler_drain(charge_sink);
+    if (s_wake_records == 0) {
+        s_wake_charge_ua_us = (double)sim_uptime_us() * PROFILE_UA_AWAKE;
+    }
+    w.charge_ua_us += s_wake_charge_ua_us;
+    w.energy_uw_us += s_wake_charge_ua_us * sim_battery_rest_mv() / 1000.0;
+    w.awake_us += sim_uptime_us();
+    if (w.wake_pumped) {
+        w.watering_wakes++;
+    }
+    sim_rtc_save();
+
+    // Calibration and settings may change at runtime; refresh what counts
+    // as too dry for the time asleep.
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        w.dry_raw[ch] = dry_threshold_raw(ch);
+    }
+    w.sleep_us = sleep_us;
+    fflush(stdout);
+    _exit(0);
+}
+
+[[noreturn]] static void run_wake() {
+    alarm(SIM_WAKE_TIMEOUT_S);
+    sim_rtc_restore();
+
+    SimWorld &w = *sim_world();
+    w.wake_us = w.now_us;
+    w.timer_wakeup_us = 0;
+    w.wake_pumped = false;
+    w.brownout = false;
+    sim_advance_us(w.boot_us);
+
+    setup();
+    for (;;) {
+        loop();
+    }
+}
+
+// =============================================================================
+// RUN (parent)
+// =============================================================================
+
+static bool run_one_wake() {
+    const pid_t pid = fork();
+    if (pid < 0) {
+        perror("sim_replay: fork");
+        return false;
+    }
+    if (pid == 0) {
+        run_wake();
+    }
+    int status = 0;
+    if (waitpid(pid, &status, 0) != pid) {
+        perror("sim_replay: waitpid");
+        return false;
+    }
+    if (WIFSIGNALED(status)) {
+        fprintf(stderr, "sim_replay: wake %u died (signal %d%s)\n", sim_world()->wakes, WTERMSIG(status),
+                WTERMSIG(status) == SIGALRM ? ", hung" : "");
+        return false;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "sim_replay: wake %u failed (exit %d)\n", sim_world()->wakes, WEXITSTATUS(status));
+        return false;
+    }
+    return true;
+}
+
+static void sleep_until_next_wake() {
+    SimWorld &w = *sim_world();
+    const uint16_t mv = sim_battery_rest_mv();
+    const double ua_us = (double)w.sleep_us * w.sleep_ua;
+    w.charge_ua_us += ua_us;
+    w.energy_uw_us += ua_us * mv / 1000.0;
+    w.pump_mask = 0;
+    sim_advance_us(w.sleep_us);
+
+    if (w.brownout) {
+        w.reset_reason = ESP_RST_BROWNOUT;
+        w.wake_cause = ESP_SLEEP_WAKEUP_UNDEFINED;
+    } else {
+        w.reset_reason = ESP_RST_DEEPSLEEP;
+        w.wake_cause = ESP_SLEEP_WAKEUP_TIMER;
+    }
+}
+
+static void report(const SimTrace &trace) {
+    const SimWorld &w = *sim_world();
+    uint64_t below_us = 0;
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        below_us += w.below_min_us[ch];
+    }
+    const double days = (double)w.now_us / US_PER_DAY;
+
+    printf("SIM,policy,%s\n", SIM_POLICY);
+    printf("SIM,trace_rows,%u\n", trace.rows);
+    printf("SIM,trace_skipped,%u\n", trace.skipped);
+    printf("SIM,days,%.2f\n", days);
+    printf("SIM,wakes,%u\n", w.wakes);
+    printf("SIM,wakes_per_day,%.2f\n", (days > 0.0) ? w.wakes / days : 0.0);
+    printf("SIM,watering_wakes,%u\n", w.watering_wakes);
+    printf("SIM,radio_wakes_est,%u\n", w.wakes / TELEMETRY_UPLOAD_EVERY_WAKES);
+    printf("SIM,water_ml,%.1f\n", w.pumped_ul / 1000.0);
+    printf("SIM,runoff_ml,%.1f\n", w.runoff_ul / 1000.0);
+    printf("SIM,pump_s,%.1f\n", (double)w.pump_us / 1e6);
+    printf("SIM,awake_s,%.1f\n", (double)w.awake_us / 1e6);
+    printf("SIM,charge_mah,%.2f\n", w.charge_ua_us / 1000.0 / US_PER_HOUR);
+    printf("SIM,energy_mwh,%.2f\n", w.energy_uw_us / 1000.0 / US_PER_HOUR);
+    printf("SIM,avg_ua,%.1f\n", (w.now_us > 0) ? w.charge_ua_us / (double)w.now_us : 0.0);
+    printf("SIM,below_min_h,%.1f\n", (double)below_us / US_PER_HOUR);
+    printf("SIM,brownouts,%u\n", w.brownouts);
+    printf("SIM,reservoir_empty_day,%.2f\n", (w.reservoir_empty_us != 0) ? w.reservoir_empty_us / US_PER_DAY : -1.0);
+    printf("SIM_DONE\n");
+}
+
+// =============================================================================
+// COMMAND LINE
+// =============================================================================
+
+static void usage() {
+    fprintf(stderr,
+            "usage: program <trace.csv> [options]\n"
+            "  --loops <n>          passes through the trace (default 1)\n"
+            "  --pot-ml <ml>        water from dry to wet calibration (default 500)\n"
+            "  --soak-s <s>         soak-in time constant (default 60)\n"
+            "  --flow-pct <pct>     pump flow vs PUMP_FLOW_UL_PER_S (default 100)\n"
+            "  --reservoir-ml <ml>  reservoir size, 0 = unlimited (default 0)\n"
+            "  --sag-mv <mv>        battery drop per running pump (default 400)\n"
+            "  --brownout-mv <mv>   reset below this loaded voltage (default %d)\n"
+            "  --noise <raw>        +/- sensor noise per sample (default 8)\n"
+            "  --boot-ms <ms>       boot time before setup() (default 150)\n"
+            "  --sleep-ua <ua>      deep sleep current (default 10)\n"
+            "  --log <file>         per-wake CSV\n",
+            BATTERY_BROWNOUT_MV);
+}
+
+static bool parse_args(int argc, char **argv, SimOptions *opt) {
+    *opt = {nullptr, nullptr, 1.0, 500.0, 60.0, 100.0, 0.0, 150.0, 400, BATTERY_BROWNOUT_MV, 8, 10};
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (arg[0] != '-') {
+            opt->trace_path = arg;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char *val = argv[++i];
+        if      (strcmp(arg, "--loops") == 0)        opt->loops = atof(val);
+        else if (strcmp(arg, "--pot-ml") == 0)       opt->pot_ml = atof(val);
+        else if (strcmp(arg, "--soak-s") == 0)       opt->soak_s = atof(val);
+        else if (strcmp(arg, "--flow-pct") == 0)     opt->flow_pct = atof(val);
+        else if (strcmp(arg, "--reservoir-ml") == 0) opt->reservoir_ml = atof(val);
+        else if (strcmp(arg, "--sag-mv") == 0)       opt->sag_mv = (unsigned)atoi(val);
+        else if (strcmp(arg, "--brownout-mv") == 0)  opt->brownout_mv = (unsigned)atoi(val);
+        else if (strcmp(arg, "--noise") == 0)        opt->noise = (unsigned)atoi(val);
+        else if (strcmp(arg, "--boot-ms") == 0)      opt->boot_ms = atof(val);
+        else if (strcmp(arg, "--sleep-ua") == 0)     opt->sleep_ua = (unsigned)atoi(val);
+        else if (strcmp(arg, "--log") == 0)          opt->log_path = val;
+        else return false;
+    }
+    return opt->trace_path != nullptr && opt->loops > 0.0 && opt->pot_ml > 0.0 && opt->soak_s > 0.0;
+}
+
+int main(int argc, char **argv) {
+    SimOptions opt;
+    if (!parse_args(argc, argv, &opt)) {
+        usage();
+        return 2;
+    }
+
+    static SimTrace trace;
+    std::string error;
+    if (!sim_trace_load(opt.trace_path, &trace, &error)) {
+        fprintf(stderr, "sim_replay: %s\n", error.c_str());
+        return 2;
+    }
+    if (!sim_world_create(&trace)) {
+        fprintf(stderr, "sim_replay: cannot map the shared state\n");
+        return 2;
+    }
+
+    SimWorld &w = *sim_world();
+    w.pot_ul = opt.pot_ml * 1000.0;
+    w.soak_s = opt.soak_s;
+    w.flow_scale = opt.flow_pct / 100.0;
+    w.reservoir_ul = (opt.reservoir_ml > 0.0) ? opt.reservoir_ml * 1000.0 : -1.0;
+    w.sag_mv = (uint16_t)opt.sag_mv;
+    w.brownout_mv = (uint16_t)opt.brownout_mv;
+    w.noise_raw = (uint16_t)opt.noise;
+    w.boot_us = (uint32_t)(opt.boot_ms * 1000.0);
+    w.sleep_ua = opt.sleep_ua;
+    w.reset_reason = ESP_RST_POWERON;
+    w.wake_cause = ESP_SLEEP_WAKEUP_UNDEFINED;
+
+    FILE *log = nullptr;
+    if (opt.log_path != nullptr) {
+        log = fopen(opt.log_path, "w");
+        if (log == nullptr) {
+            perror("sim_replay: --log");
+            return 2;
+        }
+        fprintf(log, "wake,time_s,reset,awake_ms,sleep_s,pumped_ml,soil_raw,battery_mv\n");
+    }
+
+    const uint64_t end_us = (uint64_t)((double)trace.span_us * opt.loops);
+    while (w.now_us < end_us) {
+        const double pumped_before = w.pumped_ul;
+        const uint8_t reset = w.reset_reason;
+        w.wakes++;
+        if (!run_one_wake()) {
+            return 1;
+        }
+        if (log != nullptr) {
+            fprintf(log, "%u,%.0f,%u,%.0f,%.0f,%.1f,%.0f,%u\n", w.wakes, w.wake_us / 1e6, reset,
+                    (w.now_us - w.wake_us) / 1e3, w.sleep_us / 1e6, (w.pumped_ul - pumped_before) / 1000.0,
+                    w.soil_raw[0], sim_battery_rest_mv());
+        }
+        sleep_until_next_wake();
+    }
+
+    if (log != nullptr) {
+        fclose(log);
+    }
+    report(trace);
+    return 0;
+}
@@ -0,0 +1,134 @@
+/**
+ * sim_trace.cpp - Trace loading for the replay harness
+ */
+
+#include "sim_trace.h"
+#include "config.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+typedef struct {
+    int64_t  ts;
+    int32_t  raw;
+    int32_t  battery_mv;
+    bool     watered;
+} TraceRow;
+
+static std::vector<std::string> split_csv(const std::string &line) {
+    std::vector<std::string> out;
+    std::stringstream ss(line);
+    std::string cell;
+    while (std::getline(ss, cell, ',')) {
+        cell.erase(std::remove(cell.begin(), cell.end(), '\r'), cell.end());
+        cell.erase(std::remove(cell.begin(), cell.end(), '"'), cell.end());
+        out.push_back(cell);
+    }
+    return out;
+}
+
+static int column(const std::vector<std::string> &header, const char *name) {
+    for (size_t i = 0; i < header.size(); ++i) {
+        if (header[i] == name) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static bool parse_int(const std::vector<std::string> &cells, int col, int64_t *out) {
+    if (col < 0 || (size_t)col >= cells.size() || cells[col].empty()) {
+        return false;
+    }
+    char *end = nullptr;
+    const double v = strtod(cells[col].c_str(), &end);
+    if (end == cells[col].c_str()) {
+        return false;
+    }
+    *out = (int64_t)v;
+    return true;
+}
+
+static bool raw_usable(int32_t raw) {
+    return raw >= SENSOR_RAW_MIN && raw <= SENSOR_RAW_MAX;
+}
+
+bool sim_trace_load(const char *path, SimTrace *trace, std::string *error) {
+    std::ifstream in(path);
+    if (!in) {
+        *error = std::string("cannot open ") + path;
+        return false;
+    }
+
+    std::string line;
+    if (!std::getline(in, line)) {
+        *error = "empty trace";
+        return false;
+    }
+    const std::vector<std::string> header = split_csv(line);
+    const int col_ts = column(header, "ts");
+    const int col_raw = column(header, "raw");
+    const int col_batt = column(header, "battery_mv");
+    const int col_result = column(header, "result");
+    if (col_ts < 0 || col_raw < 0) {
+        *error = "trace needs ts and raw columns";
+        return false;
+    }
+
+    std::vector<TraceRow> rows;
+    while (std::getline(in, line)) {
+        const std::vector<std::string> cells = split_csv(line);
+        int64_t ts = 0;
+        int64_t raw = 0;
+        int64_t batt = 0;
+        if (!parse_int(cells, col_ts, &ts) || !parse_int(cells, col_raw, &raw)) {
+            continue;
+        }
+        parse_int(cells, col_batt, &batt);
+        const std::string result = (col_result >= 0 && (size_t)col_result < cells.size()) ? cells[col_result] : "";
+        rows.push_back({ts, (int32_t)raw, (int32_t)batt, result == "ok" || result == "partial"});
+    }
+
+    trace->segments.clear();
+    trace->start_us.clear();
+    trace->span_us = 0;
+    trace->rows = (uint32_t)rows.size();
+    trace->skipped = 0;
+
+    float dry_drift = 0.0f;
+    bool have_first = false;
+    for (size_t i = 0; i + 1 < rows.size(); ++i) {
+        const TraceRow &a = rows[i];
+        const TraceRow &b = rows[i + 1];
+        const int64_t dt = b.ts - a.ts;
+        if (dt <= 0 || dt > (int64_t)SIM_TRACE_MAX_GAP_S || !raw_usable(a.raw) || !raw_usable(b.raw)) {
+            trace->skipped++;
+            continue;
+        }
+        if (!have_first) {
+            trace->first_raw = (uint16_t)a.raw;
+            have_first = true;
+        }
+        if (!a.watered) {
+            dry_drift = (float)(b.raw - a.raw) / (float)dt;
+        }
+        trace->start_us.push_back(trace->span_us);
+        trace->segments.push_back({(uint32_t)dt, dry_drift, (uint16_t)std::max<int32_t>(a.battery_mv, 0)});
+        trace->span_us += (uint64_t)dt * 1000000ULL;
+    }
+
+    if (trace->segments.empty()) {
+        *error = "trace has fewer than two usable rows";
+        return false;
+    }
+    return true;
+}
+
+const SimTraceSegment &sim_trace_at(const SimTrace &trace, uint64_t t_us, uint64_t *left_us) {
+    const uint64_t t = t_us % trace.span_us;
+    const auto it = std::upper_bound(trace.start_us.begin(), trace.start_us.end(), t);
+    const size_t i = (size_t)(it - trace.start_us.begin()) - 1;
+    const SimTraceSegment &seg = trace.segments[i];
+    *left_us = trace.start_us[i] + (uint64_t)seg.dur_s * 1000000ULL - t;
+    return seg;
+}
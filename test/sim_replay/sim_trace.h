@@ -0,0 +1,55 @@
+/**
+ * sim_trace.h - Recorded telemetry trace for the replay harness
+ *
+ * A trace is the telemetry history of one plant channel as CSV with a
+ * header row: ts (persistent time, s) and raw (sensor ADC) are required,
+ * battery_mv and result are used when present; other columns are ignored.
+ * replay_compare.py exports it from a receiver database
+ * (host_app/data/plants/<plant>.db).
+ *
+ * Loading turns consecutive rows into segments of replayed environment:
+ * how fast the soil dried (raw drift per second) and the battery voltage.
+ * An interval that started with a watering ("ok" / "partial") keeps the
+ * drift of the interval before it, since its own drift is mostly the
+ * delivered water; gaps (power loss, missing data) and sensor faults are
+ * left out.
+ */
+
+#ifndef SIM_TRACE_H
+#define SIM_TRACE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define SIM_TRACE_MAX_GAP_S  (2UL * 24UL * 3600UL)   // Longer intervals are a break in the data
+
+typedef struct {
+    uint32_t dur_s;
+    float    drift_per_s;     // raw change per second, positive = drying
+    uint16_t battery_mv;      // rest voltage, 0 = not recorded
+} SimTraceSegment;
+
+typedef struct {
+    std::vector<SimTraceSegment> segments;
+    std::vector<uint64_t> start_us;   // start of each segment within one pass
+    uint64_t span_us;                 // one pass through the trace
+    uint16_t first_raw;
+    uint32_t rows;
+    uint32_t skipped;                 // intervals left out (gaps, faults)
+} SimTrace;
+
+/**
+ * Load a CSV trace.
+ * @return false with *error set if the file is unreadable or has fewer
+ *         than two usable rows
+ */
+bool sim_trace_load(const char *path, SimTrace *trace, std::string *error);
+
+/**
+ * Segment at time t_us (the trace repeats after span_us).
+ * @param left_us  Receives the time left in that segment
+ */
+const SimTraceSegment &sim_trace_at(const SimTrace &trace, uint64_t t_us, uint64_t *left_us);
+
+#endif // SIM_TRACE_H
@@ -0,0 +1,218 @@
+/**
+ * sim_world.cpp - Shared state and plant model of the replay harness
+ */
+
+#include "sim_world.h"
+#include <math.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define SIM_ADC_REF_MV          3300     // as battery.cpp converts
+#define SIM_DEFAULT_BATTERY_MV  5000     // trace without battery_mv
+
+typedef struct {
+    SimWorld    world;
+    uint8_t     rtc[SIM_RTC_BYTES];
+    SimNvsEntry nvs[SIM_NVS_ENTRIES];
+    uint8_t     flash[SIM_FLASH_BYTES];
+} SimShared;
+
+static SimShared *s_shared = nullptr;
+static const SimTrace *s_trace = nullptr;   // read-only, inherited by every wake
+
+// Linker-provided bounds of the RTC_DATA_ATTR section (hal/esp_attr.h)
+extern "C" uint8_t __start_sim_rtc[];
+extern "C" uint8_t __stop_sim_rtc[];
+
+// =============================================================================
+// SHARED STATE
+// =============================================================================
+
+bool sim_world_create(const SimTrace *trace) {
+    void *mem = mmap(nullptr, sizeof(SimShared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED || (size_t)(__stop_sim_rtc - __start_sim_rtc) > SIM_RTC_BYTES) {
+        return false;
+    }
+    s_shared = (SimShared *)mem;
+    memset(s_shared, 0, sizeof(*s_shared));
+    memset(s_shared->flash, 0xFF, sizeof(s_shared->flash));
+    s_trace = trace;
+
+    // Power-on RTC contents: whatever the image initializes
+    sim_rtc_save();
+
+    SimWorld &w = s_shared->world;
+    w.rng = 0x12345678U;
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        w.soil_raw[ch] = trace->first_raw;
+    }
+    return true;
+}
+
+SimWorld *sim_world() {
+    return &s_shared->world;
+}
+
+SimNvsEntry *sim_nvs() {
+    return s_shared->nvs;
+}
+
+uint8_t *sim_flash() {
+    return s_shared->flash;
+}
+
+void sim_rtc_save() {
+    memcpy(s_shared->rtc, __start_sim_rtc, (size_t)(__stop_sim_rtc - __start_sim_rtc));
+}
+
+void sim_rtc_restore() {
+    memcpy(__start_sim_rtc, s_shared->rtc, (size_t)(__stop_sim_rtc - __start_sim_rtc));
+}
+
+// =============================================================================
+// PLANT
+// =============================================================================
+
+static double raw_per_ul() {
+    return (double)(DEFAULT_SENSOR_DRY - DEFAULT_SENSOR_WET) / sim_world()->pot_ul;
+}
+
+static uint8_t pumps_running() {
+    return (uint8_t)__builtin_popcount(sim_world()->pump_mask);
+}
+
+uint16_t sim_battery_rest_mv() {
+    uint64_t left_us = 0;
+    const uint16_t mv = sim_trace_at(*s_trace, sim_world()->now_us, &left_us).battery_mv;
+    return (mv != 0) ? mv : SIM_DEFAULT_BATTERY_MV;
+}
+
+uint16_t sim_battery_mv() {
+    const int32_t mv = (int32_t)sim_battery_rest_mv() - (int32_t)pumps_running() * sim_world()->sag_mv;
+    return (uint16_t)((mv > 0) ? mv : 0);
+}
+
+static bool reservoir_limited() {
+    return sim_world()->reservoir_ul >= 0.0;
+}
+
+// One step with constant drift and pump states
+static void step_plant(const SimTraceSegment &seg, uint64_t step_us) {
+    SimWorld &w = *sim_world();
+    const double dt = (double)step_us / 1e6;
+    const double k = raw_per_ul();
+    const double flow = (double)PUMP_FLOW_UL_PER_S * sim_battery_mv() / PUMP_FLOW_REF_MV * w.flow_scale;
+    const double soaked = 1.0 - exp(-dt / w.soak_s);
+    const double dry_limit = (double)SENSOR_RAW_MAX - 2.0 * w.noise_raw - 1.0;
+
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        if (w.pump_mask & (1u << ch)) {
+            double ul = flow * dt;
+            if (reservoir_limited()) {
+                ul = (ul < w.reservoir_ul) ? ul : w.reservoir_ul;
+                w.reservoir_ul -= ul;
+                if (w.reservoir_ul <= 0.0 && w.reservoir_empty_us == 0) {
+                    w.reservoir_empty_us = w.now_us;
+                }
+            }
+            w.surface_ul[ch] += ul;
+            w.pumped_ul += ul;
+            w.pump_us += step_us;
+        }
+
+        const double absorbed = w.surface_ul[ch] * soaked;
+        w.surface_ul[ch] -= absorbed;
+        double raw = w.soil_raw[ch] - absorbed * k + seg.drift_per_s * dt;
+        if (raw < DEFAULT_SENSOR_WET) {
+            w.runoff_ul += (DEFAULT_SENSOR_WET - raw) / k;
+            raw = DEFAULT_SENSOR_WET;
+        }
+        w.soil_raw[ch] = (raw < dry_limit) ? raw : dry_limit;
+
+        if (w.dry_raw[ch] != 0 && w.soil_raw[ch] >= w.dry_raw[ch]) {
+            w.below_min_us[ch] += step_us;
+        }
+    }
+    w.now_us += step_us;
+}
+
+void sim_advance_us(uint64_t us) {
+    SimWorld &w = *sim_world();
+    while (us > 0) {
+        uint64_t left_us = 0;
+        const SimTraceSegment &seg = sim_trace_at(*s_trace, w.now_us, &left_us);
+        uint64_t step = (us < left_us) ? us : left_us;
+        if (step > SIM_MAX_STEP_US) {
+            step = SIM_MAX_STEP_US;
+        }
+        step_plant(seg, step);
+        us -= step;
+
+        if (w.pump_mask != 0 && sim_battery_mv() < w.brownout_mv) {
+            // The 3.3 V rail drops out: the pumps stop with the reset
+            w.pump_mask = 0;
+            w.brownout = true;
+            w.brownouts++;
+            sim_end_wake(0);
+        }
+    }
+}
+
+uint64_t sim_uptime_us() {
+    return sim_world()->now_us - sim_world()->wake_us;
+}
+
+// =============================================================================
+// PINS
+// =============================================================================
+
+static int32_t noise(uint16_t amplitude) {
+    SimWorld &w = *sim_world();
+    w.rng ^= w.rng << 13;
+    w.rng ^= w.rng >> 17;
+    w.rng ^= w.rng << 5;
+    return (amplitude == 0) ? 0 : (int32_t)(w.rng % (2U * amplitude + 1U)) - (int32_t)amplitude;
+}
+
+static uint16_t clamp_adc(double value) {
+    if (value < 0.0) return 0;
+    if (value > ADC_MAX_VALUE) return ADC_MAX_VALUE;
+    return (uint16_t)lround(value);
+}
+
+uint16_t sim_analog_read(uint8_t pin) {
+    SimWorld &w = *sim_world();
+    if (pin == PIN_BATTERY_ADC) {
+        const double at_pin = sim_battery_mv() / BATTERY_DIVIDER_RATIO;
+        return clamp_adc(at_pin * ADC_MAX_VALUE / SIM_ADC_REF_MV + noise(2));
+    }
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        if (pin == PLANT_CHANNELS[ch].soil_pin) {
+            return clamp_adc(w.soil_raw[ch] + noise(w.noise_raw));
+        }
+    }
+    return 0;
+}
+
+int sim_digital_read(uint8_t pin) {
+    SimWorld &w = *sim_world();
+    if (pin == PIN_WATER_LEVEL) {
+        // Float switch closes (LOW) once the reservoir is empty
+        return (!reservoir_limited() || w.reservoir_ul > 0.0) ? HIGH : LOW;
+    }
+    return HIGH;   // buttons released, pull-ups
+}
+
+void sim_digital_write(uint8_t pin, uint8_t level) {
+    SimWorld &w = *sim_world();
+    for (uint8_t ch = 0; ch < PLANT_CHANNEL_COUNT; ++ch) {
+        if (pin == PLANT_CHANNELS[ch].pump_pin) {
+            if (level == HIGH) {
+                w.pump_mask |= (uint8_t)(1u << ch);
+                w.wake_pumped = true;
+            } else {
+                w.pump_mask &= (uint8_t)~(1u << ch);
+            }
+        }
+    }
+}
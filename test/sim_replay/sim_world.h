@@ -0,0 +1,132 @@
+/**
+ * sim_world.h - Simulated board and plant of the replay harness
+ *
+ * Everything that outlives a simulated wake sits in one block of shared
+ * memory: the RTC memory image, NVS, the flash partition, the clock, the
+ * plant and the running totals. Each wake runs in a forked process, a
+ * fresh copy of the firmware's RAM as after a real deep sleep; the HAL
+ * shims in hal/ read and drive this world.
+ *
+ * Plant model, per channel and in sensor raw units (higher = drier):
+ *   - raw follows the drift of the trace segment the clock is in, asleep
+ *     and awake (replayed drying, sim_trace.h)
+ *   - pumped water collects on the surface and soaks in with time
+ *     constant soak_s; each uL lowers raw by (dry - wet) / pot_ul of the
+ *     default calibration
+ *   - the soil cannot get wetter than the wet calibration, the excess is
+ *     counted as runoff
+ * Flow scales with the loaded battery voltage like pump_volume_ms()
+ * assumes (times flow_scale); each running pump sags the battery by
+ * sag_mv, and a loaded voltage below brownout_mv resets the board.
+ */
+
+#ifndef SIM_WORLD_H
+#define SIM_WORLD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+#include "sim_trace.h"
+
+#define SIM_NVS_ENTRIES     96
+#define SIM_NVS_KEY_LEN     40       // "<namespace>/<key>"
+#define SIM_NVS_VALUE_LEN   160
+#define SIM_FLASH_BYTES     (32U * 4096U)
+#define SIM_RTC_BYTES       (16U * 1024U)
+#define SIM_MAX_STEP_US     (60ULL * 1000000ULL)   // Integration step while asleep
+
+typedef struct {
+    char     key[SIM_NVS_KEY_LEN];   // "" = free
+    uint16_t len;
+    uint8_t  value[SIM_NVS_VALUE_LEN];
+} SimNvsEntry;
+
+typedef struct {
+    // Options, set by sim_main before the first wake
+    double   pot_ul;
+    double   soak_s;
+    double   flow_scale;
+    double   reservoir_ul;            // < 0 = unlimited
+    uint16_t sag_mv;
+    uint16_t brownout_mv;
+    uint16_t noise_raw;
+    uint32_t boot_us;                 // ROM + image load before setup()
+    uint32_t sleep_ua;                // deep sleep current
+
+    // Board
+    uint64_t now_us;                  // RTC timer, since the simulated power-on
+    uint64_t wake_us;                 // now_us when the running wake started
+    uint64_t timer_wakeup_us;         // last esp_sleep_enable_timer_wakeup()
+    uint64_t sleep_us;                // deep sleep requested by the finished wake
+    uint8_t  reset_reason;            // esp_reset_reason_t of the running wake
+    uint8_t  wake_cause;              // esp_sleep_wakeup_cause_t
+    uint8_t  pump_mask;
+    bool     brownout;                // the running wake ended in a brown-out
+    uint32_t rng;
+
+    // Plant
+    double   soil_raw[PLANT_CHANNEL_COUNT];
+    double   surface_ul[PLANT_CHANNEL_COUNT];
+    uint16_t dry_raw[PLANT_CHANNEL_COUNT];   // raw from which humidity is below minimal, 0 = unknown
+
+    // Totals
+    uint32_t wakes;
+    uint32_t watering_wakes;
+    uint32_t brownouts;
+    double   pumped_ul;
+    double   runoff_ul;
+    uint64_t pump_us;                 // summed over pumps
+    uint64_t awake_us;
+    double   charge_ua_us;            // awake (profiler estimate) + deep sleep
+    double   energy_uw_us;            // charge times the battery voltage
+    uint64_t below_min_us[PLANT_CHANNEL_COUNT];
+    uint64_t reservoir_empty_us;      // 0 = never ran dry
+    bool     wake_pumped;             // a pump ran during the running wake
+} SimWorld;
+
+// =============================================================================
+// SHARED STATE
+// =============================================================================
+
+/** Map the shared block (once, before the first fork). */
+bool sim_world_create(const SimTrace *trace);
+
+SimWorld *sim_world();
+SimNvsEntry *sim_nvs();
+uint8_t *sim_flash();
+
+/** Copy this process's RTC section to the shared image, and back. */
+void sim_rtc_save();
+void sim_rtc_restore();
+
+// =============================================================================
+// TIME AND PLANT
+// =============================================================================
+
+/** Advance the clock, integrating the plant, pumps and reservoir. */
+void sim_advance_us(uint64_t us);
+
+/** Microseconds since the running wake started. */
+uint64_t sim_uptime_us();
+
+/** Battery voltage now, under the load of the running pumps. */
+uint16_t sim_battery_mv();
+
+/** Rest voltage of the trace segment the clock is in. */
+uint16_t sim_battery_rest_mv();
+
+uint16_t sim_analog_read(uint8_t pin);
+int sim_digital_read(uint8_t pin);
+void sim_digital_write(uint8_t pin, uint8_t level);
+
+// =============================================================================
+// WAKE END (sim_main.cpp)
+// =============================================================================
+
+/**
+ * Close the running wake: totals, RTC image, exit the wake process.
+ * Called by esp_deep_sleep_start() and on a brown-out.
+ */
+[[noreturn]] void sim_end_wake(uint64_t sleep_us);
+
+#endif // SIM_WORLD_H